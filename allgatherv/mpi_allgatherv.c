@@ -13,10 +13,17 @@
 #include "pattern.h"
 #include "execinfo.h"
 #include "timings.h"
+#include "timer.h"
+#include "clock_sync.h"
+#include "timestamps.h"
 #include "backtrace.h"
 #include "location.h"
 #include "buff_content.h"
 #include "datatype.h"
+#include "capture.h"
+#include "sampling.h"
+#include "profiling_control.h"
+#include "region.h"
 
 static SRCountNode_t *counts_head = NULL;
 static SRDisplNode_t *displs_head = NULL;
@@ -33,10 +40,11 @@ static int world_rank = -1;
 static uint64_t allgathervCalls = 0;       // Total number of allgatherv calls that we went through (indexed on 0, not 1)
 static uint64_t allgathervCallsLogged = 0; // Total number of allgatherv calls for which we gathered data
 static uint64_t allgathervCallStart = -1;  // Number of allgatherv call during which we started to gather data
-static uint64_t dump_call_data = -1;
 
 static uint64_t _num_call_start_profiling = ALLGATHERV_NUM_CALL_START_PROFILING;
 static uint64_t _limit_av_calls = DEFAULT_LIMIT_ALLGATHERV_CALLS;
+static int _commit_data_at_call = -1;                // Call after which the data is committed, -1 if not requested
+static bool _release_resources_after_commit = false; // Release the resources after each call, once the data is committed
 
 #if ENABLE_LATE_ARRIVAL_TIMING
 static int _inject_delay = 0;
@@ -44,6 +52,7 @@ static int _inject_delay = 0;
 
 static int do_send_buffs = 0; // Specify that the focus is on send buffers rather than recv buffers
 static int max_call = -1;     // Specify when to stop when checking content of buffers
+static int min_call = 0;      // Specify when to start when checking content of buffers
 
 // Buffers used to store data through all allgatherv calls
 int *sbuf = NULL;
@@ -63,12 +72,6 @@ static int _trampoline_flag = 0;
 static int _trampoline_iterations = 0;
 #endif  /* defined(HAVE_MPIX_HARMONIZE) */
 
-#if ENABLE_EXEC_TIMING
-double timestamps_start[500];
-double timestamps_end[500];
-size_t num_timestamps = 0;
-#endif // ENABLE_EXEC_TIMING
-
 /* FORTRAN BINDINGS */
 extern int mpi_fortran_in_place_;
 #define OMPI_IS_FORTRAN_IN_PLACE(addr) \
@@ -89,52 +92,46 @@ static int *lookupRankRecvDispls(SRDisplNode_t *call_data, int rank)
     return lookup_rank_displs(call_data->recv_data_size, call_data->recv_data, rank);
 }
 
-static int *lookupRankSendCounters(SRCountNode_t *call_data, int rank)
+static counts_data_t *lookupRankSendCounters(SRCountNode_t *call_data, int rank)
 {
-    return lookup_rank_counters(call_data->send_data_size, call_data->send_data, rank);
+    return lookup_rank_counts_data(call_data->send_data_size, call_data->send_data, rank);
 }
 
-static int *lookupRankRecvCounters(SRCountNode_t *call_data, int rank)
+static counts_data_t *lookupRankRecvCounters(SRCountNode_t *call_data, int rank)
 {
-    return lookup_rank_counters(call_data->recv_data_size, call_data->recv_data, rank);
+    return lookup_rank_counts_data(call_data->recv_data_size, call_data->recv_data, rank);
 }
 
 // Compare if two arrays are identical.
 static bool same_call_counters(SRCountNode_t *call_data, int *send_counts, int *recv_counts, int size)
 {
-    int num = 0;
-    int rank, count_num;
+    int rank;
 
     DEBUG_ALLGATHERV_PROFILING("Comparing data with existing data...\n");
     DEBUG_ALLGATHERV_PROFILING("-> Comparing send counts...\n");
     // First compare the send counts, each rank has a single count
     for (rank = 0; rank < size; rank++)
     {
-        int *_counts = lookupRankSendCounters(call_data, rank);
+        counts_data_t *_counts = lookupRankSendCounters(call_data, rank);
         assert(_counts);
-        if (_counts[rank] != send_counts[num])
+        if (!counts_data_equal(_counts, &(send_counts[rank]), 1))
         {
             DEBUG_ALLGATHERV_PROFILING("Data differs\n");
             return false;
         }
-        num++;
     }
     DEBUG_ALLGATHERV_PROFILING("-> Send counts are the same\n");
 
     // Then the receive counts
     DEBUG_ALLGATHERV_PROFILING("-> Comparing recv counts...\n");
-    num = 0;
     for (rank = 0; rank < size; rank++)
     {
-        int *_counts = lookupRankRecvCounters(call_data, rank);
-        for (count_num = 0; count_num < size; count_num++)
+        counts_data_t *_counts = lookupRankRecvCounters(call_data, rank);
+        assert(_counts);
+        if (!counts_data_equal(_counts, &(recv_counts[rank * size]), size))
         {
-            if (_counts[count_num] != recv_counts[num])
-            {
-                DEBUG_ALLGATHERV_PROFILING("Data differs\n");
-                return false;
-            }
-            num++;
+            DEBUG_ALLGATHERV_PROFILING("Data differs\n");
+            return false;
         }
     }
 
@@ -174,18 +171,10 @@ static bool same_call_displs(SRDisplNode_t *call_data, int *displs, int size)
 
 static counts_data_t *lookupCounters(int size, int num, counts_data_t **list, int *count)
 {
-    int i, j;
+    int i;
     for (i = 0; i < num; i++)
     {
-        for (j = 0; j < size; j++)
-        {
-            if (count[j] != list[i]->counters[j])
-            {
-                break;
-            }
-        }
-
-        if (j == size)
+        if (counts_data_equal(list[i], count, size))
         {
             return list[i];
         }
@@ -428,31 +417,41 @@ static void delete_counter_data(counts_data_t **data)
         {
             free((*data)->ranks);
         }
-        if ((*data)->counters)
+        counts_data_free_series(*data);
+        free(*data);
+        *data = NULL;
+    }
+}
+
+#if ENABLE_DISPLS
+static void delete_displ_data(displs_data_t **data)
+{
+    if (*data)
+    {
+        if ((*data)->ranks)
         {
-            free((*data)->counters);
+            free((*data)->ranks);
+        }
+        if ((*data)->displs)
+        {
+            free((*data)->displs);
         }
         free(*data);
         *data = NULL;
     }
 }
+#endif // ENABLE_DISPLS
 
 static counts_data_t *new_counter_data(int size, int rank, int *counts)
 {
-    int i;
     counts_data_t *new_data = (counts_data_t *)malloc(sizeof(counts_data_t));
     assert(new_data);
-    new_data->counters = (int *)malloc(size * sizeof(int));
-    assert(new_data->counters);
+    counts_data_set_counts(new_data, counts, size);
     new_data->num_ranks = 0;
     new_data->max_ranks = MAX_TRACKED_RANKS;
     new_data->ranks = (int *)malloc(new_data->max_ranks * sizeof(int));
     assert(new_data->ranks);
 
-    for (i = 0; i < size; i++)
-    {
-        new_data->counters[i] = counts[i];
-    }
     new_data->ranks[new_data->num_ranks] = rank;
     new_data->num_ranks++;
 
@@ -707,11 +706,14 @@ static int insert_displ_data(int *rbuf, int size, int sendtype_size, int recvtyp
 
 // Compare new send count data with existing data.
 // If there is a match, increase the counter. Add new data, otherwise.
+// When quantization is enabled (see counts_data.h), counts are quantized in place before
+// being compared, after accounting for the exact amount of data that is exchanged.
 static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendtype_size, int recvtype_size)
 {
     int num = 0;
     struct SRCountNode *newNode = NULL;
     struct SRCountNode *temp;
+    uint64_t send_bytes, recv_bytes;
 
     DEBUG_ALLGATHERV_PROFILING("Insert data for a new allgatherv call...\n");
 
@@ -719,6 +721,12 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
     assert(rbuf);
     assert(logger);
 
+    // The send count of a rank is sent to every rank of the communicator
+    send_bytes = counts_total(sbuf, size) * size * sendtype_size;
+    recv_bytes = counts_total(rbuf, size * size) * recvtype_size;
+    counts_quantize(sbuf, size);
+    counts_quantize(rbuf, size * size);
+
     temp = counts_head;
     while (temp != NULL)
     {
@@ -746,6 +754,8 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
             }
             temp->list_calls[temp->count] = allgathervCalls; // Note: count starts at 1, not 0
             temp->count++;
+            temp->send_bytes += send_bytes;
+            temp->recv_bytes += recv_bytes;
 #if DEBUG
             fprintf(logger->f, "old data: %d --> %d --- %d\n", size, temp->size, temp->count);
 #endif
@@ -774,6 +784,11 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
     newNode->recv_data = (counts_data_t **)malloc(size * sizeof(counts_data_t));
     assert(newNode->recv_data);
     newNode->recv_data_size = 0;
+    newNode->send_structure = NULL;
+    newNode->recv_structure = NULL;
+    newNode->send_bytes = send_bytes;
+    newNode->recv_bytes = recv_bytes;
+    newNode->cluster = -1;
 
     // We add rank's data one by one so we can compress the data when possible
     num = 0;
@@ -839,6 +854,18 @@ int _mpi_init(int *argc, char ***argv)
         _limit_av_calls = atoi(limit_a2a_calls);
     }
 
+    char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
+    if (need_data_commit_str != NULL)
+    {
+        _commit_data_at_call = atoi(need_data_commit_str);
+    }
+
+    char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
+    if (need_to_free_data != NULL && strncmp(need_to_free_data, "0", 1) != 0)
+    {
+        _release_resources_after_commit = true;
+    }
+
     ret = PMPI_Init(argc, argv);
 
     PMPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
@@ -866,6 +893,7 @@ int _mpi_init(int *argc, char ***argv)
 #if ENABLE_EXEC_TIMING
     op_exec_times = (double *)malloc(world_size * sizeof(double));
     assert(op_exec_times);
+    timestamps_init("allgatherv", world_rank);
 #endif // ENABLE_EXEC_TIMING
 #if ENABLE_LATE_ARRIVAL_TIMING
     late_arrival_timings = (double *)malloc(world_size * sizeof(double));
@@ -893,9 +921,43 @@ int _mpi_init(int *argc, char ***argv)
         max_call = atoi(max_call_num_envvar);
     }
 
-    char *dump_call_data_envvar = getenv("DUMP_CALL_DATA");
-    if (dump_call_data_envvar != NULL)
-        dump_call_data = atoi(dump_call_data_envvar);
+    char *min_call_num_envvar = getenv(COLLECTIVE_PROFILER_MIN_CALL_CHECK_BUFF_CONTENT_ENVVAR);
+    if (min_call_num_envvar != NULL)
+    {
+        min_call = atoi(min_call_num_envvar);
+    }
+
+    int capture_rc = capture_init("allgatherv", world_rank);
+    if (capture_rc)
+    {
+        fprintf(stderr, "capture_init() failed: %d\n", capture_rc);
+    }
+
+    int sampling_rc = sampling_init();
+    if (sampling_rc)
+    {
+        fprintf(stderr, "sampling_init() failed: %d\n", sampling_rc);
+    }
+
+    int control_rc = profiling_control_init(world_rank);
+    if (control_rc)
+    {
+        fprintf(stderr, "profiling_control_init() failed: %d\n", control_rc);
+    }
+
+#if ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+    timer_init();
+#endif // ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+
+#if ENABLE_CLOCK_SYNC
+    // Estimate the offset and drift of the clocks once so timestamps can be compared between ranks
+    int clock_sync_rc = clock_sync_init(MPI_COMM_WORLD);
+    if (clock_sync_rc)
+    {
+        fprintf(stderr, "clock_sync_init() failed: %d\n", clock_sync_rc);
+        PMPI_Abort(MPI_COMM_WORLD, 1);
+    }
+#endif // ENABLE_CLOCK_SYNC
 
     // Make sure we do not create an articial imbalance between ranks.
     PMPI_Barrier(MPI_COMM_WORLD);
@@ -918,6 +980,18 @@ int _mpi_init_thread(int *argc, char ***argv, int required, int *provided)
         _limit_av_calls = atoi(limit_a2a_calls);
     }
 
+    char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
+    if (need_data_commit_str != NULL)
+    {
+        _commit_data_at_call = atoi(need_data_commit_str);
+    }
+
+    char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
+    if (need_to_free_data != NULL && strncmp(need_to_free_data, "0", 1) != 0)
+    {
+        _release_resources_after_commit = true;
+    }
+
     ret = PMPI_Init_thread(argc, argv, required, provided);
 
     PMPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
@@ -945,6 +1019,7 @@ int _mpi_init_thread(int *argc, char ***argv, int required, int *provided)
 #if ENABLE_EXEC_TIMING
     op_exec_times = (double *)malloc(world_size * sizeof(double));
     assert(op_exec_times);
+    timestamps_init("allgatherv", world_rank);
 #endif // ENABLE_EXEC_TIMING
 #if ENABLE_LATE_ARRIVAL_TIMING
     late_arrival_timings = (double *)malloc(world_size * sizeof(double));
@@ -972,9 +1047,43 @@ int _mpi_init_thread(int *argc, char ***argv, int required, int *provided)
         max_call = atoi(max_call_num_envvar);
     }
 
-    char *dump_call_data_envvar = getenv("DUMP_CALL_DATA");
-    if (dump_call_data_envvar != NULL)
-        dump_call_data = atoi(dump_call_data_envvar);
+    char *min_call_num_envvar = getenv(COLLECTIVE_PROFILER_MIN_CALL_CHECK_BUFF_CONTENT_ENVVAR);
+    if (min_call_num_envvar != NULL)
+    {
+        min_call = atoi(min_call_num_envvar);
+    }
+
+    int capture_rc = capture_init("allgatherv", world_rank);
+    if (capture_rc)
+    {
+        fprintf(stderr, "capture_init() failed: %d\n", capture_rc);
+    }
+
+    int sampling_rc = sampling_init();
+    if (sampling_rc)
+    {
+        fprintf(stderr, "sampling_init() failed: %d\n", sampling_rc);
+    }
+
+    int control_rc = profiling_control_init(world_rank);
+    if (control_rc)
+    {
+        fprintf(stderr, "profiling_control_init() failed: %d\n", control_rc);
+    }
+
+#if ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+    timer_init();
+#endif // ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+
+#if ENABLE_CLOCK_SYNC
+    // Estimate the offset and drift of the clocks once so timestamps can be compared between ranks
+    int clock_sync_rc = clock_sync_init(MPI_COMM_WORLD);
+    if (clock_sync_rc)
+    {
+        fprintf(stderr, "clock_sync_init() failed: %d\n", clock_sync_rc);
+        PMPI_Abort(MPI_COMM_WORLD, 1);
+    }
+#endif // ENABLE_CLOCK_SYNC
 
     // Make sure we do not create an articial imbalance between ranks.
     PMPI_Barrier(MPI_COMM_WORLD);
@@ -1053,12 +1162,12 @@ static int _release_displs_resources()
 
         for (i = 0; i < displs_head->send_data_size; i++)
         {
-            delete_counter_data(&(displs_head->send_data[i]));
+            delete_displ_data(&(displs_head->send_data[i]));
         }
 
         for (i = 0; i < displs_head->recv_data_size; i++)
         {
-            delete_counter_data(&(displs_head->recv_data[i]));
+            delete_displ_data(&(displs_head->recv_data[i]));
         }
 
         free(displs_head->recv_data);
@@ -1174,15 +1283,37 @@ static int _release_profiling_resources()
 
 static int _finalize_profiling()
 {
+    profiling_control_fini();
+    clock_sync_fini();
+    sampling_fini();
+    region_fini();
+    capture_fini();
+#if ENABLE_EXEC_TIMING
+    timestamps_fini();
+#endif // ENABLE_EXEC_TIMING
     logger_fini(&logger);
     _release_profiling_resources();
     return 0;
 }
 
+static void save_regions(int world_rank)
+{
+    char *filename = allgatherv_get_full_filename(MAIN_CTX, "regions_allgatherv", logger->jobid, world_rank);
+    FILE *fh = fopen(filename, "w");
+    assert(fh);
+    region_write(fh, "allgatherv");
+    fclose(fh);
+    free(filename);
+}
+
 static int _commit_data()
 {
     log_profiling_data(logger, allgathervCalls, allgathervCallStart, allgathervCallsLogged, counts_head, displs_head, op_timing_exec_head);
 
+    // Statistics per region are only saved when the application annotates its regions
+    if (region_count() > 1 && allgathervCallsLogged > 0)
+        save_regions(world_rank);
+
 /*
 #if ENABLE_TIMING
     //log_timing_data(logger, op_timing_exec_head);
@@ -1191,33 +1322,10 @@ static int _commit_data()
 
 #if ENABLE_EXEC_TIMING
     /* Save start & end timestamps */
-    if (num_timestamps > 0)
+    int timestamps_rc = timestamps_flush();
+    if (timestamps_rc)
     {
-        int ret, rc;
-        size_t i;
-        char *filename = NULL;
-        char *output_dir = NULL;
-
-        output_dir = get_output_dir();
-        if (output_dir)
-        {
-            _asprintf(filename, rc, "%s/timestamps.rank%d.md", output_dir, world_rank);
-        }
-        else
-        {
-            _asprintf(filename, rc, "timestamps.rank%d.md", world_rank);
-        }
-        assert(rc > 0);
-
-        FILE *f = fopen(filename, "w");
-        assert(f);
-
-        for (i = 0; i < num_timestamps; i++)
-        {
-            fprintf(f, "%lf %lf\n", timestamps_start[i], timestamps_end[i]);
-        }
-        fclose(f);
-        num_timestamps = 0;
+        fprintf(stderr, "timestamps_flush() failed: %d\n", timestamps_rc);
     }
 #endif // ENABLE_EXEC_TIMING
 
@@ -1289,44 +1397,6 @@ static void save_counts(int *sendcount, int *recvcounts, int s_datatype_size, in
 }
 #endif // ((ENABLE_RAW_DATA || ENABLE_PER_RANK_STATS || ENABLE_VALIDATION) && !ENABLE_COMPACT_FORMAT)
 
-static inline void
-allgatherv_save_buf_content(void *buf, const int count, MPI_Datatype type, MPI_Comm comm, int rank, char *ctxt)
-{
-    char *filename = NULL;
-    char *output_dir = NULL;
-    int rc;
-
-    assert(buf);
-    assert(ctxt);
-
-    output_dir = get_output_dir();
-    if (output_dir != NULL)
-    {
-        _asprintf(filename, rc, "%s/data_%s_rank%d.txt", output_dir, ctxt, rank);
-        assert(rc > 0);
-    }
-    else
-    {
-        _asprintf(filename, rc, "data_%s_rank%d.txt", ctxt, rank);
-        assert(rc > 0);
-    }
-
-    FILE *f = fopen(filename, "w");
-    assert(f);
-
-    // We assume the data is contiguous and that the type is of a type compatible with a C double
-    double *ptr = (double *)buf;
-    int j;
-    for (j = 0; j < count; j++)
-    {
-        fprintf(f, "%f ", ptr[j]);
-    }
-    fprintf(f, "\n");
-
-    fclose(f);
-    free(filename);
-}
-
 int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendtype,
                     void *recvbuf, const int *recvcounts, const int *rdispls, MPI_Datatype recvtype,
                     MPI_Comm comm)
@@ -1334,6 +1404,7 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
     int comm_size;
     int ret;
     bool need_profile = true;
+    sampling_state_t *sampling = NULL;
     int my_comm_rank;
     char *collective_name = "allgatherv";
 
@@ -1366,6 +1437,12 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
         {
             need_profile = false;
         }
+        else if (sampling_enabled())
+        {
+            // Unsampled calls are not profiled at all, they only decrement the countdown of the communicator
+            sampling = sampling_lookup(comm);
+            need_profile = !sampling_skip_call(sampling);
+        }
     }
 
     if (need_profile)
@@ -1375,7 +1452,8 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
             allgathervCallStart = allgathervCalls;
         }
 
-        if (dump_call_data == allgathervCalls)
+        bool capture_call = capture_call_selected(allgathervCalls);
+        if (capture_call)
         {
             // Save datatypes information
             if (my_comm_rank == 0)
@@ -1401,13 +1479,15 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
                 }
             }
 
-            int rc = store_call_data_single_count(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)sendbuf, sendcount, sendtype);
-            if (rc)
+            // The data is written in the background while the application continues
+            if (sendbuf != MPI_IN_PLACE)
             {
-                fprintf(stderr, "store_call_data_single_count() failed on l.%d: %d\n", __LINE__, rc);
-                MPI_Abort(MPI_COMM_WORLD, 11);
+                int rc = capture_call_data(SEND_CONTEXT_ID, comm, my_comm_rank, allgathervCalls, sendbuf, &sendcount, NULL, 1, sendtype);
+                if (rc)
+                {
+                    fprintf(stderr, "capture_call_data() failed on l.%d: %d\n", __LINE__, rc);
+                }
             }
-            allgatherv_save_buf_content((void *)sendbuf, sendcount, sendtype, comm, world_rank, "send");
         }
 
 #if ENABLE_LATE_ARRIVAL_TIMING
@@ -1415,44 +1495,32 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
         {
             sleep(1);
         }
-        double t_barrier_start = MPI_Wtime();
+        double t_barrier_start = timer_wtime();
         PMPI_Barrier(comm);
-        double t_barrier_end = MPI_Wtime();
+        double t_barrier_end = timer_wtime();
 #endif // ENABLE_LATE_ARRIVAL_TIMING
 
 #if ENABLE_EXEC_TIMING
-        double t_start = MPI_Wtime();
-        if (num_timestamps < 500)
-        {
-            timestamps_start[num_timestamps] = t_start;
-        }
+        // Timestamps are saved so they are corrected to the reference clock to be comparable between ranks
+        double t_start = clock_sync_wtime();
 #endif // ENABLE_EXEC_TIMING
 
+        double t_call_start = timer_wtime();
         ret = PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+        double t_call = timer_wtime() - t_call_start;
 
-        if (dump_call_data == allgathervCalls)
+        if (capture_call)
         {
-            int rc = store_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype);
+            int rc = capture_call_data(RECV_CONTEXT_ID, comm, my_comm_rank, allgathervCalls, recvbuf, recvcounts, rdispls, comm_size, recvtype);
             if (rc)
             {
-                fprintf(stderr, "store_call_data() failed on l.%d: %d\n", __LINE__, rc);
-                MPI_Abort(MPI_COMM_WORLD, 11);
+                fprintf(stderr, "capture_call_data() failed on l.%d: %d\n", __LINE__, rc);
             }
-            save_buf_content(recvbuf, recvcounts, rdispls, recvtype, comm, world_rank, "recv");
-            release_buffcontent_loggers();
-            PMPI_Barrier(comm);
-            if (my_comm_rank == 0)
-                fprintf(stderr, "All data acquired, aborting...\n");
-            MPI_Abort(MPI_COMM_WORLD, 22);
         }
 
 #if ENABLE_EXEC_TIMING
-        double t_end = MPI_Wtime();
-        if (num_timestamps < 500)
-        {
-            timestamps_end[num_timestamps] = t_end;
-            num_timestamps++;
-        }
+        double t_end = clock_sync_wtime();
+        timestamps_add(allgathervCalls, t_start, t_end);
         double t_op = t_end - t_start;
 #endif // ENABLE_EXEC_TIMING
 
@@ -1494,6 +1562,8 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
 
         if (allgathervCalls == max_call)
         {
+            // Complete the files, including their index, before stopping
+            release_buffcontent_loggers();
             fprintf(stderr, "Reaching the limit, check successful\n");
             PMPI_Abort(MPI_COMM_WORLD, 32);
         }
@@ -1504,64 +1574,39 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
         {
             if (allgathervCalls == max_call)
             {
-                fprintf(stderr, "Reaching the analysis limit, check successful\n");
+                // Report the calls with different content, if any, before stopping
+                release_buffcontent_loggers();
+                fprintf(stderr, "Reaching the analysis limit, check complete\n");
                 PMPI_Abort(MPI_COMM_WORLD, 1);
             }
             if (my_comm_rank == 0)
             {
                 fprintf(stderr, "Checking call %" PRIu64 "\n", allgathervCalls);
             }
-            if (max_call == -1 || (max_call > -1 && allgathervCalls < max_call))
-            {
-                read_and_compare_call_data(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)sendbuf, (int *)sendcount, NULL, sendtype, true);
-            }
-            else
-            {
-                read_and_compare_call_data(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)sendbuf, (int *)sendcount, NULL, sendtype, false);
-            }
+            bool check = allgathervCalls >= min_call && (max_call == -1 || allgathervCalls < max_call);
+            read_and_compare_call_data_single_count(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)sendbuf, sendcount, sendtype, check);
         }
         else
         {
             if (allgathervCalls == max_call)
             {
-                fprintf(stderr, "Reaching the analysis limit, check successful\n");
+                // Report the calls with different content, if any, before stopping
+                release_buffcontent_loggers();
+                fprintf(stderr, "Reaching the analysis limit, check complete\n");
                 PMPI_Abort(MPI_COMM_WORLD, 1);
             }
-            if (max_call == -1 || (max_call > -1 && allgathervCalls < max_call))
-            {
-                read_and_compare_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype, true);
-            }
-            else
-            {
-                read_and_compare_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype, false);
-            }
+            bool check = allgathervCalls >= min_call && (max_call == -1 || allgathervCalls < max_call);
+            read_and_compare_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, allgathervCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype, check);
         }
 #endif // ENABLE_COMPARE_DATA_VALIDATION
 
 #if ENABLE_LOCATION_TRACKING
-        int my_pid = getpid();
-        // Note that the library will free all the allocated memory. We hand over the pointer
-        // and the profiler frees the memory when finalizing
-        int *pids = (int *)malloc(comm_size * sizeof(int));
-        assert(pids);
-        int *world_comm_ranks = (int *)malloc(comm_size * sizeof(int));
-        assert(world_comm_ranks);
-        char hostname[256];
-        gethostname(hostname, 256);
-        char *hostnames = (char *)malloc(256 * comm_size * sizeof(char));
-        assert(hostnames);
-
-        PMPI_Gather(&my_pid, 1, MPI_INT, pids, 1, MPI_INT, 0, comm);
-        PMPI_Gather(&world_rank, 1, MPI_INT, world_comm_ranks, 1, MPI_INT, 0, comm);
-        PMPI_Gather(&hostname, 256, MPI_CHAR, hostnames, 256, MPI_CHAR, 0, comm);
-        if (my_comm_rank == 0)
+        // Locations are gathered only the first time the communicator is used, all the ranks must call it
+        int rc = commit_rank_locations(collective_name, comm, comm_size, world_rank, my_comm_rank, allgathervCalls);
+        if (rc)
         {
-            int rc = commit_rank_locations(collective_name, comm, comm_size, world_rank, my_comm_rank, pids, world_comm_ranks, hostnames, allgathervCalls);
-            if (rc)
-            {
-                fprintf(stderr, "save_rank_locations() failed: %d", rc);
-                PMPI_Abort(MPI_COMM_WORLD, 1);
-            }
+            fprintf(stderr, "commit_rank_locations() failed: %d", rc);
+            PMPI_Abort(MPI_COMM_WORLD, 1);
         }
 #endif // ENABLE_LOCATION_TRACKING
 
@@ -1626,6 +1671,7 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
                 PMPI_Abort(MPI_COMM_WORLD, 1);
             }
 #endif // ENABLE_LATE_ARRIVAL_TIMING
+            region_add_call(region_current(), allgathervCalls, t_call);
             allgathervCallsLogged++;
         }
 
@@ -1633,6 +1679,15 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
         // All ranks sync so that if we have I/O happening for some ranks during the data commit, it would not skew the next timings
         PMPI_Barrier(comm);
 #endif // ENABLE_LATE_ARRIVAL_TIMING
+
+        if (sampling != NULL)
+        {
+            int sampling_rc = sampling_next(sampling, comm, NULL, recvcounts, comm_size);
+            if (sampling_rc)
+            {
+                fprintf(stderr, "sampling_next() failed: %d\n", sampling_rc);
+            }
+        }
     }
     else
     {
@@ -1646,19 +1701,12 @@ int _mpi_allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendt
     PMPI_Barrier(comm);
 #endif // SYNC
 
-    char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
-    char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
-
-    if (need_data_commit_str != NULL)
+    if (_commit_data_at_call != -1 && allgathervCalls == _commit_data_at_call)
     {
-        int targetCallID = atoi(need_data_commit_str);
-        if (allgathervCalls == targetCallID)
-        {
-            _commit_data();
-        }
+        _commit_data();
     }
 
-    if (need_to_free_data != NULL && strncmp(need_to_free_data, "0", 1) != 0)
+    if (_release_resources_after_commit)
     {
         _release_profiling_resources();
     }
@@ -1673,6 +1721,15 @@ int MPI_Allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendty
                    void *recvbuf, const int *recvcounts, const int *rdispls, MPI_Datatype recvtype,
                    MPI_Comm comm)
 {
+    if( 0 != profiling_control_update(comm) ) {
+        fprintf(stderr, "profiling_control_sync() failed\n");
+    }
+    /* When profiling is disabled, the library only forwards the calls. They are still counted
+     * so the call numbers always match the calls of the application. */
+    if( !profiling_enabled() ) {
+        allgathervCalls++;
+        return PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+    }
 #if defined(HAVE_MPIX_HARMONIZE)
     /* From time to time we need to resynchronize the clocks, but we can only do it on MPI_Allgatherv on
      * MPI_COMM_WORLD.
@@ -1687,9 +1744,30 @@ int MPI_Allgatherv(const void *sendbuf, const int sendcount, MPI_Datatype sendty
         }
     }
 #endif  /* defined(HAVE_MPIX_HARMONIZE) */
+#if ENABLE_CLOCK_SYNC
+    /* From time to time we resynchronize the clocks to follow their drift, on MPI_COMM_WORLD only */
+    if( MPI_SUCCESS != clock_sync_tick(comm) ) {
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+#endif // ENABLE_CLOCK_SYNC
     return _mpi_allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
 }
 
+// MPI_Pcontrol(0) disables profiling and any other level enables it. It must be called by all
+// the ranks at the same point of the application, like the collectives it controls.
+int MPI_Pcontrol(const int level, ...)
+{
+    profiling_control_pcontrol(level);
+    return PMPI_Pcontrol(level);
+}
+
+void mpi_pcontrol_(MPI_Fint *level, MPI_Fint *ierr)
+{
+    int c_ierr = MPI_Pcontrol(OMPI_FINT_2_INT(*level));
+    if (NULL != ierr)
+        *ierr = OMPI_INT_2_FINT(c_ierr);
+}
+
 void mpi_allgatherv_(void *sendbuf, MPI_Fint *sendcount, MPI_Fint *sendtype,
                      void *recvbuf, MPI_Fint *recvcount, MPI_Fint *rdispls, MPI_Fint *recvtype,
                      MPI_Fint *comm, MPI_Fint *ierr)
@@ -19,8 +19,14 @@
 #include "pattern.h"
 #include "execinfo.h"
 #include "timings.h"
+#include "timer.h"
+#include "clock_sync.h"
+#include "timestamps.h"
 #include "backtrace.h"
 #include "location.h"
+#include "sampling.h"
+#include "profiling_control.h"
+#include "region.h"
 
 static SRCountNode_t *counts_head = NULL;
 static SRDisplNode_t *displs_head = NULL;
@@ -42,6 +48,8 @@ static uint64_t avCallStart = -1;  // Number of alltoall call during which we st
 
 static uint64_t _num_call_start_profiling = NUM_CALL_START_PROFILING;
 static uint64_t _limit_av_calls = DEFAULT_LIMIT_ALLTOALL_CALLS;
+static int _commit_data_at_call = -1;			   // Call after which the data is committed, -1 if not requested
+static bool _release_resources_after_commit = false; // Release the resources after each call, once the data is committed
 
 // Buffers used to store data through all alltoall calls
 int *sbuf = NULL;
@@ -87,14 +95,14 @@ void print_trace(FILE *f)
 	fprintf(f, "stack trace for %s pid=%s\n", name_buf, pid_buf);
 }
 
-static int *lookupRankSendCounters(SRCountNode_t *call_data, int rank)
+static counts_data_t *lookupRankSendCounters(SRCountNode_t *call_data, int rank)
 {
-	return lookup_rank_counters(call_data->send_data_size, call_data->send_data, rank);  //TODO alltoallv coversion: send_data_size will =1 if it, where is that set?
+	return lookup_rank_counts_data(call_data->send_data_size, call_data->send_data, rank);  //TODO alltoallv coversion: send_data_size will =1 if it, where is that set?
 }
 
-static int *lookupRankRecvCounters(SRCountNode_t *call_data, int rank)
+static counts_data_t *lookupRankRecvCounters(SRCountNode_t *call_data, int rank)
 {
-	return lookup_rank_counters(call_data->recv_data_size, call_data->recv_data, rank); //TODO alltoallv coversion: send_data_size will =1?, where is that set?
+	return lookup_rank_counts_data(call_data->recv_data_size, call_data->recv_data, rank); //TODO alltoallv coversion: send_data_size will =1?, where is that set?
 }
 
 // Compare if two arrays are identical.
@@ -103,7 +111,7 @@ static bool same_call_counters(SRCountNode_t *call_data, int *send_counts, int *
 {
 	int num = 0;
 	int rank, count_num;
-	int *_counts;
+	counts_data_t *_counts;
 
 	DEBUG_ALLTOALL_PROFILING("Comparing data with existing data...\n");
 	DEBUG_ALLTOALL_PROFILING("-> Comparing send counts...\n");
@@ -114,7 +122,7 @@ static bool same_call_counters(SRCountNode_t *call_data, int *send_counts, int *
 		_counts = lookupRankSendCounters(call_data, rank);  // TODO conversion from alltoallv: return just the singe counter value for that rank
 		assert(_counts);
 		count_num = 0; //  conversion from alltoallv: no need to loop since only one value for the rank
-		if (_counts[count_num] != send_counts[num])
+		if (counts_data_get(_counts, count_num) != send_counts[num])
 		{
 			DEBUG_ALLTOALL_PROFILING("Data differs\n");
 			return false;
@@ -141,7 +149,7 @@ static bool same_call_counters(SRCountNode_t *call_data, int *send_counts, int *
 	{
 		_counts = lookupRankRecvCounters(call_data, rank);  // TODO conversion from alltoallv: return just the singe counter value for that rank
 		count_num = 0;  //  conversion from alltoallv: no need to loop since only one value for the rank
-		if (_counts[count_num] != recv_counts[num])
+		if (counts_data_get(_counts, count_num) != recv_counts[num])
 		{
 			DEBUG_ALLTOALL_PROFILING("Data differs\n");
 			return false;
@@ -162,24 +170,16 @@ static bool same_call_counters(SRCountNode_t *call_data, int *send_counts, int *
 	return true;
 }
 
-// called with lookupCounters(call_data->size, call_data->send_data_size --> num, call_data->send_data, counts);
-// call_data is a SRCountNode_t and size is the comm size, send_data_size is "Size of the array of unique series of send counters", send_data is counts_data_t ** the just said array 
-// and counts is &(rbuf[num * size])
-// returns list[i] where count[j] != list[i]->counters[j], list[i] is the counts_data argument, which is call_data->send_data, which is NewNode->senddata and if j == size, i.e. if they match 
+// called with lookupCounters(1, call_data->send_data_size --> num, call_data->send_data, counts);
+// call_data is a SRCountNode_t and size is the number of counts per rank, i.e. 1, send_data_size is "Size of the array of unique series of send counters", send_data is counts_data_t ** the just said array 
+// and counts is &(rbuf[num])
+// returns list[i] when its counts match count, list[i] is the counts_data argument, which is call_data->send_data, which is NewNode->senddata
 static counts_data_t *lookupCounters(int size, int num, counts_data_t **list, int *count)
 {
-	int i, j;
+	int i;
 	for (i = 0; i < num; i++)  // i counts to num, so this is a loop over counts_data ** send_data
 	{
-		for (j = 0; j < size; j++)  // and this is a loop over ranks? (Size= communicator size)
-		{
-			if (count[j] != list[i]->counters[j])
-			{
-				break;
-			}
-		}
-
-		if (j == size)  // i.e. if j loop completed without a difference being found by the if
+		if (counts_data_equal(list[i], count, size))
 		{
 			return list[i];
 		}
@@ -350,12 +350,12 @@ static int commit_pattern_from_counts(int callID, int *send_counts, int *recv_co
 
 static counts_data_t *lookupSendCounters(int *counts, SRCountNode_t *call_data)
 {
-	return lookupCounters(call_data->size, call_data->send_data_size, call_data->send_data, counts);
+	return lookupCounters(1, call_data->send_data_size, call_data->send_data, counts); // only one count per rank for alltoall
 }
 
 static counts_data_t *lookupRecvCounters(int *counts, SRCountNode_t *call_data)
 {
-	return lookupCounters(call_data->size, call_data->recv_data_size, call_data->recv_data, counts);
+	return lookupCounters(1, call_data->recv_data_size, call_data->recv_data, counts); // only one count per rank for alltoall
 }
 
 static int add_rank_to_counters_data(int rank, counts_data_t *counters_data)  // TODO - DONE no alltoall mods here - adding rank records not counts.
@@ -380,10 +380,7 @@ static void delete_counter_data(counts_data_t **data)
 		{
 			free((*data)->ranks);
 		}
-		if ((*data)->counters)
-		{
-			free((*data)->counters);
-		}
+		counts_data_free_series(*data);
 		free(*data);
 		*data = NULL;
 	}
@@ -391,18 +388,14 @@ static void delete_counter_data(counts_data_t **data)
 
 static counts_data_t *new_counter_data(int size, int rank, int *counts)
 {
-	int i;
 	counts_data_t *new_data = (counts_data_t *)malloc(sizeof(counts_data_t));
 	assert(new_data);
-	new_data->counters = (int *)malloc(sizeof(int)); // was malloc(size * sizeof(int)) for alltoallv but only one count per rank for alltoall
-	assert(new_data->counters);
+	counts_data_set_counts(new_data, counts, 1); // was size counts for alltoallv but only one count per rank for alltoall
 	new_data->num_ranks = 0;
 	new_data->max_ranks = MAX_TRACKED_RANKS;
 	new_data->ranks = (int *)malloc(new_data->max_ranks * sizeof(int));
 	assert(new_data->ranks);
 
-    // alltoall mod here is to write only one count (so loop removed cf alltoallv) 
-	new_data->counters[0] = counts[0];
 
 	new_data->ranks[new_data->num_ranks] = rank;
 	new_data->num_ranks++;
@@ -490,6 +483,7 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 	int i, j, num = 0;
 	struct SRCountNode *newNode = NULL;
 	struct SRCountNode *temp;
+	uint64_t send_bytes, recv_bytes;
 
 	DEBUG_ALLTOALL_PROFILING("Insert data for a new alltoall call...\n");
 
@@ -497,6 +491,11 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 	assert(rbuf);
 	assert(logger);
 
+	// Every rank sends and receives its single count to and from every rank; counts are not
+	// quantized since there is a single count per rank
+	send_bytes = counts_total(sbuf, size) * size * sendtype_size;
+	recv_bytes = counts_total(rbuf, size) * size * recvtype_size;
+
 	temp = counts_head;
 	while (temp != NULL)
 	{
@@ -524,6 +523,8 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 			}
 			temp->list_calls[temp->count] = avCalls; // Note: count starts at 1, not 0
 			temp->count++;
+			temp->send_bytes += send_bytes;
+			temp->recv_bytes += recv_bytes;
 #if DEBUG
 			fprintf(logger->f, "old data: %d --> %d --- %d\n", size, temp->size, temp->count);
 #endif
@@ -552,6 +553,11 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 	newNode->recv_data = (counts_data_t **)malloc(size * sizeof(counts_data_t));
 	assert(newNode->recv_data);
 	newNode->recv_data_size = 0;
+	newNode->send_structure = NULL;
+	newNode->recv_structure = NULL;
+	newNode->send_bytes = send_bytes;
+	newNode->recv_bytes = recv_bytes;
+	newNode->cluster = -1;
 
 	// We add rank's data one by one so we can compress the data when possible
 	num = 0;
@@ -799,6 +805,18 @@ int _mpi_init(int *argc, char ***argv)
 		_limit_av_calls = atoi(limit_a2a_calls);
 	}
 
+	char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
+	if (need_data_commit_str != NULL)
+	{
+		_commit_data_at_call = atoi(need_data_commit_str);
+	}
+
+	char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
+	if (need_to_free_data != NULL && strncmp(need_to_free_data, "0", 1) != 0)
+	{
+		_release_resources_after_commit = true;
+	}
+
 	ret = PMPI_Init(argc, argv);
 
 	MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
@@ -827,6 +845,7 @@ int _mpi_init(int *argc, char ***argv)
 #if ENABLE_EXEC_TIMING
 	op_exec_times = (double *)malloc(world_size * sizeof(double));
 	assert(op_exec_times);
+	timestamps_init("alltoall", world_rank);
 #endif // ENABLE_EXEC_TIMING
 #if ENABLE_LATE_ARRIVAL_TIMING
 	late_arrival_timings = (double *)malloc(world_size * sizeof(double));
@@ -837,6 +856,32 @@ int _mpi_init(int *argc, char ***argv)
 	srand((unsigned)getpid());
 #endif
 
+	int sampling_rc = sampling_init();
+	if (sampling_rc)
+	{
+		fprintf(stderr, "sampling_init() failed: %d\n", sampling_rc);
+	}
+
+	int control_rc = profiling_control_init(world_rank);
+	if (control_rc)
+	{
+		fprintf(stderr, "profiling_control_init() failed: %d\n", control_rc);
+	}
+
+#if ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+	timer_init();
+#endif // ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+
+#if ENABLE_CLOCK_SYNC
+	// Estimate the offset and drift of the clocks once so timestamps can be compared between ranks
+	int clock_sync_rc = clock_sync_init(MPI_COMM_WORLD);
+	if (clock_sync_rc)
+	{
+		fprintf(stderr, "clock_sync_init() failed: %d\n", clock_sync_rc);
+		PMPI_Abort(MPI_COMM_WORLD, 1);
+	}
+#endif // ENABLE_CLOCK_SYNC
+
 	// Make sure we do not create an articial imbalance between ranks.
 	MPI_Barrier(MPI_COMM_WORLD);
 
@@ -985,14 +1030,44 @@ static int _release_profiling_resources()
 
 static int _finalize_profiling()
 {
+	profiling_control_fini();
+	clock_sync_fini();
+	sampling_fini();
+	region_fini();
+#if ENABLE_EXEC_TIMING
+	timestamps_fini();
+#endif // ENABLE_EXEC_TIMING
 	logger_fini(&logger);
 	_release_profiling_resources();
 }
 
+static void save_regions(int world_rank)
+{
+	char *filename = alltoall_get_full_filename(MAIN_CTX, "regions_alltoall", logger->jobid, world_rank);
+	FILE *fh = fopen(filename, "w");
+	assert(fh);
+	region_write(fh, "alltoall");
+	fclose(fh);
+	free(filename);
+}
+
 static int _commit_data()
 {
 	log_profiling_data(logger, avCalls, avCallStart, avCallsLogged, counts_head, displs_head, op_timing_exec_head);
 
+	// Statistics per region are only saved when the application annotates its regions
+	if (region_count() > 1 && avCallsLogged > 0)
+		save_regions(world_rank);
+
+#if ENABLE_EXEC_TIMING
+	/* Save start & end timestamps */
+	int timestamps_rc = timestamps_flush();
+	if (timestamps_rc)
+	{
+		fprintf(stderr, "timestamps_flush() failed: %d\n", timestamps_rc);
+	}
+#endif // ENABLE_EXEC_TIMING
+
 	/*
 #if ENABLE_TIMING
 	log_timing_data(logger, op_timing_exec_head);
@@ -1073,6 +1148,7 @@ int _mpi_alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtyp
 	int localrank;
 	int ret;
 	bool need_profile = true;
+	sampling_state_t *sampling = NULL;
 	int my_comm_rank;
 	char *collective_name = "alltoall";
 
@@ -1105,6 +1181,12 @@ int _mpi_alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtyp
 		{
 			need_profile = false;
 		}
+		else if (sampling_enabled())
+		{
+			// Unsampled calls are not profiled at all, they only decrement the countdown of the communicator
+			sampling = sampling_lookup(comm);
+			need_profile = !sampling_skip_call(sampling);
+		}
 	}
 
 	if (need_profile)
@@ -1115,19 +1197,23 @@ int _mpi_alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtyp
 		}
 
 #if ENABLE_LATE_ARRIVAL_TIMING
-		double t_barrier_start = MPI_Wtime();
+		double t_barrier_start = timer_wtime();
 		PMPI_Barrier(comm);
-		double t_barrier_end = MPI_Wtime();
+		double t_barrier_end = timer_wtime();
 #endif // ENABLE_LATE_ARRIVAL_TIMING
 
 #if ENABLE_EXEC_TIMING
-		double t_start = MPI_Wtime();
+		// Timestamps are saved so they are corrected to the reference clock to be comparable between ranks
+		double t_start = clock_sync_wtime();
 #endif // ENABLE_EXEC_TIMING
         DEBUG_ALLTOALL_PROFILING("DEBUG sampler prog: send type value, %i\n", sendtype );
+		double t_call_start = timer_wtime();
 		ret = PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+		double t_call = timer_wtime() - t_call_start;
 
 #if ENABLE_EXEC_TIMING
-		double t_end = MPI_Wtime();
+		double t_end = clock_sync_wtime();
+		timestamps_add(avCalls, t_start, t_end);
 		double t_op = t_end - t_start;
 #endif // ENABLE_EXEC_TIMING
 
@@ -1172,27 +1258,12 @@ int _mpi_alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtyp
 #endif // ENABLE_LATE_ARRIVAL_TIMING
 
 #if ENABLE_LOCATION_TRACKING
-		int my_pid = getpid();
-		int *pids = (int *)malloc(comm_size * sizeof(int));
-		assert(pids);
-		int *world_comm_ranks = (int *)malloc(comm_size * sizeof(int));
-		assert(world_comm_ranks);
-		char hostname[256];
-		gethostname(hostname, 256);
-		char *hostnames = (char *)malloc(256 * comm_size * sizeof(char));
-		assert(hostnames);
-
-		MPI_Gather(&my_pid, 1, MPI_INT, pids, 1, MPI_INT, 0, comm);
-		MPI_Gather(&world_rank, 1, MPI_INT, world_comm_ranks, 1, MPI_INT, 0, comm);
-		MPI_Gather(&hostname, 256, MPI_CHAR, hostnames, 256, MPI_CHAR, 0, comm);
-		if (my_comm_rank == 0)
+		// Locations are gathered only the first time the communicator is used, all the ranks must call it
+		int rc = commit_rank_locations(collective_name, comm, comm_size, world_rank, my_comm_rank, avCalls);
+		if (rc)
 		{
-			int rc = commit_rank_locations(collective_name, comm, comm_size, world_rank, my_comm_rank, pids, world_comm_ranks, hostnames, avCalls);
-			if (rc)
-			{
-				fprintf(stderr, "save_rank_locations() failed: %d", rc);
-				MPI_Abort(MPI_COMM_WORLD, 1);
-			}
+			fprintf(stderr, "commit_rank_locations() failed: %d", rc);
+			MPI_Abort(MPI_COMM_WORLD, 1);
 		}
 #endif // ENABLE_LOCATION_TRACKING
 
@@ -1243,8 +1314,18 @@ int _mpi_alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtyp
 				MPI_Abort(MPI_COMM_WORLD, 1);
 			}
 #endif // ENABLE_LATE_ARRIVAL_TIMING
+			region_add_call(region_current(), avCalls, t_call);
 			avCallsLogged++;
 		} // end of: if (my_comm_rank == 0)
+
+		if (sampling != NULL)
+		{
+			int sampling_rc = sampling_next(sampling, comm, &sendcount, &recvcount, 1);
+			if (sampling_rc)
+			{
+				fprintf(stderr, "sampling_next() failed: %d\n", sampling_rc);
+			}
+		}
 	} // end of: if (need_profile)
 	else
 	{
@@ -1258,19 +1339,12 @@ int _mpi_alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtyp
 	MPI_Barrier(comm);
 #endif
 
-	char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
-	char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
-
-	if (need_data_commit_str != NULL)
+	if (_commit_data_at_call != -1 && avCalls == _commit_data_at_call)
 	{
-		int targetCallID = atoi(need_data_commit_str);
-		if (avCalls == targetCallID)
-		{
-			_commit_data();
-		}
+		_commit_data();
 	}
 
-	if (need_to_free_data != NULL && need_to_free_data != "0")
+	if (_release_resources_after_commit)
 	{
 		_release_profiling_resources();
 	}
@@ -1284,6 +1358,15 @@ int _mpi_alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtyp
 int MPI_Alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtype,
                   void *recvbuf, const int recvcount, MPI_Datatype recvtype, MPI_Comm comm)
 {
+    if( 0 != profiling_control_update(comm) ) {
+        fprintf(stderr, "profiling_control_sync() failed\n");
+    }
+    /* When profiling is disabled, the library only forwards the calls. They are still counted
+     * so the call numbers always match the calls of the application. */
+    if( !profiling_enabled() ) {
+        avCalls++;
+        return PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    }
 #if defined(HAVE_MPIX_HARMONIZE)
     /* From time to time we need to resynchronize the clocks, but we can only do it on MPI_Alltoall on
      * MPI_COMM_WORLD.
@@ -1298,9 +1381,30 @@ int MPI_Alltoall(const void *sendbuf, const int sendcount, MPI_Datatype sendtype
         }
     }
 #endif  /* defined(HAVE_MPIX_HARMONIZE) */
+#if ENABLE_CLOCK_SYNC
+    /* From time to time we resynchronize the clocks to follow their drift, on MPI_COMM_WORLD only */
+    if( MPI_SUCCESS != clock_sync_tick(comm) ) {
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+#endif // ENABLE_CLOCK_SYNC
     return _mpi_alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
 }
 
+// MPI_Pcontrol(0) disables profiling and any other level enables it. It must be called by all
+// the ranks at the same point of the application, like the collectives it controls.
+int MPI_Pcontrol(const int level, ...)
+{
+	profiling_control_pcontrol(level);
+	return PMPI_Pcontrol(level);
+}
+
+void mpi_pcontrol_(MPI_Fint *level, MPI_Fint *ierr)
+{
+	int c_ierr = MPI_Pcontrol(OMPI_FINT_2_INT(*level));
+	if (NULL != ierr)
+		*ierr = OMPI_INT_2_FINT(c_ierr);
+}
+
 void mpi_alltoall_(void *sendbuf, MPI_Fint sendcount,  MPI_Fint *sendtype,
 					void *recvbuf, MPI_Fint recvcount,  MPI_Fint *recvtype,
 					MPI_Fint *comm, MPI_Fint *ierr)
@@ -13,10 +13,21 @@
 #include "pattern.h"
 #include "execinfo.h"
 #include "timings.h"
+#include "timer.h"
+#include "clock_sync.h"
+#include "timestamps.h"
 #include "backtrace.h"
 #include "location.h"
 #include "buff_content.h"
 #include "datatype.h"
+#include "capture.h"
+#include "similarity.h"
+#include "periodicity.h"
+#include "flight_recorder.h"
+#include "sampling.h"
+#include "runtime_features.h"
+#include "profiling_control.h"
+#include "region.h"
 
 static SRCountNode_t *counts_head = NULL;
 static SRDisplNode_t *displs_head = NULL;
@@ -33,16 +44,21 @@ static int world_rank = -1;
 static uint64_t avCalls = 0;	   // Total number of alltoallv calls that we went through (indexed on 0, not 1)
 static uint64_t avCallsLogged = 0; // Total number of alltoallv calls for which we gathered data
 static uint64_t avCallStart = -1;  // Number of alltoallv call during which we started to gather data
-static uint64_t dump_call_data = -1;
 // char myhostname[HOSTNAME_LEN];
 // char *hostnames = NULL; // Only used by rank0
 
 static uint64_t _num_call_start_profiling = NUM_CALL_START_PROFILING;
 static uint64_t _limit_av_calls = DEFAULT_LIMIT_ALLTOALLV_CALLS;
+static int _commit_data_at_call = -1;			   // Call after which the data is committed, -1 if not requested
+static bool _release_resources_after_commit = false; // Release the resources after each call, once the data is committed
 static int _inject_delay = 0;
+static unsigned int alltoallv_features = COMPILED_FEATURES;
+// Clocks only need to be synchronized when timestamps of different ranks are compared
+#define NEED_CLOCK_SYNC (!ENABLE_RUNTIME_FEATURES || (alltoallv_features & FEATURE_EXEC_TIMING))
 
 static int do_send_buffs = 0; // Specify that the focus is on send buffers rather than recv buffers
 static int max_call = -1;	  // Specify when to stop when checking content of buffers
+static int min_call = 0; 	  // Specify when to start when checking content of buffers
 
 // Buffers used to store data through all alltoallv calls
 int *sbuf = NULL;
@@ -52,6 +68,14 @@ double *late_arrival_timings = NULL;
 
 static logger_t *logger = NULL;
 
+// Clusters of similar count matrices, created with the first matrix when clustering is enabled
+static bool matrix_clusters = false;
+static double similarity_threshold = DEFAULT_SIMILARITY_THRESHOLD;
+static similarity_index_t *clusters = NULL;
+
+// Cycles in the sequence of the data sets of the calls
+static periodicity_detector_t *cycles = NULL;
+
 /* FORTRAN BINDINGS */
 extern int mpi_fortran_in_place_;
 #define OMPI_IS_FORTRAN_IN_PLACE(addr) \
@@ -76,56 +100,60 @@ static int _trampoline_iterations = 0;
 
 static int _finalize_profiling();
 static int _commit_data();
+#if ENABLE_RUNTIME_FEATURES
+static void _select_features();
+#endif // ENABLE_RUNTIME_FEATURES
 
-static int *lookupRankSendCounters(SRCountNode_t *call_data, int rank)
+static counts_data_t *lookupRankSendCounters(SRCountNode_t *call_data, int rank)
 {
-	return lookup_rank_counters(call_data->send_data_size, call_data->send_data, rank);
+	return lookup_rank_counts_data(call_data->send_data_size, call_data->send_data, rank);
 }
 
-static int *lookupRankRecvCounters(SRCountNode_t *call_data, int rank)
+static counts_data_t *lookupRankRecvCounters(SRCountNode_t *call_data, int rank)
 {
-	return lookup_rank_counters(call_data->recv_data_size, call_data->recv_data, rank);
+	return lookup_rank_counts_data(call_data->recv_data_size, call_data->recv_data, rank);
 }
 
 // Compare if two arrays are identical.
 static bool same_call_counters(SRCountNode_t *call_data, int *send_counts, int *recv_counts, int size)
 {
-	int num = 0;
-	int rank, count_num;
+	int rank;
 
 	DEBUG_ALLTOALLV_PROFILING("Comparing data with existing data...\n");
 	DEBUG_ALLTOALLV_PROFILING("-> Comparing send counts...\n");
 	// First compare the send counts
-	for (rank = 0; rank < size; rank++)
+	if (call_data->send_structure != NULL && !matrix_structure_match(call_data->send_structure, send_counts, size))
+	{
+		DEBUG_ALLTOALLV_PROFILING("Data differs\n");
+		return false;
+	}
+	for (rank = 0; call_data->send_structure == NULL && rank < size; rank++)
 	{
-		int *_counts = lookupRankSendCounters(call_data, rank);
+		counts_data_t *_counts = lookupRankSendCounters(call_data, rank);
 		assert(_counts);
-		for (count_num = 0; count_num < size; count_num++)
+		if (!counts_data_equal(_counts, &(send_counts[rank * size]), size))
 		{
-			if (_counts[count_num] != send_counts[num])
-			{
-				DEBUG_ALLTOALLV_PROFILING("Data differs\n");
-				return false;
-			}
-			num++;
+			DEBUG_ALLTOALLV_PROFILING("Data differs\n");
+			return false;
 		}
 	}
 	DEBUG_ALLTOALLV_PROFILING("-> Send counts are the same\n");
 
 	// Then the receive counts
 	DEBUG_ALLTOALLV_PROFILING("-> Comparing recv counts...\n");
-	num = 0;
-	for (rank = 0; rank < size; rank++)
+	if (call_data->recv_structure != NULL && !matrix_structure_match(call_data->recv_structure, recv_counts, size))
+	{
+		DEBUG_ALLTOALLV_PROFILING("Data differs\n");
+		return false;
+	}
+	for (rank = 0; call_data->recv_structure == NULL && rank < size; rank++)
 	{
-		int *_counts = lookupRankRecvCounters(call_data, rank);
-		for (count_num = 0; count_num < size; count_num++)
+		counts_data_t *_counts = lookupRankRecvCounters(call_data, rank);
+		assert(_counts);
+		if (!counts_data_equal(_counts, &(recv_counts[rank * size]), size))
 		{
-			if (_counts[count_num] != recv_counts[num])
-			{
-				DEBUG_ALLTOALLV_PROFILING("Data differs\n");
-				return false;
-			}
-			num++;
+			DEBUG_ALLTOALLV_PROFILING("Data differs\n");
+			return false;
 		}
 	}
 
@@ -135,18 +163,10 @@ static bool same_call_counters(SRCountNode_t *call_data, int *send_counts, int *
 
 static counts_data_t *lookupCounters(int size, int num, counts_data_t **list, int *count)
 {
-	int i, j;
+	int i;
 	for (i = 0; i < num; i++)
 	{
-		for (j = 0; j < size; j++)
-		{
-			if (count[j] != list[i]->counters[j])
-			{
-				break;
-			}
-		}
-
-		if (j == size)
+		if (counts_data_equal(list[i], count, size))
 		{
 			return list[i];
 		}
@@ -347,10 +367,7 @@ static void delete_counter_data(counts_data_t **data)
 		{
 			free((*data)->ranks);
 		}
-		if ((*data)->counters)
-		{
-			free((*data)->counters);
-		}
+		counts_data_free_series(*data);
 		free(*data);
 		*data = NULL;
 	}
@@ -358,20 +375,14 @@ static void delete_counter_data(counts_data_t **data)
 
 static counts_data_t *new_counter_data(int size, int rank, int *counts)
 {
-	int i;
 	counts_data_t *new_data = (counts_data_t *)malloc(sizeof(counts_data_t));
 	assert(new_data);
-	new_data->counters = (int *)malloc(size * sizeof(int));
-	assert(new_data->counters);
+	counts_data_set_counts(new_data, counts, size);
 	new_data->num_ranks = 0;
 	new_data->max_ranks = MAX_TRACKED_RANKS;
 	new_data->ranks = (int *)malloc(new_data->max_ranks * sizeof(int));
 	assert(new_data->ranks);
 
-	for (i = 0; i < size; i++)
-	{
-		new_data->counters[i] = counts[i];
-	}
 	new_data->ranks[new_data->num_ranks] = rank;
 	new_data->num_ranks++;
 
@@ -449,11 +460,15 @@ static int compareAndSaveRecvCounters(int rank, int *counts, SRCountNode_t *call
 // Compare new send count data with existing data.
 // If there is a match, increas the counter. Add new data, otherwise.
 // recv count was not compared.
+// When quantization is enabled (see counts_data.h), counts are quantized in place before
+// being compared, after accounting for the exact amount of data that is exchanged.
 static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendtype_size, int recvtype_size)
 {
 	int i, j, num = 0;
 	struct SRCountNode *newNode = NULL;
 	struct SRCountNode *temp;
+	uint64_t send_bytes, recv_bytes;
+	int data_set = 0;
 
 	DEBUG_ALLTOALLV_PROFILING("Insert data for a new alltoallv call...\n");
 
@@ -461,6 +476,11 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 	assert(rbuf);
 	assert(logger);
 
+	send_bytes = counts_total(sbuf, size * size) * sendtype_size;
+	recv_bytes = counts_total(rbuf, size * size) * recvtype_size;
+	counts_quantize(sbuf, size * size);
+	counts_quantize(rbuf, size * size);
+
 	temp = counts_head;
 	while (temp != NULL)
 	{
@@ -470,6 +490,7 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 #if DEBUG
 			fprintf(logger->f, "new data: %d\n", size);
 #endif
+			data_set++;
 			if (temp->next != NULL)
 				temp = temp->next;
 			else
@@ -488,6 +509,12 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 			}
 			temp->list_calls[temp->count] = avCalls; // Note: count starts at 1, not 0
 			temp->count++;
+			temp->send_bytes += send_bytes;
+			temp->recv_bytes += recv_bytes;
+			if (temp->cluster != -1)
+				similarity_index_add_calls(clusters, temp->cluster, 1);
+			periodicity_add_call(cycles, avCalls, data_set);
+			region_add_data_set(region_current(), data_set);
 #if DEBUG
 			fprintf(logger->f, "old data: %d --> %d --- %d\n", size, temp->size, temp->count);
 #endif
@@ -516,13 +543,33 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 	newNode->recv_data = (counts_data_t **)malloc(size * sizeof(counts_data_t));
 	assert(newNode->recv_data);
 	newNode->recv_data_size = 0;
+	// Matrices with a known structure are stored as the description of their structure
+	newNode->send_structure = matrix_structure_detect(sbuf, size);
+	newNode->recv_structure = matrix_structure_detect(rbuf, size);
+	newNode->send_bytes = send_bytes;
+	newNode->recv_bytes = recv_bytes;
+	if (cycles == NULL)
+		cycles = periodicity_detector_init();
+	periodicity_add_call(cycles, avCalls, data_set);
+	region_add_data_set(region_current(), data_set);
+	newNode->cluster = -1;
+	if (matrix_clusters)
+	{
+		if (clusters == NULL)
+			clusters = similarity_index_init(similarity_threshold);
+		// The send count matrix is enough since the recv count matrix is its transpose
+		similarity_sketch_t sketch;
+		similarity_sketch_init(&sketch, sbuf, size);
+		newNode->cluster = similarity_index_add(clusters, &sketch, data_set);
+		similarity_index_add_calls(clusters, newNode->cluster, 1);
+	}
 
 	// We add rank's data one by one so we can compress the data when possible
 	num = 0;
 	int _rank;
 
 	DEBUG_ALLTOALLV_PROFILING("handling send counts...\n");
-	for (_rank = 0; _rank < size; _rank++)
+	for (_rank = 0; newNode->send_structure == NULL && _rank < size; _rank++)
 	{
 		if (compareAndSaveSendCounters(_rank, &(sbuf[num * size]), newNode))
 		{
@@ -534,7 +581,7 @@ static int insert_sendrecv_count_data(int *sbuf, int *rbuf, int size, int sendty
 
 	DEBUG_ALLTOALLV_PROFILING("handling recv counts...\n");
 	num = 0;
-	for (_rank = 0; _rank < size; _rank++)
+	for (_rank = 0; newNode->recv_structure == NULL && _rank < size; _rank++)
 	{
 		if (compareAndSaveRecvCounters(_rank, &(rbuf[num * size]), newNode))
 		{
@@ -755,11 +802,27 @@ int _mpi_init(int *argc, char ***argv)
 		_limit_av_calls = atoi(limit_a2a_calls);
 	}
 
+	char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
+	if (need_data_commit_str != NULL)
+	{
+		_commit_data_at_call = atoi(need_data_commit_str);
+	}
+
+	char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
+	if (need_to_free_data != NULL && strncmp(need_to_free_data, "0", 1) != 0)
+	{
+		_release_resources_after_commit = true;
+	}
+
 	ret = PMPI_Init(argc, argv);
 
 	PMPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
 	PMPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+#if ENABLE_RUNTIME_FEATURES
+	_select_features();
+#endif // ENABLE_RUNTIME_FEATURES
+
 	// We do not know what rank will gather alltoallv data since alltoallv can
 	// be called on any communicator
 	int jobid = get_job_id();
@@ -769,6 +832,7 @@ int _mpi_init(int *argc, char ***argv)
 	alltoallv_logger_cfg.limit_number_calls = DEFAULT_LIMIT_ALLTOALLV_CALLS;
 	logger = logger_init(jobid, world_rank, world_size, &alltoallv_logger_cfg);
 	assert(logger);
+	matrix_clusters = similarity_enabled(&similarity_threshold);
 
 	// Allocate buffers reused between alltoallv calls
 	// Note the buffer may be used on a communicator that is not comm_world
@@ -782,6 +846,10 @@ int _mpi_init(int *argc, char ***argv)
 #if ENABLE_EXEC_TIMING
 	op_exec_times = (double *)malloc(world_size * sizeof(double));
 	assert(op_exec_times);
+	if (alltoallv_features & FEATURE_EXEC_TIMING)
+	{
+		timestamps_init("alltoallv", world_rank);
+	}
 #endif // ENABLE_EXEC_TIMING
 #if ENABLE_LATE_ARRIVAL_TIMING
 	late_arrival_timings = (double *)malloc(world_size * sizeof(double));
@@ -809,9 +877,52 @@ int _mpi_init(int *argc, char ***argv)
 		max_call = atoi(max_call_num_envvar);
 	}
 
-	char *dump_call_data_envvar = getenv("DUMP_CALL_DATA");
-	if (dump_call_data_envvar != NULL)
-		dump_call_data = atoi(dump_call_data_envvar);
+	char *min_call_num_envvar = getenv(COLLECTIVE_PROFILER_MIN_CALL_CHECK_BUFF_CONTENT_ENVVAR);
+	if (min_call_num_envvar != NULL)
+	{
+		min_call = atoi(min_call_num_envvar);
+	}
+
+	int capture_rc = capture_init("alltoallv", world_rank);
+	if (capture_rc)
+	{
+		fprintf(stderr, "capture_init() failed: %d\n", capture_rc);
+	}
+
+	int flight_recorder_rc = flight_recorder_init("alltoallv", world_rank, world_size);
+	if (flight_recorder_rc)
+	{
+		fprintf(stderr, "flight_recorder_init() failed: %d\n", flight_recorder_rc);
+	}
+
+	int sampling_rc = sampling_init();
+	if (sampling_rc)
+	{
+		fprintf(stderr, "sampling_init() failed: %d\n", sampling_rc);
+	}
+
+	int control_rc = profiling_control_init(world_rank);
+	if (control_rc)
+	{
+		fprintf(stderr, "profiling_control_init() failed: %d\n", control_rc);
+	}
+
+#if ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+	timer_init();
+#endif // ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+
+#if ENABLE_CLOCK_SYNC
+	// Estimate the offset and drift of the clocks once so timestamps can be compared between ranks
+	if (NEED_CLOCK_SYNC)
+	{
+		int clock_sync_rc = clock_sync_init(MPI_COMM_WORLD);
+		if (clock_sync_rc)
+		{
+			fprintf(stderr, "clock_sync_init() failed: %d\n", clock_sync_rc);
+			PMPI_Abort(MPI_COMM_WORLD, 1);
+		}
+	}
+#endif // ENABLE_CLOCK_SYNC
 
 	// Make sure we do not create an articial imbalance between ranks.
 	PMPI_Barrier(MPI_COMM_WORLD);
@@ -836,11 +947,27 @@ int _mpi_init_thread(int *argc, char ***argv, int required, int *provided)
 		_limit_av_calls = atoi(limit_a2a_calls);
 	}
 
+	char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
+	if (need_data_commit_str != NULL)
+	{
+		_commit_data_at_call = atoi(need_data_commit_str);
+	}
+
+	char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
+	if (need_to_free_data != NULL && strncmp(need_to_free_data, "0", 1) != 0)
+	{
+		_release_resources_after_commit = true;
+	}
+
 	ret = PMPI_Init_thread(argc, argv, required, provided);
 
 	PMPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
 	PMPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+#if ENABLE_RUNTIME_FEATURES
+	_select_features();
+#endif // ENABLE_RUNTIME_FEATURES
+
 	// We do not know what rank will gather alltoallv data since alltoallv can
 	// be called on any communicator
 	int jobid = get_job_id();
@@ -850,6 +977,7 @@ int _mpi_init_thread(int *argc, char ***argv, int required, int *provided)
 	alltoallv_logger_cfg.limit_number_calls = DEFAULT_LIMIT_ALLTOALLV_CALLS;
 	logger = logger_init(jobid, world_rank, world_size, &alltoallv_logger_cfg);
 	assert(logger);
+	matrix_clusters = similarity_enabled(&similarity_threshold);
 
 	// Allocate buffers reused between alltoallv calls
 	// Note the buffer may be used on a communicator that is not comm_world
@@ -863,6 +991,10 @@ int _mpi_init_thread(int *argc, char ***argv, int required, int *provided)
 #if ENABLE_EXEC_TIMING
 	op_exec_times = (double *)malloc(world_size * sizeof(double));
 	assert(op_exec_times);
+	if (alltoallv_features & FEATURE_EXEC_TIMING)
+	{
+		timestamps_init("alltoallv", world_rank);
+	}
 #endif // ENABLE_EXEC_TIMING
 #if ENABLE_LATE_ARRIVAL_TIMING
 	late_arrival_timings = (double *)malloc(world_size * sizeof(double));
@@ -890,9 +1022,52 @@ int _mpi_init_thread(int *argc, char ***argv, int required, int *provided)
 		max_call = atoi(max_call_num_envvar);
 	}
 
-	char *dump_call_data_envvar = getenv("DUMP_CALL_DATA");
-	if (dump_call_data_envvar != NULL)
-		dump_call_data = atoi(dump_call_data_envvar);
+	char *min_call_num_envvar = getenv(COLLECTIVE_PROFILER_MIN_CALL_CHECK_BUFF_CONTENT_ENVVAR);
+	if (min_call_num_envvar != NULL)
+	{
+		min_call = atoi(min_call_num_envvar);
+	}
+
+	int capture_rc = capture_init("alltoallv", world_rank);
+	if (capture_rc)
+	{
+		fprintf(stderr, "capture_init() failed: %d\n", capture_rc);
+	}
+
+	int flight_recorder_rc = flight_recorder_init("alltoallv", world_rank, world_size);
+	if (flight_recorder_rc)
+	{
+		fprintf(stderr, "flight_recorder_init() failed: %d\n", flight_recorder_rc);
+	}
+
+	int sampling_rc = sampling_init();
+	if (sampling_rc)
+	{
+		fprintf(stderr, "sampling_init() failed: %d\n", sampling_rc);
+	}
+
+	int control_rc = profiling_control_init(world_rank);
+	if (control_rc)
+	{
+		fprintf(stderr, "profiling_control_init() failed: %d\n", control_rc);
+	}
+
+#if ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+	timer_init();
+#endif // ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING
+
+#if ENABLE_CLOCK_SYNC
+	// Estimate the offset and drift of the clocks once so timestamps can be compared between ranks
+	if (NEED_CLOCK_SYNC)
+	{
+		int clock_sync_rc = clock_sync_init(MPI_COMM_WORLD);
+		if (clock_sync_rc)
+		{
+			fprintf(stderr, "clock_sync_init() failed: %d\n", clock_sync_rc);
+			PMPI_Abort(MPI_COMM_WORLD, 1);
+		}
+	}
+#endif // ENABLE_CLOCK_SYNC
 
 	// Make sure we do not create an articial imbalance between ranks.
 	PMPI_Barrier(MPI_COMM_WORLD);
@@ -977,11 +1152,15 @@ static int _release_counts_resources()
 
 		free(counts_head->recv_data);
 		free(counts_head->send_data);
+		matrix_structure_free(&(counts_head->send_structure));
+		matrix_structure_free(&(counts_head->recv_structure));
 		free(counts_head->list_calls);
 
 		free(counts_head);
 		counts_head = c_ptr;
 	}
+	similarity_index_free(&clusters);
+	periodicity_detector_free(&cycles);
 	return 0;
 }
 
@@ -1069,14 +1248,70 @@ static int _release_profiling_resources()
 
 static int _finalize_profiling()
 {
+	profiling_control_fini();
+	clock_sync_fini();
+	sampling_fini();
+	region_fini();
+	capture_fini();
+	flight_recorder_fini();
+#if ENABLE_EXEC_TIMING
+	timestamps_fini();
+#endif // ENABLE_EXEC_TIMING
 	logger_fini(&logger);
 	_release_profiling_resources();
 }
 
+static void save_cycles(int world_rank)
+{
+	char *filename = alltoallv_get_full_filename(MAIN_CTX, "cycles_alltoallv", logger->jobid, world_rank);
+	FILE *fh = fopen(filename, "w");
+	assert(fh);
+	periodicity_write(fh, cycles);
+	fclose(fh);
+	free(filename);
+}
+
+static void save_regions(int world_rank)
+{
+	char *filename = alltoallv_get_full_filename(MAIN_CTX, "regions_alltoallv", logger->jobid, world_rank);
+	FILE *fh = fopen(filename, "w");
+	assert(fh);
+	region_write(fh, "alltoallv");
+	fclose(fh);
+	free(filename);
+}
+
+static void save_clusters(int world_rank)
+{
+	char *filename = alltoallv_get_full_filename(MAIN_CTX, "clusters_alltoallv", logger->jobid, world_rank);
+	FILE *fh = fopen(filename, "w");
+	assert(fh);
+	similarity_index_write(fh, clusters);
+	fclose(fh);
+	free(filename);
+}
+
 static int _commit_data()
 {
 	log_profiling_data(logger, avCalls, avCallStart, avCallsLogged, counts_head, displs_head, op_timing_exec_head);
 
+	if (clusters != NULL)
+		save_clusters(world_rank);
+	if (cycles != NULL && cycles->num_segments > 0)
+		save_cycles(world_rank);
+	// Statistics per region are only saved when the application annotates its regions
+	if (region_count() > 1 && avCallsLogged > 0)
+		save_regions(world_rank);
+
+#if ENABLE_EXEC_TIMING
+	/* Save start & end timestamps */
+	int timestamps_rc = timestamps_flush();
+	if (timestamps_rc)
+	{
+		fprintf(stderr, "timestamps_flush() failed: %d\n", timestamps_rc);
+	}
+#endif // ENABLE_EXEC_TIMING
+
 	/*
 #if ENABLE_TIMING
 	log_timing_data(logger, op_timing_exec_head);
@@ -1149,15 +1384,28 @@ static void save_counts(int *sendcounts, int *recvcounts, int s_datatype_size, i
 	free(filename);
 }
 
-int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispls,
-				   MPI_Datatype sendtype, void *recvbuf, const int *recvcounts,
-				   const int *rdispls, MPI_Datatype recvtype, MPI_Comm comm)
+// Return address of the current call to MPI_Alltoallv(), recorded by the flight recorder
+static void *flight_recorder_call_site = NULL;
+
+static inline void _flight_recorder_add(double t_start, const int *sendcounts, const int *recvcounts, int comm_size)
+{
+	if (flight_recorder_enabled())
+		flight_recorder_add(avCalls, t_start, timer_wtime(), sendcounts, recvcounts, comm_size, flight_recorder_call_site);
+}
+
+// _mpi_alltoallv_features profiles a call with the given features. It is always inlined
+// with constant features so the code of the features that are not selected is removed.
+static inline __attribute__((always_inline)) int _mpi_alltoallv_features(const unsigned int features,
+																		 const void *sendbuf, const int *sendcounts, const int *sdispls,
+																		 MPI_Datatype sendtype, void *recvbuf, const int *recvcounts,
+																		 const int *rdispls, MPI_Datatype recvtype, MPI_Comm comm)
 {
 	int comm_size;
 	int i, j;
 	int localrank;
 	int ret;
 	bool need_profile = true;
+	sampling_state_t *sampling = NULL;
 	int my_comm_rank;
 	char *collective_name = "alltoallv";
 
@@ -1166,7 +1414,7 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 	PMPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
 
 #if ENABLE_BACKTRACE
-	if (my_comm_rank == 0)
+	if ((features & FEATURE_BACKTRACE) && my_comm_rank == 0)
 	{
 		void *array[16];
 		size_t _s;
@@ -1190,6 +1438,12 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 		{
 			need_profile = false;
 		}
+		else if (sampling_enabled())
+		{
+			// Unsampled calls are not profiled at all, they only decrement the countdown of the communicator
+			sampling = sampling_lookup(comm);
+			need_profile = !sampling_skip_call(sampling);
+		}
 	}
 
 	if (need_profile)
@@ -1199,7 +1453,8 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 			avCallStart = avCalls;
 		}
 
-		if (dump_call_data == avCalls)
+		bool capture_call = capture_call_selected(avCalls);
+		if (capture_call)
 		{
 			// Save datatypes information
 			if (my_comm_rank == 0)
@@ -1225,13 +1480,15 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 				}
 			}
 
-			int rc = store_call_data(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)sendbuf, (int *)sendcounts, (int *)sdispls, sendtype);
-			if (rc)
+			// The data is written in the background while the application continues
+			if (sendbuf != MPI_IN_PLACE)
 			{
-				fprintf(stderr, "store_call_data() failed on l.%d: %d\n", __LINE__, rc);
-				MPI_Abort(MPI_COMM_WORLD, 11);
+				int rc = capture_call_data(SEND_CONTEXT_ID, comm, my_comm_rank, avCalls, sendbuf, sendcounts, sdispls, comm_size, sendtype);
+				if (rc)
+				{
+					fprintf(stderr, "capture_call_data() failed on l.%d: %d\n", __LINE__, rc);
+				}
 			}
-			save_buf_content((void *)sendbuf, sendcounts, sdispls, sendtype, comm, world_rank, "send");
 		}
 
 #if ENABLE_LATE_ARRIVAL_TIMING
@@ -1239,52 +1496,77 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 		{
 			sleep(1);
 		}
-		double t_barrier_start = MPI_Wtime();
+#if ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
+		// Entry timestamp on the reference clock, the arrival skew is computed when committing the data
+		double t_entry = clock_sync_wtime();
+#else
+		double t_barrier_start = timer_wtime();
 		PMPI_Barrier(comm);
-		double t_barrier_end = MPI_Wtime();
+		double t_barrier_end = timer_wtime();
+#endif // ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
 #endif // ENABLE_LATE_ARRIVAL_TIMING
 
 #if ENABLE_EXEC_TIMING
-		double t_start = MPI_Wtime();
+		double t_start = 0;
+		double t_op = 0;
+		if (features & FEATURE_EXEC_TIMING)
+		{
+			// Timestamps are saved so they are corrected to the reference clock to be comparable between ranks
+			t_start = clock_sync_wtime();
+		}
 #endif // ENABLE_EXEC_TIMING
 
+		double t_call_start = timer_wtime();
 		ret = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+		double t_call = timer_wtime() - t_call_start;
+		_flight_recorder_add(t_call_start, sendcounts, recvcounts, comm_size);
 
-		if (dump_call_data == avCalls)
+		if (capture_call)
 		{
-			int rc = store_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype);
+			int rc = capture_call_data(RECV_CONTEXT_ID, comm, my_comm_rank, avCalls, recvbuf, recvcounts, rdispls, comm_size, recvtype);
 			if (rc)
 			{
-				fprintf(stderr, "store_call_data() failed on l.%d: %d\n", __LINE__, rc);
-				MPI_Abort(MPI_COMM_WORLD, 11);
+				fprintf(stderr, "capture_call_data() failed on l.%d: %d\n", __LINE__, rc);
 			}
-			save_buf_content(recvbuf, recvcounts, rdispls, recvtype, comm, world_rank, "recv");
-			release_buffcontent_loggers();
-			PMPI_Barrier(comm);
-			if (my_comm_rank == 0)
-				fprintf(stderr, "All data acquired, aborting...\n");
-			MPI_Abort(MPI_COMM_WORLD, 22);
 		}
 
 #if ENABLE_EXEC_TIMING
-		double t_end = MPI_Wtime();
-		double t_op = t_end - t_start;
+		if (features & FEATURE_EXEC_TIMING)
+		{
+			double t_end = clock_sync_wtime();
+			timestamps_add(avCalls, t_start, t_end);
+			t_op = t_end - t_start;
+		}
 #endif // ENABLE_EXEC_TIMING
 
-#if ENABLE_LATE_ARRIVAL_TIMING
+#if ENABLE_LATE_ARRIVAL_TIMING && !ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
 		double t_arrival = t_barrier_end - t_barrier_start;
-#endif // ENABLE_LATE_ARRIVAL_TIMING
+#endif // ENABLE_LATE_ARRIVAL_TIMING && !ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
 
 		// Gather a bunch of counters
-		PMPI_Gather(sendcounts, comm_size, MPI_INT, sbuf, comm_size, MPI_INT, 0, comm);
-		PMPI_Gather(recvcounts, comm_size, MPI_INT, rbuf, comm_size, MPI_INT, 0, comm);
+		if (features & FEATURE_COUNTS)
+		{
+			PMPI_Gather(sendcounts, comm_size, MPI_INT, sbuf, comm_size, MPI_INT, 0, comm);
+			PMPI_Gather(recvcounts, comm_size, MPI_INT, rbuf, comm_size, MPI_INT, 0, comm);
+		}
 
 #if ENABLE_EXEC_TIMING
-		PMPI_Gather(&t_op, 1, MPI_DOUBLE, op_exec_times, 1, MPI_DOUBLE, 0, comm);
+		if (features & FEATURE_EXEC_TIMING)
+		{
+			PMPI_Gather(&t_op, 1, MPI_DOUBLE, op_exec_times, 1, MPI_DOUBLE, 0, comm);
+		}
 #endif // ENABLE_EXEC_TIMING
 
 #if ENABLE_LATE_ARRIVAL_TIMING
+#if ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
+		PMPI_Gather(&t_entry, 1, MPI_DOUBLE, late_arrival_timings, 1, MPI_DOUBLE, 0, comm);
+		if (my_comm_rank == 0)
+		{
+			entry_times_to_late_arrivals(late_arrival_timings, comm_size);
+		}
+#else
 		PMPI_Gather(&t_arrival, 1, MPI_DOUBLE, late_arrival_timings, 1, MPI_DOUBLE, 0, comm);
+#endif // ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
 #endif // ENABLE_LATE_ARRIVAL_TIMING
 
 #if ENABLE_SAVE_DATA_VALIDATION
@@ -1303,6 +1585,8 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 
 		if (avCalls == max_call)
 		{
+			// Complete the files, including their index, before stopping
+			release_buffcontent_loggers();
 			fprintf(stderr, "Reaching the limit, check successful\n");
 			PMPI_Abort(MPI_COMM_WORLD, 32);
 		}
@@ -1313,62 +1597,40 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 		{
 			if (avCalls == max_call)
 			{
-				fprintf(stderr, "Reaching the analysis limit, check successful\n");
+				// Report the calls with different content, if any, before stopping
+				release_buffcontent_loggers();
+				fprintf(stderr, "Reaching the analysis limit, check complete\n");
 				PMPI_Abort(MPI_COMM_WORLD, 1);
 			}
 			if (my_comm_rank == 0)
 			{
 				fprintf(stderr, "Checking call %" PRIu64 "\n", avCalls);
 			}
-			if (max_call == -1 || (max_call > -1 && avCalls < max_call))
-			{
-				read_and_compare_call_data(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)sendbuf, (int *)sendcounts, (int *)sdispls, sendtype, true);
-			}
-			else
-			{
-				read_and_compare_call_data(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)sendbuf, (int *)sendcounts, (int *)sdispls, sendtype, false);
-			}
+			bool check = avCalls >= min_call && (max_call == -1 || avCalls < max_call);
+			read_and_compare_call_data(collective_name, SEND_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)sendbuf, (int *)sendcounts, (int *)sdispls, sendtype, check);
 		}
 		else
 		{
 			if (avCalls == max_call)
 			{
-				fprintf(stderr, "Reaching the analysis limit, check successful\n");
+				// Report the calls with different content, if any, before stopping
+				release_buffcontent_loggers();
+				fprintf(stderr, "Reaching the analysis limit, check complete\n");
 				PMPI_Abort(MPI_COMM_WORLD, 1);
 			}
-			if (max_call == -1 || (max_call > -1 && avCalls < max_call))
-			{
-				read_and_compare_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype, true);
-			}
-			else
-			{
-				read_and_compare_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype, false);
-			}
+			bool check = avCalls >= min_call && (max_call == -1 || avCalls < max_call);
+			read_and_compare_call_data(collective_name, RECV_CONTEXT_IDX, comm, my_comm_rank, world_rank, avCalls, (void *)recvbuf, (int *)recvcounts, (int *)rdispls, recvtype, check);
 		}
 #endif // ENABLE_COMPARE_DATA_VALIDATION
 
 #if ENABLE_LOCATION_TRACKING
-		int my_pid = getpid();
-		// Note that the library will free all the allocated memory. We hand over the pointer
-		// and the profiler frees the memory when finalizing
-		int *pids = (int *)malloc(comm_size * sizeof(int));
-		assert(pids);
-		int *world_comm_ranks = (int *)malloc(comm_size * sizeof(int));
-		assert(world_comm_ranks);
-		char hostname[256];
-		gethostname(hostname, 256);
-		char *hostnames = (char *)malloc(256 * comm_size * sizeof(char));
-		assert(hostnames);
-
-		PMPI_Gather(&my_pid, 1, MPI_INT, pids, 1, MPI_INT, 0, comm);
-		PMPI_Gather(&world_rank, 1, MPI_INT, world_comm_ranks, 1, MPI_INT, 0, comm);
-		PMPI_Gather(&hostname, 256, MPI_CHAR, hostnames, 256, MPI_CHAR, 0, comm);
-		if (my_comm_rank == 0)
+		if (features & FEATURE_LOCATION)
 		{
-			int rc = commit_rank_locations(collective_name, comm, comm_size, world_rank, my_comm_rank, pids, world_comm_ranks, hostnames, avCalls);
+			// Locations are gathered only the first time the communicator is used, all the ranks must call it
+			int rc = commit_rank_locations(collective_name, comm, comm_size, world_rank, my_comm_rank, avCalls);
 			if (rc)
 			{
-				fprintf(stderr, "save_rank_locations() failed: %d", rc);
+				fprintf(stderr, "commit_rank_locations() failed: %d", rc);
 				PMPI_Abort(MPI_COMM_WORLD, 1);
 			}
 		}
@@ -1381,23 +1643,29 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 #endif
 
 #if ((ENABLE_RAW_DATA || ENABLE_PER_RANK_STATS || ENABLE_VALIDATION) && ENABLE_COMPACT_FORMAT)
-			DEBUG_ALLTOALLV_PROFILING("Saving data of call #%" PRIu64 ".\n", avCalls);
-			int s_dt_size, r_dt_size;
-			PMPI_Type_size(sendtype, &s_dt_size);
-			PMPI_Type_size(recvtype, &r_dt_size);
-			if (insert_sendrecv_count_data(sbuf, rbuf, comm_size, s_dt_size, r_dt_size))
+			if (features & FEATURE_COUNTS)
 			{
-				fprintf(stderr, "[%s:%d][ERROR] unable to insert send/recv counts\n", __FILE__, __LINE__);
-				PMPI_Abort(MPI_COMM_WORLD, 1);
+				DEBUG_ALLTOALLV_PROFILING("Saving data of call #%" PRIu64 ".\n", avCalls);
+				int s_dt_size, r_dt_size;
+				PMPI_Type_size(sendtype, &s_dt_size);
+				PMPI_Type_size(recvtype, &r_dt_size);
+				if (insert_sendrecv_count_data(sbuf, rbuf, comm_size, s_dt_size, r_dt_size))
+				{
+					fprintf(stderr, "[%s:%d][ERROR] unable to insert send/recv counts\n", __FILE__, __LINE__);
+					PMPI_Abort(MPI_COMM_WORLD, 1);
+				}
 			}
 #endif // ((ENABLE_RAW_DATA || ENABLE_PER_RANK_STATS || ENABLE_VALIDATION) && ENABLE_COMPACT_FORMAT)
 
 #if ((ENABLE_RAW_DATA || ENABLE_PER_RANK_STATS || ENABLE_VALIDATION) && !ENABLE_COMPACT_FORMAT)
-			DEBUG_ALLTOALLV_PROFILING("Saving data of call #%" PRIu64 ".\n", avCalls);
-			int s_dt_size, r_dt_size;
-			PMPI_Type_size(sendtype, &s_dt_size);
-			PMPI_Type_size(recvtype, &r_dt_size);
-			save_counts(sbuf, rbuf, s_dt_size, r_dt_size, comm_size, avCalls);
+			if (features & FEATURE_COUNTS)
+			{
+				DEBUG_ALLTOALLV_PROFILING("Saving data of call #%" PRIu64 ".\n", avCalls);
+				int s_dt_size, r_dt_size;
+				PMPI_Type_size(sendtype, &s_dt_size);
+				PMPI_Type_size(recvtype, &r_dt_size);
+				save_counts(sbuf, rbuf, s_dt_size, r_dt_size, comm_size, avCalls);
+			}
 #endif // ((ENABLE_RAW_DATA || ENABLE_PER_RANK_STATS || ENABLE_VALIDATION) && !ENABLE_COMPACT_FORMAT)
 
 #if ENABLE_PATTERN_DETECTION
@@ -1405,12 +1673,15 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 #endif
 
 #if ENABLE_EXEC_TIMING
-			int jobid = get_job_id();
-			int rc = commit_timings(comm, collective_name, world_rank, my_comm_rank, jobid, op_exec_times, comm_size, avCalls);
-			if (rc)
+			if (features & FEATURE_EXEC_TIMING)
 			{
-				fprintf(stderr, "commit_timings() failed: %d\n", rc);
-				PMPI_Abort(MPI_COMM_WORLD, 1);
+				int jobid = get_job_id();
+				int rc = commit_timings(comm, collective_name, world_rank, my_comm_rank, jobid, op_exec_times, comm_size, avCalls);
+				if (rc)
+				{
+					fprintf(stderr, "commit_timings() failed: %d\n", rc);
+					PMPI_Abort(MPI_COMM_WORLD, 1);
+				}
 			}
 #endif // ENABLE_EXEC_TIMING
 
@@ -1423,18 +1694,30 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 				PMPI_Abort(MPI_COMM_WORLD, 1);
 			}
 #endif // ENABLE_LATE_ARRIVAL_TIMING
+			region_add_call(region_current(), avCalls, t_call);
 			avCallsLogged++;
 		}
 
-#if ENABLE_LATE_ARRIVAL_TIMING
+#if ENABLE_LATE_ARRIVAL_TIMING && !ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
 		// All ranks sync so that if we have I/O happening for some ranks during the data commit, it would not skew the next timings
 		PMPI_Barrier(comm);
-#endif // ENABLE_LATE_ARRIVAL_TIMING
+#endif // ENABLE_LATE_ARRIVAL_TIMING && !ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
+
+		if (sampling != NULL)
+		{
+			int sampling_rc = sampling_next(sampling, comm, sendcounts, recvcounts, comm_size);
+			if (sampling_rc)
+			{
+				fprintf(stderr, "sampling_next() failed: %d\n", sampling_rc);
+			}
+		}
 	}
 	else
 	{
 		// No need to profile that call but we still count the number of alltoallv calls
+		double t_flight_start = flight_recorder_enabled() ? timer_wtime() : 0;
 		ret = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+		_flight_recorder_add(t_flight_start, sendcounts, recvcounts, comm_size);
 	}
 
 #if SYNC
@@ -1443,19 +1726,12 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 	PMPI_Barrier(comm);
 #endif // SYNC
 
-	char *need_data_commit_str = getenv(A2A_COMMIT_PROFILER_DATA_AT_ENVVAR);
-	char *need_to_free_data = getenv(A2A_RELEASE_RESOURCES_AFTER_DATA_COMMIT_ENVVAR);
-
-	if (need_data_commit_str != NULL)
+	if (_commit_data_at_call != -1 && avCalls == _commit_data_at_call)
 	{
-		int targetCallID = atoi(need_data_commit_str);
-		if (avCalls == targetCallID)
-		{
-			_commit_data();
-		}
+		_commit_data();
 	}
 
-	if (need_to_free_data != NULL && strncmp(need_to_free_data, "0", 1) != 0)
+	if (_release_resources_after_commit)
 	{
 		_release_profiling_resources();
 	}
@@ -1466,10 +1742,89 @@ int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispl
 	return ret;
 }
 
+#if ENABLE_RUNTIME_FEATURES
+typedef int (*alltoallv_fn_t)(const void *sendbuf, const int *sendcounts, const int *sdispls,
+							  MPI_Datatype sendtype, void *recvbuf, const int *recvcounts,
+							  const int *rdispls, MPI_Datatype recvtype, MPI_Comm comm);
+
+// One specialization of the profiling of a call per combination of features
+#define ALLTOALLV_SPECIALIZATION(_features)                                                                                    \
+	static int _mpi_alltoallv_##_features(const void *sendbuf, const int *sendcounts, const int *sdispls,                      \
+										  MPI_Datatype sendtype, void *recvbuf, const int *recvcounts,                         \
+										  const int *rdispls, MPI_Datatype recvtype, MPI_Comm comm)                            \
+	{                                                                                                                          \
+		return _mpi_alltoallv_features(_features, sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm); \
+	}
+
+ALLTOALLV_SPECIALIZATION(0)
+ALLTOALLV_SPECIALIZATION(1)
+ALLTOALLV_SPECIALIZATION(2)
+ALLTOALLV_SPECIALIZATION(3)
+ALLTOALLV_SPECIALIZATION(4)
+ALLTOALLV_SPECIALIZATION(5)
+ALLTOALLV_SPECIALIZATION(6)
+ALLTOALLV_SPECIALIZATION(7)
+ALLTOALLV_SPECIALIZATION(8)
+ALLTOALLV_SPECIALIZATION(9)
+ALLTOALLV_SPECIALIZATION(10)
+ALLTOALLV_SPECIALIZATION(11)
+ALLTOALLV_SPECIALIZATION(12)
+ALLTOALLV_SPECIALIZATION(13)
+ALLTOALLV_SPECIALIZATION(14)
+ALLTOALLV_SPECIALIZATION(15)
+
+static alltoallv_fn_t alltoallv_specializations[NUM_FEATURE_SETS] = {
+	_mpi_alltoallv_0, _mpi_alltoallv_1, _mpi_alltoallv_2, _mpi_alltoallv_3,
+	_mpi_alltoallv_4, _mpi_alltoallv_5, _mpi_alltoallv_6, _mpi_alltoallv_7,
+	_mpi_alltoallv_8, _mpi_alltoallv_9, _mpi_alltoallv_10, _mpi_alltoallv_11,
+	_mpi_alltoallv_12, _mpi_alltoallv_13, _mpi_alltoallv_14, _mpi_alltoallv_15};
+
+// Specialization of the selected features, set in MPI_Init
+static alltoallv_fn_t alltoallv_specialization = _mpi_alltoallv_1;
+
+static void _select_features()
+{
+	if (features_init(&alltoallv_features))
+	{
+		fprintf(stderr, "[WARN] invalid features, only counts are gathered\n");
+		alltoallv_features = FEATURE_COUNTS;
+	}
+	alltoallv_specialization = alltoallv_specializations[alltoallv_features];
+	if (world_rank == 0)
+	{
+		char *features = features_to_str(alltoallv_features);
+		fprintf(stderr, "[INFO] alltoallv features: %s\n", features);
+		free(features);
+	}
+}
+#endif // ENABLE_RUNTIME_FEATURES
+
+int _mpi_alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispls,
+				   MPI_Datatype sendtype, void *recvbuf, const int *recvcounts,
+				   const int *rdispls, MPI_Datatype recvtype, MPI_Comm comm)
+{
+#if ENABLE_RUNTIME_FEATURES
+	return alltoallv_specialization(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+#else
+	return _mpi_alltoallv_features(COMPILED_FEATURES, sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+#endif // ENABLE_RUNTIME_FEATURES
+}
+
 int MPI_Alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispls,
 				  MPI_Datatype sendtype, void *recvbuf, const int *recvcounts,
 				  const int *rdispls, MPI_Datatype recvtype, MPI_Comm comm)
 {
+	if (profiling_control_update(comm) != 0)
+	{
+		fprintf(stderr, "profiling_control_sync() failed\n");
+	}
+	// When profiling is disabled, the library only forwards the calls. They are still counted
+	// so the call numbers always match the calls of the application.
+	if (!profiling_enabled())
+	{
+		avCalls++;
+		return PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+	}
 #if defined(HAVE_MPIX_HARMONIZE)
     /* From time to time we need to resynchronize the clocks, but we can only do it on MPI_Alltoallv on
      * MPI_COMM_WORLD.
@@ -1484,9 +1839,41 @@ int MPI_Alltoallv(const void *sendbuf, const int *sendcounts, const int *sdispls
         }
     }
 #endif  /* defined(HAVE_MPIX_HARMONIZE) */
+#if ENABLE_CLOCK_SYNC
+    /* From time to time we resynchronize the clocks to follow their drift, on MPI_COMM_WORLD only */
+    if( NEED_CLOCK_SYNC && MPI_SUCCESS != clock_sync_tick(comm) ) {
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+#endif // ENABLE_CLOCK_SYNC
+    flight_recorder_call_site = __builtin_return_address(0);
     return _mpi_alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
 }
 
+// MPI_Pcontrol(0) disables profiling and any other level enables it. It must be called by all
+// the ranks at the same point of the application, like the collectives it controls.
+int MPI_Pcontrol(const int level, ...)
+{
+	profiling_control_pcontrol(level);
+	return PMPI_Pcontrol(level);
+}
+
+void mpi_pcontrol_(MPI_Fint *level, MPI_Fint *ierr)
+{
+	int c_ierr = MPI_Pcontrol(OMPI_FINT_2_INT(*level));
+	if (NULL != ierr)
+		*ierr = OMPI_INT_2_FINT(c_ierr);
+}
+
+// The flight recorder of the rank is dumped before the job is aborted, the last calls
+// usually explaining why
+int MPI_Abort(MPI_Comm comm, int errorcode)
+{
+	char reason[MAX_STRING_LEN];
+	snprintf(reason, MAX_STRING_LEN, "MPI_Abort (error code: %d)", errorcode);
+	flight_recorder_dump(reason);
+	return PMPI_Abort(comm, errorcode);
+}
+
 void mpi_alltoallv_(void *sendbuf, MPI_Fint *sendcount, MPI_Fint *sdispls, MPI_Fint *sendtype,
 					void *recvbuf, MPI_Fint *recvcount, MPI_Fint *rdispls, MPI_Fint *recvtype,
 					MPI_Fint *comm, MPI_Fint *ierr)
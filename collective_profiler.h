@@ -0,0 +1,58 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+/*
+ * Public API of the profiler, to be included by applications.
+ *
+ * cp_region_begin() and cp_region_end() annotate the phases of an application, e.g., the
+ * assembly and the solve of a time step, so the statistics of the collectives are grouped
+ * by phase. Regions are nested: a region started within another one is a different region
+ * than the same region started at the top level. The regions are per thread.
+ *
+ * cp_flight_recorder_dump() writes the last calls of the rank kept by the flight recorder,
+ * e.g., when the application detects an error; the reason is written in the dump.
+ *
+ * The functions do nothing when no profiling library is preloaded, so an annotated
+ * application does not need to be linked with the profiler.
+ */
+
+#ifndef COLLECTIVE_PROFILER_H
+#define COLLECTIVE_PROFILER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Implemented by the profiling libraries
+    void collective_profiler_region_begin(const char *name) __attribute__((weak));
+    void collective_profiler_region_end(void) __attribute__((weak));
+    int collective_profiler_flight_recorder_dump(const char *reason) __attribute__((weak));
+
+    static inline void cp_region_begin(const char *name)
+    {
+        if (collective_profiler_region_begin != 0)
+            collective_profiler_region_begin(name);
+    }
+
+    static inline void cp_region_end(void)
+    {
+        if (collective_profiler_region_end != 0)
+            collective_profiler_region_end();
+    }
+
+    static inline int cp_flight_recorder_dump(const char *reason)
+    {
+        if (collective_profiler_flight_recorder_dump != 0)
+            return collective_profiler_flight_recorder_dump(reason);
+        return 0;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COLLECTIVE_PROFILER_H
@@ -10,6 +10,23 @@
 #define MAX_STRING_LEN (64)
 #define SYNC 0 // Force the ranks to sync after each collective operations to ensure rank 0 does not artifically fall behind
 #define DEFAULT_MSG_SIZE_THRESHOLD 200     // The default threshold between small and big messages
+#define DEFAULT_SPARSE_COUNTS_RATIO (0.25) // Series of counts with a lower ratio of non-zero counts are stored as sparse series
+#define SPARSE_COUNTS_MIN_LEN (16)         // Shorter series of counts are always stored as dense series
+#define MATRIX_STRUCTURE_MIN_SIZE (16)     // Count matrices of smaller communicators are always stored row by row
+#define DEFAULT_COUNTS_TOLERANCE (0.1)     // The default relative tolerance of the quantization of counts
+#define DEFAULT_SIMILARITY_THRESHOLD (0.5) // Count matrices with a lower estimated similarity are never in the same cluster
+#define PERIODICITY_MAX_PERIOD (64)        // Longest cycle of patterns that can be detected
+#define PERIODICITY_MIN_REPEATS (3)        // A cycle of patterns is only detected after that many repetitions
+#define CHANGEPOINT_WARMUP_CALLS (16)      // Number of calls used to estimate the timings of a new regime
+#define CHANGEPOINT_MIN_RELATIVE_STDDEV (0.05) // Lower bound of the standard deviation of the timings of a regime, relative to their mean
+#define CHANGEPOINT_MAX_DEVIATION (4.0)    // Standardized timings are clipped to that many standard deviations
+#define CHANGEPOINT_DRIFT (0.5)            // Deviations smaller than that many standard deviations are not accumulated
+#define CHANGEPOINT_THRESHOLD (8.0)        // A change is detected when the accumulated deviations exceed the threshold
+#define FLIGHT_RECORDER_MAX_SLOW_DUMPS (16) // Maximum number of dumps of the flight recorder of a rank triggered by slow calls
+#define SAMPLING_MAX_ADAPTIVE_INTERVAL (1024) // Longest interval between two sampled calls of the adaptive sampling policy
+#define PROFILING_CONTROL_SYNC_INTERVAL (64) // Number of calls on MPI_COMM_WORLD between two checks of the signals and of the control file
+#define REGION_MAX_DEPTH (16)              // Maximum nesting of the regions of the application, deeper regions are merged with their parent
+#define REGION_MAX_REGIONS (256)           // Maximum number of distinct regions, calls in additional regions are counted in their parent
 
 /* A few environment variables to control a few things at runtime */
 
@@ -22,6 +39,57 @@
 // Name of the environment variable to specify where output files will be created. 
 #define PROFILER_OUTPUT_DIR_ENVVAR "MPI_COLLECTIVE_PROFILER_OUTPUT_DIR"
 
+// Name of the environment variable to specify every how many collective operations on MPI_COMM_WORLD the clocks are resynchronized (0 to disable)
+#define CLOCK_RESYNC_FREQUENCY_ENVVAR "COLLECTIVE_PROFILER_CLOCK_RESYNC_FREQUENCY"
+
+// Name of the environment variable to disable the use of the TSC for timings, CLOCK_MONOTONIC_RAW is then used
+#define TIMER_DISABLE_TSC_ENVVAR "COLLECTIVE_PROFILER_DISABLE_TSC"
+
+// Name of the environment variable to specify the size in bytes of the in-memory timestamp log before it is written to its file
+#define TIMESTAMPS_FLUSH_THRESHOLD_ENVVAR "COLLECTIVE_PROFILER_TIMESTAMPS_FLUSH_THRESHOLD"
+
+// Name of the environment variable to change the ratio of non-zero counts under which series of counts are stored as sparse series (0 to disable)
+#define SPARSE_COUNTS_RATIO_ENVVAR "COLLECTIVE_PROFILER_SPARSE_COUNTS_RATIO"
+
+// Name of the environment variable to quantize counts before comparing them with the counts of previous calls: "log2" or "relative" (disabled by default)
+#define COUNTS_QUANTIZATION_ENVVAR "COLLECTIVE_PROFILER_COUNTS_QUANTIZATION"
+
+// Name of the environment variable to change the relative tolerance of the "relative" quantization of counts
+#define COUNTS_TOLERANCE_ENVVAR "COLLECTIVE_PROFILER_COUNTS_TOLERANCE"
+
+// Name of the environment variable to enable the clustering of similar count matrices (set to 1)
+#define MATRIX_CLUSTERS_ENVVAR "COLLECTIVE_PROFILER_MATRIX_CLUSTERS"
+
+// Name of the environment variable to change the similarity threshold of the clustering of count matrices
+#define SIMILARITY_THRESHOLD_ENVVAR "COLLECTIVE_PROFILER_SIMILARITY_THRESHOLD"
+
+// Name of the environment variable to capture the content of the buffers of that many calls after a change of the timings of a communicator
+#define CHANGEPOINT_CAPTURE_CALLS_ENVVAR "COLLECTIVE_PROFILER_CHANGEPOINT_CAPTURE_CALLS"
+
+// Name of the environment variable to keep the data of that many last calls in the flight recorder of each rank
+#define FLIGHT_RECORDER_CALLS_ENVVAR "COLLECTIVE_PROFILER_FLIGHT_RECORDER_CALLS"
+
+// Name of the environment variable to dump the flight recorder of a rank after a call slower than that many seconds
+#define FLIGHT_RECORDER_THRESHOLD_ENVVAR "COLLECTIVE_PROFILER_FLIGHT_RECORDER_THRESHOLD"
+
+// Name of the environment variable to set the sampling policies of the profiled calls, e.g., "every:10,MPI_COMM_WORLD=random:0.01"
+#define SAMPLING_ENVVAR "COLLECTIVE_PROFILER_SAMPLING"
+
+// Name of the environment variable to set the seed of the random sampling policy, which must be the same on all ranks
+#define SAMPLING_SEED_ENVVAR "COLLECTIVE_PROFILER_SAMPLING_SEED"
+
+// Name of the environment variable to select the features of the libraries where they are selected at runtime, e.g., "counts,exec_timings"
+#define FEATURES_ENVVAR "COLLECTIVE_PROFILER_FEATURES"
+
+// Name of the environment variable to start the application with profiling disabled (set to 0), MPI_Pcontrol() or the controls enabling it later
+#define PROFILING_ENABLED_ENVVAR "COLLECTIVE_PROFILER_ENABLED"
+
+// Name of the environment variable to toggle profiling when rank 0 receives SIGUSR1 (set to 1)
+#define PROFILING_CONTROL_SIGNAL_ENVVAR "COLLECTIVE_PROFILER_CONTROL_SIGNAL"
+
+// Name of the environment variable to specify a file enabling (content "1") or disabling (content "0") profiling while the application runs
+#define PROFILING_CONTROL_FILE_ENVVAR "COLLECTIVE_PROFILER_CONTROL_FILE"
+
 #ifndef FORMAT_VERSION
 #define FORMAT_VERSION (0)
 #endif // FORMAT_VERSION
@@ -45,6 +113,12 @@
 #define ENABLE_COMPACT_FORMAT (1)
 #endif // ENABLE_COMPACT_FORMAT
 
+// Switch to select the features at runtime, with FEATURES_ENVVAR, instead of at compile time.
+// The code of all the features is compiled in and specialized for every combination of features.
+#ifndef ENABLE_RUNTIME_FEATURES
+#define ENABLE_RUNTIME_FEATURES (0)
+#endif // ENABLE_RUNTIME_FEATURES
+
 // Switch to enable/disable timing of collective operations
 #ifndef ENABLE_EXEC_TIMING
 #define ENABLE_EXEC_TIMING (0)
@@ -55,6 +129,23 @@
 #define ENABLE_LATE_ARRIVAL_TIMING (0)
 #endif // ENABLE_LATE_ARRIVAL_TIMING
 
+// Switch to enable/disable measuring late arrivals from timestamps corrected with synchronized clocks
+// instead of timing a barrier injected before the collective. To be used in conjunction with ENABLE_LATE_ARRIVAL_TIMING
+#ifndef ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
+#define ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING (0)
+#endif // ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING
+
+// Switch to enable/disable the built-in clock synchronization, which is only required when timestamps
+// from different ranks are compared. It is not used when the clocks are harmonized with MPIX_Harmonize,
+// except for barrier-free late arrivals, which always rely on it.
+#ifndef ENABLE_CLOCK_SYNC
+#if ENABLE_BARRIER_FREE_LATE_ARRIVAL_TIMING || ((ENABLE_EXEC_TIMING || ENABLE_LATE_ARRIVAL_TIMING) && !defined(HAVE_MPIX_HARMONIZE))
+#define ENABLE_CLOCK_SYNC (1)
+#else
+#define ENABLE_CLOCK_SYNC (0)
+#endif
+#endif // ENABLE_CLOCK_SYNC
+
 // Switch to enable/disable tracking of the ranks' location
 #ifndef ENABLE_LOCATION_TRACKING
 #define ENABLE_LOCATION_TRACKING (0)
@@ -37,21 +37,21 @@ static inline void _write_backtrace_info(FILE *f)
     fprintf(f, "stack trace for %s pid=%s\n", name_buf, pid_buf);
 }
 
-static inline int _open_backtrace_file(char *collective_name, char **backtrace_filename, FILE **backtrace_file, int world_rank, uint64_t id)
+static inline int _open_backtrace_file(char *collective_name, char **backtrace_filename, FILE **backtrace_file, int world_rank)
 {
     char *filename = NULL;
     char *output_dir = NULL;
     int rc;
-    // filename schema: bracktrace_rank<WORLDRANK>_trace<ID>.md
+    // filename schema: <COLLECTIVE>_backtrace_rank<WORLDRANK>.md
     output_dir = get_output_dir();
     if (output_dir)
     {
-        _asprintf(filename, rc, "%s/%s_backtrace_rank%d_trace%" PRIu64 ".md", output_dir, collective_name, world_rank, id);
+        _asprintf(filename, rc, "%s/%s_backtrace_rank%d.md", output_dir, collective_name, world_rank);
         assert(rc > 0);
     }
     else
     {
-        _asprintf(filename, rc, "%s_backtrace_rank%d_trace%" PRIu64 ".md", collective_name, world_rank, id);
+        _asprintf(filename, rc, "%s_backtrace_rank%d.md", collective_name, world_rank);
         assert(rc > 0);
     }
 
@@ -63,34 +63,69 @@ static inline int _open_backtrace_file(char *collective_name, char **backtrace_f
     return 0;
 }
 
-int write_backtrace_to_file(backtrace_logger_t *logger)
+// write_backtraces_to_file saves all the unique traces of the rank and their contexts
+// in a single file: a trace table indexed by the trace ID, followed by a context table
+// where each row refers to a trace ID. Everything is written in one sequential pass.
+int write_backtraces_to_file(char *collective_name, int world_rank)
 {
-    assert(logger);
-    assert(logger->fd);
-    _write_backtrace_info(logger->fd);
-
+    backtrace_logger_t *ptr;
+    char *filename = NULL;
+    FILE *f = NULL;
+    size_t num_contexts = 0;
+    uint64_t num_traces = 0;
     uint64_t i;
-    fprintf(logger->fd, "\n# Trace\n\n");
-    for (i = 0; i < logger->trace_size; i++)
+
+    if (trace_loggers_head == NULL)
+        return 0;
+
+    int rc = _open_backtrace_file(collective_name, &filename, &f, world_rank);
+    if (rc)
+    {
+        fprintf(stderr, "_open_backtrace_file() failed: %d\n", rc);
+        return rc;
+    }
+    assert(f);
+    // Write the format version at the begining of the file
+    FORMAT_VERSION_WRITE(f);
+    _write_backtrace_info(f);
+    fprintf(f, "\n");
+
+    for (ptr = trace_loggers_head; ptr != NULL; ptr = ptr->next)
     {
+        num_traces++;
+        num_contexts += ptr->num_contexts;
+    }
+    fprintf(f, "Number of traces: %" PRIu64 "\n", num_traces);
+    fprintf(f, "Number of contexts: %zu\n", num_contexts);
 
-        fprintf(logger->fd, "%s\n", logger->trace[i]);
+    fprintf(f, "\n# Traces\n");
+    for (ptr = trace_loggers_head; ptr != NULL; ptr = ptr->next)
+    {
+        fprintf(f, "\n## Trace %" PRIu64 "\n\n", ptr->id);
+        for (i = 0; i < ptr->trace_size; i++)
+        {
+            fprintf(f, "%s\n", ptr->trace[i]);
+        }
     }
-    fprintf(logger->fd, "\n");
 
-    for (i = 0; i < logger->num_contexts; i++)
+    fprintf(f, "\n# Contexts\n\n");
+    fprintf(f, "Trace | Communicator | Communicator rank | COMM_WORLD rank | Calls\n");
+    for (ptr = trace_loggers_head; ptr != NULL; ptr = ptr->next)
     {
-        fprintf(logger->fd, "# Context %" PRIu64 "\n\n", i);
-        char *str = compress_uint64_array(logger->contexts[i].calls, logger->contexts[i].calls_count, 1);
-        assert(str);
-        fprintf(logger->fd, "Communicator: %"PRIu32"\n", logger->contexts[i].comm_id);
-        fprintf(logger->fd, "Communicator rank: %d\n", logger->contexts[i].comm_rank);
-        fprintf(logger->fd, "COMM_WORLD rank: %d\n", logger->contexts[i].world_rank);
-        fprintf(logger->fd, "Calls: %s\n", str);
-        fprintf(logger->fd, "\n");
-        free(str);
+        trace_context_t *ctxt = ptr->contexts;
+        while (ctxt != NULL)
+        {
+            range_encoder_t enc;
+            fprintf(f, "%" PRIu64 " | %" PRIu32 " | %d | %d | ", ptr->id, ctxt->comm_id, ctxt->comm_rank, ctxt->world_rank);
+            range_encoder_init(&enc, NULL, f, false);
+            write_compressed_uint64_array(&enc, ctxt->calls, ctxt->calls_count, 1);
+            fprintf(f, "\n");
+            ctxt = ctxt->next;
+        }
     }
 
+    fclose(f);
+    free(filename);
     return 0;
 }
 
@@ -143,23 +178,6 @@ int lookup_backtrace(char *collective_name, char **trace, size_t trace_size, bac
     return 0;
 }
 
-static inline int _close_backtrace_file(backtrace_logger_t *logger)
-{
-    if (logger->fd)
-    {
-        fclose(logger->fd);
-        logger->fd = NULL;
-    }
-
-    if (logger->filename)
-    {
-        free(logger->filename);
-        logger->filename = NULL;
-    }
-    
-    return 0;
-}
-
 int init_backtrace_context(MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, trace_context_t **trace_ctxt)
 {
     uint32_t comm_id;
@@ -194,8 +212,6 @@ static inline int init_backtrace_logger(char *collective_name, char **trace, siz
     trace_id++;
     new_logger->world_rank = world_rank;
     new_logger->contexts = trace_ctxt;
-    new_logger->fd = NULL;
-    new_logger->filename = NULL;
     new_logger->num_contexts = 1;
     new_logger->max_contexts = 1;
     new_logger->trace = trace;
@@ -203,31 +219,18 @@ static inline int init_backtrace_logger(char *collective_name, char **trace, siz
     new_logger->prev = NULL;
     new_logger->next = NULL;
 
-    int rc = _open_backtrace_file(new_logger->collective_name, &new_logger->filename, &new_logger->fd, new_logger->world_rank, new_logger->id);
-    if (rc)
-    {
-        fprintf(stderr, "_open_backtrace_file() failed: %d\n", rc);
-        return -1;
-    }
-    assert(new_logger->filename);
-
     if (trace_loggers_head == NULL)
     {
         trace_loggers_head = new_logger;
         trace_loggers_tail = new_logger;
-        new_logger->id = 0;
     }
     else
     {
         trace_loggers_tail->next = new_logger;
         new_logger->prev = trace_loggers_tail;
-        new_logger->id = trace_loggers_tail->id + 1;
         trace_loggers_tail = new_logger;
     }
 
-    assert(new_logger->fd);
-    // Write the format version at the begining of the file
-    FORMAT_VERSION_WRITE(new_logger->fd);
     *trace_logger = new_logger;
     return 0;
 }
@@ -250,12 +253,9 @@ static inline int _fini_trace_contexts(trace_context_t *ctx)
 
 int fini_backtrace_logger(backtrace_logger_t **logger)
 {
-    write_backtrace_to_file(*logger);
-    _close_backtrace_file(*logger);
     _fini_trace_contexts((*logger)->contexts);
     (*logger)->contexts = NULL;
     (*logger)->num_contexts = 0;
-    (*logger)->contexts = NULL;
 
     if ((*logger)->collective_name)
     {
@@ -263,18 +263,6 @@ int fini_backtrace_logger(backtrace_logger_t **logger)
         (*logger)->collective_name = NULL;
     }
 
-    if ((*logger)->fd)
-    {
-        fclose((*logger)->fd);
-        (*logger)->fd = NULL;
-    }
-
-    if ((*logger)->filename)
-    {
-        free((*logger)->filename);
-        (*logger)->filename = NULL;
-    }
-
     // Specification for the trace buffer says: "This array is malloc(3)ed by backtrace_symbols(), 
     // and must be freed by the caller. (The strings pointed to by the array of pointers need 
     // not and should not be freed.)"
@@ -283,6 +271,7 @@ int fini_backtrace_logger(backtrace_logger_t **logger)
         free((*logger)->trace);
         (*logger)->trace = NULL;
     }
+    free(*logger);
     *logger = NULL;
 
     return 0;
@@ -291,6 +280,18 @@ int fini_backtrace_logger(backtrace_logger_t **logger)
 int release_backtrace_loggers()
 {
     backtrace_logger_t *ptr = trace_loggers_head;
+    if (ptr != NULL)
+    {
+        // All the traces of the rank end up in a single file so we write everything
+        // before releasing the loggers.
+        int rc = write_backtraces_to_file(ptr->collective_name, ptr->world_rank);
+        if (rc)
+        {
+            fprintf(stderr, "write_backtraces_to_file() failed: %d\n", rc);
+            return rc;
+        }
+    }
+
     while (ptr)
     {
         backtrace_logger_t *next = ptr->next;
@@ -305,6 +306,7 @@ int release_backtrace_loggers()
     }
     trace_loggers_head = NULL;
     trace_loggers_tail = NULL;
+    trace_id = 0;
     return 0;
 }
 
@@ -28,6 +28,7 @@ typedef struct trace_context
 // backtrace_logger is the central structure to track and profile backtrace in
 // the context of MPI collective. We track in a unique manner each trace but for each
 // trace, multiple contexts can be tracked. A context is the tuple communictor id/rank/call.
+// All the traces of a rank are saved in a single file when the loggers are released.
 typedef struct backtrace_logger
 {
     char *collective_name;
@@ -38,8 +39,6 @@ typedef struct backtrace_logger
     size_t max_contexts;
     char **trace;
     size_t trace_size;
-    FILE *fd; // File descriptor to write the trace
-    char *filename; // Filename for the trace
     struct backtrace_logger *next;
     struct backtrace_logger *prev;
 } backtrace_logger_t;
@@ -10,10 +10,9 @@
 #include <string.h>
 #include <assert.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
-#include <openssl/sha.h>
-
 #include "buff_content.h"
 #include "collective_profiler_config.h"
 #include "common_utils.h"
@@ -22,8 +21,87 @@ buffcontent_logger_t *buffcontent_loggers_head = NULL;
 buffcontent_logger_t *buffcontent_loggers_tail = NULL;
 uint64_t buffcontent_id = 0;
 
+// Scratch buffers reused between calls to build the records
+static unsigned char *record_buf = NULL;
+static size_t record_buf_size = 0;
+static digest_task_t *tasks_buf = NULL;
+static size_t tasks_buf_size = 0;
+// Only used for the datatypes that cannot be flattened
+static char *pack_buf = NULL;
+static size_t pack_buf_size = 0;
+
+static inline void _close_report(buffcontent_logger_t *logger, int idx)
+{
+    logger_context_t *ctxt = &(logger->ctxt[idx]);
+    if (ctxt->report_fd)
+    {
+        fprintf(ctxt->report_fd, "\nNumber of calls checked: %" PRIu64 "\n", ctxt->num_checked_calls);
+        fprintf(ctxt->report_fd, "Number of calls with different content: %" PRIu64 "\n", ctxt->num_diverged_calls);
+        fprintf(stderr, "Rank %d: content of %" PRIu64 " out of %" PRIu64 " calls differ, see %s\n", logger->world_rank, ctxt->num_diverged_calls, ctxt->num_checked_calls, ctxt->report_filename);
+        fclose(ctxt->report_fd);
+        ctxt->report_fd = NULL;
+    }
+
+    if (ctxt->report_filename)
+    {
+        free(ctxt->report_filename);
+        ctxt->report_filename = NULL;
+    }
+}
+
+// _write_index appends the index of the records and the footer to the file
+static int _write_index(logger_context_t *ctxt)
+{
+    buffcontent_file_footer_t footer;
+    uint64_t padding = 0;
+
+    off_t offset = ftello(ctxt->fd);
+    size_t padding_size = (sizeof(uint64_t) - (offset % sizeof(uint64_t))) % sizeof(uint64_t);
+    footer.index_offset = offset + padding_size;
+    footer.num_entries = ctxt->index_size;
+    memcpy(footer.magic, BUFFCONTENT_INDEX_MAGIC, BUFFCONTENT_INDEX_MAGIC_LEN);
+    if ((padding_size > 0 && fwrite(&padding, padding_size, 1, ctxt->fd) != 1) ||
+        (ctxt->index_size > 0 && fwrite(ctxt->index, sizeof(buffcontent_index_entry_t), ctxt->index_size, ctxt->fd) != ctxt->index_size) ||
+        fwrite(&footer, sizeof(footer), 1, ctxt->fd) != 1)
+    {
+        fprintf(stderr, "unable to write index to %s\n", ctxt->filename);
+        return 1;
+    }
+    return 0;
+}
+
+static inline void _close_context(logger_context_t *ctxt)
+{
+    if (ctxt->fd && ctxt->write_index)
+    {
+        int rc = _write_index(ctxt);
+        if (rc)
+            fprintf(stderr, "_write_index() failed: %d\n", rc);
+        ctxt->write_index = false;
+    }
+
+    if (ctxt->map)
+    {
+        munmap(ctxt->map, ctxt->map_size);
+        ctxt->map = NULL;
+        ctxt->map_size = 0;
+    }
+
+    if (ctxt->index && !ctxt->index_mapped)
+        free(ctxt->index);
+    ctxt->index = NULL;
+    ctxt->index_size = 0;
+    ctxt->index_max = 0;
+    ctxt->index_mapped = false;
+}
+
 static inline int _close_buffcontent_file(buffcontent_logger_t *logger)
 {
+    _close_report(logger, SEND_CONTEXT_IDX);
+    _close_report(logger, RECV_CONTEXT_IDX);
+    _close_context(&(logger->ctxt[SEND_CONTEXT_IDX]));
+    _close_context(&(logger->ctxt[RECV_CONTEXT_IDX]));
+
     if (logger->ctxt[0].fd)
     {
         fclose(logger->ctxt[0].fd);
@@ -106,6 +184,292 @@ int release_buffcontent_loggers()
     }
     buffcontent_loggers_head = NULL;
     buffcontent_loggers_tail = NULL;
+
+    digest_fini();
+    if (record_buf != NULL)
+    {
+        free(record_buf);
+        record_buf = NULL;
+        record_buf_size = 0;
+    }
+    if (tasks_buf != NULL)
+    {
+        free(tasks_buf);
+        tasks_buf = NULL;
+        tasks_buf_size = 0;
+    }
+    if (pack_buf != NULL)
+    {
+        free(pack_buf);
+        pack_buf = NULL;
+        pack_buf_size = 0;
+    }
+    datatype_fini();
+    return 0;
+}
+
+static inline void _ensure_scratch_buffers(size_t num_tasks, size_t record_size)
+{
+    if (num_tasks > tasks_buf_size)
+    {
+        tasks_buf = realloc(tasks_buf, num_tasks * sizeof(digest_task_t));
+        assert(tasks_buf);
+        tasks_buf_size = num_tasks;
+    }
+    if (record_size > record_buf_size)
+    {
+        record_buf = realloc(record_buf, record_size);
+        assert(record_buf);
+        record_buf_size = record_size;
+    }
+}
+
+static inline void _digest_to_hex(unsigned char *digest, size_t size, char *str)
+{
+    size_t j;
+    for (j = 0; j < size; j++)
+    {
+        // 3 because it adds EOC
+        snprintf(&str[j * 2], 3, "%02x", digest[j]);
+    }
+}
+
+int write_buffcontent_header(logger_context_t *ctxt)
+{
+    buffcontent_file_header_t header;
+
+    ctxt->engine = digest_get_engine();
+    memcpy(header.magic, BUFFCONTENT_FILE_MAGIC, BUFFCONTENT_FILE_MAGIC_LEN);
+    header.format_version = FORMAT_VERSION;
+    header.engine = ctxt->engine;
+    header.digest_size = digest_size(ctxt->engine);
+    header.reserved = 0;
+    if (fwrite(&header, sizeof(header), 1, ctxt->fd) != 1)
+    {
+        fprintf(stderr, "unable to write header to %s\n", ctxt->filename);
+        return 1;
+    }
+    ctxt->write_index = true;
+    return 0;
+}
+
+static inline void _index_add(logger_context_t *ctxt, uint64_t call, uint64_t offset)
+{
+    if (ctxt->index_size >= ctxt->index_max)
+    {
+        ctxt->index_max = ctxt->index_max == 0 ? 1024 : ctxt->index_max * 2;
+        ctxt->index = realloc(ctxt->index, ctxt->index_max * sizeof(buffcontent_index_entry_t));
+        assert(ctxt->index);
+    }
+    ctxt->index[ctxt->index_size].call = call;
+    ctxt->index[ctxt->index_size].offset = offset;
+    ctxt->index_size++;
+}
+
+// _rebuild_index scans the records of a file without index. A truncated record at the
+// end of the file is ignored.
+static void _rebuild_index(logger_context_t *ctxt, size_t end)
+{
+    size_t dsize = digest_size(ctxt->engine);
+    size_t entry_size = sizeof(uint32_t) + dsize;
+    size_t record_header_size = sizeof(uint64_t) + sizeof(uint32_t) + dsize;
+    size_t offset = sizeof(buffcontent_file_header_t);
+
+    while (offset + record_header_size <= end)
+    {
+        uint64_t call;
+        uint32_t num_digests;
+        memcpy(&call, &(ctxt->map[offset]), sizeof(call));
+        memcpy(&num_digests, &(ctxt->map[offset + sizeof(call)]), sizeof(num_digests));
+        size_t record_size = record_header_size + num_digests * entry_size;
+        if (offset + record_size > end)
+            break;
+        _index_add(ctxt, call, offset);
+        offset += record_size;
+    }
+}
+
+int map_buffcontent_file(logger_context_t *ctxt)
+{
+    struct stat st;
+    buffcontent_file_header_t header;
+    buffcontent_file_footer_t footer;
+
+    if (fstat(fileno(ctxt->fd), &st) != 0 || (size_t)st.st_size < sizeof(header))
+    {
+        fprintf(stderr, "%s is not a valid buffer content file\n", ctxt->filename);
+        return -1;
+    }
+    ctxt->map_size = st.st_size;
+    ctxt->map = mmap(NULL, ctxt->map_size, PROT_READ, MAP_PRIVATE, fileno(ctxt->fd), 0);
+    if (ctxt->map == MAP_FAILED)
+    {
+        fprintf(stderr, "unable to map %s\n", ctxt->filename);
+        ctxt->map = NULL;
+        ctxt->map_size = 0;
+        return -1;
+    }
+
+    memcpy(&header, ctxt->map, sizeof(header));
+    if (memcmp(header.magic, BUFFCONTENT_FILE_MAGIC, BUFFCONTENT_FILE_MAGIC_LEN) != 0)
+    {
+        fprintf(stderr, "%s is not a valid buffer content file\n", ctxt->filename);
+        return -1;
+    }
+    if (header.format_version != FORMAT_VERSION)
+    {
+        fprintf(stderr, "incompatible version (%d vs. %d)\n", header.format_version, FORMAT_VERSION);
+        return -1;
+    }
+    // The data is compared using the engine used to create the file
+    ctxt->engine = (digest_engine_t)header.engine;
+    if (header.digest_size != digest_size(ctxt->engine))
+    {
+        fprintf(stderr, "invalid digest size (%d vs. %zu)\n", header.digest_size, digest_size(ctxt->engine));
+        return -1;
+    }
+    if (digest_set_engine(ctxt->engine))
+    {
+        fprintf(stderr, "digest engine %s used by %s is not available\n", digest_engine_name(ctxt->engine), ctxt->filename);
+        return -1;
+    }
+
+    if (ctxt->map_size >= sizeof(header) + sizeof(footer))
+    {
+        memcpy(&footer, &(ctxt->map[ctxt->map_size - sizeof(footer)]), sizeof(footer));
+        if (memcmp(footer.magic, BUFFCONTENT_INDEX_MAGIC, BUFFCONTENT_INDEX_MAGIC_LEN) == 0 &&
+            footer.index_offset % sizeof(uint64_t) == 0 &&
+            footer.index_offset + footer.num_entries * sizeof(buffcontent_index_entry_t) + sizeof(footer) == ctxt->map_size)
+        {
+            ctxt->index = (buffcontent_index_entry_t *)&(ctxt->map[footer.index_offset]);
+            ctxt->index_size = footer.num_entries;
+            ctxt->index_mapped = true;
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "%s has no index, scanning the records\n", ctxt->filename);
+    _rebuild_index(ctxt, ctxt->map_size);
+    return 0;
+}
+
+// _lookup_record returns the record of a call from the mapped file, NULL if the call has no record
+static unsigned char *_lookup_record(logger_context_t *ctxt, uint64_t n_call)
+{
+    uint64_t low = 0;
+    uint64_t high = ctxt->index_size;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        if (ctxt->index[mid].call < n_call)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low < ctxt->index_size && ctxt->index[low].call == n_call)
+        return &(ctxt->map[ctxt->index[low].offset]);
+    return NULL;
+}
+
+// _prepare_digest_tasks describes the data of all the peers with data as digest tasks; the
+// digest of each task is computed directly in the entry of the record buffer of the peer.
+// The data is accessed through the layout of the datatype so non-contiguous data is not
+// copied, unless the datatype cannot be flattened, in which case the data is packed.
+static void _prepare_digest_tasks(MPI_Datatype dt, MPI_Comm comm, void *buf, int counts[], int displs[], int num_blocks, size_t entry_size, uint32_t *num_tasks)
+{
+    datatype_layout_t *layout = NULL;
+    MPI_Aint lb, extent;
+    int position = 0;
+    uint32_t n = 0;
+    int i;
+
+    _ensure_scratch_buffers(num_blocks, num_blocks * entry_size);
+    PMPI_Type_get_extent(dt, &lb, &extent);
+    int rc = datatype_get_layout(dt, &layout);
+    if (rc)
+    {
+        int pack_size = 0;
+        for (i = 0; i < num_blocks; i++)
+        {
+            int size;
+            PMPI_Pack_size(counts[i], dt, comm, &size);
+            pack_size += size;
+        }
+        if ((size_t)pack_size > pack_buf_size)
+        {
+            pack_buf = realloc(pack_buf, pack_size);
+            assert(pack_buf);
+            pack_buf_size = pack_size;
+        }
+    }
+
+    for (i = 0; i < num_blocks; i++)
+    {
+        if (counts[i] == 0)
+        {
+            continue;
+        }
+
+        unsigned char *entry = &(record_buf[n * entry_size]);
+        uint32_t peer = i;
+        memcpy(entry, &peer, sizeof(peer));
+        digest_task_t *task = &(tasks_buf[n]);
+        task->digest = entry + sizeof(uint32_t);
+        task->blocks = NULL;
+        void *ptr = (void *)((uintptr_t)buf + (displs != NULL ? displs[i] : 0) * extent);
+        if (layout == NULL)
+        {
+            int start = position;
+            PMPI_Pack(ptr, counts[i], dt, pack_buf, pack_buf_size, &position, comm);
+            task->buf = &(pack_buf[start]);
+            task->len = position - start;
+        }
+        else
+        {
+            task->buf = ptr;
+            task->len = (size_t)counts[i] * layout->size;
+            if (!layout->is_contiguous)
+            {
+                task->blocks = layout->blocks;
+                task->num_blocks = layout->num_blocks;
+                task->count = counts[i];
+                task->extent = layout->extent;
+            }
+        }
+        n++;
+    }
+    *num_tasks = n;
+}
+
+// _write_call_digests computes the digests of the blocks of all the peers with data and
+// writes them as a single record. The digests are computed directly in the record.
+static int _write_call_digests(logger_context_t *ctxt, uint64_t n_call, MPI_Datatype dt, MPI_Comm comm, void *buf, int counts[], int displs[], int num_blocks)
+{
+    size_t dsize = digest_size(ctxt->engine);
+    size_t entry_size = sizeof(uint32_t) + dsize;
+    uint32_t num_digests = 0;
+
+    _prepare_digest_tasks(dt, comm, buf, counts, displs, num_blocks, entry_size, &num_digests);
+
+    int rc = digest_compute_tasks(ctxt->engine, tasks_buf, num_digests);
+    if (rc)
+    {
+        fprintf(stderr, "digest_compute_tasks() failed: %d\n", rc);
+        return rc;
+    }
+
+    unsigned char root[DIGEST_MAX_SIZE];
+    digest_compute(ctxt->engine, record_buf, num_digests * entry_size, root);
+    _index_add(ctxt, n_call, ftello(ctxt->fd));
+
+    if (fwrite(&n_call, sizeof(n_call), 1, ctxt->fd) != 1 ||
+        fwrite(&num_digests, sizeof(num_digests), 1, ctxt->fd) != 1 ||
+        fwrite(root, dsize, 1, ctxt->fd) != 1 ||
+        (num_digests > 0 && fwrite(record_buf, entry_size, num_digests, ctxt->fd) != num_digests))
+    {
+        fprintf(stderr, "unable to write digests to %s\n", ctxt->filename);
+        return 1;
+    }
     return 0;
 }
 
@@ -125,36 +489,9 @@ int store_call_data(char *collective_name, int ctxt, MPI_Comm comm, int comm_ran
         return rc;
     }
     assert(buffcontent_logger);
-    DT_CHECK(dt);
-    int dtsize;
-    PMPI_Type_size(dt, &dtsize);
-
-    int i;
     int comm_size;
     PMPI_Comm_size(comm, &comm_size);
-    fprintf(buffcontent_logger->ctxt[ctxt].fd, "Call %" PRIu64 "\n", n_call);
-    for (i = 0; i < comm_size; i++)
-    {
-        if (counts[i] == 0)
-        {
-            continue;
-        }
-
-        size_t data_size = counts[i] * dtsize;
-        void *ptr = (void *)((uintptr_t)buf + (uintptr_t)(displs[i] * dtsize));
-        size_t j;
-        unsigned char sha256_buff[32];
-        SHA256(ptr, data_size, sha256_buff);
-        for (j = 0; j < 32; j++)
-        {
-            fprintf(buffcontent_logger->ctxt[ctxt].fd, "%02x", sha256_buff[j]);
-        }
-        fprintf(buffcontent_logger->ctxt[ctxt].fd, "\n");
-    }
-    fprintf(buffcontent_logger->ctxt[ctxt].fd, "\n");
-    // fflush(buffcontent_logger->ctxt[ctxt].fd);
-
-    return 0;
+    return _write_call_digests(&(buffcontent_logger->ctxt[ctxt]), n_call, dt, comm, buf, counts, displs, comm_size);
 }
 
 int store_call_data_single_count(char *collective_name, int ctxt, MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, void *buf, int count, MPI_Datatype dt)
@@ -173,32 +510,160 @@ int store_call_data_single_count(char *collective_name, int ctxt, MPI_Comm comm,
         return rc;
     }
     assert(buffcontent_logger);
-    DT_CHECK(dt);
-    int dtsize;
-    PMPI_Type_size(dt, &dtsize);
+    return _write_call_digests(&(buffcontent_logger->ctxt[ctxt]), n_call, dt, comm, buf, &count, NULL, 1);
+}
 
-    int i;
-    int comm_size;
-    PMPI_Comm_size(comm, &comm_size);
-    fprintf(buffcontent_logger->ctxt[ctxt].fd, "Call %" PRIu64 "\n", n_call);
-    if (count != 0)
-    {
-        size_t data_size = count * dtsize;
-        size_t j;
-        unsigned char sha256_buff[32];
-        SHA256(buf, data_size, sha256_buff);
-        for (j = 0; j < 32; j++)
+static int _open_report(buffcontent_logger_t *logger, int ctxt)
+{
+    logger_context_t *lctxt = &(logger->ctxt[ctxt]);
+    char *output_dir = get_output_dir();
+    char *ctxt_str = ctxt == RECV_CONTEXT_IDX ? RECV_CONTEXT_ID : SEND_CONTEXT_ID;
+    int rc;
+
+    if (output_dir)
+    {
+        _asprintf(lctxt->report_filename, rc, "%s/%s_buffcontent_divergences_comm%" PRIu64 "_rank%d_%s.md", output_dir, logger->collective_name, logger->comm_id, logger->world_rank, ctxt_str);
+        assert(rc > 0);
+    }
+    else
+    {
+        _asprintf(lctxt->report_filename, rc, "%s_buffcontent_divergences_comm%" PRIu64 "_rank%d_%s.md", logger->collective_name, logger->comm_id, logger->world_rank, ctxt_str);
+        assert(rc > 0);
+    }
+
+    lctxt->report_fd = fopen(lctxt->report_filename, "w");
+    if (lctxt->report_fd == NULL)
+    {
+        fprintf(stderr, "unable to create %s\n", lctxt->report_filename);
+        return 1;
+    }
+    FORMAT_VERSION_WRITE(lctxt->report_fd);
+    fprintf(lctxt->report_fd, "Reference: %s\n", lctxt->filename);
+    return 0;
+}
+
+// _report_divergences compares the digests of the blocks of a call for which the root
+// digests differ and adds the peers with different content to the report. Both sets
+// of entries are sorted by peer. Calls without record in the reference are also reported.
+static int _report_divergences(buffcontent_logger_t *logger, int ctxt, uint64_t n_call, bool has_reference, unsigned char *local, uint32_t num_local, unsigned char *stored, uint32_t num_stored)
+{
+    logger_context_t *lctxt = &(logger->ctxt[ctxt]);
+    size_t dsize = digest_size(lctxt->engine);
+    size_t entry_size = sizeof(uint32_t) + dsize;
+    char data[2 * DIGEST_MAX_SIZE + 1];
+    char ref[2 * DIGEST_MAX_SIZE + 1];
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    if (lctxt->report_fd == NULL)
+    {
+        int rc = _open_report(logger, ctxt);
+        if (rc)
+            return rc;
+    }
+
+    lctxt->num_diverged_calls++;
+    fprintf(lctxt->report_fd, "\n# Call %" PRIu64 "\n\n", n_call);
+    if (!has_reference)
+    {
+        fprintf(lctxt->report_fd, "No reference data\n");
+        fflush(lctxt->report_fd);
+        return 0;
+    }
+    if (num_local != num_stored)
+        fprintf(lctxt->report_fd, "Number of blocks differ: %" PRIu32 " vs. %" PRIu32 "\n", num_local, num_stored);
+
+    while (i < num_local || j < num_stored)
+    {
+        uint32_t local_peer = UINT32_MAX;
+        uint32_t stored_peer = UINT32_MAX;
+        if (i < num_local)
+            memcpy(&local_peer, &(local[i * entry_size]), sizeof(uint32_t));
+        if (j < num_stored)
+            memcpy(&stored_peer, &(stored[j * entry_size]), sizeof(uint32_t));
+
+        if (local_peer == stored_peer)
+        {
+            unsigned char *local_digest = &(local[i * entry_size + sizeof(uint32_t)]);
+            unsigned char *stored_digest = &(stored[j * entry_size + sizeof(uint32_t)]);
+            if (memcmp(local_digest, stored_digest, dsize) != 0)
+            {
+                _digest_to_hex(local_digest, dsize, data);
+                _digest_to_hex(stored_digest, dsize, ref);
+                fprintf(lctxt->report_fd, "Peer %" PRIu32 ": %s vs. %s\n", local_peer, data, ref);
+            }
+            i++;
+            j++;
+        }
+        else if (local_peer < stored_peer)
         {
-            fprintf(buffcontent_logger->ctxt[ctxt].fd, "%02x", sha256_buff[j]);
+            fprintf(lctxt->report_fd, "Peer %" PRIu32 ": no data in the reference\n", local_peer);
+            i++;
         }
-        fprintf(buffcontent_logger->ctxt[ctxt].fd, "\n");
+        else
+        {
+            fprintf(lctxt->report_fd, "Peer %" PRIu32 ": no data in this execution\n", stored_peer);
+            j++;
+        }
+    }
+    // Make sure the report is complete if the application is aborted
+    fflush(lctxt->report_fd);
+    return 0;
+}
+
+// _compare_call_digests compares the data of the current call with its record from the
+// reference file. The root digests are compared first; the digests of the blocks are only
+// compared when the root digests differ, in which case the peers with different content
+// are reported.
+static int _compare_call_digests(buffcontent_logger_t *logger, int ctxt, uint64_t n_call, MPI_Datatype dt, MPI_Comm comm, void *buf, int counts[], int displs[], int num_blocks)
+{
+    logger_context_t *lctxt = &(logger->ctxt[ctxt]);
+    size_t dsize = digest_size(lctxt->engine);
+    size_t entry_size = sizeof(uint32_t) + dsize;
+    unsigned char local_root[DIGEST_MAX_SIZE];
+
+    unsigned char *record = _lookup_record(lctxt, n_call);
+    uint32_t num_digests = 0;
+    unsigned char *stored_root = NULL;
+    unsigned char *stored_digests = NULL;
+    if (record != NULL)
+    {
+        memcpy(&num_digests, &(record[sizeof(uint64_t)]), sizeof(num_digests));
+        stored_root = &(record[sizeof(uint64_t) + sizeof(uint32_t)]);
+        stored_digests = stored_root + dsize;
+    }
+
+    uint32_t num_local_digests = 0;
+    _prepare_digest_tasks(dt, comm, buf, counts, displs, num_blocks, entry_size, &num_local_digests);
+
+    int rc = digest_compute_tasks(lctxt->engine, tasks_buf, num_local_digests);
+    if (rc)
+    {
+        fprintf(stderr, "digest_compute_tasks() failed: %d\n", rc);
+        return rc;
+    }
+    digest_compute(lctxt->engine, record_buf, num_local_digests * entry_size, local_root);
+    lctxt->num_checked_calls++;
+
+    if (record != NULL && num_local_digests == num_digests && memcmp(local_root, stored_root, dsize) == 0)
+        return 0;
+
+    // The content differ, we drill down to the blocks
+    rc = _report_divergences(logger, ctxt, n_call, record != NULL, record_buf, num_local_digests, stored_digests, num_digests);
+    if (rc)
+    {
+        fprintf(stderr, "_report_divergences() failed: %d\n", rc);
+        return rc;
     }
-    fprintf(buffcontent_logger->ctxt[ctxt].fd, "\n");
     return 0;
 }
 
 int read_and_compare_call_data(char *collective_name, int ctxt, MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, void *buf, int counts[], int displs[], MPI_Datatype dt, bool check)
 {
+    // Records are directly accessed so calls that are not checked are simply skipped
+    if (!check)
+        return 0;
+
     buffcontent_logger_t *buffcontent_logger = NULL;
     int rc = get_buffcontent_logger(collective_name,
                                     ctxt,
@@ -209,46 +674,26 @@ int read_and_compare_call_data(char *collective_name, int ctxt, MPI_Comm comm, i
                                     &buffcontent_logger);
     if (rc)
         return rc;
-    DT_CHECK(dt);
-    int dtsize;
-    PMPI_Type_size(dt, &dtsize);
-
-    int i;
     int comm_size;
     PMPI_Comm_size(comm, &comm_size);
+    return _compare_call_digests(buffcontent_logger, ctxt, n_call, dt, comm, buf, counts, displs, comm_size);
+}
 
-    // Read header ("Call X\n")
-    uint64_t num_call;
-    fscanf(buffcontent_logger->ctxt[ctxt].fd, "Call %" PRIu64 "\n", &num_call);
-    for (i = 0; i < comm_size; i++)
-    {
-        if (counts[i] == 0)
-        {
-            continue;
-        }
-
-        size_t data_size = counts[i] * dtsize;
-        void *ptr = (void *)((uintptr_t)buf + (uintptr_t)(displs[i] * dtsize));
-        char buff[255];
-        fscanf(buffcontent_logger->ctxt[ctxt].fd, "%254s\n", buff);
-        if (check)
-        {
-            unsigned char sha256_buff[32];
-            SHA256(ptr, data_size, sha256_buff);
-            char data[255];
-            size_t j;
-            for (j = 0; j < 32; j++)
-            {
-                // 3 because it adds EOC
-                snprintf(&data[j * 2], 3, "%02x", sha256_buff[j]);
-            }
+int read_and_compare_call_data_single_count(char *collective_name, int ctxt, MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, void *buf, int count, MPI_Datatype dt, bool check)
+{
+    // Records are directly accessed so calls that are not checked are simply skipped
+    if (!check)
+        return 0;
 
-            if (strcmp(data, buff) != 0)
-            {
-                fprintf(stderr, "Rank %d: Content differ for call %" PRIu64 " (%s vs. %s)\n", world_rank, n_call, data, buff);
-                PMPI_Abort(comm, 1);
-            }
-        }
-    }
-    fscanf(buffcontent_logger->ctxt[ctxt].fd, "\n");
+    buffcontent_logger_t *buffcontent_logger = NULL;
+    int rc = get_buffcontent_logger(collective_name,
+                                    ctxt,
+                                    "r",
+                                    comm,
+                                    world_rank,
+                                    comm_rank,
+                                    &buffcontent_logger);
+    if (rc)
+        return rc;
+    return _compare_call_digests(buffcontent_logger, ctxt, n_call, dt, comm, buf, &count, NULL, 1);
 }
@@ -17,8 +17,11 @@
 #include "common_utils.h"
 #include "format.h"
 #include "comm.h"
+#include "digest.h"
+#include "datatype.h"
 
 #define COLLECTIVE_PROFILER_MAX_CALL_CHECK_BUFF_CONTENT_ENVVAR "COLLECTIVE_PROFILER_MAX_CALL_CHECK_BUFF_CONTENT"
+#define COLLECTIVE_PROFILER_MIN_CALL_CHECK_BUFF_CONTENT_ENVVAR "COLLECTIVE_PROFILER_MIN_CALL_CHECK_BUFF_CONTENT"
 #define COLLECTIVE_PROFILER_CHECK_SEND_BUFF_ENVVAR "COLLECTIVE_PROFILER_CHECK_SEND_BUFF"
 
 #define SEND_CONTEXT_ID "send"
@@ -27,11 +30,63 @@
 #define RECV_CONTEXT_IDX (1)
 #define MAX_LOGGER_CONTEXTS (2) // Recv and send contexts
 
+// Digests are stored in binary files: a header followed by one record per call. A record
+// is made of the call number (uint64_t), the number of digests (uint32_t), the root digest
+// of the call and, for each peer with data, the index of the peer (uint32_t) followed by
+// the digest of its block. The root digest is the digest of all the (peer, digest) entries
+// of the call so calls can be compared without reading the digests of the blocks.
+#define BUFFCONTENT_FILE_MAGIC "CPDIGEST"
+#define BUFFCONTENT_FILE_MAGIC_LEN (8)
+
+typedef struct buffcontent_file_header
+{
+    char magic[BUFFCONTENT_FILE_MAGIC_LEN];
+    uint32_t format_version;
+    uint32_t engine;
+    uint32_t digest_size;
+    uint32_t reserved;
+} buffcontent_file_header_t;
+
+// Once all the records are written, an index giving the offset of the record of each call
+// is appended to the file, aligned on 8 bytes: an array of buffcontent_index_entry_t sorted
+// by call number, followed by a footer. When comparing, files are memory-mapped and the
+// index is used to directly access the record of any call. If the file has no index, e.g.
+// because the application was aborted, the index is rebuilt by scanning the records.
+#define BUFFCONTENT_INDEX_MAGIC "CPDINDEX"
+#define BUFFCONTENT_INDEX_MAGIC_LEN (8)
+
+typedef struct buffcontent_index_entry
+{
+    uint64_t call;
+    uint64_t offset;
+} buffcontent_index_entry_t;
+
+typedef struct buffcontent_file_footer
+{
+    uint64_t index_offset;
+    uint64_t num_entries;
+    char magic[BUFFCONTENT_INDEX_MAGIC_LEN];
+} buffcontent_file_footer_t;
+
 typedef struct logger_context
 {
     char *name;
     FILE *fd;
     char *filename;
+    digest_engine_t engine; // Digest engine used for the file
+    // Index of the records, built while saving the data, loaded from the file when comparing
+    buffcontent_index_entry_t *index;
+    uint64_t index_size;
+    uint64_t index_max;
+    bool index_mapped; // The index points to the mapped file
+    bool write_index;  // The index is appended to the file when closing it
+    unsigned char *map;
+    size_t map_size;
+    // Report of the calls with content that differ from the reference, only used when comparing
+    FILE *report_fd;
+    char *report_filename;
+    uint64_t num_checked_calls;
+    uint64_t num_diverged_calls;
 } logger_context_t;
 
 // buffcontent_logger is the central structure to track and profile backtrace in
@@ -53,109 +108,6 @@ extern buffcontent_logger_t *buffcontent_loggers_head;
 extern buffcontent_logger_t *buffcontent_loggers_tail;
 extern char *get_output_dir();
 
-static inline void
-_display_config(int dt_num_intergers, int dt_num_addresses, int dt_num_datatypes, int dt_combiner)
-{
-    fprintf(stderr, "-> Num datatypes: %d\n", dt_num_datatypes);
-    switch (dt_combiner)
-    {
-    case MPI_COMBINER_NAMED:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_NAMED\n");
-        break;
-    }
-    case MPI_COMBINER_DUP:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_DUP\n");
-        break;
-    }
-    case MPI_COMBINER_CONTIGUOUS:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_CONTIGUOUS\n");
-        break;
-    }
-    case MPI_COMBINER_VECTOR:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_VECTOR\n");
-        break;
-    }
-    case MPI_COMBINER_HVECTOR:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_HVECTOR\n");
-        break;
-    }
-    case MPI_COMBINER_INDEXED:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_INDEXED\n");
-        break;
-    }
-    case MPI_COMBINER_HINDEXED:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_HINDEXED\n");
-        break;
-    }
-    case MPI_COMBINER_INDEXED_BLOCK:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_INDEXED_BLOCK\n");
-        break;
-    }
-    case MPI_COMBINER_STRUCT:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_STRUCT\n");
-        break;
-    }
-    case MPI_COMBINER_SUBARRAY:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_SUBARRAY\n");
-        break;
-    }
-    case MPI_COMBINER_DARRAY:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_DARRAY\n");
-        break;
-    }
-    case MPI_COMBINER_F90_REAL:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_F90_REAL\n");
-        break;
-    }
-    case MPI_COMBINER_F90_COMPLEX:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_F90_COMPLEX\n");
-        break;
-    }
-    case MPI_COMBINER_F90_INTEGER:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_F90_INTEGER\n");
-        break;
-    }
-    case MPI_COMBINER_RESIZED:
-    {
-        fprintf(stderr, "-> Combiner: MPI_COMBINER_RESIZED\n");
-        break;
-    }
-    default:
-
-        fprintf(stderr, "-> Combiner: unknown\n");
-    }
-}
-
-#define DT_CHECK(dt)                                                                                                \
-    do                                                                                                              \
-    {                                                                                                               \
-        int dt_num_intergers;                                                                                       \
-        int dt_num_addresses;                                                                                       \
-        int dt_num_datatypes;                                                                                       \
-        int dt_combiner;                                                                                            \
-        PMPI_Type_get_envelope(dt, &dt_num_intergers, &dt_num_addresses, &dt_num_datatypes, &dt_combiner);          \
-        if (dt_num_datatypes > 1 || !(dt_combiner == MPI_COMBINER_CONTIGUOUS || dt_combiner == MPI_COMBINER_NAMED)) \
-        {                                                                                                           \
-            fprintf(stderr, "Unsupported datatype configuration\n");                                                \
-            _display_config(dt_num_intergers, dt_num_addresses, dt_num_datatypes, dt_combiner);                     \
-            MPI_Abort(MPI_COMM_WORLD, 1);                                                                           \
-        }                                                                                                           \
-    } while (0)
-
 static inline int
 lookup_buffcontent_logger(char *collective_name, MPI_Comm comm, buffcontent_logger_t **logger)
 {
@@ -187,12 +139,12 @@ open_content_storage_file(char *collective_name, char **filename, FILE **file, u
     {
         if (_output_dir)
         {
-            _asprintf(_filename, rc, "%s/%s_buffcontent_comm%" PRIu64 "_rank%d.txt", _output_dir, collective_name, comm_id, world_rank);
+            _asprintf(_filename, rc, "%s/%s_buffcontent_comm%" PRIu64 "_rank%d.bin", _output_dir, collective_name, comm_id, world_rank);
             assert(rc > 0);
         }
         else
         {
-            _asprintf(_filename, rc, "%s_buffcontent_comm%" PRIu64 "_rank%d.txt", collective_name, comm_id, world_rank);
+            _asprintf(_filename, rc, "%s_buffcontent_comm%" PRIu64 "_rank%d.bin", collective_name, comm_id, world_rank);
             assert(rc > 0);
         }
     }
@@ -203,12 +155,12 @@ open_content_storage_file(char *collective_name, char **filename, FILE **file, u
             _ctxt = "recv";
         if (_output_dir)
         {
-            _asprintf(_filename, rc, "%s/%s_buffcontent_comm%" PRIu64 "_rank%d_%s.txt", _output_dir, collective_name, comm_id, world_rank, _ctxt);
+            _asprintf(_filename, rc, "%s/%s_buffcontent_comm%" PRIu64 "_rank%d_%s.bin", _output_dir, collective_name, comm_id, world_rank, _ctxt);
             assert(rc > 0);
         }
         else
         {
-            _asprintf(_filename, rc, "%s_buffcontent_comm%" PRIu64 "_rank%d_%s.txt", collective_name, comm_id, world_rank, _ctxt);
+            _asprintf(_filename, rc, "%s_buffcontent_comm%" PRIu64 "_rank%d_%s.bin", collective_name, comm_id, world_rank, _ctxt);
             assert(rc > 0);
         }
     }
@@ -237,6 +189,20 @@ init_buffcontent_logger(char *collective_name, int world_rank, MPI_Comm comm, ui
     new_logger->ctxt[1].fd = NULL;
     new_logger->ctxt[0].filename = NULL;
     new_logger->ctxt[1].filename = NULL;
+    for (int i = 0; i < MAX_LOGGER_CONTEXTS; i++)
+    {
+        new_logger->ctxt[i].index = NULL;
+        new_logger->ctxt[i].index_size = 0;
+        new_logger->ctxt[i].index_max = 0;
+        new_logger->ctxt[i].index_mapped = false;
+        new_logger->ctxt[i].write_index = false;
+        new_logger->ctxt[i].map = NULL;
+        new_logger->ctxt[i].map_size = 0;
+        new_logger->ctxt[i].report_fd = NULL;
+        new_logger->ctxt[i].report_filename = NULL;
+        new_logger->ctxt[i].num_checked_calls = 0;
+        new_logger->ctxt[i].num_diverged_calls = 0;
+    }
 
     if (buffcontent_loggers_head == NULL)
     {
@@ -256,6 +222,9 @@ init_buffcontent_logger(char *collective_name, int world_rank, MPI_Comm comm, ui
     return 0;
 }
 
+int write_buffcontent_header(logger_context_t *ctxt);
+int map_buffcontent_file(logger_context_t *ctxt);
+
 static inline int
 get_buffcontent_logger(char *collective_name, int ctxt, char *mode, MPI_Comm comm, int world_rank, int comm_rank, buffcontent_logger_t **buffcontent_logger)
 {
@@ -304,18 +273,22 @@ get_buffcontent_logger(char *collective_name, int ctxt, char *mode, MPI_Comm com
         }
         if (strcmp(mode, "w") == 0)
         {
-            // Write the format version at the begining of the file
-            FORMAT_VERSION_WRITE(logger->ctxt[ctxt].fd);
+            // Write the header, which includes the format version, at the begining of the file
+            rc = write_buffcontent_header(&(logger->ctxt[ctxt]));
+            if (rc)
+            {
+                fprintf(stderr, "write_buffcontent_header() failed: %d\n", rc);
+                return rc;
+            }
         }
         else
         {
-            // Read the format version so we can continue to read the file once we return from the function
-            int version;
-            fscanf(logger->ctxt[ctxt].fd, "FORMAT_VERSION: %d\n\n", &version);
-            if (version != FORMAT_VERSION)
+            // Map the file and load its index so the record of any call can be accessed
+            rc = map_buffcontent_file(&(logger->ctxt[ctxt]));
+            if (rc)
             {
-                fprintf(stderr, "incompatible version (%d vs. %d)\n", version, FORMAT_VERSION);
-                return -1;
+                fprintf(stderr, "map_buffcontent_file() failed: %d\n", rc);
+                return rc;
             }
         }
     }
@@ -325,62 +298,10 @@ get_buffcontent_logger(char *collective_name, int ctxt, char *mode, MPI_Comm com
     return 0;
 }
 
-static inline void
-save_buf_content(void *buf, const int *counts, const int *displs, MPI_Datatype type, MPI_Comm comm, int rank, char *ctxt)
-{
-    assert(buf);
-    assert(counts);
-    assert(displs);
-    assert(ctxt);
-
-    int size;
-    PMPI_Comm_size(comm, &size);
-    int dtsz;
-    PMPI_Type_size(type, &dtsz);
-
-    char *filename = NULL;
-    char *output_dir = NULL;
-    int rc;
-    output_dir = get_output_dir();
-    if (output_dir)
-    {
-        _asprintf(filename, rc, "%s/data_%s_rank%d.txt", output_dir, ctxt, rank);
-        assert(rc > 0);
-    }
-    else
-    {
-        _asprintf(filename, rc, "data_%s_rank%d.txt", ctxt, rank);
-        assert(rc > 0);
-    }
-
-    FILE *f = fopen(filename, "w");
-    assert(f);
-
-    int i;
-    for (i = 0; i < size; i++)
-    {
-        int displ = displs[i];
-        int count = counts[i];
-        off_t offset = displ * dtsz;
-        //size_t data_size = count *dtsz;
-
-        // We assume the data is contiguous and that the type is of a type compatible with a C double
-        double *ptr = (double *)((ptrdiff_t)buf + offset);
-        int j;
-        for (j = 0; j < count; j++)
-        {
-            fprintf(f, "%f ", ptr[j]);
-        }
-        fprintf(f, "\n");
-    }
-
-    fclose(f);
-    free(filename);
-}
-
 int store_call_data(char *collective_name, int ctxt, MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, void *buf, int counts[], int displs[], MPI_Datatype dt);
 int store_call_data_single_count(char *collective_name, int ctxt, MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, void *buf, int count, MPI_Datatype dt);
 int read_and_compare_call_data(char *collective_name, int ctxt, MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, void *buf, int counts[], int displs[], MPI_Datatype dt, bool check);
+int read_and_compare_call_data_single_count(char *collective_name, int ctxt, MPI_Comm comm, int comm_rank, int world_rank, uint64_t n_call, void *buf, int count, MPI_Datatype dt, bool check);
 int release_buffcontent_loggers();
 
 #endif // MPI_COLLECTIVE_PROFILER_BUFFCONTENT_H
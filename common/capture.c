@@ -0,0 +1,573 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "capture.h"
+#include "collective_profiler_config.h"
+#include "common_utils.h"
+#include "comm.h"
+#include "datatype.h"
+
+extern char *get_output_dir();
+
+static capture_t *capture = NULL;
+
+static int _cmp_ranges(const void *a, const void *b)
+{
+    const capture_range_t *r1 = (const capture_range_t *)a;
+    const capture_range_t *r2 = (const capture_range_t *)b;
+    if (r1->first < r2->first)
+        return -1;
+    if (r1->first > r2->first)
+        return 1;
+    return 0;
+}
+
+// _sort_ranges sorts the ranges and merges the ones that overlap or are adjacent, so the
+// ranges are disjoint and sorted by both their first and their last call
+static void _sort_ranges(capture_t *c)
+{
+    size_t i, n = 0;
+
+    qsort(c->ranges, c->num_ranges, sizeof(capture_range_t), _cmp_ranges);
+    for (i = 0; i < c->num_ranges; i++)
+    {
+        if (n > 0 && c->ranges[i].first <= c->ranges[n - 1].last + 1)
+        {
+            if (c->ranges[i].last > c->ranges[n - 1].last)
+                c->ranges[n - 1].last = c->ranges[i].last;
+            continue;
+        }
+        c->ranges[n] = c->ranges[i];
+        n++;
+    }
+    c->num_ranges = n;
+}
+
+// _parse_calls parses a list of calls such as "3,10-20"
+static int _parse_calls(capture_t *c, char *str)
+{
+    char *s = strdup(str);
+    char *saveptr = NULL;
+    char *token;
+    size_t max_ranges = 8;
+
+    assert(s);
+    c->ranges = malloc(max_ranges * sizeof(capture_range_t));
+    assert(c->ranges);
+    for (token = strtok_r(s, ",", &saveptr); token != NULL; token = strtok_r(NULL, ",", &saveptr))
+    {
+        char *end = NULL;
+        capture_range_t range;
+        range.first = strtoull(token, &end, 10);
+        range.last = range.first;
+        if (*end == '-')
+            range.last = strtoull(end + 1, &end, 10);
+        if (end == token || *end != '\0' || range.last < range.first)
+        {
+            fprintf(stderr, "invalid list of calls to capture: %s\n", str);
+            free(s);
+            return 1;
+        }
+
+        if (c->num_ranges >= max_ranges)
+        {
+            max_ranges *= 2;
+            c->ranges = realloc(c->ranges, max_ranges * sizeof(capture_range_t));
+            assert(c->ranges);
+        }
+        c->ranges[c->num_ranges] = range;
+        c->num_ranges++;
+    }
+    free(s);
+    _sort_ranges(c);
+    return 0;
+}
+
+static inline void _free_item(capture_item_t *item)
+{
+    free(item->filename);
+    free(item->counts);
+    free(item->displs);
+    free(item->data);
+    free(item);
+}
+
+// _writev_all writes all the vectors; writev may write less than requested, in which case
+// we continue where it stopped. The vectors are modified.
+static int _writev_all(int fd, struct iovec *v, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t n = writev(fd, v, iovcnt);
+        if (n < 0)
+            return 1;
+        while (iovcnt > 0 && (size_t)n >= v->iov_len)
+        {
+            n -= v->iov_len;
+            v++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            v->iov_base = (char *)v->iov_base + n;
+            v->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+static int _write_item(capture_item_t *item)
+{
+    int fd = open(item->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "unable to create %s\n", item->filename);
+        return 1;
+    }
+
+    struct iovec iov[4];
+    size_t peers_size = item->header.num_peers * sizeof(int);
+    iov[0].iov_base = &(item->header);
+    iov[0].iov_len = sizeof(item->header);
+    iov[1].iov_base = item->counts;
+    iov[1].iov_len = peers_size;
+    iov[2].iov_base = item->displs;
+    iov[2].iov_len = peers_size;
+    iov[3].iov_base = item->data;
+    iov[3].iov_len = item->header.data_size;
+    int rc = _writev_all(fd, iov, 4);
+    if (rc)
+        fprintf(stderr, "unable to write to %s\n", item->filename);
+    close(fd);
+    return rc;
+}
+
+// iov_batch accumulates the blocks of memory to write with a single writev call
+typedef struct iov_batch
+{
+    int fd;
+    int iovcnt;
+    struct iovec iov[CAPTURE_IOV_BATCH_SIZE];
+} iov_batch_t;
+
+static inline int _flush_iov_batch(iov_batch_t *batch)
+{
+    int rc = _writev_all(batch->fd, batch->iov, batch->iovcnt);
+    batch->iovcnt = 0;
+    return rc;
+}
+
+static inline int _add_iov(iov_batch_t *batch, const void *base, size_t len)
+{
+    if (len == 0)
+        return 0;
+    if (batch->iovcnt > 0)
+    {
+        // Blocks that follow each other in memory are written as a single block
+        struct iovec *last = &(batch->iov[batch->iovcnt - 1]);
+        if ((const char *)last->iov_base + last->iov_len == (const char *)base)
+        {
+            last->iov_len += len;
+            return 0;
+        }
+    }
+    if (batch->iovcnt == CAPTURE_IOV_BATCH_SIZE)
+    {
+        int rc = _flush_iov_batch(batch);
+        if (rc)
+            return rc;
+    }
+    batch->iov[batch->iovcnt].iov_base = (void *)base;
+    batch->iov[batch->iovcnt].iov_len = len;
+    batch->iovcnt++;
+    return 0;
+}
+
+// _add_peer_data adds the data of a peer to the batch, directly from the buffer of the
+// application when the datatype can be flattened, otherwise from a packed copy
+static int _add_peer_data(iov_batch_t *batch, const char *ptr, int count, MPI_Datatype dt, datatype_layout_t *layout, MPI_Comm comm)
+{
+    int rc;
+    int j;
+    size_t k;
+
+    if (layout == NULL)
+    {
+        int pack_size;
+        int position = 0;
+        PMPI_Pack_size(count, dt, comm, &pack_size);
+        char *packed = malloc(pack_size > 0 ? pack_size : 1);
+        assert(packed);
+        PMPI_Pack(ptr, count, dt, packed, pack_size, &position, comm);
+        // The copy is released right away so it must be written before returning
+        rc = _add_iov(batch, packed, position);
+        if (rc == 0)
+            rc = _flush_iov_batch(batch);
+        free(packed);
+        return rc;
+    }
+
+    if (layout->is_contiguous)
+        return _add_iov(batch, ptr, count * layout->size);
+
+    for (j = 0; j < count; j++)
+    {
+        for (k = 0; k < layout->num_blocks; k++)
+        {
+            rc = _add_iov(batch, ptr + j * layout->extent + layout->blocks[k].offset, layout->blocks[k].len);
+            if (rc)
+                return rc;
+        }
+    }
+    return 0;
+}
+
+void capture_init_header(capture_file_header_t *header, uint64_t n_call, uint32_t comm_id, const int *counts, int num_peers, MPI_Datatype dt)
+{
+    datatype_info_t dt_info = {0};
+    int i;
+
+    analyze_datatype(dt, &dt_info);
+    memset(header, 0, sizeof(capture_file_header_t));
+    memcpy(header->magic, CAPTURE_FILE_MAGIC, CAPTURE_FILE_MAGIC_LEN);
+    header->format_version = FORMAT_VERSION;
+    header->num_peers = num_peers;
+    header->call = n_call;
+    header->comm_id = comm_id;
+    header->element_size = dt_info.size;
+    header->type_id = dt_info.is_predefined ? dt_info.id : UNKNOWN_ID;
+    for (i = 0; i < num_peers; i++)
+        header->data_size += (uint64_t)counts[i] * dt_info.size;
+}
+
+// capture_write_buffer synchronously writes the data of a buffer in a capture file. The
+// data is written directly from the buffer, one vector per contiguous block of memory,
+// without being copied.
+int capture_write_buffer(char *filename, capture_file_header_t *header, const void *buf, const int *counts, const int *displs, MPI_Datatype dt, MPI_Comm comm)
+{
+    datatype_layout_t *layout = NULL;
+    MPI_Aint lb, extent;
+    int *zeros = NULL;
+    int i;
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "unable to create %s\n", filename);
+        return 1;
+    }
+
+    iov_batch_t *batch = malloc(sizeof(iov_batch_t));
+    assert(batch);
+    batch->fd = fd;
+    batch->iovcnt = 0;
+
+    size_t peers_size = header->num_peers * sizeof(int);
+    if (displs == NULL)
+    {
+        zeros = calloc(header->num_peers > 0 ? header->num_peers : 1, sizeof(int));
+        assert(zeros);
+    }
+    int rc = _add_iov(batch, header, sizeof(capture_file_header_t));
+    if (rc == 0)
+        rc = _add_iov(batch, counts, peers_size);
+    if (rc == 0)
+        rc = _add_iov(batch, displs != NULL ? displs : zeros, peers_size);
+
+    PMPI_Type_get_extent(dt, &lb, &extent);
+    if (datatype_get_layout(dt, &layout))
+        layout = NULL;
+    for (i = 0; rc == 0 && i < (int)header->num_peers; i++)
+    {
+        const char *ptr = (const char *)buf + (displs != NULL ? displs[i] : 0) * extent;
+        rc = _add_peer_data(batch, ptr, counts[i], dt, layout, comm);
+    }
+    if (rc == 0)
+        rc = _flush_iov_batch(batch);
+    if (rc)
+        fprintf(stderr, "unable to write to %s\n", filename);
+
+    close(fd);
+    free(batch);
+    free(zeros);
+    return rc;
+}
+
+static void *_writer(void *arg)
+{
+    capture_t *c = (capture_t *)arg;
+
+    pthread_mutex_lock(&c->lock);
+    while (true)
+    {
+        while (c->head == NULL && !c->shutdown)
+            pthread_cond_wait(&c->work_cond, &c->lock);
+        if (c->head == NULL)
+            break;
+
+        capture_item_t *item = c->head;
+        c->head = item->next;
+        if (c->head == NULL)
+            c->tail = NULL;
+        pthread_mutex_unlock(&c->lock);
+
+        int rc = _write_item(item);
+        if (rc)
+            fprintf(stderr, "_write_item() failed: %d\n", rc);
+        size_t size = item->header.data_size;
+        _free_item(item);
+
+        pthread_mutex_lock(&c->lock);
+        c->staged -= size;
+        pthread_cond_broadcast(&c->space_cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+int capture_init(char *collective_name, int world_rank)
+{
+    char *calls_envvar = getenv(COLLECTIVE_PROFILER_CAPTURE_CALLS_ENVVAR);
+    if (calls_envvar == NULL)
+        calls_envvar = getenv(DUMP_CALL_DATA_ENVVAR);
+    // Calls may also be selected at runtime, after a change of the timings
+    char *changepoint_envvar = getenv(CHANGEPOINT_CAPTURE_CALLS_ENVVAR);
+    if (calls_envvar == NULL && (changepoint_envvar == NULL || atoi(changepoint_envvar) <= 0))
+        return 0;
+
+    capture_t *c = calloc(1, sizeof(capture_t));
+    assert(c);
+    int rc = calls_envvar != NULL ? _parse_calls(c, calls_envvar) : 0;
+    if (rc)
+    {
+        free(c->ranges);
+        free(c);
+        return rc;
+    }
+
+    c->collective_name = strdup(collective_name);
+    c->world_rank = world_rank;
+    c->staging_size = CAPTURE_DEFAULT_STAGING_SIZE;
+    char *staging_size_envvar = getenv(COLLECTIVE_PROFILER_CAPTURE_STAGING_SIZE_ENVVAR);
+    if (staging_size_envvar != NULL)
+        c->staging_size = strtoull(staging_size_envvar, NULL, 10);
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->work_cond, NULL);
+    pthread_cond_init(&c->space_cond, NULL);
+    capture = c;
+    return 0;
+}
+
+bool capture_call_selected(uint64_t n_call)
+{
+    if (capture == NULL)
+        return false;
+
+    size_t low = 0;
+    size_t high = capture->num_ranges;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (capture->ranges[mid].last < n_call)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low < capture->num_ranges && capture->ranges[low].first <= n_call;
+}
+
+// capture_add_calls selects more calls to capture, e.g., after a change of the timings;
+// nothing is captured if capturing was not enabled when the profiler was initialized
+void capture_add_calls(uint64_t first, uint64_t last)
+{
+    if (capture == NULL)
+        return;
+    capture->ranges = realloc(capture->ranges, (capture->num_ranges + 1) * sizeof(capture_range_t));
+    assert(capture->ranges);
+    capture->ranges[capture->num_ranges].first = first;
+    capture->ranges[capture->num_ranges].last = last;
+    capture->num_ranges++;
+    _sort_ranges(capture);
+}
+
+// _stage_data reserves space in the staging area, waiting for the writer thread to write
+// data if necessary. Returns false if the data cannot fit in the staging area.
+static bool _stage_data(capture_t *c, size_t size)
+{
+    if (size > c->staging_size)
+        return false;
+
+    pthread_mutex_lock(&c->lock);
+    while (c->staged + size > c->staging_size)
+        pthread_cond_wait(&c->space_cond, &c->lock);
+    c->staged += size;
+    pthread_mutex_unlock(&c->lock);
+    return true;
+}
+
+static void _copy_data(capture_item_t *item, const void *buf, const int *counts, const int *displs, int num_peers, MPI_Datatype dt, MPI_Comm comm)
+{
+    datatype_layout_t *layout = NULL;
+    MPI_Aint lb, extent;
+    size_t offset = 0;
+    int i, j;
+    size_t k;
+
+    PMPI_Type_get_extent(dt, &lb, &extent);
+    int rc = datatype_get_layout(dt, &layout);
+    for (i = 0; i < num_peers; i++)
+    {
+        const char *ptr = (const char *)buf + (displs != NULL ? displs[i] : 0) * extent;
+        if (counts[i] == 0)
+            continue;
+
+        if (rc)
+        {
+            // The datatype cannot be flattened
+            int position = 0;
+            PMPI_Pack(ptr, counts[i], dt, (char *)item->data + offset, item->header.data_size - offset, &position, comm);
+            offset += position;
+        }
+        else if (layout->is_contiguous)
+        {
+            memcpy((char *)item->data + offset, ptr, counts[i] * layout->size);
+            offset += counts[i] * layout->size;
+        }
+        else
+        {
+            for (j = 0; j < counts[i]; j++)
+            {
+                for (k = 0; k < layout->num_blocks; k++)
+                {
+                    memcpy((char *)item->data + offset, ptr + j * extent + layout->blocks[k].offset, layout->blocks[k].len);
+                    offset += layout->blocks[k].len;
+                }
+            }
+        }
+    }
+    assert(offset == item->header.data_size);
+}
+
+static char *_capture_filename(capture_t *c, char *ctxt, uint32_t comm_id, uint64_t n_call)
+{
+    char *filename = NULL;
+    char *output_dir = get_output_dir();
+    int rc;
+
+    if (output_dir)
+    {
+        _asprintf(filename, rc, "%s/%s_capture_%s_comm%" PRIu32 "_rank%d_call%" PRIu64 ".bin", output_dir, c->collective_name, ctxt, comm_id, c->world_rank, n_call);
+    }
+    else
+    {
+        _asprintf(filename, rc, "%s_capture_%s_comm%" PRIu32 "_rank%d_call%" PRIu64 ".bin", c->collective_name, ctxt, comm_id, c->world_rank, n_call);
+    }
+    assert(rc > 0);
+    return filename;
+}
+
+// capture_call_data copies the data of a buffer into the staging area; the data is then
+// written to a file by a background thread while the application continues its execution.
+int capture_call_data(char *ctxt, MPI_Comm comm, int comm_rank, uint64_t n_call, const void *buf, const int *counts, const int *displs, int num_peers, MPI_Datatype dt)
+{
+    capture_t *c = capture;
+    uint32_t comm_id;
+    int rc;
+
+    if (c == NULL)
+        return 0;
+    GET_COMM_LOGGER(comm, c->world_rank, comm_rank, comm_id);
+
+    capture_file_header_t header;
+    capture_init_header(&header, n_call, comm_id, counts, num_peers, dt);
+    size_t data_size = header.data_size;
+    if (!_stage_data(c, data_size))
+    {
+        // The data does not fit in the staging area: it is written right away, without copy
+        char *filename = _capture_filename(c, ctxt, comm_id, n_call);
+        rc = capture_write_buffer(filename, &header, buf, counts, displs, dt, comm);
+        free(filename);
+        if (rc)
+            fprintf(stderr, "capture_write_buffer() failed: %d\n", rc);
+        return rc;
+    }
+
+    capture_item_t *item = malloc(sizeof(capture_item_t));
+    assert(item);
+    item->filename = _capture_filename(c, ctxt, comm_id, n_call);
+    item->header = header;
+    item->counts = malloc(num_peers * sizeof(int));
+    item->displs = calloc(num_peers, sizeof(int));
+    item->data = malloc(data_size > 0 ? data_size : 1);
+    assert(item->counts);
+    assert(item->displs);
+    assert(item->data);
+    memcpy(item->counts, counts, num_peers * sizeof(int));
+    if (displs != NULL)
+        memcpy(item->displs, displs, num_peers * sizeof(int));
+    item->next = NULL;
+    _copy_data(item, buf, counts, displs, num_peers, dt, comm);
+
+    pthread_mutex_lock(&c->lock);
+    if (!c->writer_started)
+    {
+        rc = pthread_create(&c->writer, NULL, _writer, c);
+        if (rc)
+        {
+            c->staged -= data_size;
+            pthread_cond_broadcast(&c->space_cond);
+            pthread_mutex_unlock(&c->lock);
+            fprintf(stderr, "pthread_create() failed: %d\n", rc);
+            // Without writer thread, the copy of the data is written right away
+            rc = _write_item(item);
+            if (rc)
+                fprintf(stderr, "_write_item() failed: %d\n", rc);
+            _free_item(item);
+            return rc;
+        }
+        c->writer_started = true;
+    }
+    if (c->tail == NULL)
+        c->head = item;
+    else
+        c->tail->next = item;
+    c->tail = item;
+    pthread_cond_signal(&c->work_cond);
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+}
+
+// capture_fini waits for all the captured data to be written
+int capture_fini()
+{
+    capture_t *c = capture;
+    if (c == NULL)
+        return 0;
+
+    pthread_mutex_lock(&c->lock);
+    c->shutdown = true;
+    pthread_cond_signal(&c->work_cond);
+    pthread_mutex_unlock(&c->lock);
+    if (c->writer_started)
+        pthread_join(c->writer, NULL);
+
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->work_cond);
+    pthread_cond_destroy(&c->space_cond);
+    free(c->collective_name);
+    free(c->ranges);
+    free(c);
+    capture = NULL;
+    return 0;
+}
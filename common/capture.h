@@ -0,0 +1,93 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_CAPTURE_H
+#define COLLECTIVE_PROFILER_CAPTURE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "mpi.h"
+
+// Name of the environment variable to specify the calls for which the content of the
+// buffers is captured: a comma-separated list of call numbers and ranges, e.g., "3,10-20"
+#define COLLECTIVE_PROFILER_CAPTURE_CALLS_ENVVAR "COLLECTIVE_PROFILER_CAPTURE_CALLS"
+// Legacy environment variable to capture a single call
+#define DUMP_CALL_DATA_ENVVAR "DUMP_CALL_DATA"
+// Name of the environment variable to specify the size of the staging area (in bytes)
+#define COLLECTIVE_PROFILER_CAPTURE_STAGING_SIZE_ENVVAR "COLLECTIVE_PROFILER_CAPTURE_STAGING_SIZE"
+
+#define CAPTURE_DEFAULT_STAGING_SIZE (64 * 1024 * 1024)
+
+// Maximum number of blocks of memory written with a single writev call
+#define CAPTURE_IOV_BATCH_SIZE (1024)
+
+// Binary file layout: a header, the counts and the displacements of all the peers
+// (32-bit integers) and the data of all the peers, packed, in the order of the peers.
+#define CAPTURE_FILE_MAGIC "CPCAPTUR"
+#define CAPTURE_FILE_MAGIC_LEN (8)
+
+typedef struct capture_file_header
+{
+    char magic[CAPTURE_FILE_MAGIC_LEN];
+    uint32_t format_version;
+    uint32_t num_peers;    // Number of counts and displacements
+    uint64_t call;
+    uint32_t comm_id;
+    uint32_t element_size; // Size of an element once packed
+    uint64_t data_size;
+    uint32_t type_id; // type_id_t of the datatype, UNKNOWN_ID for derived datatypes
+    uint32_t reserved;
+} capture_file_header_t;
+
+typedef struct capture_range
+{
+    uint64_t first;
+    uint64_t last;
+} capture_range_t;
+
+// capture_item is the data of a buffer waiting to be written by the writer thread
+typedef struct capture_item
+{
+    char *filename;
+    capture_file_header_t header;
+    int *counts;
+    int *displs;
+    void *data;
+    struct capture_item *next;
+} capture_item_t;
+
+typedef struct capture
+{
+    char *collective_name;
+    int world_rank;
+    capture_range_t *ranges; // Sorted ranges of calls to capture
+    size_t num_ranges;
+
+    // Staging area: the data being copied or waiting to be written uses at most staging_size bytes
+    size_t staging_size;
+    size_t staged;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;  // Signaled when data is queued or when the capture ends
+    pthread_cond_t space_cond; // Signaled when data has been written
+    capture_item_t *head;
+    capture_item_t *tail;
+    bool writer_started;
+    bool shutdown;
+    pthread_t writer;
+} capture_t;
+
+int capture_init(char *collective_name, int world_rank);
+bool capture_call_selected(uint64_t n_call);
+void capture_add_calls(uint64_t first, uint64_t last);
+int capture_call_data(char *ctxt, MPI_Comm comm, int comm_rank, uint64_t n_call, const void *buf, const int *counts, const int *displs, int num_peers, MPI_Datatype dt);
+int capture_fini();
+
+void capture_init_header(capture_file_header_t *header, uint64_t n_call, uint32_t comm_id, const int *counts, int num_peers, MPI_Datatype dt);
+int capture_write_buffer(char *filename, capture_file_header_t *header, const void *buf, const int *counts, const int *displs, MPI_Datatype dt, MPI_Comm comm);
+
+#endif // COLLECTIVE_PROFILER_CAPTURE_H
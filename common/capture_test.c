@@ -0,0 +1,197 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "mpi.h"
+
+#include "capture.h"
+#include "datatype.h"
+
+#define NUM_PEERS (3)
+// Large enough for the data of the vector datatype to require more than one writev call
+#define VECTOR_COUNT (2 * CAPTURE_IOV_BATCH_SIZE)
+
+char *get_output_dir()
+{
+    return NULL;
+}
+
+// check_capture_file writes a buffer in a capture file and compares the content of the
+// file with the data packed by MPI
+static int check_capture_file(char *filename, void *buf, int *counts, int *displs, MPI_Datatype type, uint32_t expected_type_id)
+{
+    capture_file_header_t header;
+    capture_file_header_t read_header;
+    MPI_Aint lb, extent;
+    int type_size;
+    int rc;
+    int i;
+
+    MPI_Type_size(type, &type_size);
+    MPI_Type_get_extent(type, &lb, &extent);
+    capture_init_header(&header, 42, 0, counts, NUM_PEERS, type);
+    rc = capture_write_buffer(filename, &header, buf, counts, displs, type, MPI_COMM_WORLD);
+    if (rc)
+    {
+        fprintf(stderr, "*** [ERROR] capture_write_buffer() failed: %d\n", rc);
+        return 1;
+    }
+
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] unable to open %s\n", filename);
+        return 1;
+    }
+    int read_counts[NUM_PEERS];
+    int read_displs[NUM_PEERS];
+    if (fread(&read_header, sizeof(read_header), 1, f) != 1 ||
+        fread(read_counts, sizeof(int), NUM_PEERS, f) != NUM_PEERS ||
+        fread(read_displs, sizeof(int), NUM_PEERS, f) != NUM_PEERS)
+    {
+        fprintf(stderr, "*** [ERROR] %s is truncated\n", filename);
+        fclose(f);
+        return 1;
+    }
+    if (memcmp(read_header.magic, CAPTURE_FILE_MAGIC, CAPTURE_FILE_MAGIC_LEN) != 0 ||
+        read_header.call != 42 ||
+        read_header.num_peers != NUM_PEERS ||
+        read_header.element_size != (uint32_t)type_size ||
+        read_header.type_id != expected_type_id ||
+        memcmp(read_counts, counts, sizeof(read_counts)) != 0 ||
+        memcmp(read_displs, displs, sizeof(read_displs)) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid header in %s\n", filename);
+        fclose(f);
+        return 1;
+    }
+
+    char *data = malloc(read_header.data_size + 1);
+    char *packed = malloc(read_header.data_size + 1);
+    size_t offset = 0;
+    if (fread(data, 1, read_header.data_size, f) != read_header.data_size || fgetc(f) != EOF)
+    {
+        fprintf(stderr, "*** [ERROR] invalid amount of data in %s\n", filename);
+        rc = 1;
+    }
+    for (i = 0; rc == 0 && i < NUM_PEERS; i++)
+    {
+        int position = 0;
+        MPI_Pack((char *)buf + displs[i] * extent, counts[i], type, packed + offset, read_header.data_size - offset, &position, MPI_COMM_WORLD);
+        offset += position;
+    }
+    if (rc == 0 && (offset != read_header.data_size || memcmp(data, packed, offset) != 0))
+    {
+        fprintf(stderr, "*** [ERROR] data in %s differs from the packed data\n", filename);
+        rc = 1;
+    }
+    fclose(f);
+    free(data);
+    free(packed);
+    if (rc == 0)
+        fprintf(stdout, "*** capture of %s successful\n", filename);
+    return rc;
+}
+
+// check_selected_calls checks the calls selected by a list of calls that includes nested
+// and overlapping ranges
+static int check_selected_calls(void)
+{
+    uint64_t selected[] = {0, 600, 1000, 1001, 1005, 1010};
+    uint64_t ignored[] = {1011, 1999};
+    size_t i;
+    int rc = 0;
+
+    setenv(COLLECTIVE_PROFILER_CAPTURE_CALLS_ENVVAR, "501-510,0-1000,1001,1003-1010,1005", 1);
+    if (capture_init("test", 0))
+        return 1;
+    for (i = 0; i < sizeof(selected) / sizeof(uint64_t); i++)
+    {
+        if (!capture_call_selected(selected[i]))
+        {
+            fprintf(stderr, "call %" PRIu64 " is not selected\n", selected[i]);
+            rc = 1;
+        }
+    }
+    for (i = 0; i < sizeof(ignored) / sizeof(uint64_t); i++)
+    {
+        if (capture_call_selected(ignored[i]))
+        {
+            fprintf(stderr, "call %" PRIu64 " is selected\n", ignored[i]);
+            rc = 1;
+        }
+    }
+
+    // Calls selected after a change point within a selected range do not shrink the range
+    capture_add_calls(1002, 1004);
+    capture_add_calls(2000, 2005);
+    if (!capture_call_selected(600) || !capture_call_selected(1008) || !capture_call_selected(2000) || capture_call_selected(2006))
+    {
+        fprintf(stderr, "invalid selection of the added calls\n");
+        rc = 1;
+    }
+    capture_fini();
+    unsetenv(COLLECTIVE_PROFILER_CAPTURE_CALLS_ENVVAR);
+    if (rc == 0)
+        fprintf(stdout, "*** selection of the calls successful\n");
+    return rc;
+}
+
+static int capture_test(void)
+{
+    int counts[NUM_PEERS] = {4, 0, 3};
+    int displs[NUM_PEERS] = {0, 4, 5};
+    double doubles[8];
+    int i;
+
+    if (check_selected_calls())
+        return 1;
+
+    for (i = 0; i < 8; i++)
+        doubles[i] = 1.0 / (i + 3);
+    if (check_capture_file("capture_test_double.bin", doubles, counts, displs, MPI_DOUBLE, MPI_DOUBLE_ID))
+        return 1;
+    unsigned int uints[8] = {0, 1, 2, 3, 4, 5, 6, 4000000000U};
+    if (check_capture_file("capture_test_unsigned.bin", uints, counts, displs, MPI_UNSIGNED, MPI_UNSIGNED_ID))
+        return 1;
+
+    // Strided datatype: every element is a block of 2 integers out of 3
+    MPI_Datatype vector, resized;
+    MPI_Type_vector(1, 2, 3, MPI_INT, &vector);
+    MPI_Type_create_resized(vector, 0, 3 * sizeof(int), &resized);
+    MPI_Type_commit(&resized);
+    int vector_counts[NUM_PEERS] = {VECTOR_COUNT, 1, VECTOR_COUNT};
+    int vector_displs[NUM_PEERS] = {0, VECTOR_COUNT, VECTOR_COUNT + 1};
+    int *ints = malloc((2 * VECTOR_COUNT + 1) * 3 * sizeof(int));
+    for (i = 0; i < (2 * VECTOR_COUNT + 1) * 3; i++)
+        ints[i] = i;
+    int rc = check_capture_file("capture_test_vector.bin", ints, vector_counts, vector_displs, resized, UNKNOWN_ID);
+    free(ints);
+    MPI_Type_free(&resized);
+    MPI_Type_free(&vector);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+
+    if (capture_test())
+    {
+        fprintf(stderr, "[ERROR] capture test failed\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    datatype_fini();
+    MPI_Finalize();
+    fprintf(stdout, "capture test succeeded\n");
+    return EXIT_SUCCESS;
+}
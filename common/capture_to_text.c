@@ -0,0 +1,219 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+/*
+ * capture_to_text prints the content of the files of the captured calls as text: a
+ * description of the call followed by one line per peer with the elements sent to or
+ * received from the peer.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "capture.h"
+#include "datatype.h"
+
+static void print_element(FILE *out, uint32_t type_id, uint32_t element_size, const unsigned char *elt)
+{
+    uint32_t i;
+
+    switch (type_id)
+    {
+    case MPI_DOUBLE_ID:
+    case MPI_DOUBLE_PRECISION_ID:
+    case MPI_REAL8_ID:
+        if (element_size == sizeof(double))
+        {
+            double v;
+            memcpy(&v, elt, sizeof(v));
+            // 17 significant digits are enough to print any double without loss
+            fprintf(out, "%.17g", v);
+            return;
+        }
+        break;
+    case MPI_FLOAT_ID:
+    case MPI_REAL_ID:
+    case MPI_REAL4_ID:
+        if (element_size == sizeof(float))
+        {
+            float v;
+            memcpy(&v, elt, sizeof(v));
+            fprintf(out, "%.9g", v);
+            return;
+        }
+        break;
+    case MPI_CHAR_ID:
+    case MPI_SIGNED_CHAR_ID:
+    case MPI_SHORT_ID:
+    case MPI_INT_ID:
+    case MPI_LONG_ID:
+    case MPI_LONG_LONG_INT_ID:
+    case MPI_INTEGER_ID:
+    case MPI_INTEGER1_ID:
+    case MPI_INTEGER2_ID:
+    case MPI_INTEGER4_ID:
+    case MPI_INTEGER8_ID:
+    {
+        int64_t v;
+        if (element_size == 1)
+            v = *(const int8_t *)elt;
+        else if (element_size == 2)
+        {
+            int16_t v16;
+            memcpy(&v16, elt, sizeof(v16));
+            v = v16;
+        }
+        else if (element_size == 4)
+        {
+            int32_t v32;
+            memcpy(&v32, elt, sizeof(v32));
+            v = v32;
+        }
+        else if (element_size == 8)
+            memcpy(&v, elt, sizeof(v));
+        else
+            break;
+        fprintf(out, "%" PRId64, v);
+        return;
+    }
+    case MPI_UNSIGNED_CHAR_ID:
+    case MPI_UNSIGNED_SHORT_ID:
+    case MPI_UNSIGNED_ID:
+    case MPI_UNSIGNED_LONG_ID:
+    {
+        uint64_t v;
+        if (element_size == 1)
+            v = *(const uint8_t *)elt;
+        else if (element_size == 2)
+        {
+            uint16_t v16;
+            memcpy(&v16, elt, sizeof(v16));
+            v = v16;
+        }
+        else if (element_size == 4)
+        {
+            uint32_t v32;
+            memcpy(&v32, elt, sizeof(v32));
+            v = v32;
+        }
+        else if (element_size == 8)
+            memcpy(&v, elt, sizeof(v));
+        else
+            break;
+        fprintf(out, "%" PRIu64, v);
+        return;
+    }
+    default:
+        break;
+    }
+
+    // Any other datatype is printed as one hexadecimal string per element
+    for (i = 0; i < element_size; i++)
+        fprintf(out, "%02x", elt[i]);
+}
+
+static int print_capture_file(FILE *out, char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "unable to open %s\n", filename);
+        return 1;
+    }
+
+    capture_file_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, CAPTURE_FILE_MAGIC, CAPTURE_FILE_MAGIC_LEN) != 0)
+    {
+        fprintf(stderr, "%s is not a capture file\n", filename);
+        fclose(f);
+        return 1;
+    }
+    if (header.format_version != FORMAT_VERSION)
+    {
+        fprintf(stderr, "%s: unsupported format version %" PRIu32 "\n", filename, header.format_version);
+        fclose(f);
+        return 1;
+    }
+
+    int *counts = malloc((header.num_peers > 0 ? header.num_peers : 1) * sizeof(int));
+    int *displs = malloc((header.num_peers > 0 ? header.num_peers : 1) * sizeof(int));
+    unsigned char *data = malloc(header.data_size > 0 ? header.data_size : 1);
+    if (counts == NULL || displs == NULL || data == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        fclose(f);
+        free(counts);
+        free(displs);
+        free(data);
+        return 1;
+    }
+
+    int rc = 0;
+    if (fread(counts, sizeof(int), header.num_peers, f) != header.num_peers ||
+        fread(displs, sizeof(int), header.num_peers, f) != header.num_peers ||
+        fread(data, 1, header.data_size, f) != header.data_size)
+    {
+        fprintf(stderr, "%s is truncated\n", filename);
+        rc = 1;
+        goto exit;
+    }
+
+    fprintf(out, "# Call: %" PRIu64 "\n", header.call);
+    fprintf(out, "# Communicator: %" PRIu32 "\n", header.comm_id);
+    fprintf(out, "# Datatype: %s\n", type_id_to_str(header.type_id));
+    fprintf(out, "# Element size: %" PRIu32 "\n", header.element_size);
+    fprintf(out, "# Number of peers: %" PRIu32 "\n", header.num_peers);
+
+    uint64_t offset = 0;
+    uint32_t i;
+    for (i = 0; i < header.num_peers; i++)
+    {
+        int j;
+        fprintf(out, "%" PRIu32 " (count: %d, displacement: %d):", i, counts[i], displs[i]);
+        for (j = 0; j < counts[i]; j++)
+        {
+            if (offset + header.element_size > header.data_size)
+            {
+                fprintf(stderr, "%s: inconsistent counts\n", filename);
+                rc = 1;
+                goto exit;
+            }
+            fprintf(out, " ");
+            print_element(out, header.type_id, header.element_size, data + offset);
+            offset += header.element_size;
+        }
+        fprintf(out, "\n");
+    }
+
+exit:
+    fclose(f);
+    free(counts);
+    free(displs);
+    free(data);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <CAPTURE_FILE> [<CAPTURE_FILE> ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        if (argc > 2)
+            fprintf(stdout, "## %s\n", argv[i]);
+        if (print_capture_file(stdout, argv[i]))
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
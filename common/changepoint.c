@@ -0,0 +1,124 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <string.h>
+#include <time.h>
+
+#include "changepoint.h"
+
+// _sqrt avoids depending on the math library for a few square roots per regime
+static double _sqrt(double x)
+{
+    double r = x > 1 ? x : 1;
+    int i;
+    if (x <= 0)
+        return 0;
+    for (i = 0; i < 64; i++)
+    {
+        double next = 0.5 * (r + x / r);
+        if (next == r)
+            break;
+        r = next;
+    }
+    return r;
+}
+
+void changepoint_init(changepoint_detector_t *detector)
+{
+    memset(detector, 0, sizeof(changepoint_detector_t));
+}
+
+static void _new_regime(changepoint_detector_t *detector, uint64_t first_call)
+{
+    changepoint_init(detector);
+    detector->started = true;
+    detector->first_call = first_call;
+}
+
+// changepoint_add adds the timing of a call and returns true when it reveals a change, in
+// which case the change is described in event
+bool changepoint_add(changepoint_detector_t *detector, uint64_t call, double value, changepoint_event_t *event)
+{
+    if (!detector->started)
+    {
+        detector->started = true;
+        detector->first_call = call;
+    }
+    if (detector->num_calls < CHANGEPOINT_WARMUP_CALLS)
+    {
+        detector->num_calls++;
+        double delta = value - detector->mean;
+        detector->mean += delta / detector->num_calls;
+        detector->m2 += delta * (value - detector->mean);
+        if (detector->num_calls == CHANGEPOINT_WARMUP_CALLS)
+        {
+            // Very regular timings would make any small variation a change
+            detector->stddev = _sqrt(detector->m2 / (detector->num_calls - 1));
+            if (detector->stddev < CHANGEPOINT_MIN_RELATIVE_STDDEV * detector->mean)
+                detector->stddev = CHANGEPOINT_MIN_RELATIVE_STDDEV * detector->mean;
+        }
+        return false;
+    }
+
+    double z = detector->stddev > 0 ? (value - detector->mean) / detector->stddev : 0;
+    if (z > CHANGEPOINT_MAX_DEVIATION)
+        z = CHANGEPOINT_MAX_DEVIATION;
+    if (z < -CHANGEPOINT_MAX_DEVIATION)
+        z = -CHANGEPOINT_MAX_DEVIATION;
+
+    if (detector->upper == 0)
+    {
+        detector->upper_onset = call;
+        detector->upper_calls = 0;
+        detector->upper_total = 0;
+    }
+    detector->upper += z - CHANGEPOINT_DRIFT;
+    if (detector->upper < 0)
+        detector->upper = 0;
+    detector->upper_calls++;
+    detector->upper_total += value;
+
+    if (detector->lower == 0)
+    {
+        detector->lower_onset = call;
+        detector->lower_calls = 0;
+        detector->lower_total = 0;
+    }
+    detector->lower += -z - CHANGEPOINT_DRIFT;
+    if (detector->lower < 0)
+        detector->lower = 0;
+    detector->lower_calls++;
+    detector->lower_total += value;
+
+    if (detector->upper <= CHANGEPOINT_THRESHOLD && detector->lower <= CHANGEPOINT_THRESHOLD)
+        return false;
+
+    bool slower = detector->upper > CHANGEPOINT_THRESHOLD;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    event->call = call;
+    event->onset_call = slower ? detector->upper_onset : detector->lower_onset;
+    event->timestamp = now.tv_sec + now.tv_nsec / 1e9;
+    event->before_first_call = detector->first_call;
+    event->before_mean = detector->mean;
+    event->before_stddev = _sqrt(detector->m2 / (detector->num_calls - 1));
+    event->after_calls = slower ? detector->upper_calls : detector->lower_calls;
+    event->after_mean = (slower ? detector->upper_total : detector->lower_total) / event->after_calls;
+
+    // The calls of the new regime seen so far are not used for its statistics, which are
+    // estimated with the next calls
+    _new_regime(detector, event->onset_call);
+    return true;
+}
+
+void changepoint_write_event(FILE *f, changepoint_event_t *event)
+{
+    fprintf(f, "# Regime change at call %" PRIu64 "\n\n", event->call);
+    fprintf(f, "Timestamp: %.6f\n", event->timestamp);
+    fprintf(f, "First call of the new regime: %" PRIu64 "\n", event->onset_call);
+    fprintf(f, "Before (from call %" PRIu64 "): mean = %f; standard deviation = %f\n", event->before_first_call, event->before_mean, event->before_stddev);
+    fprintf(f, "After (%" PRIu64 " calls): mean = %f; ratio = %.2f\n\n", event->after_calls, event->after_mean, event->before_mean > 0 ? event->after_mean / event->before_mean : 0);
+}
@@ -0,0 +1,63 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_CHANGEPOINT_H
+#define COLLECTIVE_PROFILER_CHANGEPOINT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "collective_profiler_config.h"
+
+typedef struct changepoint_event
+{
+    uint64_t call;       // Call that revealed the change
+    uint64_t onset_call; // First call of the new regime
+    double timestamp;    // Time of the detection, in seconds since the Epoch
+    // Statistics of the previous regime, from its first CHANGEPOINT_WARMUP_CALLS calls
+    uint64_t before_first_call;
+    double before_mean;
+    double before_stddev;
+    // Mean of the calls of the new regime seen so far
+    uint64_t after_calls;
+    double after_mean;
+} changepoint_event_t;
+
+/*
+ * Online detection of changes of the mean of a series of timings with a two-sided CUSUM.
+ * The mean and standard deviation of a regime are estimated over its first
+ * CHANGEPOINT_WARMUP_CALLS calls; every following timing is then standardized, clipped
+ * to CHANGEPOINT_MAX_DEVIATION so a single outlier never reveals a change, and accumulated
+ * in the upper and lower sums, minus the drift CHANGEPOINT_DRIFT. A change is detected
+ * when a sum exceeds CHANGEPOINT_THRESHOLD; the new regime starts with the first call of
+ * the run of positive sums and its statistics are estimated again.
+ */
+typedef struct changepoint_detector
+{
+    bool started;
+    uint64_t first_call; // First call of the current regime
+    uint64_t num_calls;  // Number of calls of the warm-up of the current regime
+    double mean;
+    double m2; // Sum of the squared differences with the mean (Welford)
+    double stddev;
+    // Upper and lower CUSUM sums, with the first call and the sum of the timings of their
+    // current run of positive values
+    double upper;
+    uint64_t upper_onset;
+    uint64_t upper_calls;
+    double upper_total;
+    double lower;
+    uint64_t lower_onset;
+    uint64_t lower_calls;
+    double lower_total;
+} changepoint_detector_t;
+
+void changepoint_init(changepoint_detector_t *detector);
+bool changepoint_add(changepoint_detector_t *detector, uint64_t call, double value, changepoint_event_t *event);
+void changepoint_write_event(FILE *f, changepoint_event_t *event);
+
+#endif // COLLECTIVE_PROFILER_CHANGEPOINT_H
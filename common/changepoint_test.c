@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "changepoint.h"
+
+#define MAX_TEXT_LEN (1024)
+
+static uint64_t seed = 42;
+
+// _timing returns a timing around mean with a noise of 2%
+static double _timing(double mean)
+{
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    double noise = (double)(seed >> 11) / (double)(1ULL << 53) * 0.04 - 0.02;
+    return mean * (1 + noise);
+}
+
+static int changepoint_test(void)
+{
+    changepoint_detector_t d;
+    changepoint_event_t event;
+    uint64_t call;
+    int num_events = 0;
+
+    changepoint_init(&d);
+    for (call = 0; call < 300; call++)
+    {
+        double t = _timing(call >= 100 && call < 200 ? 2.0 : 1.0);
+        // Single outliers, e.g., when the operating system preempts a rank, are not changes
+        if (call == 50 || call == 150)
+            t *= 10;
+        if (!changepoint_add(&d, call, t, &event))
+            continue;
+
+        num_events++;
+        if (num_events == 1 && (event.onset_call != 100 || event.call > 105 || event.before_first_call != 0 ||
+                                event.before_mean < 0.98 || event.before_mean > 1.02 || event.after_mean < 1.9 || event.after_mean > 2.1))
+        {
+            fprintf(stderr, "*** [ERROR] invalid slowdown: call %" PRIu64 ", onset %" PRIu64 ", before %f, after %f\n", event.call, event.onset_call, event.before_mean, event.after_mean);
+            return 1;
+        }
+        if (num_events == 2 && (event.onset_call != 200 || event.call > 205 || event.before_first_call != 100 ||
+                                event.before_mean < 1.96 || event.before_mean > 2.04 || event.after_mean < 0.95 || event.after_mean > 1.05))
+        {
+            fprintf(stderr, "*** [ERROR] invalid speedup: call %" PRIu64 ", onset %" PRIu64 ", before %f, after %f\n", event.call, event.onset_call, event.before_mean, event.after_mean);
+            return 1;
+        }
+        if (num_events > 2)
+        {
+            fprintf(stderr, "*** [ERROR] unexpected change at call %" PRIu64 "\n", event.call);
+            return 1;
+        }
+    }
+    if (num_events != 2)
+    {
+        fprintf(stderr, "*** [ERROR] %d changes detected instead of 2\n", num_events);
+        return 1;
+    }
+    fprintf(stdout, "*** detection of changes successful\n");
+
+    // Constant timings: the smallest variation must not be a change
+    changepoint_init(&d);
+    for (call = 0; call < 100; call++)
+    {
+        if (changepoint_add(&d, call, call < 50 ? 1.0 : 1.01, &event))
+        {
+            fprintf(stderr, "*** [ERROR] change detected in constant timings at call %" PRIu64 "\n", call);
+            return 1;
+        }
+    }
+    fprintf(stdout, "*** constant timings successful\n");
+
+    static char text[MAX_TEXT_LEN];
+    FILE *f = fmemopen(text, MAX_TEXT_LEN, "w");
+    changepoint_write_event(f, &event);
+    fclose(f);
+    if (strncmp(text, "# Regime change at call 202\n\nTimestamp: ", 40) != 0 || strstr(text, "First call of the new regime: 200\n") == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] invalid description of a change:\n%s\n", text);
+        return 1;
+    }
+    fprintf(stdout, "*** description of a change successful\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (changepoint_test())
+    {
+        fprintf(stderr, "[ERROR] change-point test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "change-point test succeeded\n");
+    return EXIT_SUCCESS;
+}
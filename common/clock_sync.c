@@ -0,0 +1,209 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include "clock_sync.h"
+#include "collective_profiler_config.h"
+
+#define CLOCK_SYNC_TAG (1)
+
+double clock_sync_offset = 0.0;
+double clock_sync_drift = 0.0;
+double clock_sync_ref_time = 0.0;
+
+// Offset samples against the reference clock and the local time at which they were taken
+static double sample_times[CLOCK_SYNC_MAX_SAMPLES];
+static double sample_offsets[CLOCK_SYNC_MAX_SAMPLES];
+static int num_samples = 0;
+static int next_sample = 0;
+
+static int resync_frequency = CLOCK_SYNC_DEFAULT_RESYNC_FREQUENCY;
+static uint64_t num_ticks = 0;
+
+// Private communicator used for the exchanges so they cannot match any message of the
+// application. It is duplicated once by clock_sync_init() and reused by every resynchronization.
+static MPI_Comm sync_comm = MPI_COMM_NULL;
+
+// _measure_parent_offset is executed by a child and estimates the offset of the reference clock
+// against its local clock using the ping-pong exchange with the smallest round-trip time. The parent
+// replies with its own corrected time and the remote timestamp is assumed to have been taken in the
+// middle of the exchange.
+static inline void _measure_parent_offset(MPI_Comm comm, int parent, double *offset, double *time)
+{
+    int i;
+    double best_rtt = -1.0;
+    double parent_time;
+
+    for (i = 0; i < CLOCK_SYNC_PINGPONG_ITERATIONS; i++)
+    {
+        double t_start = timer_wtime();
+        PMPI_Send(&t_start, 1, MPI_DOUBLE, parent, CLOCK_SYNC_TAG, comm);
+        PMPI_Recv(&parent_time, 1, MPI_DOUBLE, parent, CLOCK_SYNC_TAG, comm, MPI_STATUS_IGNORE);
+        double t_end = timer_wtime();
+        double rtt = t_end - t_start;
+        if (best_rtt < 0 || rtt < best_rtt)
+        {
+            best_rtt = rtt;
+            *time = t_start + rtt / 2;
+            *offset = parent_time - *time;
+        }
+    }
+}
+
+// _serve_child is executed by a parent that already knows its offset against the reference clock.
+static inline void _serve_child(MPI_Comm comm, int child, double offset)
+{
+    int i;
+    double t;
+
+    for (i = 0; i < CLOCK_SYNC_PINGPONG_ITERATIONS; i++)
+    {
+        PMPI_Recv(&t, 1, MPI_DOUBLE, child, CLOCK_SYNC_TAG, comm, MPI_STATUS_IGNORE);
+        t = timer_wtime() + offset;
+        PMPI_Send(&t, 1, MPI_DOUBLE, child, CLOCK_SYNC_TAG, comm);
+    }
+}
+
+// _fit_model fits the linear model of the local clock to the samples with a least-squares regression.
+static inline void _fit_model()
+{
+    int i;
+    double mean_time = 0.0;
+    double mean_offset = 0.0;
+    double cov = 0.0;
+    double var = 0.0;
+
+    assert(num_samples > 0);
+    for (i = 0; i < num_samples; i++)
+    {
+        mean_time += sample_times[i];
+        mean_offset += sample_offsets[i];
+    }
+    mean_time /= num_samples;
+    mean_offset /= num_samples;
+
+    for (i = 0; i < num_samples; i++)
+    {
+        cov += (sample_times[i] - mean_time) * (sample_offsets[i] - mean_offset);
+        var += (sample_times[i] - mean_time) * (sample_times[i] - mean_time);
+    }
+
+    clock_sync_ref_time = mean_time;
+    clock_sync_offset = mean_offset;
+    clock_sync_drift = var > 0.0 ? cov / var : 0.0;
+}
+
+// _sync_clocks estimates the offset of the clock of each rank against the clock of rank 0 using a
+// binomial tree: a rank first synchronizes with its parent and then serves its children so all the
+// pairs at the same level of the tree exchange concurrently and the operation takes log(P) steps.
+static int _sync_clocks()
+{
+    int rank;
+    int size;
+    int mask = 1;
+    double offset = 0.0;
+    double time = 0.0;
+
+    if (sync_comm == MPI_COMM_NULL)
+        return 0;
+
+    PMPI_Comm_rank(sync_comm, &rank);
+    PMPI_Comm_size(sync_comm, &size);
+
+    while (mask < size)
+    {
+        if (rank & mask)
+        {
+            _measure_parent_offset(sync_comm, rank - mask, &offset, &time);
+            break;
+        }
+        mask <<= 1;
+    }
+
+    mask >>= 1;
+    while (mask > 0)
+    {
+        if (rank + mask < size)
+            _serve_child(sync_comm, rank + mask, offset);
+        mask >>= 1;
+    }
+
+    if (rank != 0)
+    {
+        sample_times[next_sample] = time;
+        sample_offsets[next_sample] = offset;
+        next_sample = (next_sample + 1) % CLOCK_SYNC_MAX_SAMPLES;
+        if (num_samples < CLOCK_SYNC_MAX_SAMPLES)
+            num_samples++;
+        _fit_model();
+    }
+
+    return 0;
+}
+
+// clock_sync_init estimates the offset between the clock of each rank of the communicator and
+// the clock of its rank 0. It is collective over the communicator and is meant to be called
+// once, while initializing the profiler.
+int clock_sync_init(MPI_Comm comm)
+{
+    int rc;
+
+    clock_sync_fini();
+    rc = PMPI_Comm_dup(comm, &sync_comm);
+    if (rc != MPI_SUCCESS)
+    {
+        fprintf(stderr, "PMPI_Comm_dup() failed: %d\n", rc);
+        sync_comm = MPI_COMM_NULL;
+        return rc;
+    }
+
+    num_samples = 0;
+    next_sample = 0;
+    num_ticks = 0;
+    clock_sync_offset = 0.0;
+    clock_sync_drift = 0.0;
+    clock_sync_ref_time = 0.0;
+
+    char *resync_frequency_envvar = getenv(CLOCK_RESYNC_FREQUENCY_ENVVAR);
+    if (resync_frequency_envvar != NULL)
+        resync_frequency = atoi(resync_frequency_envvar);
+
+    return _sync_clocks();
+}
+
+// clock_sync_resync takes a new offset sample and updates the estimation of the clock drift.
+// It is collective over the communicator used with clock_sync_init().
+int clock_sync_resync(MPI_Comm comm)
+{
+    return _sync_clocks();
+}
+
+// clock_sync_tick is called for every collective operation and periodically resynchronizes the
+// clocks. Resynchronizations can only happen on MPI_COMM_WORLD, where all the ranks participate.
+int clock_sync_tick(MPI_Comm comm)
+{
+    if (comm != MPI_COMM_WORLD || resync_frequency <= 0)
+        return 0;
+
+    num_ticks++;
+    if (num_ticks % resync_frequency == 0)
+        return clock_sync_resync(comm);
+    return 0;
+}
+
+// clock_sync_fini releases the communicator used for the exchanges. It must be called before
+// MPI is finalized; the clock model remains valid afterwards.
+int clock_sync_fini()
+{
+    if (sync_comm != MPI_COMM_NULL)
+        PMPI_Comm_free(&sync_comm);
+    sync_comm = MPI_COMM_NULL;
+    return 0;
+}
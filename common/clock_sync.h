@@ -0,0 +1,45 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_CLOCK_SYNC_H
+#define COLLECTIVE_PROFILER_CLOCK_SYNC_H
+
+#include "mpi.h"
+#include "timer.h"
+
+// Number of ping-pong exchanges used to estimate the offset between the clock of a rank
+// and the clock of its parent in the tree. The exchange with the smallest round-trip time is used.
+#define CLOCK_SYNC_PINGPONG_ITERATIONS (20)
+
+// Maximum number of offset samples used to fit the drift of the local clock. Once reached,
+// the oldest sample is replaced.
+#define CLOCK_SYNC_MAX_SAMPLES (16)
+
+// By default, the clocks are resynchronized every CLOCK_SYNC_DEFAULT_RESYNC_FREQUENCY
+// collective operations on MPI_COMM_WORLD (0 disables resynchronization).
+#define CLOCK_SYNC_DEFAULT_RESYNC_FREQUENCY (50)
+
+// Linear model of the local clock against the reference clock, i.e., the clock of rank 0
+// of the communicator used with clock_sync_init():
+// reference_time = local_time + clock_sync_offset + clock_sync_drift * (local_time - clock_sync_ref_time)
+extern double clock_sync_offset;
+extern double clock_sync_drift;
+extern double clock_sync_ref_time;
+
+int clock_sync_init(MPI_Comm comm);
+int clock_sync_resync(MPI_Comm comm);
+int clock_sync_tick(MPI_Comm comm);
+int clock_sync_fini();
+
+// clock_sync_wtime returns the local time corrected to the reference clock so timestamps
+// from different ranks can be compared without any additional synchronization.
+static inline double clock_sync_wtime()
+{
+    double t = timer_wtime();
+    return t + clock_sync_offset + clock_sync_drift * (t - clock_sync_ref_time);
+}
+
+#endif // COLLECTIVE_PROFILER_CLOCK_SYNC_H
@@ -21,23 +21,63 @@ uint32_t next_id = 0;
 
 extern char *get_output_dir();
 
-int lookup_comm(MPI_Comm comm, uint32_t *id)
+// The ID of a communicator is attached to the communicator itself so that a handle reused by
+// MPI after MPI_Comm_free() is seen as a new communicator by all the modules
+static int comm_keyval = MPI_KEYVAL_INVALID;
+
+// _comm_delete_fn retires the entry of a freed communicator, which stays in the list so its
+// data is saved. The attribute is the ID and not the entry since the list may already be
+// released when MPI_COMM_WORLD is freed by MPI_Finalize().
+static int _comm_delete_fn(MPI_Comm comm, int keyval, void *attr_val, void *extra_state)
 {
+    uint32_t id = (uint32_t)(uintptr_t)attr_val;
     comm_data_t *data = comm_data_head;
     while (data != NULL)
     {
-        if (data->comm == comm)
+        if (data->id == id)
         {
-            *id = data->id;
-            return 0;
+            data->comm = MPI_COMM_NULL;
+            break;
         }
         data = data->next;
     }
-    return 1;
+    return MPI_SUCCESS;
+}
+
+int lookup_comm(MPI_Comm comm, uint32_t *id)
+{
+    void *attr_val = NULL;
+    int found = 0;
+
+    if (comm_keyval == MPI_KEYVAL_INVALID)
+        return 1;
+    PMPI_Comm_get_attr(comm, comm_keyval, &attr_val, &found);
+    if (!found)
+        return 1;
+    *id = (uint32_t)(uintptr_t)attr_val;
+    return 0;
 }
 
 int add_comm(MPI_Comm comm, int world_rank, int comm_rank, uint32_t *id)
 {
+    int rc;
+
+    if (comm_keyval == MPI_KEYVAL_INVALID)
+    {
+        rc = PMPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, _comm_delete_fn, &comm_keyval, NULL);
+        if (rc != MPI_SUCCESS)
+        {
+            fprintf(stderr, "PMPI_Comm_create_keyval() failed: %d\n", rc);
+            return rc;
+        }
+    }
+    rc = PMPI_Comm_set_attr(comm, comm_keyval, (void *)(uintptr_t)next_id);
+    if (rc != MPI_SUCCESS)
+    {
+        fprintf(stderr, "PMPI_Comm_set_attr() failed: %d\n", rc);
+        return rc;
+    }
+
     if (comm_data_head == NULL)
     {
         comm_data_head = malloc(sizeof(comm_data_t));
@@ -133,6 +173,13 @@ int release_comm_data(char *collective_name, int lead_rank)
         free(comm_data_head);
         comm_data_head = ptr;
     }
+    comm_data_tail = NULL;
+    // The attributes of the communicators that are still alive are ignored from now on
+    if (comm_keyval != MPI_KEYVAL_INVALID)
+    {
+        PMPI_Comm_free_keyval(&comm_keyval);
+        comm_keyval = MPI_KEYVAL_INVALID;
+    }
 
     if (fd)
     {
@@ -6,14 +6,19 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 #ifndef _COLLECTIVE_PROFILER_COMMON_TYPES_H
 #define _COLLECTIVE_PROFILER_COMMON_TYPES_H
 
 // Compact way to save send/recv counts of ranks within a single MPI collective
+// Series of counts with few non-zero counts are stored as sparse series, see counts_data.h
 typedef struct counts_data
 {
-    int *counters; // the actual counters (i.e., send/recv counts)
+    int *counters; // the actual counters (i.e., send/recv counts), only the non-zero counts for sparse series
+    int *peers;    // Indexes of the non-zero counts in increasing order for sparse series, NULL for dense series
+    int num_counters; // Number of elements in counters (and in peers for sparse series)
+    int len;       // Number of counts of the series, including the zero counts of sparse series
     int num_ranks; // The number of ranks having that series of counters
     int max_ranks; // The current size of the ranks array
     int *ranks;    // The list of ranks having that series of counters
@@ -35,6 +40,11 @@ typedef struct SRCountNode
     int recv_data_size;        // Size of the array of unique series of recv counters
     counts_data_t **send_data; // Array of unique series of send counters
     counts_data_t **recv_data; // Array of unique series of recv counters
+    struct matrix_structure *send_structure; // Structure of the send count matrix (see matrix_structure.h), the series are then not stored; NULL otherwise
+    struct matrix_structure *recv_structure; // Structure of the recv count matrix, the series are then not stored; NULL otherwise
+    uint64_t send_bytes; // Exact amount of data sent by all the ranks over all the calls, even when counts are quantized
+    uint64_t recv_bytes; // Exact amount of data received by all the ranks over all the calls, even when counts are quantized
+    int cluster; // Cluster of similar count matrices (see similarity.h), -1 when matrices are not clustered
     double *op_exec_times;
     double *late_arrival_timings;
     struct SRCountNode *next;
@@ -112,6 +122,13 @@ typedef struct caller_info
     struct caller_info *next;
 } caller_info_t;
 
+// Contiguous block of memory, relative to the begining of an element of data
+typedef struct data_block
+{
+    ptrdiff_t offset;
+    size_t len;
+} data_block_t;
+
 typedef char* (*get_full_filename_fn_t)(int, char *, int, int);
 
 typedef struct logger_config
@@ -1,16 +1,21 @@
 /*************************************************************************
- * Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION. All rights reserved.
  *
  * See LICENSE.txt for license information
  ************************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include "format.h"
 
 #define MAX_ELTS (20)
 #define MAX_STRLEN (128)
 
+// Sizes of the inputs of the benchmarks; the encoding time should grow linearly
+#define BENCHMARK_SMALL_SIZE (1000000)
+#define BENCHMARK_LARGE_SIZE (4 * BENCHMARK_SMALL_SIZE)
+
 typedef struct ca_test
 {
     int array[MAX_ELTS];
@@ -21,7 +26,7 @@ typedef struct ca_test
 
 static int compress_array_test(void)
 {
-    int num_tests = 8;
+    int num_tests = 10;
     ca_test_t tests[] = {
         { // Test 0
             array : {0, 1, 2, 3, 4, 5, 6},
@@ -71,6 +76,18 @@ static int compress_array_test(void)
             ysize : 3,
             expected_result : "0-2\n0-2\n0-2",
         },
+        { // Test 8
+            array : {-3, -2, -1, 0, 4, -7},
+            xsize : 6,
+            ysize : 1,
+            expected_result : "-3-0, 4, -7",
+        },
+        { // Test 9
+            array : {5, 9, 10, 2, 3, 4},
+            xsize : 3,
+            ysize : 2,
+            expected_result : "5, 9-10\n2-4",
+        },
     };
 
     int i;
@@ -89,21 +106,116 @@ static int compress_array_test(void)
 
             fprintf(stdout, "*** Test %d successful\n", i);
         }
+
+        // The parser must give back the original values
+        uint64_t *values = NULL;
+        size_t num_values = 0;
+        int j;
+        if (parse_compressed_array(str, true, &values, &num_values) || num_values != (size_t)(tests[i].xsize * tests[i].ysize))
+        {
+            fprintf(stderr, "[ERROR] unable to parse the result of test #%d: %s\n", i, str);
+            return 1;
+        }
+        for (j = 0; j < tests[i].xsize * tests[i].ysize; j++)
+        {
+            if ((int)(int64_t)values[j] != tests[i].array[j])
+            {
+                fprintf(stderr, "[ERROR] element %d of test #%d parsed as %d instead of %d\n", j, i, (int)(int64_t)values[j], tests[i].array[j]);
+                return 1;
+            }
+        }
+        free(values);
         free(str);
     }
     return 0;
 }
 
-int main(int argc, char **argv)
+static int compress_uint64_array_test(void)
 {
-    if (compress_array_test())
+    uint64_t array[] = {UINT64_MAX - 2, UINT64_MAX - 1, UINT64_MAX, 0, 1, 3};
+    char *expected_result = "18446744073709551613-18446744073709551615, 0-1, 3";
+    char *str = compress_uint64_array(array, 6, 1);
+    if (strcmp(str, expected_result) != 0)
     {
-        fprintf(stderr, "[ERROR] compressing array test failed\n");
+        fprintf(stderr, "[ERROR] expected %s but got %s\n", expected_result, str);
+        return 1;
     }
-    else
+
+    // Data written directly to a file must be identical
+    char buf[MAX_STRLEN];
+    range_encoder_t enc;
+    FILE *f = tmpfile();
+    range_encoder_init(&enc, NULL, f, false);
+    write_compressed_uint64_array(&enc, array, 6, 1);
+    rewind(f);
+    size_t len = fread(buf, 1, MAX_STRLEN - 1, f);
+    buf[len] = '\0';
+    fclose(f);
+    if (strcmp(str, buf) != 0)
+    {
+        fprintf(stderr, "[ERROR] data written to a file is %s instead of %s\n", buf, str);
+        return 1;
+    }
+
+    uint64_t *values = NULL;
+    size_t num_values = 0;
+    if (parse_compressed_array(str, false, &values, &num_values) || num_values != 6 || memcmp(values, array, sizeof(array)) != 0)
     {
-        fprintf(stdout, "compressing array test succeeded\n");
+        fprintf(stderr, "[ERROR] unable to parse %s\n", str);
+        return 1;
     }
+    free(values);
+    free(str);
 
+    if (parse_compressed_array("1-, 3", false, &values, &num_values) == 0)
+    {
+        fprintf(stderr, "[ERROR] invalid string successfully parsed\n");
+        return 1;
+    }
+    fprintf(stdout, "*** uint64_t test successful\n");
     return 0;
 }
+
+// _benchmark_compress returns the time in seconds to compress a list of call IDs with a gap
+// every other call, which is the worst case since every range has only two elements
+static double _benchmark_compress(size_t size)
+{
+    struct timespec start, end;
+    size_t i;
+    uint64_t *calls = malloc(size * sizeof(uint64_t));
+    for (i = 0; i < size; i++)
+        calls[i] = i + i / 2;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char *str = compress_uint64_array(calls, size, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    free(str);
+    free(calls);
+    double t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stdout, "*** Compressing %zu calls: %f seconds\n", size, t);
+    return t;
+}
+
+// compress_benchmark only reports the encoding times: they depend on the load of the machine.
+// With inputs 4 times apart, a linear encoder has a ratio of about 4 and a quadratic one of 16.
+static void compress_benchmark(void)
+{
+    double t_small = _benchmark_compress(BENCHMARK_SMALL_SIZE);
+    double t_large = _benchmark_compress(BENCHMARK_LARGE_SIZE);
+    if (t_small > 0)
+        fprintf(stdout, "*** Compressing %d calls is %f times slower than compressing %d calls\n", BENCHMARK_LARGE_SIZE, t_large / t_small, BENCHMARK_SMALL_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+    if (compress_array_test() || compress_uint64_array_test())
+    {
+        fprintf(stderr, "[ERROR] compressing array test failed\n");
+        return EXIT_FAILURE;
+    }
+    compress_benchmark();
+
+    fprintf(stdout, "compressing array test succeeded\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,341 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+
+#include "counts_data.h"
+
+static double sparse_counts_ratio = -1;
+
+static double _get_sparse_counts_ratio()
+{
+    if (sparse_counts_ratio < 0)
+    {
+        char *ratio_envvar = getenv(SPARSE_COUNTS_RATIO_ENVVAR);
+        sparse_counts_ratio = DEFAULT_SPARSE_COUNTS_RATIO;
+        if (ratio_envvar != NULL)
+            sparse_counts_ratio = atof(ratio_envvar);
+        if (sparse_counts_ratio < 0)
+            sparse_counts_ratio = 0;
+    }
+    return sparse_counts_ratio;
+}
+
+static counts_quantization_t counts_quantization = COUNTS_QUANTIZATION_NONE;
+static double counts_tolerance = DEFAULT_COUNTS_TOLERANCE;
+static bool counts_quantization_set = false;
+
+// Lower bounds of the buckets of the relative quantization, in increasing order
+static int *bucket_bounds = NULL;
+static int num_bucket_bounds = 0;
+static double bucket_bounds_tolerance = -1;
+
+// get_counts_quantization returns the quantization requested with the
+// COUNTS_QUANTIZATION_ENVVAR environment variable and, when tolerance is not NULL, its
+// relative tolerance
+counts_quantization_t get_counts_quantization(double *tolerance)
+{
+    if (!counts_quantization_set)
+    {
+        char *quantization_envvar = getenv(COUNTS_QUANTIZATION_ENVVAR);
+        char *tolerance_envvar = getenv(COUNTS_TOLERANCE_ENVVAR);
+        if (quantization_envvar != NULL && strcmp(quantization_envvar, "log2") == 0)
+            counts_quantization = COUNTS_QUANTIZATION_LOG2;
+        if (quantization_envvar != NULL && strcmp(quantization_envvar, "relative") == 0)
+            counts_quantization = COUNTS_QUANTIZATION_RELATIVE;
+        if (tolerance_envvar != NULL && atof(tolerance_envvar) > 0)
+            counts_tolerance = atof(tolerance_envvar);
+        counts_quantization_set = true;
+    }
+    if (tolerance != NULL)
+        *tolerance = counts_tolerance;
+    return counts_quantization;
+}
+
+char *counts_quantization_to_str(counts_quantization_t quantization)
+{
+    switch (quantization)
+    {
+    case COUNTS_QUANTIZATION_LOG2:
+        return "log2";
+    case COUNTS_QUANTIZATION_RELATIVE:
+        return "relative";
+    default:
+        return "none";
+    }
+}
+
+// _init_bucket_bounds computes the lower bounds of the buckets of the relative quantization
+// once for a given tolerance, so quantizing a count is a binary search
+static void _init_bucket_bounds(double tolerance)
+{
+    double bound = 1.0;
+    int max_bounds = 64;
+
+    free(bucket_bounds);
+    bucket_bounds = (int *)malloc(max_bounds * sizeof(int));
+    assert(bucket_bounds);
+    num_bucket_bounds = 0;
+    while (bound < INT_MAX)
+    {
+        int b = (int)(bound + 0.5);
+        if (num_bucket_bounds == 0 || b > bucket_bounds[num_bucket_bounds - 1])
+        {
+            if (num_bucket_bounds == max_bounds)
+            {
+                max_bounds *= 2;
+                bucket_bounds = (int *)realloc(bucket_bounds, max_bounds * sizeof(int));
+                assert(bucket_bounds);
+            }
+            bucket_bounds[num_bucket_bounds] = b;
+            num_bucket_bounds++;
+        }
+        bound *= 1.0 + tolerance;
+    }
+    bucket_bounds_tolerance = tolerance;
+}
+
+// quantize_count returns the lower bound of the bucket of a count; negative and zero counts
+// are returned unchanged
+int quantize_count(int count, counts_quantization_t quantization, double tolerance)
+{
+    int low, high;
+
+    if (count <= 0)
+        return count;
+    switch (quantization)
+    {
+    case COUNTS_QUANTIZATION_LOG2:
+        return 1 << (31 - __builtin_clz(count));
+
+    case COUNTS_QUANTIZATION_RELATIVE:
+        if (tolerance <= 0)
+            return count;
+        if (tolerance != bucket_bounds_tolerance)
+            _init_bucket_bounds(tolerance);
+        // Largest bound lower than or equal to the count; the first bound is always 1
+        low = 0;
+        high = num_bucket_bounds - 1;
+        while (low < high)
+        {
+            int mid = (low + high + 1) / 2;
+            if (bucket_bounds[mid] <= count)
+                low = mid;
+            else
+                high = mid - 1;
+        }
+        return bucket_bounds[low];
+
+    default:
+        return count;
+    }
+}
+
+// counts_quantize quantizes counts in place as requested with the COUNTS_QUANTIZATION_ENVVAR
+// environment variable
+void counts_quantize(int *counts, int len)
+{
+    double tolerance;
+    counts_quantization_t quantization = get_counts_quantization(&tolerance);
+    int i;
+
+    if (quantization == COUNTS_QUANTIZATION_NONE)
+        return;
+    for (i = 0; i < len; i++)
+        counts[i] = quantize_count(counts[i], quantization, tolerance);
+}
+
+uint64_t counts_total(int *counts, int len)
+{
+    uint64_t total = 0;
+    int i;
+    for (i = 0; i < len; i++)
+    {
+        if (counts[i] > 0)
+            total += counts[i];
+    }
+    return total;
+}
+
+// counts_data_set_counts stores a copy of counts in data, as a sparse series when most of
+// the counts are zero
+void counts_data_set_counts(counts_data_t *data, int *counts, int len)
+{
+    int nnz = 0;
+    int i;
+    for (i = 0; i < len; i++)
+    {
+        if (counts[i] != 0)
+            nnz++;
+    }
+    bool sparse = len >= SPARSE_COUNTS_MIN_LEN && nnz < _get_sparse_counts_ratio() * len;
+    counts_data_init_series(data, counts, len, sparse);
+}
+
+// counts_data_init_series stores a copy of counts in data using the requested representation
+void counts_data_init_series(counts_data_t *data, int *counts, int len, bool sparse)
+{
+    int i;
+    data->len = len;
+    if (!sparse)
+    {
+        data->peers = NULL;
+        data->num_counters = len;
+        data->counters = (int *)malloc((len > 0 ? len : 1) * sizeof(int));
+        assert(data->counters);
+        memcpy(data->counters, counts, len * sizeof(int));
+        return;
+    }
+
+    data->num_counters = 0;
+    for (i = 0; i < len; i++)
+    {
+        if (counts[i] != 0)
+            data->num_counters++;
+    }
+    // Arrays are never empty so a sparse series is always identified by its peers
+    data->peers = (int *)malloc((data->num_counters > 0 ? data->num_counters : 1) * sizeof(int));
+    data->counters = (int *)malloc((data->num_counters > 0 ? data->num_counters : 1) * sizeof(int));
+    assert(data->peers);
+    assert(data->counters);
+    data->num_counters = 0;
+    for (i = 0; i < len; i++)
+    {
+        if (counts[i] != 0)
+        {
+            data->peers[data->num_counters] = i;
+            data->counters[data->num_counters] = counts[i];
+            data->num_counters++;
+        }
+    }
+}
+
+void counts_data_free_series(counts_data_t *data)
+{
+    free(data->counters);
+    free(data->peers);
+    data->counters = NULL;
+    data->peers = NULL;
+    data->num_counters = 0;
+    data->len = 0;
+}
+
+// counts_data_get returns the count of a peer
+int counts_data_get(counts_data_t *data, int idx)
+{
+    assert(idx >= 0 && idx < data->len);
+    if (data->peers == NULL)
+        return data->counters[idx];
+
+    int low = 0;
+    int high = data->num_counters - 1;
+    while (low <= high)
+    {
+        int mid = low + (high - low) / 2;
+        if (data->peers[mid] == idx)
+            return data->counters[mid];
+        if (data->peers[mid] < idx)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+    return 0;
+}
+
+// counts_data_to_dense expands the series into counts, which must have data->len elements
+void counts_data_to_dense(counts_data_t *data, int *counts)
+{
+    int i;
+    if (data->peers == NULL)
+    {
+        memcpy(counts, data->counters, data->len * sizeof(int));
+        return;
+    }
+    memset(counts, 0, data->len * sizeof(int));
+    for (i = 0; i < data->num_counters; i++)
+        counts[data->peers[i]] = data->counters[i];
+}
+
+// counts_data_equal checks whether the series is identical to an array of counts, without
+// expanding sparse series
+bool counts_data_equal(counts_data_t *data, int *counts, int len)
+{
+    int i, j;
+    if (data->len != len)
+        return false;
+    if (data->peers == NULL)
+        return memcmp(data->counters, counts, len * sizeof(int)) == 0;
+
+    j = 0;
+    for (i = 0; i < len; i++)
+    {
+        if (j < data->num_counters && data->peers[j] == i)
+        {
+            if (counts[i] != data->counters[j])
+                return false;
+            j++;
+        }
+        else if (counts[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool counts_data_same_series(counts_data_t *data1, counts_data_t *data2)
+{
+    if (data1->len != data2->len || data1->num_counters != data2->num_counters)
+        return false;
+    if ((data1->peers == NULL) != (data2->peers == NULL))
+        return false;
+    if (data1->peers != NULL && memcmp(data1->peers, data2->peers, data1->num_counters * sizeof(int)) != 0)
+        return false;
+    return memcmp(data1->counters, data2->counters, data1->num_counters * sizeof(int)) == 0;
+}
+
+static inline uint64_t _hash_add(uint64_t h, uint32_t v)
+{
+    // FNV-1a
+    h ^= v;
+    h *= 1099511628211ULL;
+    return h;
+}
+
+// counts_data_hash hashes the non-zero counts of the series and their peers, so the hash
+// does not depend on the representation of the series
+uint64_t counts_data_hash(counts_data_t *data)
+{
+    uint64_t h = _hash_add(14695981039346656037ULL, (uint32_t)data->len);
+    int i;
+    for (i = 0; i < data->num_counters; i++)
+    {
+        if (data->counters[i] == 0)
+            continue;
+        h = _hash_add(h, (uint32_t)(data->peers != NULL ? data->peers[i] : i));
+        h = _hash_add(h, (uint32_t)data->counters[i]);
+    }
+    return h;
+}
+
+// counts_data_write writes the counts of a series as in the count files: all the counts of
+// dense series, "sparse" followed by the peer:count pairs of the non-zero counts otherwise
+void counts_data_write(FILE *f, counts_data_t *data)
+{
+    int i;
+    if (data->peers == NULL)
+    {
+        for (i = 0; i < data->num_counters; i++)
+            fprintf(f, "%d ", data->counters[i]);
+        return;
+    }
+    fprintf(f, "sparse ");
+    for (i = 0; i < data->num_counters; i++)
+        fprintf(f, "%d:%d ", data->peers[i], data->counters[i]);
+}
@@ -0,0 +1,58 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_COUNTS_DATA_H
+#define COLLECTIVE_PROFILER_COUNTS_DATA_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "collective_profiler_config.h"
+#include "common_types.h"
+
+/*
+ * The counts of a series are stored either as a dense array, or as a sparse series when
+ * the ratio of non-zero counts is lower than DEFAULT_SPARSE_COUNTS_RATIO (or the value of
+ * the SPARSE_COUNTS_RATIO_ENVVAR environment variable): the peers having a non-zero count,
+ * in increasing order, and their counts, similarly to a row of a CSR matrix. The
+ * representation only depends on the counts so two identical series always have the same
+ * representation.
+ */
+
+/*
+ * Counts can be quantized before being compared with the counts of previous calls, so calls
+ * whose counts differ slightly share the same data: with the log2 quantization, a count is
+ * replaced by the largest power of 2 that is not greater than the count; with the relative
+ * quantization, counts are split in buckets whose bounds grow geometrically by a factor of
+ * 1 + tolerance (rounded to integers) and a count is replaced by the lower bound of its
+ * bucket. Quantized counts are left unchanged by a second quantization, and zero counts are
+ * never changed so the peers of a rank are preserved.
+ */
+typedef enum counts_quantization
+{
+    COUNTS_QUANTIZATION_NONE = 0,
+    COUNTS_QUANTIZATION_LOG2,
+    COUNTS_QUANTIZATION_RELATIVE,
+} counts_quantization_t;
+
+counts_quantization_t get_counts_quantization(double *tolerance);
+char *counts_quantization_to_str(counts_quantization_t quantization);
+int quantize_count(int count, counts_quantization_t quantization, double tolerance);
+void counts_quantize(int *counts, int len);
+uint64_t counts_total(int *counts, int len);
+
+void counts_data_set_counts(counts_data_t *data, int *counts, int len);
+void counts_data_init_series(counts_data_t *data, int *counts, int len, bool sparse);
+void counts_data_free_series(counts_data_t *data);
+int counts_data_get(counts_data_t *data, int idx);
+void counts_data_to_dense(counts_data_t *data, int *counts);
+bool counts_data_equal(counts_data_t *data, int *counts, int len);
+bool counts_data_same_series(counts_data_t *data1, counts_data_t *data2);
+uint64_t counts_data_hash(counts_data_t *data);
+void counts_data_write(FILE *f, counts_data_t *data);
+
+#endif // COLLECTIVE_PROFILER_COUNTS_DATA_H
@@ -0,0 +1,224 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "counts_data.h"
+
+#define LEN (1024)
+#define MAX_TEXT_LEN (256)
+
+static char *_write(counts_data_t *data)
+{
+    static char text[MAX_TEXT_LEN];
+    FILE *f = fmemopen(text, MAX_TEXT_LEN, "w");
+    counts_data_write(f, data);
+    fclose(f);
+    return text;
+}
+
+static int check_series(int *counts, int len, bool expected_sparse, char *expected_text)
+{
+    counts_data_t data, dense, sparse;
+    int *expanded = malloc(len * sizeof(int));
+    int i;
+
+    counts_data_set_counts(&data, counts, len);
+    if ((data.peers != NULL) != expected_sparse || data.len != len)
+    {
+        fprintf(stderr, "*** [ERROR] invalid representation of a series of %d counts\n", len);
+        return 1;
+    }
+
+    counts_data_to_dense(&data, expanded);
+    if (memcmp(expanded, counts, len * sizeof(int)) != 0 || !counts_data_equal(&data, counts, len))
+    {
+        fprintf(stderr, "*** [ERROR] the series differs from its counts\n");
+        return 1;
+    }
+    for (i = 0; i < len; i++)
+    {
+        if (counts_data_get(&data, i) != counts[i])
+        {
+            fprintf(stderr, "*** [ERROR] invalid count %d: %d instead of %d\n", i, counts_data_get(&data, i), counts[i]);
+            return 1;
+        }
+    }
+
+    // Any change must be detected, including on zero counts
+    for (i = 0; i < len; i += len / 4 + 1)
+    {
+        expanded[i]++;
+        if (counts_data_equal(&data, expanded, len))
+        {
+            fprintf(stderr, "*** [ERROR] change of count %d not detected\n", i);
+            return 1;
+        }
+        expanded[i]--;
+    }
+    if (counts_data_equal(&data, counts, len - 1))
+    {
+        fprintf(stderr, "*** [ERROR] change of length not detected\n");
+        return 1;
+    }
+
+    // The hash does not depend on the representation
+    counts_data_init_series(&dense, counts, len, false);
+    counts_data_init_series(&sparse, counts, len, true);
+    if (counts_data_hash(&dense) != counts_data_hash(&sparse) || counts_data_hash(&data) != counts_data_hash(&dense))
+    {
+        fprintf(stderr, "*** [ERROR] the hash depends on the representation\n");
+        return 1;
+    }
+    if (!counts_data_same_series(&data, expected_sparse ? &sparse : &dense))
+    {
+        fprintf(stderr, "*** [ERROR] identical series are not detected\n");
+        return 1;
+    }
+
+    if (expected_text != NULL && strcmp(_write(&data), expected_text) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid text: \"%s\" instead of \"%s\"\n", _write(&data), expected_text);
+        return 1;
+    }
+
+    counts_data_free_series(&data);
+    counts_data_free_series(&dense);
+    counts_data_free_series(&sparse);
+    free(expanded);
+    return 0;
+}
+
+static int counts_data_test(void)
+{
+    int counts[LEN] = {0};
+    int small[4] = {0, 0, 7, 0};
+    int i;
+
+    // Short series are always dense
+    if (check_series(small, 4, false, "0 0 7 0 "))
+        return 1;
+    fprintf(stdout, "*** short series successful\n");
+
+    // Nearest neighbor exchange: only two peers
+    counts[1] = 100;
+    counts[LEN - 1] = 100;
+    if (check_series(counts, LEN, true, "sparse 1:100 1023:100 "))
+        return 1;
+    fprintf(stdout, "*** sparse series successful\n");
+
+    // No peer at all
+    memset(counts, 0, sizeof(counts));
+    if (check_series(counts, LEN, true, "sparse "))
+        return 1;
+    fprintf(stdout, "*** empty series successful\n");
+
+    for (i = 0; i < LEN; i++)
+        counts[i] = i % 2;
+    if (check_series(counts, LEN, false, NULL))
+        return 1;
+    fprintf(stdout, "*** dense series successful\n");
+
+    // Series with the same non-zero counts but different lengths are different
+    counts_data_t data1, data2;
+    memset(counts, 0, sizeof(counts));
+    counts[0] = 1;
+    counts_data_set_counts(&data1, counts, LEN);
+    counts_data_set_counts(&data2, counts, LEN / 2);
+    if (counts_data_same_series(&data1, &data2))
+    {
+        fprintf(stderr, "*** [ERROR] series with different lengths are identical\n");
+        return 1;
+    }
+    counts_data_free_series(&data1);
+    counts_data_free_series(&data2);
+    return 0;
+}
+
+// check_quantization checks that quantized counts are within the tolerance of the counts,
+// that zero counts are preserved and that a second quantization does not change the counts
+static int check_quantization(counts_quantization_t quantization, double tolerance, double max_error)
+{
+    int count, previous = 0;
+    for (count = 0; count < 1 << 20; count++)
+    {
+        int q = quantize_count(count, quantization, tolerance);
+        if ((count == 0) != (q == 0) || q > count || count - q > max_error * count)
+        {
+            fprintf(stderr, "*** [ERROR] count %d quantized as %d with the %s quantization\n", count, q, counts_quantization_to_str(quantization));
+            return 1;
+        }
+        if (quantize_count(q, quantization, tolerance) != q || q < previous)
+        {
+            fprintf(stderr, "*** [ERROR] quantization of count %d is not stable\n", count);
+            return 1;
+        }
+        previous = q;
+    }
+    // The largest counts are quantized too
+    if (quantize_count(INT_MAX, quantization, tolerance) < INT_MAX - max_error * INT_MAX)
+    {
+        fprintf(stderr, "*** [ERROR] invalid quantization of the largest count\n");
+        return 1;
+    }
+    fprintf(stdout, "*** %s quantization successful\n", counts_quantization_to_str(quantization));
+    return 0;
+}
+
+static int counts_quantization_test(void)
+{
+    int counts[8] = {0, 1, 3, 100, 1000, 0, 1024, 1500};
+    int log2_counts[8] = {0, 1, 2, 64, 512, 0, 1024, 1024};
+
+    if (quantize_count(100, COUNTS_QUANTIZATION_NONE, 0) != 100 || quantize_count(-1, COUNTS_QUANTIZATION_LOG2, 0) != -1)
+    {
+        fprintf(stderr, "*** [ERROR] counts changed without quantization\n");
+        return 1;
+    }
+    if (check_quantization(COUNTS_QUANTIZATION_LOG2, 0, 0.5))
+        return 1;
+    if (check_quantization(COUNTS_QUANTIZATION_RELATIVE, 0.1, 0.1))
+        return 1;
+    if (check_quantization(COUNTS_QUANTIZATION_RELATIVE, 0.5, 0.5))
+        return 1;
+
+    // The quantization of a series is requested with an environment variable
+    setenv(COUNTS_QUANTIZATION_ENVVAR, "log2", 1);
+    if (get_counts_quantization(NULL) != COUNTS_QUANTIZATION_LOG2 || counts_total(counts, 8) != 3628)
+    {
+        fprintf(stderr, "*** [ERROR] invalid configuration of the quantization\n");
+        return 1;
+    }
+    counts_quantize(counts, 8);
+    if (memcmp(counts, log2_counts, sizeof(counts)) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid quantization of a series\n");
+        return 1;
+    }
+    fprintf(stdout, "*** quantization of a series successful\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (counts_data_test())
+    {
+        fprintf(stderr, "[ERROR] counts data test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (counts_quantization_test())
+    {
+        fprintf(stderr, "[ERROR] counts quantization test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "counts data test succeeded\n");
+    return EXIT_SUCCESS;
+}
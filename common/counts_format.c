@@ -0,0 +1,730 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "counts_format.h"
+#include "format.h"
+
+#define COUNTS_WRITER_INITIAL_CAPACITY (64)
+// Maximum size of a varint
+#define VARINT_MAX_LEN (10)
+
+counts_format_t get_counts_format()
+{
+    char *format = getenv(COLLECTIVE_PROFILER_COUNTS_FORMAT_ENVVAR);
+    if (format == NULL || strcmp(format, "text") == 0)
+        return COUNTS_FORMAT_TEXT;
+    if (strcmp(format, "binary") == 0)
+        return COUNTS_FORMAT_BINARY;
+    if (strcmp(format, "both") == 0)
+        return COUNTS_FORMAT_BOTH;
+    fprintf(stderr, "invalid format of count files: %s, using text\n", format);
+    return COUNTS_FORMAT_TEXT;
+}
+
+static inline uint64_t _zigzag_encode(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t _zigzag_decode(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* Writer */
+
+static inline void _put_varint(counts_writer_t *w, uint64_t v)
+{
+    if (w->buf_len + VARINT_MAX_LEN > w->buf_size)
+    {
+        w->buf_size *= 2;
+        uint8_t *tmp = realloc(w->buf, w->buf_size);
+        assert(tmp);
+        w->buf = tmp;
+    }
+    while (v >= 0x80)
+    {
+        w->buf[w->buf_len] = (uint8_t)(v | 0x80);
+        w->buf_len++;
+        v >>= 7;
+    }
+    w->buf[w->buf_len] = (uint8_t)v;
+    w->buf_len++;
+}
+
+// _flush_record writes the encoded record and returns its offset
+static int _flush_record(counts_writer_t *w, uint64_t *offset)
+{
+    *offset = w->offset;
+    if (fwrite(w->buf, 1, w->buf_len, w->f) != w->buf_len)
+    {
+        fprintf(stderr, "unable to write to %s\n", w->filename);
+        return 1;
+    }
+    w->offset += w->buf_len;
+    w->buf_len = 0;
+    return 0;
+}
+
+static void _insert_hash(counts_writer_t *w, uint64_t id)
+{
+    uint64_t slot = counts_data_hash(&(w->rows[id])) & (w->hash_capacity - 1);
+    while (w->hash_table[slot] != 0)
+        slot = (slot + 1) & (w->hash_capacity - 1);
+    w->hash_table[slot] = id + 1;
+}
+
+// _lookup_row returns the identifier of a row, or -1 if the row is not in the dictionary
+static int64_t _lookup_row(counts_writer_t *w, counts_data_t *row)
+{
+    uint64_t slot = counts_data_hash(row) & (w->hash_capacity - 1);
+    while (w->hash_table[slot] != 0)
+    {
+        uint64_t id = w->hash_table[slot] - 1;
+        if (counts_data_same_series(&(w->rows[id]), row))
+            return id;
+        slot = (slot + 1) & (w->hash_capacity - 1);
+    }
+    return -1;
+}
+
+// _base_row returns the row used to delta-encode a row; only dense rows are delta-encoded
+static int64_t _base_row(counts_writer_t *w, int rank, counts_data_t *row)
+{
+    if (!(w->header.flags & COUNTS_FILE_FLAG_DELTA) || rank < 0 || rank >= w->prev_rows_size || row->peers != NULL)
+        return -1;
+    int64_t base = w->prev_rows[rank];
+    if (base < 0 || w->rows[base].len != row->len || w->rows[base].peers != NULL || w->row_chains[base] >= COUNTS_FILE_MAX_DELTA_CHAIN)
+        return -1;
+    return base;
+}
+
+// _copy_row copies the counts of a row, keeping its representation
+static void _copy_row(counts_data_t *dst, counts_data_t *src)
+{
+    size_t size = (src->num_counters > 0 ? src->num_counters : 1) * sizeof(int);
+    memset(dst, 0, sizeof(counts_data_t));
+    dst->len = src->len;
+    dst->num_counters = src->num_counters;
+    dst->counters = malloc(size);
+    assert(dst->counters);
+    memcpy(dst->counters, src->counters, src->num_counters * sizeof(int));
+    if (src->peers != NULL)
+    {
+        dst->peers = malloc(size);
+        assert(dst->peers);
+        memcpy(dst->peers, src->peers, src->num_counters * sizeof(int));
+    }
+}
+
+// _add_row returns the identifier of a row, adding it to the dictionary if necessary
+static int _add_row(counts_writer_t *w, counts_data_t *row, int rank, uint64_t *id)
+{
+    int64_t existing = _lookup_row(w, row);
+    if (existing >= 0)
+    {
+        *id = existing;
+        return 0;
+    }
+
+    uint64_t new_id = w->header.num_rows;
+    if (new_id == w->max_rows)
+    {
+        w->max_rows *= 2;
+        w->row_offsets = realloc(w->row_offsets, w->max_rows * sizeof(uint64_t));
+        w->rows = realloc(w->rows, w->max_rows * sizeof(counts_data_t));
+        w->row_chains = realloc(w->row_chains, w->max_rows * sizeof(int));
+        assert(w->row_offsets);
+        assert(w->rows);
+        assert(w->row_chains);
+    }
+    if ((new_id + 1) * 2 > w->hash_capacity)
+    {
+        // Keep the load factor of the hash table under 50%
+        uint64_t i;
+        free(w->hash_table);
+        w->hash_capacity *= 2;
+        w->hash_table = calloc(w->hash_capacity, sizeof(uint64_t));
+        assert(w->hash_table);
+        for (i = 0; i < new_id; i++)
+            _insert_hash(w, i);
+    }
+
+    _copy_row(&(w->rows[new_id]), row);
+
+    int64_t base = _base_row(w, rank, row);
+    int i;
+    w->row_chains[new_id] = base >= 0 ? w->row_chains[base] + 1 : 1;
+    _put_varint(w, base + 1);
+    _put_varint(w, row->len);
+    _put_varint(w, row->peers != NULL ? 1 : 0);
+    if (row->peers != NULL)
+    {
+        _put_varint(w, row->num_counters);
+        for (i = 0; i < row->num_counters; i++)
+        {
+            _put_varint(w, row->peers[i] - (i > 0 ? row->peers[i - 1] : 0));
+            _put_varint(w, _zigzag_encode(row->counters[i]));
+        }
+    }
+    else
+    {
+        for (i = 0; i < row->len; i++)
+        {
+            if (base >= 0)
+                _put_varint(w, _zigzag_encode((int64_t)row->counters[i] - w->rows[base].counters[i]));
+            else
+                _put_varint(w, _zigzag_encode(row->counters[i]));
+        }
+    }
+    int rc = _flush_record(w, &(w->row_offsets[new_id]));
+    if (rc)
+        return rc;
+
+    _insert_hash(w, new_id);
+    w->header.num_rows++;
+    *id = new_id;
+    return 0;
+}
+
+int counts_writer_init(char *filename, char *collective_name, bool delta, counts_writer_t **writer)
+{
+    counts_writer_t *w = calloc(1, sizeof(counts_writer_t));
+    assert(w);
+
+    w->f = fopen(filename, "wb");
+    if (w->f == NULL)
+    {
+        fprintf(stderr, "unable to create %s\n", filename);
+        free(w);
+        return 1;
+    }
+    w->filename = strdup(filename);
+    memcpy(w->header.magic, COUNTS_FILE_MAGIC, COUNTS_FILE_MAGIC_LEN);
+    w->header.format_version = FORMAT_VERSION;
+    w->header.flags = delta ? COUNTS_FILE_FLAG_DELTA : 0;
+    strncpy(w->header.collective_name, collective_name, COUNTS_FILE_COLLECTIVE_NAME_LEN - 1);
+
+    // The header is written again with the final values when the file is closed
+    if (fwrite(&(w->header), sizeof(w->header), 1, w->f) != 1)
+    {
+        fprintf(stderr, "unable to write to %s\n", filename);
+        fclose(w->f);
+        free(w->filename);
+        free(w);
+        return 1;
+    }
+    w->offset = sizeof(w->header);
+
+    w->max_rows = COUNTS_WRITER_INITIAL_CAPACITY;
+    w->row_offsets = malloc(w->max_rows * sizeof(uint64_t));
+    w->rows = malloc(w->max_rows * sizeof(counts_data_t));
+    w->row_chains = malloc(w->max_rows * sizeof(int));
+    w->hash_capacity = 2 * COUNTS_WRITER_INITIAL_CAPACITY;
+    w->hash_table = calloc(w->hash_capacity, sizeof(uint64_t));
+    w->max_datasets = COUNTS_WRITER_INITIAL_CAPACITY;
+    w->dataset_offsets = malloc(w->max_datasets * sizeof(uint64_t));
+    w->buf_size = 4096;
+    w->buf = malloc(w->buf_size);
+    assert(w->row_offsets);
+    assert(w->rows);
+    assert(w->row_chains);
+    assert(w->hash_table);
+    assert(w->dataset_offsets);
+    assert(w->buf);
+
+    *writer = w;
+    return 0;
+}
+
+// counts_writer_add_dataset adds a count matrix, i.e., the unique series of counts and the
+// ranks that have them, and the calls that used that matrix
+int counts_writer_add_dataset(counts_writer_t *w, uint64_t startcall, uint64_t endcall, uint64_t num_calls, uint64_t *calls, uint64_t num_counts_data, counts_data_t **counters, int comm_size, int rank_vec_len, int type_size)
+{
+    uint64_t *row_ids = malloc((num_counts_data > 0 ? num_counts_data : 1) * sizeof(uint64_t));
+    uint64_t i;
+    int j;
+    int rc;
+
+    assert(row_ids);
+    // The new rows are written before the data set that references them
+    for (i = 0; i < num_counts_data; i++)
+    {
+        int rank = counters[i]->num_ranks > 0 ? counters[i]->ranks[0] : -1;
+        assert(counters[i]->len == rank_vec_len);
+        rc = _add_row(w, counters[i], rank, &(row_ids[i]));
+        if (rc)
+        {
+            free(row_ids);
+            return rc;
+        }
+    }
+
+    _put_varint(w, startcall);
+    _put_varint(w, endcall);
+    _put_varint(w, num_calls);
+    for (i = 0; i < num_calls; i++)
+        _put_varint(w, _zigzag_encode((int64_t)(calls[i] - (i > 0 ? calls[i - 1] : 0))));
+    _put_varint(w, comm_size);
+    _put_varint(w, rank_vec_len);
+    _put_varint(w, type_size);
+    _put_varint(w, num_counts_data);
+    for (i = 0; i < num_counts_data; i++)
+    {
+        _put_varint(w, row_ids[i]);
+        _put_varint(w, counters[i]->num_ranks);
+        for (j = 0; j < counters[i]->num_ranks; j++)
+            _put_varint(w, _zigzag_encode((int64_t)counters[i]->ranks[j] - (j > 0 ? counters[i]->ranks[j - 1] : 0)));
+    }
+
+    if (w->header.num_datasets == w->max_datasets)
+    {
+        w->max_datasets *= 2;
+        w->dataset_offsets = realloc(w->dataset_offsets, w->max_datasets * sizeof(uint64_t));
+        assert(w->dataset_offsets);
+    }
+    rc = _flush_record(w, &(w->dataset_offsets[w->header.num_datasets]));
+    if (rc)
+    {
+        free(row_ids);
+        return rc;
+    }
+    w->header.num_datasets++;
+
+    // The rows of this data set are the bases of the rows of the next one
+    if (w->header.flags & COUNTS_FILE_FLAG_DELTA)
+    {
+        for (i = 0; i < num_counts_data; i++)
+        {
+            for (j = 0; j < counters[i]->num_ranks; j++)
+            {
+                int rank = counters[i]->ranks[j];
+                if (rank < 0)
+                    continue;
+                if (rank >= w->prev_rows_size)
+                {
+                    int new_size = w->prev_rows_size > 0 ? w->prev_rows_size : COUNTS_WRITER_INITIAL_CAPACITY;
+                    while (rank >= new_size)
+                        new_size *= 2;
+                    w->prev_rows = realloc(w->prev_rows, new_size * sizeof(int64_t));
+                    assert(w->prev_rows);
+                    int k;
+                    for (k = w->prev_rows_size; k < new_size; k++)
+                        w->prev_rows[k] = -1;
+                    w->prev_rows_size = new_size;
+                }
+                w->prev_rows[rank] = row_ids[i];
+            }
+        }
+    }
+    free(row_ids);
+    return 0;
+}
+
+static int _write_index(counts_writer_t *w, uint64_t *offsets, uint64_t num, uint64_t *index_offset)
+{
+    // The index is aligned on 8 bytes so it can be accessed in place once the file is mapped
+    static const uint8_t padding[8] = {0};
+    size_t pad = (8 - (w->offset % 8)) % 8;
+    if (pad > 0 && fwrite(padding, 1, pad, w->f) != pad)
+        return 1;
+    w->offset += pad;
+    *index_offset = w->offset;
+    if (num > 0 && fwrite(offsets, sizeof(uint64_t), num, w->f) != num)
+        return 1;
+    w->offset += num * sizeof(uint64_t);
+    return 0;
+}
+
+int counts_writer_fini(counts_writer_t **writer)
+{
+    counts_writer_t *w;
+    uint64_t i;
+    int rc;
+
+    if (writer == NULL || *writer == NULL)
+        return 0;
+    w = *writer;
+
+    rc = _write_index(w, w->row_offsets, w->header.num_rows, &(w->header.rows_index_offset));
+    if (rc == 0)
+        rc = _write_index(w, w->dataset_offsets, w->header.num_datasets, &(w->header.datasets_index_offset));
+    if (rc == 0)
+    {
+        fseek(w->f, 0, SEEK_SET);
+        if (fwrite(&(w->header), sizeof(w->header), 1, w->f) != 1)
+            rc = 1;
+    }
+    if (rc)
+        fprintf(stderr, "unable to write to %s\n", w->filename);
+    fclose(w->f);
+
+    for (i = 0; i < w->header.num_rows; i++)
+        counts_data_free_series(&(w->rows[i]));
+    free(w->rows);
+    free(w->row_chains);
+    free(w->row_offsets);
+    free(w->hash_table);
+    free(w->dataset_offsets);
+    free(w->prev_rows);
+    free(w->buf);
+    free(w->filename);
+    free(w);
+    *writer = NULL;
+    return rc;
+}
+
+/* Reader */
+
+static inline int _get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v)
+{
+    uint64_t result = 0;
+    int shift = 0;
+    while (*p < end && shift < 64)
+    {
+        uint8_t byte = **p;
+        (*p)++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *v = result;
+            return 0;
+        }
+        shift += 7;
+    }
+    return 1;
+}
+
+int counts_file_open(char *filename, counts_file_t **file)
+{
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "unable to open %s\n", filename);
+        return 1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(counts_file_header_t))
+    {
+        fprintf(stderr, "%s is not a count file\n", filename);
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "unable to map %s\n", filename);
+        return 1;
+    }
+
+    counts_file_t *f = calloc(1, sizeof(counts_file_t));
+    assert(f);
+    f->map = map;
+    f->size = st.st_size;
+    f->header = (const counts_file_header_t *)map;
+    const counts_file_header_t *h = f->header;
+    if (memcmp(h->magic, COUNTS_FILE_MAGIC, COUNTS_FILE_MAGIC_LEN) != 0 ||
+        h->rows_index_offset + h->num_rows * sizeof(uint64_t) > f->size ||
+        h->datasets_index_offset + h->num_datasets * sizeof(uint64_t) > f->size ||
+        h->rows_index_offset % 8 != 0 || h->datasets_index_offset % 8 != 0)
+    {
+        fprintf(stderr, "%s is not a valid count file\n", filename);
+        counts_file_close(&f);
+        return 1;
+    }
+    f->rows_index = (const uint64_t *)(f->map + h->rows_index_offset);
+    f->datasets_index = (const uint64_t *)(f->map + h->datasets_index_offset);
+    *file = f;
+    return 0;
+}
+
+// _read_row_record reads the header of a row record; p then points to the counts
+static int _read_row_record(counts_file_t *file, uint64_t id, const uint8_t **p, int64_t *base, uint64_t *len, bool *sparse)
+{
+    uint64_t base_plus_one, flag;
+    const uint8_t *end = file->map + file->size;
+
+    if (id >= file->header->num_rows || file->rows_index[id] >= file->size)
+        return 1;
+    *p = file->map + file->rows_index[id];
+    if (_get_varint(p, end, &base_plus_one) || _get_varint(p, end, len) || _get_varint(p, end, &flag))
+        return 1;
+    // The base of a row is always written before the row and only dense rows are delta-encoded
+    if (base_plus_one > id || flag > 1 || (flag == 1 && base_plus_one != 0))
+        return 1;
+    // Every count uses at least one byte
+    if (flag == 0 && *len > (uint64_t)(end - *p))
+        return 1;
+    *base = (int64_t)base_plus_one - 1;
+    *sparse = flag == 1;
+    return 0;
+}
+
+static int _get_sparse_row(const uint8_t *p, const uint8_t *end, uint64_t len, counts_data_t *row)
+{
+    uint64_t num, i, v;
+    int64_t peer = 0;
+
+    if (_get_varint(&p, end, &num) || num > len || num > (uint64_t)(end - p))
+        return 1;
+    memset(row, 0, sizeof(counts_data_t));
+    row->len = (int)len;
+    row->num_counters = (int)num;
+    row->peers = malloc((num > 0 ? num : 1) * sizeof(int));
+    row->counters = malloc((num > 0 ? num : 1) * sizeof(int));
+    assert(row->peers);
+    assert(row->counters);
+    for (i = 0; i < num; i++)
+    {
+        if (_get_varint(&p, end, &v))
+            goto error;
+        peer += v;
+        // Peers are in increasing order
+        if ((i > 0 && v == 0) || peer >= (int64_t)len)
+            goto error;
+        row->peers[i] = (int)peer;
+        if (_get_varint(&p, end, &v))
+            goto error;
+        row->counters[i] = (int)_zigzag_decode(v);
+    }
+    return 0;
+
+error:
+    counts_data_free_series(row);
+    return 1;
+}
+
+// counts_file_get_series decodes a row of the dictionary, keeping its representation; the
+// row must be released with counts_data_free_series()
+int counts_file_get_series(counts_file_t *file, uint64_t id, counts_data_t *row)
+{
+    const uint8_t *end = file->map + file->size;
+    const uint8_t *p;
+    int64_t base;
+    uint64_t row_len, i, v;
+    bool sparse;
+
+    if (_read_row_record(file, id, &p, &base, &row_len, &sparse))
+        return 1;
+    if (sparse)
+        return _get_sparse_row(p, end, row_len, row);
+
+    // Rows are decoded from the first row of their chain of bases
+    uint64_t chain[COUNTS_FILE_MAX_DELTA_CHAIN];
+    uint64_t chain_len = 1;
+    chain[0] = id;
+    while (base >= 0)
+    {
+        uint64_t base_len;
+        const uint8_t *q;
+        if (chain_len == COUNTS_FILE_MAX_DELTA_CHAIN)
+            return 1;
+        chain[chain_len] = base;
+        chain_len++;
+        if (_read_row_record(file, base, &q, &base, &base_len, &sparse) || base_len != row_len || sparse)
+            return 1;
+    }
+
+    int *r = calloc(row_len > 0 ? row_len : 1, sizeof(int));
+    assert(r);
+    while (chain_len > 0)
+    {
+        chain_len--;
+        if (_read_row_record(file, chain[chain_len], &p, &base, &row_len, &sparse))
+            goto error;
+        for (i = 0; i < row_len; i++)
+        {
+            if (_get_varint(&p, end, &v))
+                goto error;
+            // The first row of the chain is not delta-encoded so r only contains zeros
+            r[i] += (int)_zigzag_decode(v);
+        }
+    }
+    memset(row, 0, sizeof(counts_data_t));
+    row->counters = r;
+    row->num_counters = (int)row_len;
+    row->len = (int)row_len;
+    return 0;
+
+error:
+    free(r);
+    return 1;
+}
+
+// counts_file_get_row decodes a row of the dictionary as a dense array of counts; the row
+// must be freed by the caller
+int counts_file_get_row(counts_file_t *file, uint64_t id, int **row, int *len)
+{
+    counts_data_t series;
+    if (counts_file_get_series(file, id, &series))
+        return 1;
+    if (series.peers == NULL)
+    {
+        *row = series.counters;
+        *len = series.len;
+        return 0;
+    }
+    int *r = calloc(series.len > 0 ? series.len : 1, sizeof(int));
+    assert(r);
+    counts_data_to_dense(&series, r);
+    *len = series.len;
+    counts_data_free_series(&series);
+    *row = r;
+    return 0;
+}
+
+static int _get_deltas_uint64(const uint8_t **p, const uint8_t *end, uint64_t num, uint64_t *values)
+{
+    uint64_t i, v;
+    for (i = 0; i < num; i++)
+    {
+        if (_get_varint(p, end, &v))
+            return 1;
+        values[i] = (i > 0 ? values[i - 1] : 0) + (uint64_t)_zigzag_decode(v);
+    }
+    return 0;
+}
+
+// counts_file_get_dataset decodes a data set; it must be released with counts_dataset_free()
+int counts_file_get_dataset(counts_file_t *file, uint64_t idx, counts_dataset_t *ds)
+{
+    const uint8_t *end = file->map + file->size;
+    const uint8_t *p;
+    uint64_t v, i, j;
+
+    memset(ds, 0, sizeof(counts_dataset_t));
+    if (idx >= file->header->num_datasets || file->datasets_index[idx] >= file->size)
+        return 1;
+    p = file->map + file->datasets_index[idx];
+    if (_get_varint(&p, end, &ds->startcall) || _get_varint(&p, end, &ds->endcall) || _get_varint(&p, end, &ds->num_calls))
+        return 1;
+    // Every call uses at least one byte so the number of calls is bounded by the size of the file
+    if (ds->num_calls > (uint64_t)(end - p))
+        return 1;
+    ds->calls = malloc((ds->num_calls > 0 ? ds->num_calls : 1) * sizeof(uint64_t));
+    assert(ds->calls);
+    if (_get_deltas_uint64(&p, end, ds->num_calls, ds->calls))
+        goto error;
+    if (_get_varint(&p, end, &v))
+        goto error;
+    ds->comm_size = (int)v;
+    if (_get_varint(&p, end, &v))
+        goto error;
+    ds->rank_vec_len = (int)v;
+    if (_get_varint(&p, end, &v))
+        goto error;
+    ds->type_size = (int)v;
+    if (_get_varint(&p, end, &ds->num_refs) || ds->num_refs > (uint64_t)(end - p))
+        goto error;
+    ds->refs = calloc(ds->num_refs > 0 ? ds->num_refs : 1, sizeof(counts_ref_t));
+    assert(ds->refs);
+    for (i = 0; i < ds->num_refs; i++)
+    {
+        counts_ref_t *ref = &(ds->refs[i]);
+        if (_get_varint(&p, end, &ref->row) || ref->row >= file->header->num_rows)
+            goto error;
+        if (_get_varint(&p, end, &ref->num_ranks) || ref->num_ranks > (uint64_t)(end - p))
+            goto error;
+        ref->ranks = malloc((ref->num_ranks > 0 ? ref->num_ranks : 1) * sizeof(int));
+        assert(ref->ranks);
+        int64_t rank = 0;
+        for (j = 0; j < ref->num_ranks; j++)
+        {
+            if (_get_varint(&p, end, &v))
+                goto error;
+            rank += _zigzag_decode(v);
+            ref->ranks[j] = (int)rank;
+        }
+    }
+    return 0;
+
+error:
+    counts_dataset_free(ds);
+    return 1;
+}
+
+void counts_dataset_free(counts_dataset_t *ds)
+{
+    uint64_t i;
+    if (ds->refs != NULL)
+    {
+        for (i = 0; i < ds->num_refs; i++)
+            free(ds->refs[i].ranks);
+    }
+    free(ds->refs);
+    free(ds->calls);
+    memset(ds, 0, sizeof(counts_dataset_t));
+}
+
+// counts_file_write_text writes the content of a binary count file using the text format
+// of the count files
+int counts_file_write_text(counts_file_t *file, FILE *out)
+{
+    char collective_name[COUNTS_FILE_COLLECTIVE_NAME_LEN + 1];
+    uint64_t i, j;
+
+    memcpy(collective_name, file->header->collective_name, COUNTS_FILE_COLLECTIVE_NAME_LEN);
+    collective_name[COUNTS_FILE_COLLECTIVE_NAME_LEN] = '\0';
+    for (i = 0; i < file->header->num_datasets; i++)
+    {
+        counts_dataset_t ds;
+        range_encoder_t enc;
+        if (counts_file_get_dataset(file, i, &ds))
+        {
+            fprintf(stderr, "unable to read data set %" PRIu64 "\n", i);
+            return 1;
+        }
+
+        fprintf(out, "# Raw counters\n\n");
+        fprintf(out, "Number of ranks: %d\n", ds.comm_size);
+        fprintf(out, "Datatype size: %d\n", ds.type_size);
+        fprintf(out, "%s calls %" PRIu64 "-%" PRIu64 "\n", collective_name, ds.startcall, ds.endcall - 1);
+        fprintf(out, "Count: %" PRIu64 " calls - ", ds.num_calls);
+        range_encoder_init(&enc, NULL, out, false);
+        write_compressed_uint64_array(&enc, ds.calls, ds.num_calls, 1);
+        fprintf(out, "\n");
+        fprintf(out, "\n\nBEGINNING DATA\n");
+        for (j = 0; j < ds.num_refs; j++)
+        {
+            counts_data_t row;
+            if (counts_file_get_series(file, ds.refs[j].row, &row))
+            {
+                fprintf(stderr, "unable to read row %" PRIu64 "\n", ds.refs[j].row);
+                counts_dataset_free(&ds);
+                return 1;
+            }
+            fprintf(out, "Rank(s) ");
+            range_encoder_init(&enc, NULL, out, true);
+            write_compressed_int_array(&enc, ds.refs[j].ranks, ds.refs[j].num_ranks, 1);
+            fprintf(out, ": ");
+            counts_data_write(out, &row);
+            fprintf(out, "\n");
+            counts_data_free_series(&row);
+        }
+        fprintf(out, "END DATA\n");
+        counts_dataset_free(&ds);
+    }
+    return 0;
+}
+
+void counts_file_close(counts_file_t **file)
+{
+    if (file == NULL || *file == NULL)
+        return;
+    munmap((*file)->map, (*file)->size);
+    free(*file);
+    *file = NULL;
+}
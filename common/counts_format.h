@@ -0,0 +1,147 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_COUNTS_FORMAT_H
+#define COLLECTIVE_PROFILER_COUNTS_FORMAT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "collective_profiler_config.h"
+#include "common_types.h"
+#include "counts_data.h"
+
+// Name of the environment variable to select the format of the count files: "text" (default),
+// "binary" or "both"
+#define COLLECTIVE_PROFILER_COUNTS_FORMAT_ENVVAR "COLLECTIVE_PROFILER_COUNTS_FORMAT"
+// Name of the environment variable to enable the delta encoding of the rows of the binary count files
+#define COLLECTIVE_PROFILER_COUNTS_DELTA_ENVVAR "COLLECTIVE_PROFILER_COUNTS_DELTA"
+
+typedef enum counts_format
+{
+    COUNTS_FORMAT_TEXT = 0,
+    COUNTS_FORMAT_BINARY,
+    COUNTS_FORMAT_BOTH,
+} counts_format_t;
+
+/*
+ * Binary count files are made of a header, a body and two indexes. The body is a sequence
+ * of row records and data set records, in which all the integers are unsigned LEB128
+ * varints; signed values are zigzag-encoded.
+ *
+ * - A row record is a unique series of counts, i.e., the dictionary of the rows: the
+ *   identifier of its base row plus one (0 when the row is not delta-encoded), the number
+ *   of counts, 1 for sparse rows and 0 for dense rows, and the counts. The counts of a
+ *   delta-encoded row are the differences with the counts of its base row, which is the
+ *   row that the same rank had in the previous data set. A row is decoded from at most
+ *   COUNTS_FILE_MAX_DELTA_CHAIN records, i.e., the row and its bases: a row that would
+ *   exceed that bound is written in full and starts a new chain. Sparse rows, see counts_data.h,
+ *   are never delta-encoded: their counts are the number of non-zero counts followed by
+ *   the peer (the first one and then the differences with the previous peer) and the
+ *   count of every non-zero count.
+ * - A data set record is a count matrix and the calls that used it, as in the text
+ *   format: the first and last calls of the period, the number of calls, the calls (the
+ *   first one and then the differences with the previous call), the size of the
+ *   communicator, the number of counts per rank, the size of the datatype and the number
+ *   of references to rows. Every reference is the identifier of a row, the number of ranks
+ *   having that row and the ranks (the first one and then the differences).
+ *
+ * The indexes are arrays of 64-bit offsets of the row records and of the data set records,
+ * aligned on 8 bytes, so the file can be memory-mapped and any row or data set accessed
+ * directly.
+ */
+#define COUNTS_FILE_MAGIC "CPCOUNTS"
+#define COUNTS_FILE_MAGIC_LEN (8)
+#define COUNTS_FILE_COLLECTIVE_NAME_LEN (32)
+#define COUNTS_FILE_FLAG_DELTA (1 << 0)
+#define COUNTS_FILE_MAX_DELTA_CHAIN (16) // Maximum number of records to decode a delta-encoded row
+
+typedef struct counts_file_header
+{
+    char magic[COUNTS_FILE_MAGIC_LEN];
+    uint32_t format_version;
+    uint32_t flags;
+    char collective_name[COUNTS_FILE_COLLECTIVE_NAME_LEN];
+    uint64_t num_rows;
+    uint64_t rows_index_offset;
+    uint64_t num_datasets;
+    uint64_t datasets_index_offset;
+} counts_file_header_t;
+
+typedef struct counts_writer
+{
+    char *filename;
+    FILE *f;
+    counts_file_header_t header;
+    uint64_t offset;
+
+    // Dictionary of the rows: copies of the series of counts, indexed by a hash table of row
+    // identifiers
+    uint64_t max_rows;
+    uint64_t *row_offsets;
+    counts_data_t *rows;
+    int *row_chains; // Number of records to decode every row, see COUNTS_FILE_MAX_DELTA_CHAIN
+    uint64_t hash_capacity;
+    uint64_t *hash_table; // Row identifier plus one, 0 for empty slots
+
+    uint64_t max_datasets;
+    uint64_t *dataset_offsets;
+
+    // Row of every rank in the previous data set, i.e., the base of the delta encoding
+    int64_t *prev_rows;
+    int prev_rows_size;
+
+    uint8_t *buf; // Encoding buffer of the records
+    size_t buf_size;
+    size_t buf_len;
+} counts_writer_t;
+
+typedef struct counts_ref
+{
+    uint64_t row;
+    uint64_t num_ranks;
+    int *ranks;
+} counts_ref_t;
+
+typedef struct counts_dataset
+{
+    uint64_t startcall;
+    uint64_t endcall;
+    uint64_t num_calls;
+    uint64_t *calls;
+    int comm_size;
+    int rank_vec_len;
+    int type_size;
+    uint64_t num_refs;
+    counts_ref_t *refs;
+} counts_dataset_t;
+
+// counts_file is a memory-mapped binary count file
+typedef struct counts_file
+{
+    uint8_t *map;
+    size_t size;
+    const counts_file_header_t *header;
+    const uint64_t *rows_index;
+    const uint64_t *datasets_index;
+} counts_file_t;
+
+counts_format_t get_counts_format();
+
+int counts_writer_init(char *filename, char *collective_name, bool delta, counts_writer_t **writer);
+int counts_writer_add_dataset(counts_writer_t *w, uint64_t startcall, uint64_t endcall, uint64_t num_calls, uint64_t *calls, uint64_t num_counts_data, counts_data_t **counters, int comm_size, int rank_vec_len, int type_size);
+int counts_writer_fini(counts_writer_t **writer);
+
+int counts_file_open(char *filename, counts_file_t **file);
+int counts_file_get_series(counts_file_t *file, uint64_t id, counts_data_t *row);
+int counts_file_get_row(counts_file_t *file, uint64_t id, int **row, int *len);
+int counts_file_get_dataset(counts_file_t *file, uint64_t idx, counts_dataset_t *ds);
+void counts_dataset_free(counts_dataset_t *ds);
+int counts_file_write_text(counts_file_t *file, FILE *out);
+void counts_file_close(counts_file_t **file);
+
+#endif // COLLECTIVE_PROFILER_COUNTS_FORMAT_H
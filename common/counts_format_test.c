@@ -0,0 +1,335 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "counts_format.h"
+
+#define COMM_SIZE (4)
+#define NUM_DATASETS (3)
+#define MAX_TEXT_LEN (4096)
+#define SPARSE_LEN (64)
+
+// Count matrices of the data sets: one row per rank
+static int matrices[NUM_DATASETS][COMM_SIZE][COMM_SIZE] = {
+    {{1, 2, 3, 4}, {1, 2, 3, 4}, {0, 0, 0, 0}, {1, 2, 3, 4}},
+    {{1, 2, 3, 5}, {1, 2, 3, 5}, {0, 0, 0, 0}, {1000000, -1, 3, 4}},
+    {{1, 2, 3, 4}, {1, 2, 3, 4}, {0, 0, 0, 0}, {1, 2, 3, 4}},
+};
+static uint64_t calls[NUM_DATASETS][3] = {{0, 1, 2}, {3, 5, 6}, {7, 8, 9}};
+
+static char *expected_first_dataset = "# Raw counters\n\n"
+                                      "Number of ranks: 4\n"
+                                      "Datatype size: 8\n"
+                                      "alltoallv calls 0-9\n"
+                                      "Count: 3 calls - 0-2\n"
+                                      "\n\nBEGINNING DATA\n"
+                                      "Rank(s) 0-1, 3: 1 2 3 4 \n"
+                                      "Rank(s) 2: 0 0 0 0 \n"
+                                      "END DATA\n";
+
+// _build_dataset groups the ranks having the same row, as the profiler does
+static int _build_dataset(int matrix[COMM_SIZE][COMM_SIZE], counts_data_t **data)
+{
+    int num = 0;
+    int rank, i;
+    for (rank = 0; rank < COMM_SIZE; rank++)
+    {
+        for (i = 0; i < num; i++)
+        {
+            if (counts_data_equal(data[i], matrix[rank], COMM_SIZE))
+                break;
+        }
+        if (i == num)
+        {
+            data[num] = calloc(1, sizeof(counts_data_t));
+            counts_data_set_counts(data[num], matrix[rank], COMM_SIZE);
+            data[num]->ranks = calloc(COMM_SIZE, sizeof(int));
+            num++;
+        }
+        data[i]->ranks[data[i]->num_ranks] = rank;
+        data[i]->num_ranks++;
+    }
+    return num;
+}
+
+static int _write_file(char *filename, bool delta)
+{
+    counts_writer_t *w = NULL;
+    counts_data_t *data[COMM_SIZE];
+    int i, j;
+
+    if (counts_writer_init(filename, "alltoallv", delta, &w))
+        return 1;
+    for (i = 0; i < NUM_DATASETS; i++)
+    {
+        int num = _build_dataset(matrices[i], data);
+        int rc = counts_writer_add_dataset(w, 0, 10, 3, calls[i], num, data, COMM_SIZE, COMM_SIZE, 8);
+        for (j = 0; j < num; j++)
+        {
+            counts_data_free_series(data[j]);
+            free(data[j]->ranks);
+            free(data[j]);
+        }
+        if (rc)
+            return 1;
+    }
+    return counts_writer_fini(&w);
+}
+
+static char *_to_text(counts_file_t *file)
+{
+    char *text = calloc(MAX_TEXT_LEN, 1);
+    FILE *f = fmemopen(text, MAX_TEXT_LEN, "w");
+    int rc = counts_file_write_text(file, f);
+    fclose(f);
+    if (rc)
+    {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+static int check_counts_file(char *filename, bool delta, char **text)
+{
+    counts_file_t *file = NULL;
+    int i, rank;
+
+    if (_write_file(filename, delta) || counts_file_open(filename, &file))
+    {
+        fprintf(stderr, "*** [ERROR] unable to write or open %s\n", filename);
+        return 1;
+    }
+
+    // The rows of the first and last data sets are identical so only 4 rows are unique
+    if (file->header->num_rows != 4 || file->header->num_datasets != NUM_DATASETS)
+    {
+        fprintf(stderr, "*** [ERROR] %s has %" PRIu64 " rows and %" PRIu64 " data sets\n", filename, file->header->num_rows, file->header->num_datasets);
+        return 1;
+    }
+
+    for (i = 0; i < NUM_DATASETS; i++)
+    {
+        counts_dataset_t ds;
+        uint64_t j, k;
+        if (counts_file_get_dataset(file, i, &ds) || ds.num_calls != 3 || memcmp(ds.calls, calls[i], sizeof(calls[i])) != 0)
+        {
+            fprintf(stderr, "*** [ERROR] invalid data set %d in %s\n", i, filename);
+            return 1;
+        }
+        // Every rank must get its row back
+        int found = 0;
+        for (j = 0; j < ds.num_refs; j++)
+        {
+            int *row = NULL;
+            int len;
+            if (counts_file_get_row(file, ds.refs[j].row, &row, &len) || len != COMM_SIZE)
+            {
+                fprintf(stderr, "*** [ERROR] unable to read row %" PRIu64 " from %s\n", ds.refs[j].row, filename);
+                return 1;
+            }
+            for (k = 0; k < ds.refs[j].num_ranks; k++)
+            {
+                rank = ds.refs[j].ranks[k];
+                if (memcmp(row, matrices[i][rank], COMM_SIZE * sizeof(int)) != 0)
+                {
+                    fprintf(stderr, "*** [ERROR] invalid row for rank %d in data set %d of %s\n", rank, i, filename);
+                    return 1;
+                }
+                found++;
+            }
+            free(row);
+        }
+        counts_dataset_free(&ds);
+        if (found != COMM_SIZE)
+        {
+            fprintf(stderr, "*** [ERROR] data set %d of %s has %d ranks\n", i, filename, found);
+            return 1;
+        }
+    }
+
+    *text = _to_text(file);
+    counts_file_close(&file);
+    if (*text == NULL || strncmp(*text, expected_first_dataset, strlen(expected_first_dataset)) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid text for %s:\n%s\n", filename, *text);
+        return 1;
+    }
+
+    fprintf(stdout, "*** %s successful\n", filename);
+    return 0;
+}
+
+// check_sparse_rows checks that sparse series are stored as sparse rows, and that a sparse
+// and a dense series with the same length are both read back
+static int check_sparse_rows(char *filename)
+{
+    int sparse_counts[SPARSE_LEN] = {0};
+    int dense_counts[SPARSE_LEN];
+    int ranks[2] = {0, 1};
+    uint64_t call = 0;
+    counts_data_t sparse, dense;
+    counts_data_t *data[2] = {&sparse, &dense};
+    counts_writer_t *w = NULL;
+    counts_file_t *file = NULL;
+    int i;
+
+    for (i = 0; i < SPARSE_LEN; i++)
+        dense_counts[i] = i + 1;
+    sparse_counts[3] = 10;
+    sparse_counts[SPARSE_LEN - 1] = -2;
+    counts_data_set_counts(&sparse, sparse_counts, SPARSE_LEN);
+    counts_data_set_counts(&dense, dense_counts, SPARSE_LEN);
+    sparse.num_ranks = 1;
+    sparse.ranks = &(ranks[0]);
+    dense.num_ranks = 1;
+    dense.ranks = &(ranks[1]);
+    if (sparse.peers == NULL || dense.peers != NULL)
+    {
+        fprintf(stderr, "*** [ERROR] invalid representation of the series\n");
+        return 1;
+    }
+
+    // The rows of the second data set are based on the rows of the first one, only the dense
+    // row is delta-encoded
+    int rc = counts_writer_init(filename, "alltoallv", true, &w);
+    if (rc == 0)
+        rc = counts_writer_add_dataset(w, 0, 1, 1, &call, 2, data, 2, SPARSE_LEN, 4);
+    counts_data_free_series(&sparse);
+    counts_data_free_series(&dense);
+    sparse_counts[5] = 1;
+    dense_counts[5] = 0;
+    counts_data_set_counts(&sparse, sparse_counts, SPARSE_LEN);
+    counts_data_set_counts(&dense, dense_counts, SPARSE_LEN);
+    call = 1;
+    if (rc == 0)
+        rc = counts_writer_add_dataset(w, 1, 2, 1, &call, 2, data, 2, SPARSE_LEN, 4);
+    if (rc || counts_writer_fini(&w) || counts_file_open(filename, &file) || file->header->num_rows != 4)
+    {
+        fprintf(stderr, "*** [ERROR] unable to write %s\n", filename);
+        return 1;
+    }
+    for (i = 2; i < 4; i++)
+    {
+        int *row = NULL;
+        int len;
+        if (counts_file_get_row(file, i, &row, &len) || len != SPARSE_LEN || memcmp(row, i == 2 ? sparse_counts : dense_counts, sizeof(sparse_counts)) != 0)
+        {
+            fprintf(stderr, "*** [ERROR] invalid row %d in %s\n", i, filename);
+            return 1;
+        }
+        free(row);
+    }
+
+    char *text = _to_text(file);
+    counts_file_close(&file);
+    char *expected_line = "Rank(s) 0: sparse 3:10 5:1 63:-2 \n";
+    if (text == NULL || strstr(text, expected_line) == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] invalid text for %s:\n%s\n", filename, text);
+        return 1;
+    }
+    free(text);
+    counts_data_free_series(&sparse);
+    counts_data_free_series(&dense);
+    remove(filename);
+    fprintf(stdout, "*** %s successful\n", filename);
+    return 0;
+}
+
+// check_delta_chains checks that the chains of delta-encoded rows are bounded when the row
+// of a rank changes in every data set
+static int check_delta_chains(char *filename)
+{
+    int counts[COMM_SIZE] = {0, 1, 2, 3};
+    int rank = 0;
+    counts_data_t row;
+    counts_data_t *data[1] = {&row};
+    counts_writer_t *w = NULL;
+    counts_file_t *file = NULL;
+    uint64_t call;
+    int rc = counts_writer_init(filename, "alltoallv", true, &w);
+
+    for (call = 0; rc == 0 && call < 3 * COUNTS_FILE_MAX_DELTA_CHAIN; call++)
+    {
+        counts[0] = (int)call;
+        counts_data_set_counts(&row, counts, COMM_SIZE);
+        row.num_ranks = 1;
+        row.ranks = &rank;
+        rc = counts_writer_add_dataset(w, call, call, 1, &call, 1, data, 1, COMM_SIZE, 4);
+        counts_data_free_series(&row);
+    }
+    if (rc || counts_writer_fini(&w) || counts_file_open(filename, &file) || file->header->num_rows != 3 * COUNTS_FILE_MAX_DELTA_CHAIN)
+    {
+        fprintf(stderr, "*** [ERROR] unable to write %s\n", filename);
+        return 1;
+    }
+    for (call = 0; call < file->header->num_rows; call++)
+    {
+        int *r = NULL;
+        int len;
+        // The first varint of a row record is the identifier of its base plus one
+        bool full = file->map[file->rows_index[call]] == 0;
+        if (full != (call % COUNTS_FILE_MAX_DELTA_CHAIN == 0) || counts_file_get_row(file, call, &r, &len) || r[0] != (int)call || r[3] != 3)
+        {
+            fprintf(stderr, "*** [ERROR] invalid row %" PRIu64 " in %s\n", call, filename);
+            return 1;
+        }
+        free(r);
+    }
+    counts_file_close(&file);
+    remove(filename);
+    fprintf(stdout, "*** %s successful\n", filename);
+    return 0;
+}
+
+static int counts_format_test(void)
+{
+    char *text = NULL;
+    char *delta_text = NULL;
+    counts_file_t *file = NULL;
+
+    if (check_counts_file("counts_format_test.bin", false, &text))
+        return 1;
+    if (check_counts_file("counts_format_test_delta.bin", true, &delta_text))
+        return 1;
+    if (strcmp(text, delta_text) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] the content of the files differs with delta encoding\n");
+        return 1;
+    }
+    free(text);
+    free(delta_text);
+
+    // A truncated file must be rejected
+    if (truncate("counts_format_test.bin", sizeof(counts_file_header_t) + 4) != 0 || counts_file_open("counts_format_test.bin", &file) == 0)
+    {
+        fprintf(stderr, "*** [ERROR] truncated file was not detected\n");
+        return 1;
+    }
+
+    remove("counts_format_test.bin");
+    remove("counts_format_test_delta.bin");
+    if (check_delta_chains("counts_format_test_chains.bin"))
+        return 1;
+    return check_sparse_rows("counts_format_test_sparse.bin");
+}
+
+int main(int argc, char **argv)
+{
+    if (counts_format_test())
+    {
+        fprintf(stderr, "[ERROR] counts format test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "counts format test succeeded\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,31 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+/*
+ * counts_to_text converts a binary count file back to the text format of the count files.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "counts_format.h"
+
+int main(int argc, char **argv)
+{
+    counts_file_t *file = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <BINARY_COUNT_FILE>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (counts_file_open(argv[1], &file))
+        return EXIT_FAILURE;
+    int rc = counts_file_write_text(file, stdout);
+    counts_file_close(&file);
+    return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,13 +1,397 @@
 /*************************************************************************
- * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION. All rights reserved.
  *
  * See LICENSE.txt for license information
  ************************************************************************/
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "mpi.h"
 
 #include "datatype.h"
+
+// Keyval used to cache the layout of derived datatypes
+static int layout_keyval = MPI_KEYVAL_INVALID;
+
+// Attributes are not cached on predefined datatypes, their layouts are kept in a list
+typedef struct predefined_layout
+{
+    MPI_Datatype type;
+    datatype_layout_t layout;
+    struct predefined_layout *next;
+} predefined_layout_t;
+
+static predefined_layout_t *predefined_layouts = NULL;
+
+typedef struct blocks_builder
+{
+    data_block_t *blocks;
+    size_t num_blocks;
+    size_t max_blocks;
+} blocks_builder_t;
+
+static inline void _add_block(blocks_builder_t *b, MPI_Aint offset, size_t len)
+{
+    if (len == 0)
+        return;
+
+    // Blocks that are adjacent in memory and in the type map are merged
+    if (b->num_blocks > 0 && b->blocks[b->num_blocks - 1].offset + (ptrdiff_t)b->blocks[b->num_blocks - 1].len == offset)
+    {
+        b->blocks[b->num_blocks - 1].len += len;
+        return;
+    }
+
+    if (b->num_blocks >= b->max_blocks)
+    {
+        b->max_blocks = b->max_blocks == 0 ? 8 : b->max_blocks * 2;
+        b->blocks = realloc(b->blocks, b->max_blocks * sizeof(data_block_t));
+        assert(b->blocks);
+    }
+    b->blocks[b->num_blocks].offset = offset;
+    b->blocks[b->num_blocks].len = len;
+    b->num_blocks++;
+}
+
+static inline MPI_Aint _get_extent(MPI_Datatype type)
+{
+    MPI_Aint lb, extent;
+    PMPI_Type_get_extent(type, &lb, &extent);
+    return extent;
+}
+
+static int _flatten(MPI_Datatype type, MPI_Aint disp, blocks_builder_t *b);
+
+// _flatten_repeat flattens count * blocklen elements of a datatype, blocklen elements
+// being contiguous and the blocks of elements being separated by stride bytes
+static inline int _flatten_repeat(MPI_Datatype type, MPI_Aint disp, int count, int blocklen, MPI_Aint stride, blocks_builder_t *b)
+{
+    MPI_Aint extent = _get_extent(type);
+    int i, j;
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < blocklen; j++)
+        {
+            int rc = _flatten(type, disp + i * stride + j * extent, b);
+            if (rc)
+                return rc;
+        }
+    }
+    return 0;
+}
+
+// _flatten_subarray flattens a subarray datatype: ints are ndims, sizes, subsizes, starts and order
+static inline int _flatten_subarray(MPI_Datatype type, MPI_Aint disp, int *ints, blocks_builder_t *b)
+{
+    int ndims = ints[0];
+    int *sizes = &(ints[1]);
+    int *subsizes = &(ints[1 + ndims]);
+    int *starts = &(ints[1 + 2 * ndims]);
+    int order = ints[1 + 3 * ndims];
+    MPI_Aint extent = _get_extent(type);
+    MPI_Aint *strides = malloc(ndims * sizeof(MPI_Aint));
+    int *idx = calloc(ndims, sizeof(int));
+    int rc = 0;
+    int d;
+    assert(strides);
+    assert(idx);
+
+    // Dimensions are walked from the slowest to the fastest varying one
+    MPI_Aint stride = extent;
+    for (d = ndims - 1; d >= 0; d--)
+    {
+        int dim = order == MPI_ORDER_C ? d : ndims - 1 - d;
+        strides[dim] = stride;
+        stride *= sizes[dim];
+    }
+
+    for (d = 0; d < ndims; d++)
+    {
+        if (subsizes[d] == 0)
+            goto exit_fn;
+    }
+
+    while (true)
+    {
+        MPI_Aint offset = disp;
+        for (d = 0; d < ndims; d++)
+            offset += (starts[d] + idx[d]) * strides[d];
+        rc = _flatten(type, offset, b);
+        if (rc)
+            goto exit_fn;
+
+        // Next element, the fastest varying dimension first
+        for (d = ndims - 1; d >= 0; d--)
+        {
+            int dim = order == MPI_ORDER_C ? d : ndims - 1 - d;
+            idx[dim]++;
+            if (idx[dim] < subsizes[dim])
+                break;
+            idx[dim] = 0;
+        }
+        if (d < 0)
+            break;
+    }
+
+exit_fn:
+    free(strides);
+    free(idx);
+    return rc;
+}
+
+static int _flatten_derived(MPI_Datatype type, MPI_Aint disp, int combiner, int num_ints, int num_addrs, int num_types, blocks_builder_t *b)
+{
+    int *ints = malloc((num_ints + 1) * sizeof(int));
+    MPI_Aint *addrs = malloc((num_addrs + 1) * sizeof(MPI_Aint));
+    MPI_Datatype *types = malloc((num_types + 1) * sizeof(MPI_Datatype));
+    int rc = 0;
+    int i;
+    assert(ints);
+    assert(addrs);
+    assert(types);
+
+    PMPI_Type_get_contents(type, num_ints, num_addrs, num_types, ints, addrs, types);
+
+    switch (combiner)
+    {
+    case MPI_COMBINER_DUP:
+    case MPI_COMBINER_RESIZED:
+        // Resizing only changes the extent of the datatype, not its data
+        rc = _flatten(types[0], disp, b);
+        break;
+    case MPI_COMBINER_CONTIGUOUS:
+        rc = _flatten_repeat(types[0], disp, 1, ints[0], 0, b);
+        break;
+    case MPI_COMBINER_VECTOR:
+        rc = _flatten_repeat(types[0], disp, ints[0], ints[1], ints[2] * _get_extent(types[0]), b);
+        break;
+    case MPI_COMBINER_HVECTOR:
+        rc = _flatten_repeat(types[0], disp, ints[0], ints[1], addrs[0], b);
+        break;
+    case MPI_COMBINER_INDEXED:
+        for (i = 0; i < ints[0] && rc == 0; i++)
+            rc = _flatten_repeat(types[0], disp + ints[1 + ints[0] + i] * _get_extent(types[0]), 1, ints[1 + i], 0, b);
+        break;
+    case MPI_COMBINER_HINDEXED:
+        for (i = 0; i < ints[0] && rc == 0; i++)
+            rc = _flatten_repeat(types[0], disp + addrs[i], 1, ints[1 + i], 0, b);
+        break;
+    case MPI_COMBINER_INDEXED_BLOCK:
+        for (i = 0; i < ints[0] && rc == 0; i++)
+            rc = _flatten_repeat(types[0], disp + ints[2 + i] * _get_extent(types[0]), 1, ints[1], 0, b);
+        break;
+    case MPI_COMBINER_HINDEXED_BLOCK:
+        for (i = 0; i < ints[0] && rc == 0; i++)
+            rc = _flatten_repeat(types[0], disp + addrs[i], 1, ints[1], 0, b);
+        break;
+    case MPI_COMBINER_STRUCT:
+        for (i = 0; i < ints[0] && rc == 0; i++)
+            rc = _flatten_repeat(types[i], disp + addrs[i], 1, ints[1 + i], 0, b);
+        break;
+    case MPI_COMBINER_SUBARRAY:
+        rc = _flatten_subarray(types[0], disp, ints, b);
+        break;
+    default:
+        // Distributed arrays and Fortran 90 parameterized types are not flattened
+        rc = 1;
+    }
+
+    // Datatypes returned by MPI_Type_get_contents must be freed unless they are predefined
+    for (i = 0; i < num_types; i++)
+    {
+        int t_ints, t_addrs, t_types, t_combiner;
+        PMPI_Type_get_envelope(types[i], &t_ints, &t_addrs, &t_types, &t_combiner);
+        if (t_combiner != MPI_COMBINER_NAMED)
+            PMPI_Type_free(&(types[i]));
+    }
+    free(ints);
+    free(addrs);
+    free(types);
+    return rc;
+}
+
+#define PAIR_BLOCKS(b, disp, value_type)                                                 \
+    do                                                                                   \
+    {                                                                                    \
+        struct                                                                           \
+        {                                                                                \
+            value_type value;                                                            \
+            int index;                                                                   \
+        } __pair;                                                                        \
+        _add_block(b, disp, sizeof(__pair.value));                                       \
+        _add_block(b, disp + ((char *)&(__pair.index) - (char *)&(__pair)), sizeof(int)); \
+    } while (0)
+
+// _flatten_predefined adds the blocks of a predefined datatype. All the predefined
+// datatypes are contiguous but the pair types used by MPI_MINLOC and MPI_MAXLOC,
+// which may have padding between their two values.
+static inline void _flatten_predefined(MPI_Datatype type, MPI_Aint disp, blocks_builder_t *b)
+{
+    if (type == MPI_SHORT_INT)
+    {
+        PAIR_BLOCKS(b, disp, short);
+        return;
+    }
+    if (type == MPI_LONG_INT)
+    {
+        PAIR_BLOCKS(b, disp, long);
+        return;
+    }
+    if (type == MPI_FLOAT_INT)
+    {
+        PAIR_BLOCKS(b, disp, float);
+        return;
+    }
+    if (type == MPI_DOUBLE_INT)
+    {
+        PAIR_BLOCKS(b, disp, double);
+        return;
+    }
+    if (type == MPI_LONG_DOUBLE_INT)
+    {
+        PAIR_BLOCKS(b, disp, long double);
+        return;
+    }
+
+    int size;
+    PMPI_Type_size(type, &size);
+    _add_block(b, disp, size);
+}
+
+static int _flatten(MPI_Datatype type, MPI_Aint disp, blocks_builder_t *b)
+{
+    int num_ints, num_addrs, num_types, combiner;
+    PMPI_Type_get_envelope(type, &num_ints, &num_addrs, &num_types, &combiner);
+    if (combiner == MPI_COMBINER_NAMED)
+    {
+        _flatten_predefined(type, disp, b);
+        return 0;
+    }
+    return _flatten_derived(type, disp, combiner, num_ints, num_addrs, num_types, b);
+}
+
+static int _layout_delete_fn(MPI_Datatype type, int keyval, void *attr_val, void *extra_state)
+{
+    datatype_layout_t *layout = (datatype_layout_t *)attr_val;
+    if (layout != NULL)
+    {
+        free(layout->blocks);
+        free(layout);
+    }
+    return MPI_SUCCESS;
+}
+
+static int _build_layout(MPI_Datatype type, datatype_layout_t *layout)
+{
+    blocks_builder_t b = {NULL, 0, 0};
+    MPI_Aint lb;
+    int size;
+
+    PMPI_Type_size(type, &size);
+    PMPI_Type_get_extent(type, &lb, &(layout->extent));
+    layout->size = size;
+    int rc = _flatten(type, 0, &b);
+    if (rc)
+    {
+        free(b.blocks);
+        return rc;
+    }
+    layout->blocks = b.blocks;
+    layout->num_blocks = b.num_blocks;
+    layout->is_contiguous = (b.num_blocks == 1 && b.blocks[0].offset == 0 && (MPI_Aint)b.blocks[0].len == layout->extent) || size == 0;
+    return 0;
+}
+
+// datatype_get_layout returns the layout of a datatype, flattening it the first time the
+// datatype is used. Returns a non-zero value if the datatype cannot be flattened; the failure
+// of a derived datatype is cached as a NULL layout so it is not flattened again. Predefined
+// datatypes are always flattened.
+int datatype_get_layout(MPI_Datatype type, datatype_layout_t **layout)
+{
+    int num_ints, num_addrs, num_types, combiner;
+    int rc;
+
+    PMPI_Type_get_envelope(type, &num_ints, &num_addrs, &num_types, &combiner);
+    if (combiner == MPI_COMBINER_NAMED)
+    {
+        predefined_layout_t *ptr = predefined_layouts;
+        while (ptr != NULL)
+        {
+            if (ptr->type == type)
+            {
+                *layout = &(ptr->layout);
+                return 0;
+            }
+            ptr = ptr->next;
+        }
+
+        predefined_layout_t *new_layout = malloc(sizeof(predefined_layout_t));
+        assert(new_layout);
+        new_layout->type = type;
+        rc = _build_layout(type, &(new_layout->layout));
+        if (rc)
+        {
+            free(new_layout);
+            return rc;
+        }
+        new_layout->next = predefined_layouts;
+        predefined_layouts = new_layout;
+        *layout = &(new_layout->layout);
+        return 0;
+    }
+
+    if (layout_keyval == MPI_KEYVAL_INVALID)
+    {
+        rc = PMPI_Type_create_keyval(MPI_TYPE_NULL_COPY_FN, _layout_delete_fn, &layout_keyval, NULL);
+        if (rc != MPI_SUCCESS)
+        {
+            fprintf(stderr, "PMPI_Type_create_keyval() failed: %d\n", rc);
+            return 1;
+        }
+    }
+
+    int found = 0;
+    datatype_layout_t *cached = NULL;
+    PMPI_Type_get_attr(type, layout_keyval, &cached, &found);
+    if (found)
+    {
+        *layout = cached;
+        return cached == NULL ? 1 : 0;
+    }
+
+    datatype_layout_t *new_layout = malloc(sizeof(datatype_layout_t));
+    assert(new_layout);
+    rc = _build_layout(type, new_layout);
+    if (rc)
+    {
+        free(new_layout);
+        PMPI_Type_set_attr(type, layout_keyval, NULL);
+        *layout = NULL;
+        return rc;
+    }
+    PMPI_Type_set_attr(type, layout_keyval, new_layout);
+    *layout = new_layout;
+    return 0;
+}
+
+int datatype_fini()
+{
+    while (predefined_layouts != NULL)
+    {
+        predefined_layout_t *next = predefined_layouts->next;
+        free(predefined_layouts->layout.blocks);
+        free(predefined_layouts);
+        predefined_layouts = next;
+    }
+
+    // Layouts cached on derived datatypes are released when the datatypes are freed
+    if (layout_keyval != MPI_KEYVAL_INVALID)
+    {
+        PMPI_Type_free_keyval(&layout_keyval);
+        layout_keyval = MPI_KEYVAL_INVALID;
+    }
+    return 0;
+}
@@ -6,6 +6,9 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+
+#include "mpi.h"
 
 #include "collective_profiler_config.h"
 #include "common_utils.h"
@@ -58,6 +61,22 @@ typedef struct datatype_info
     MPI_Datatype type;
 } datatype_info_t;
 
+// datatype_layout is the flattened representation of a datatype: the list of contiguous
+// blocks of memory of a single element, in the order of the type map. Layouts are computed
+// once per datatype and cached on the datatype as an attribute, so the data of any datatype
+// can be accessed without packing it.
+typedef struct datatype_layout
+{
+    bool is_contiguous; // The data of any number of elements is a single block at the begining of the buffer
+    size_t size;        // Amount of data of a single element
+    MPI_Aint extent;    // Extent of a single element
+    size_t num_blocks;
+    data_block_t *blocks;
+} datatype_layout_t;
+
+int datatype_get_layout(MPI_Datatype type, datatype_layout_t **layout);
+int datatype_fini();
+
 extern char *get_output_dir();
 
 static inline char *
@@ -207,7 +226,7 @@ get_predefined_type(datatype_info_t *info)
     }
     if (info->type == MPI_UNSIGNED)
     {
-        info->id = MPI_UNSIGNED_SHORT_ID;
+        info->id = MPI_UNSIGNED_ID;
         return;
     }
     if (info->type == MPI_LONG)
@@ -377,6 +396,14 @@ save_datatype_info(char *collective_name, MPI_Comm comm, int comm_rank, int worl
     fprintf(file, "Datatype is contiguous: %d\n", dt_info->is_contiguous);
     fprintf(file, "Datatype is pre-defined: %d\n", dt_info->is_predefined);
 
+    datatype_layout_t *layout = NULL;
+    rc = datatype_get_layout(dt_info->type, &layout);
+    if (rc == 0)
+    {
+        fprintf(file, "Extent: %" PRId64 "\n", (int64_t)layout->extent);
+        fprintf(file, "Number of contiguous blocks: %zu\n", layout->num_blocks);
+    }
+
     fclose(file);
     free(filename);
     filename = NULL;
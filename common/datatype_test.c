@@ -0,0 +1,152 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpi.h"
+
+#include "datatype.h"
+
+#define BUFFER_SIZE (4096)
+#define NUM_ELEMENTS (3)
+
+// check_layout compares the data gathered through the layout of a datatype with the data packed by MPI
+static int check_layout(char *name, MPI_Datatype type, bool expect_contiguous)
+{
+    unsigned char buf[BUFFER_SIZE];
+    unsigned char packed[BUFFER_SIZE];
+    unsigned char flattened[BUFFER_SIZE];
+    datatype_layout_t *layout = NULL;
+    datatype_layout_t *cached = NULL;
+    int position = 0;
+    size_t len = 0;
+    size_t i, j;
+
+    for (i = 0; i < BUFFER_SIZE; i++)
+        buf[i] = (unsigned char)(i * 7 + 3);
+
+    if (datatype_get_layout(type, &layout) || layout == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] unable to get the layout of %s\n", name);
+        return 1;
+    }
+    if (datatype_get_layout(type, &cached) || cached != layout)
+    {
+        fprintf(stderr, "*** [ERROR] the layout of %s is not cached\n", name);
+        return 1;
+    }
+    if (layout->is_contiguous != expect_contiguous)
+    {
+        fprintf(stderr, "*** [ERROR] %s is %scontiguous\n", name, layout->is_contiguous ? "" : "not ");
+        return 1;
+    }
+
+    MPI_Pack(buf, NUM_ELEMENTS, type, packed, BUFFER_SIZE, &position, MPI_COMM_WORLD);
+    for (i = 0; i < NUM_ELEMENTS; i++)
+    {
+        for (j = 0; j < layout->num_blocks; j++)
+        {
+            memcpy(&(flattened[len]), &(buf[i * layout->extent + layout->blocks[j].offset]), layout->blocks[j].len);
+            len += layout->blocks[j].len;
+        }
+    }
+
+    if (len != (size_t)position || len != NUM_ELEMENTS * layout->size || memcmp(packed, flattened, len) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] data of %s accessed through its layout differs from the packed data\n", name);
+        return 1;
+    }
+    fprintf(stdout, "*** layout of %s (%zu blocks) successful\n", name, layout->num_blocks);
+    return 0;
+}
+
+static int layouts_test(void)
+{
+    MPI_Datatype contiguous, vector, indexed, structure, resized, subarray_c, subarray_f;
+    int rc = 0;
+
+    MPI_Type_contiguous(4, MPI_INT, &contiguous);
+    MPI_Type_commit(&contiguous);
+    MPI_Type_vector(3, 2, 4, MPI_DOUBLE, &vector);
+    MPI_Type_commit(&vector);
+
+    int blocklens[3] = {2, 1, 3};
+    int displs[3] = {0, 5, 9};
+    MPI_Type_indexed(3, blocklens, displs, MPI_SHORT, &indexed);
+    MPI_Type_commit(&indexed);
+
+    int struct_blocklens[3] = {1, 2, 1};
+    MPI_Aint struct_displs[3] = {0, 8, 24};
+    MPI_Datatype struct_types[3] = {MPI_CHAR, MPI_INT, MPI_DOUBLE};
+    MPI_Type_create_struct(3, struct_blocklens, struct_displs, struct_types, &structure);
+    MPI_Type_commit(&structure);
+
+    MPI_Type_create_resized(vector, 0, 128, &resized);
+    MPI_Type_commit(&resized);
+
+    int sizes[3] = {4, 5, 6};
+    int subsizes[3] = {2, 3, 2};
+    int starts[3] = {1, 1, 3};
+    MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &subarray_c);
+    MPI_Type_commit(&subarray_c);
+    MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_FORTRAN, MPI_FLOAT, &subarray_f);
+    MPI_Type_commit(&subarray_f);
+
+    rc |= check_layout("MPI_DOUBLE", MPI_DOUBLE, true);
+    rc |= check_layout("MPI_SHORT_INT", MPI_SHORT_INT, false);
+    rc |= check_layout("contiguous", contiguous, true);
+    rc |= check_layout("vector", vector, false);
+    rc |= check_layout("indexed", indexed, false);
+    rc |= check_layout("struct", structure, false);
+    rc |= check_layout("resized vector", resized, false);
+    rc |= check_layout("C subarray", subarray_c, false);
+    rc |= check_layout("Fortran subarray", subarray_f, false);
+
+    // Distributed arrays are not flattened, the failure is cached
+    MPI_Datatype darray;
+    int gsizes[1] = {8};
+    int distribs[1] = {MPI_DISTRIBUTE_BLOCK};
+    int dargs[1] = {MPI_DISTRIBUTE_DFLT_DARG};
+    int psizes[1] = {1};
+    datatype_layout_t *layout = NULL;
+    MPI_Type_create_darray(1, 0, 1, gsizes, distribs, dargs, psizes, MPI_ORDER_C, MPI_INT, &darray);
+    MPI_Type_commit(&darray);
+    if (datatype_get_layout(darray, &layout) == 0 || datatype_get_layout(darray, &layout) == 0 || layout != NULL)
+    {
+        fprintf(stderr, "*** [ERROR] distributed array flattened\n");
+        rc = 1;
+    }
+    MPI_Type_free(&darray);
+
+    // Layouts are released with the datatypes
+    MPI_Type_free(&contiguous);
+    MPI_Type_free(&vector);
+    MPI_Type_free(&indexed);
+    MPI_Type_free(&structure);
+    MPI_Type_free(&resized);
+    MPI_Type_free(&subarray_c);
+    MPI_Type_free(&subarray_f);
+    datatype_fini();
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+
+    if (layouts_test())
+    {
+        fprintf(stderr, "[ERROR] datatype test failed\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    MPI_Finalize();
+    fprintf(stdout, "datatype test succeeded\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,403 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif // __x86_64__
+
+#if HAVE_XXHASH
+#include <xxhash.h>
+#endif // HAVE_XXHASH
+
+#include "digest.h"
+
+static bool engine_initialized = false;
+static digest_engine_t engine = DIGEST_SHA256;
+
+/* CRC32C (Castagnoli) */
+
+#define CRC32C_POLY (0x82F63B78)
+
+static uint32_t crc32c_table[256];
+static bool crc32c_table_initialized = false;
+
+static inline void _crc32c_init_table()
+{
+    uint32_t i, j;
+    for (i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        crc32c_table[i] = crc;
+    }
+    crc32c_table_initialized = true;
+}
+
+// The CRC32C implementations update a CRC so it can be computed over multiple blocks;
+// the initial value is 0xFFFFFFFF and the final CRC is inverted.
+static uint32_t _crc32c_sw(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; i++)
+        crc = crc32c_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t _crc32c_sse42(uint32_t crc32, const unsigned char *buf, size_t len)
+{
+    uint64_t crc = crc32;
+    while (len >= sizeof(uint64_t))
+    {
+        uint64_t v;
+        memcpy(&v, buf, sizeof(v));
+        crc = _mm_crc32_u64(crc, v);
+        buf += sizeof(v);
+        len -= sizeof(v);
+    }
+    crc32 = (uint32_t)crc;
+    while (len > 0)
+    {
+        crc32 = _mm_crc32_u8(crc32, *buf);
+        buf++;
+        len--;
+    }
+    return crc32;
+}
+#endif // __x86_64__
+
+static uint32_t (*crc32c_impl)(uint32_t, const unsigned char *, size_t) = NULL;
+
+static inline void _crc32c_init()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        crc32c_impl = _crc32c_sse42;
+        return;
+    }
+#endif // __x86_64__
+    if (!crc32c_table_initialized)
+        _crc32c_init_table();
+    crc32c_impl = _crc32c_sw;
+}
+
+/* Engine selection */
+
+digest_engine_t digest_get_engine()
+{
+    if (engine_initialized)
+        return engine;
+
+    digest_engine_t e = DIGEST_SHA256;
+    char *engine_envvar = getenv(COLLECTIVE_PROFILER_DIGEST_ENVVAR);
+    if (engine_envvar != NULL)
+    {
+        if (strcmp(engine_envvar, "crc32c") == 0)
+            e = DIGEST_CRC32C;
+        else if (strcmp(engine_envvar, "xxh3") == 0)
+            e = DIGEST_XXH3;
+        else if (strcmp(engine_envvar, "sha256") != 0)
+            fprintf(stderr, "unknown digest engine %s, using sha256\n", engine_envvar);
+    }
+    if (digest_set_engine(e))
+    {
+        fprintf(stderr, "digest engine %s not available, using sha256\n", digest_engine_name(e));
+        digest_set_engine(DIGEST_SHA256);
+    }
+    return engine;
+}
+
+int digest_set_engine(digest_engine_t e)
+{
+#if !HAVE_XXHASH
+    if (e == DIGEST_XXH3)
+        return 1;
+#endif // !HAVE_XXHASH
+    if (e == DIGEST_CRC32C && crc32c_impl == NULL)
+        _crc32c_init();
+    engine = e;
+    engine_initialized = true;
+    return 0;
+}
+
+size_t digest_size(digest_engine_t e)
+{
+    switch (e)
+    {
+    case DIGEST_CRC32C:
+        return sizeof(uint32_t);
+    case DIGEST_XXH3:
+        return 16;
+    default:
+        return SHA256_DIGEST_LENGTH;
+    }
+}
+
+char *digest_engine_name(digest_engine_t e)
+{
+    switch (e)
+    {
+    case DIGEST_CRC32C:
+        return "crc32c";
+    case DIGEST_XXH3:
+        return "xxh3";
+    default:
+        return "sha256";
+    }
+}
+
+void digest_compute(digest_engine_t e, const void *buf, size_t len, unsigned char *digest)
+{
+    switch (e)
+    {
+    case DIGEST_CRC32C:
+    {
+        assert(crc32c_impl);
+        uint32_t crc = ~crc32c_impl(0xFFFFFFFF, buf, len);
+        memcpy(digest, &crc, sizeof(crc));
+        break;
+    }
+#if HAVE_XXHASH
+    case DIGEST_XXH3:
+    {
+        XXH128_hash_t h = XXH3_128bits(buf, len);
+        XXH128_canonical_t c;
+        XXH128_canonicalFromHash(&c, h);
+        memcpy(digest, c.digest, 16);
+        break;
+    }
+#endif // HAVE_XXHASH
+    default:
+        SHA256(buf, len, digest);
+    }
+}
+
+// digest_compute_blocks computes the digest of count elements of non-contiguous data,
+// each element being made of a series of blocks, without copying the data.
+void digest_compute_blocks(digest_engine_t e, const void *buf, const data_block_t *blocks, size_t num_blocks, size_t count, ptrdiff_t extent, unsigned char *digest)
+{
+    size_t i, j;
+    switch (e)
+    {
+    case DIGEST_CRC32C:
+    {
+        assert(crc32c_impl);
+        uint32_t crc = 0xFFFFFFFF;
+        for (i = 0; i < count; i++)
+        {
+            const unsigned char *elt = (const unsigned char *)buf + i * extent;
+            for (j = 0; j < num_blocks; j++)
+                crc = crc32c_impl(crc, elt + blocks[j].offset, blocks[j].len);
+        }
+        crc = ~crc;
+        memcpy(digest, &crc, sizeof(crc));
+        break;
+    }
+#if HAVE_XXHASH
+    case DIGEST_XXH3:
+    {
+        XXH3_state_t *state = XXH3_createState();
+        assert(state);
+        XXH3_128bits_reset(state);
+        for (i = 0; i < count; i++)
+        {
+            const unsigned char *elt = (const unsigned char *)buf + i * extent;
+            for (j = 0; j < num_blocks; j++)
+                XXH3_128bits_update(state, elt + blocks[j].offset, blocks[j].len);
+        }
+        XXH128_canonical_t c;
+        XXH128_canonicalFromHash(&c, XXH3_128bits_digest(state));
+        memcpy(digest, c.digest, 16);
+        XXH3_freeState(state);
+        break;
+    }
+#endif // HAVE_XXHASH
+    default:
+    {
+        EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+        assert(ctx);
+        EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+        for (i = 0; i < count; i++)
+        {
+            const unsigned char *elt = (const unsigned char *)buf + i * extent;
+            for (j = 0; j < num_blocks; j++)
+                EVP_DigestUpdate(ctx, elt + blocks[j].offset, blocks[j].len);
+        }
+        EVP_DigestFinal_ex(ctx, digest, NULL);
+        EVP_MD_CTX_free(ctx);
+    }
+    }
+}
+
+static inline void _compute_task(digest_engine_t e, digest_task_t *task)
+{
+    if (task->blocks == NULL)
+        digest_compute(e, task->buf, task->len, task->digest);
+    else
+        digest_compute_blocks(e, task->buf, task->blocks, task->num_blocks, task->count, task->extent, task->digest);
+}
+
+/* Thread pool */
+
+typedef struct digest_pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    pthread_t *threads;
+    int num_threads;
+    int active;
+    uint64_t generation;
+    bool shutdown;
+    digest_engine_t engine;
+    digest_task_t *tasks;
+    size_t num_tasks;
+    size_t next_task;
+} digest_pool_t;
+
+static digest_pool_t pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, -1, 0, 0, false, DIGEST_SHA256, NULL, 0, 0};
+
+static inline void _process_tasks()
+{
+    size_t i;
+    while ((i = __atomic_fetch_add(&pool.next_task, 1, __ATOMIC_RELAXED)) < pool.num_tasks)
+    {
+        _compute_task(pool.engine, &(pool.tasks[i]));
+    }
+}
+
+static void *_pool_worker(void *arg)
+{
+    // Generation of the pool when the thread was created, i.e., before any work was submitted to it
+    uint64_t seen = (uint64_t)(uintptr_t)arg;
+
+    pthread_mutex_lock(&pool.lock);
+    while (true)
+    {
+        while (!pool.shutdown && pool.generation == seen)
+            pthread_cond_wait(&pool.work_cond, &pool.lock);
+        if (pool.shutdown)
+            break;
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+
+        _process_tasks();
+
+        pthread_mutex_lock(&pool.lock);
+        pool.active--;
+        if (pool.active == 0)
+            pthread_cond_signal(&pool.done_cond);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+static inline int _pool_init()
+{
+    int i;
+
+    // The calling thread also computes digests so we only create num_threads - 1 threads
+    pool.num_threads = DIGEST_DEFAULT_NUM_THREADS - 1;
+    char *num_threads_envvar = getenv(COLLECTIVE_PROFILER_DIGEST_THREADS_ENVVAR);
+    if (num_threads_envvar != NULL)
+        pool.num_threads = atoi(num_threads_envvar) - 1;
+    if (pool.num_threads <= 0)
+    {
+        pool.num_threads = 0;
+        return 0;
+    }
+
+    pool.threads = malloc(pool.num_threads * sizeof(pthread_t));
+    assert(pool.threads);
+    for (i = 0; i < pool.num_threads; i++)
+    {
+        int rc = pthread_create(&(pool.threads[i]), NULL, _pool_worker, (void *)(uintptr_t)pool.generation);
+        if (rc)
+        {
+            fprintf(stderr, "pthread_create() failed: %d\n", rc);
+            pool.num_threads = i;
+            return rc;
+        }
+    }
+    return 0;
+}
+
+// digest_compute_tasks computes the digests of a set of blocks. When there is enough data,
+// the blocks are distributed to the threads of the pool, created on first use.
+int digest_compute_tasks(digest_engine_t e, digest_task_t *tasks, size_t num_tasks)
+{
+    size_t i;
+    size_t total_size = 0;
+
+    for (i = 0; i < num_tasks; i++)
+        total_size += tasks[i].len;
+
+    if (pool.num_threads == -1 && total_size >= DIGEST_PARALLEL_THRESHOLD)
+    {
+        int rc = _pool_init();
+        if (rc)
+            fprintf(stderr, "_pool_init() failed: %d\n", rc);
+    }
+
+    if (num_tasks < 2 || total_size < DIGEST_PARALLEL_THRESHOLD || pool.num_threads <= 0)
+    {
+        for (i = 0; i < num_tasks; i++)
+            _compute_task(e, &(tasks[i]));
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.engine = e;
+    pool.tasks = tasks;
+    pool.num_tasks = num_tasks;
+    pool.next_task = 0;
+    pool.active = pool.num_threads;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work_cond);
+    pthread_mutex_unlock(&pool.lock);
+
+    _process_tasks();
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.active > 0)
+        pthread_cond_wait(&pool.done_cond, &pool.lock);
+    pool.tasks = NULL;
+    pool.num_tasks = 0;
+    pthread_mutex_unlock(&pool.lock);
+    return 0;
+}
+
+int digest_fini()
+{
+    int i;
+
+    if (pool.num_threads > 0)
+    {
+        pthread_mutex_lock(&pool.lock);
+        pool.shutdown = true;
+        pthread_cond_broadcast(&pool.work_cond);
+        pthread_mutex_unlock(&pool.lock);
+        for (i = 0; i < pool.num_threads; i++)
+            pthread_join(pool.threads[i], NULL);
+        free(pool.threads);
+        pool.threads = NULL;
+    }
+    pool.num_threads = -1;
+    pool.shutdown = false;
+    return 0;
+}
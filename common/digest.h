@@ -0,0 +1,56 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef MPI_COLLECTIVE_PROFILER_DIGEST_H
+#define MPI_COLLECTIVE_PROFILER_DIGEST_H
+
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "common_types.h"
+
+// Name of the environment variable to select the digest engine: "sha256" (default), "crc32c" or "xxh3"
+#define COLLECTIVE_PROFILER_DIGEST_ENVVAR "COLLECTIVE_PROFILER_DIGEST"
+// Name of the environment variable to specify the number of threads used to compute digests
+#define COLLECTIVE_PROFILER_DIGEST_THREADS_ENVVAR "COLLECTIVE_PROFILER_DIGEST_THREADS"
+
+#define DIGEST_MAX_SIZE (32)
+#define DIGEST_DEFAULT_NUM_THREADS (4)
+// Below this amount of data, digests are computed by the calling thread only
+#define DIGEST_PARALLEL_THRESHOLD (1024 * 1024)
+
+typedef enum digest_engine
+{
+    DIGEST_SHA256 = 0, // Strict, cryptographic digest (32 bytes)
+    DIGEST_CRC32C = 1, // SSE4.2 accelerated when available (4 bytes)
+    DIGEST_XXH3 = 2,   // XXH3-128, only available when built with xxHash (16 bytes)
+} digest_engine_t;
+
+// digest_task is the description of the digest of a single block of data. Non-contiguous
+// data is described by the blocks of a single element (e.g., a flattened MPI datatype),
+// the number of elements and their extent; the digest is then the digest of the
+// concatenation of the blocks, i.e., the digest of the packed data.
+typedef struct digest_task
+{
+    const void *buf;
+    size_t len; // Amount of data, including when non-contiguous
+    unsigned char *digest;
+    const data_block_t *blocks; // NULL when the data is contiguous
+    size_t num_blocks;
+    size_t count;
+    ptrdiff_t extent;
+} digest_task_t;
+
+digest_engine_t digest_get_engine();
+int digest_set_engine(digest_engine_t engine);
+size_t digest_size(digest_engine_t engine);
+char *digest_engine_name(digest_engine_t engine);
+void digest_compute(digest_engine_t engine, const void *buf, size_t len, unsigned char *digest);
+void digest_compute_blocks(digest_engine_t engine, const void *buf, const data_block_t *blocks, size_t num_blocks, size_t count, ptrdiff_t extent, unsigned char *digest);
+int digest_compute_tasks(digest_engine_t engine, digest_task_t *tasks, size_t num_tasks);
+int digest_fini();
+
+#endif // MPI_COLLECTIVE_PROFILER_DIGEST_H
@@ -0,0 +1,144 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "digest.h"
+
+#define NUM_BLOCKS (8)
+#define BLOCK_SIZE (512 * 1024)
+
+static int check_digest(digest_engine_t engine, const char *input, const unsigned char *expected)
+{
+    unsigned char digest[DIGEST_MAX_SIZE];
+    digest_compute(engine, input, strlen(input), digest);
+    if (memcmp(digest, expected, digest_size(engine)) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] wrong %s digest for \"%s\"\n", digest_engine_name(engine), input);
+        return 1;
+    }
+    fprintf(stdout, "*** %s digest of \"%s\" successful\n", digest_engine_name(engine), input);
+    return 0;
+}
+
+static int known_values_test(void)
+{
+    // SHA-256("abc")
+    unsigned char sha256_abc[] = {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+                                  0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+    // CRC32C("123456789") = 0xe3069283, stored in the native byte order
+    uint32_t crc32c_check = 0xe3069283;
+
+    if (digest_set_engine(DIGEST_SHA256) || check_digest(DIGEST_SHA256, "abc", sha256_abc))
+        return 1;
+    if (digest_set_engine(DIGEST_CRC32C) || check_digest(DIGEST_CRC32C, "123456789", (unsigned char *)&crc32c_check))
+        return 1;
+    // Data that is not a multiple of 8 bytes goes through the byte-per-byte path
+    uint32_t crc32c_empty = 0;
+    if (check_digest(DIGEST_CRC32C, "", (unsigned char *)&crc32c_empty))
+        return 1;
+    return 0;
+}
+
+static int parallel_test(digest_engine_t engine)
+{
+    int i;
+    unsigned char *data = malloc(NUM_BLOCKS * BLOCK_SIZE);
+    unsigned char digests[NUM_BLOCKS][DIGEST_MAX_SIZE];
+    unsigned char expected[DIGEST_MAX_SIZE];
+    digest_task_t tasks[NUM_BLOCKS];
+
+    if (data == NULL)
+        return 1;
+    for (i = 0; i < NUM_BLOCKS * BLOCK_SIZE; i++)
+        data[i] = (unsigned char)(i * 7 + i / BLOCK_SIZE);
+
+    for (i = 0; i < NUM_BLOCKS; i++)
+    {
+        tasks[i].buf = &(data[i * BLOCK_SIZE]);
+        tasks[i].len = BLOCK_SIZE;
+        tasks[i].digest = digests[i];
+        tasks[i].blocks = NULL;
+    }
+
+    // Large enough to be computed by the thread pool
+    if (digest_compute_tasks(engine, tasks, NUM_BLOCKS))
+    {
+        fprintf(stderr, "*** [ERROR] digest_compute_tasks() failed\n");
+        free(data);
+        return 1;
+    }
+
+    for (i = 0; i < NUM_BLOCKS; i++)
+    {
+        digest_compute(engine, &(data[i * BLOCK_SIZE]), BLOCK_SIZE, expected);
+        if (memcmp(expected, digests[i], digest_size(engine)) != 0)
+        {
+            fprintf(stderr, "*** [ERROR] %s digest of block %d differs when computed in parallel\n", digest_engine_name(engine), i);
+            free(data);
+            return 1;
+        }
+    }
+    fprintf(stdout, "*** parallel %s digests successful\n", digest_engine_name(engine));
+    free(data);
+    return 0;
+}
+
+// Digests of non-contiguous data must be the digests of the same data packed
+static int blocks_test(digest_engine_t engine)
+{
+    // Elements of 32 bytes with two blocks: 8 bytes at offset 4 and 12 bytes at offset 16
+    data_block_t blocks[2] = {{4, 8}, {16, 12}};
+    unsigned char data[NUM_BLOCKS * 32];
+    unsigned char packed[NUM_BLOCKS * 20];
+    unsigned char digest[DIGEST_MAX_SIZE];
+    unsigned char expected[DIGEST_MAX_SIZE];
+    int i;
+
+    for (i = 0; i < NUM_BLOCKS * 32; i++)
+        data[i] = (unsigned char)(i * 13);
+    for (i = 0; i < NUM_BLOCKS; i++)
+    {
+        memcpy(&(packed[i * 20]), &(data[i * 32 + 4]), 8);
+        memcpy(&(packed[i * 20 + 8]), &(data[i * 32 + 16]), 12);
+    }
+
+    digest_compute(engine, packed, sizeof(packed), expected);
+    digest_compute_blocks(engine, data, blocks, 2, NUM_BLOCKS, 32, digest);
+    if (memcmp(expected, digest, digest_size(engine)) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] %s digest of non-contiguous data differs from the digest of the packed data\n", digest_engine_name(engine));
+        return 1;
+    }
+    fprintf(stdout, "*** non-contiguous %s digests successful\n", digest_engine_name(engine));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (known_values_test())
+    {
+        fprintf(stderr, "[ERROR] digest test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (blocks_test(DIGEST_SHA256) || blocks_test(DIGEST_CRC32C))
+    {
+        fprintf(stderr, "[ERROR] digest test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (parallel_test(DIGEST_SHA256) || parallel_test(DIGEST_CRC32C))
+    {
+        fprintf(stderr, "[ERROR] digest test failed\n");
+        return EXIT_FAILURE;
+    }
+    digest_fini();
+
+    fprintf(stdout, "digest test succeeded\n");
+    return EXIT_SUCCESS;
+}
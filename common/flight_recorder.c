@@ -0,0 +1,188 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <execinfo.h>
+
+#include "flight_recorder.h"
+#include "common_utils.h"
+
+extern char *get_output_dir();
+
+static flight_recorder_t *recorder = NULL;
+
+// Set by the signal handler, the dump happens at the next call since writing files is not
+// async-signal-safe
+static volatile sig_atomic_t dump_requested = 0;
+
+static void _signal_handler(int signum)
+{
+    dump_requested = 1;
+}
+
+// flight_recorder_init creates the flight recorder when the FLIGHT_RECORDER_CALLS_ENVVAR
+// environment variable requests it
+int flight_recorder_init(char *collective_name, int world_rank, int world_size)
+{
+    char *calls_envvar = getenv(FLIGHT_RECORDER_CALLS_ENVVAR);
+    char *threshold_envvar = getenv(FLIGHT_RECORDER_THRESHOLD_ENVVAR);
+    int i;
+
+    if (calls_envvar == NULL || atoi(calls_envvar) <= 0 || recorder != NULL)
+        return 0;
+
+    flight_recorder_t *r = calloc(1, sizeof(flight_recorder_t));
+    assert(r);
+    r->collective_name = strdup(collective_name);
+    r->world_rank = world_rank;
+    r->max_counts = world_size;
+    r->size = atoi(calls_envvar);
+    if (threshold_envvar != NULL)
+        r->threshold = atof(threshold_envvar);
+    r->entries = (flight_recorder_entry_t *)calloc(r->size, sizeof(flight_recorder_entry_t));
+    assert(r->entries);
+    // The counts of all the calls are allocated at once so recording a call never allocates memory
+    r->counts = (int *)malloc((size_t)r->size * 2 * world_size * sizeof(int));
+    assert(r->counts);
+    for (i = 0; i < r->size; i++)
+    {
+        r->entries[i].send_counts = &(r->counts[(size_t)i * 2 * world_size]);
+        r->entries[i].recv_counts = &(r->counts[(size_t)i * 2 * world_size + world_size]);
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(FLIGHT_RECORDER_SIGNAL, &action, NULL) != 0)
+        fprintf(stderr, "[WARN] unable to install the handler of the flight recorder\n");
+    recorder = r;
+    return 0;
+}
+
+bool flight_recorder_enabled(void)
+{
+    return recorder != NULL;
+}
+
+// flight_recorder_add records a call in the ring, overwriting the oldest call, and dumps the
+// ring if the call triggers a dump
+void flight_recorder_add(uint64_t call, double start, double end, const int *send_counts, const int *recv_counts, int num_counts, void *call_site)
+{
+    if (recorder == NULL)
+        return;
+
+    flight_recorder_entry_t *e = &(recorder->entries[recorder->num_calls % recorder->size]);
+    e->call = call;
+    e->start = start;
+    e->end = end;
+    e->call_site = call_site;
+    e->num_counts = num_counts < recorder->max_counts ? num_counts : recorder->max_counts;
+    if (send_counts != NULL)
+        memcpy(e->send_counts, send_counts, e->num_counts * sizeof(int));
+    else
+        memset(e->send_counts, 0, e->num_counts * sizeof(int));
+    if (recv_counts != NULL)
+        memcpy(e->recv_counts, recv_counts, e->num_counts * sizeof(int));
+    else
+        memset(e->recv_counts, 0, e->num_counts * sizeof(int));
+    recorder->num_calls++;
+
+    if (dump_requested)
+    {
+        dump_requested = 0;
+        flight_recorder_dump("signal");
+    }
+    if (recorder->threshold > 0 && end - start > recorder->threshold && recorder->num_slow_dumps < FLIGHT_RECORDER_MAX_SLOW_DUMPS &&
+        (recorder->num_slow_dumps == 0 || recorder->num_calls - recorder->last_dump_calls >= (uint64_t)recorder->size))
+    {
+        char reason[MAX_STRING_LEN];
+        snprintf(reason, MAX_STRING_LEN, "slow call (%f seconds)", end - start);
+        recorder->num_slow_dumps++;
+        recorder->last_dump_calls = recorder->num_calls;
+        flight_recorder_dump(reason);
+    }
+}
+
+static void _write_counts(FILE *f, char *name, int *counts, int num_counts)
+{
+    int i;
+    fprintf(f, "%s:", name);
+    for (i = 0; i < num_counts; i++)
+        fprintf(f, " %d", counts[i]);
+    fprintf(f, "\n");
+}
+
+// flight_recorder_dump writes the calls of the ring, the oldest call first, in a new file
+int flight_recorder_dump(const char *reason)
+{
+    char *filename = NULL;
+    char *dir;
+    struct timespec now;
+    uint64_t i, first;
+    int rc;
+
+    if (recorder == NULL)
+        return 0;
+
+    dir = get_output_dir();
+    if (dir != NULL)
+        _asprintf(filename, rc, "%s/%s_flight_recorder.rank%d.dump%d.md", dir, recorder->collective_name, recorder->world_rank, recorder->num_dumps);
+    else
+        _asprintf(filename, rc, "%s_flight_recorder.rank%d.dump%d.md", recorder->collective_name, recorder->world_rank, recorder->num_dumps);
+    assert(rc > 0);
+    FILE *f = fopen(filename, "w");
+    free(filename);
+    if (f == NULL)
+        return 1;
+    recorder->num_dumps++;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    first = recorder->num_calls > (uint64_t)recorder->size ? recorder->num_calls - recorder->size : 0;
+    fprintf(f, "# Flight recorder of %s on rank %d\n\n", recorder->collective_name, recorder->world_rank);
+    fprintf(f, "Reason: %s\n", reason);
+    fprintf(f, "Timestamp: %.6f\n", now.tv_sec + now.tv_nsec / 1e9);
+    fprintf(f, "Calls: %" PRIu64 "\n", recorder->num_calls - first);
+    for (i = first; i < recorder->num_calls; i++)
+    {
+        flight_recorder_entry_t *e = &(recorder->entries[i % recorder->size]);
+        fprintf(f, "\n## Call %" PRIu64 "\n\n", e->call);
+        fprintf(f, "Start: %f; duration: %f\n", e->start, e->end - e->start);
+        if (e->call_site != NULL)
+        {
+            char **symbols = backtrace_symbols(&(e->call_site), 1);
+            fprintf(f, "Call site: %s\n", symbols != NULL ? symbols[0] : "unknown");
+            free(symbols);
+        }
+        _write_counts(f, "Send counts", e->send_counts, e->num_counts);
+        _write_counts(f, "Recv counts", e->recv_counts, e->num_counts);
+    }
+    fclose(f);
+    return 0;
+}
+
+int flight_recorder_fini(void)
+{
+    if (recorder == NULL)
+        return 0;
+    signal(FLIGHT_RECORDER_SIGNAL, SIG_DFL);
+    free(recorder->collective_name);
+    free(recorder->entries);
+    free(recorder->counts);
+    free(recorder);
+    recorder = NULL;
+    return 0;
+}
+
+// Entry point of the public API, see collective_profiler.h
+int collective_profiler_flight_recorder_dump(const char *reason)
+{
+    return flight_recorder_dump(reason);
+}
@@ -0,0 +1,59 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_FLIGHT_RECORDER_H
+#define COLLECTIVE_PROFILER_FLIGHT_RECORDER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <signal.h>
+
+#include "collective_profiler_config.h"
+
+// Signal that dumps the flight recorder of a rank, at its next call
+#define FLIGHT_RECORDER_SIGNAL SIGUSR2
+
+typedef struct flight_recorder_entry
+{
+    uint64_t call;
+    double start;
+    double end;
+    void *call_site; // Return address of the call to the collective
+    int num_counts;
+    int *send_counts; // Counts of the rank, num_counts elements
+    int *recv_counts;
+} flight_recorder_entry_t;
+
+/*
+ * The flight recorder keeps the data of the last calls of a rank in a ring of fixed size,
+ * allocated once, and writes it when a trigger fires: a call slower than a threshold,
+ * FLIGHT_RECORDER_SIGNAL, MPI_Abort() or a call to cp_flight_recorder_dump(). After a slow
+ * call, the next slow calls do not trigger a new dump until the ring only has new calls, and
+ * slow calls trigger at most FLIGHT_RECORDER_MAX_SLOW_DUMPS dumps.
+ */
+typedef struct flight_recorder
+{
+    char *collective_name;
+    int world_rank;
+    int max_counts;  // Maximum number of counts per call, i.e., the size of MPI_COMM_WORLD
+    int size;        // Number of entries of the ring
+    uint64_t num_calls; // Number of calls recorded so far, the last call being at (num_calls - 1) % size
+    flight_recorder_entry_t *entries;
+    int *counts; // Counts of all the entries
+    double threshold; // Duration of a call triggering a dump, in seconds; 0 to disable
+    uint64_t last_dump_calls; // Value of num_calls at the last dump triggered by a slow call
+    int num_slow_dumps;
+    int num_dumps;
+} flight_recorder_t;
+
+int flight_recorder_init(char *collective_name, int world_rank, int world_size);
+bool flight_recorder_enabled(void);
+void flight_recorder_add(uint64_t call, double start, double end, const int *send_counts, const int *recv_counts, int num_counts, void *call_site);
+int flight_recorder_dump(const char *reason);
+int flight_recorder_fini(void);
+
+#endif // COLLECTIVE_PROFILER_FLIGHT_RECORDER_H
@@ -0,0 +1,134 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "collective_profiler.h"
+#include "flight_recorder.h"
+
+#define MAX_TEXT_LEN (4096)
+#define NUM_RANKS (4)
+
+static char output_dir[] = "/tmp/flight_recorder_testXXXXXX";
+
+char *get_output_dir()
+{
+    return output_dir;
+}
+
+// _read_dump reads a dump of the rank 1 in text and returns 0 if the file exists
+static int _read_dump(int dump, char *text)
+{
+    char filename[MAX_TEXT_LEN];
+    snprintf(filename, MAX_TEXT_LEN, "%s/alltoallv_flight_recorder.rank1.dump%d.md", output_dir, dump);
+    FILE *f = fopen(filename, "r");
+    if (f == NULL)
+        return 1;
+    size_t n = fread(text, 1, MAX_TEXT_LEN - 1, f);
+    text[n] = '\0';
+    fclose(f);
+    unlink(filename);
+    return 0;
+}
+
+static void _add_call(uint64_t call, double duration)
+{
+    int send_counts[NUM_RANKS] = {1, 2, 3, (int)call};
+    int recv_counts[NUM_RANKS] = {4, 5, 6, (int)call};
+    flight_recorder_add(call, call, call + duration, send_counts, recv_counts, NUM_RANKS, NULL);
+}
+
+static int flight_recorder_test(void)
+{
+    static char text[MAX_TEXT_LEN];
+    uint64_t call;
+
+    if (mkdtemp(output_dir) == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] unable to create a temporary directory\n");
+        return 1;
+    }
+    setenv(FLIGHT_RECORDER_CALLS_ENVVAR, "3", 1);
+    setenv(FLIGHT_RECORDER_THRESHOLD_ENVVAR, "0.5", 1);
+    flight_recorder_init("alltoallv", 1, NUM_RANKS);
+    if (!flight_recorder_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] flight recorder not enabled\n");
+        return 1;
+    }
+
+    for (call = 0; call < 5; call++)
+        _add_call(call, 0.1);
+    if (_read_dump(0, text) == 0)
+    {
+        fprintf(stderr, "*** [ERROR] dump without trigger\n");
+        return 1;
+    }
+
+    // A slow call dumps the last 3 calls, the next slow calls are already in the dump
+    _add_call(5, 1.0);
+    _add_call(6, 1.0);
+    if (_read_dump(0, text) != 0 || _read_dump(1, text) == 0)
+    {
+        fprintf(stderr, "*** [ERROR] a slow call did not dump the flight recorder once\n");
+        return 1;
+    }
+    char *call3 = strstr(text, "## Call 3\n");
+    char *call5 = strstr(text, "## Call 5\n");
+    if (strncmp(text, "# Flight recorder of alltoallv on rank 1\n\nReason: slow call (1.000000 seconds)\n", 79) != 0 ||
+        strstr(text, "Calls: 3\n") == NULL || strstr(text, "## Call 2\n") != NULL || call3 == NULL || call5 == NULL || call3 > call5 ||
+        strstr(call5, "Send counts: 1 2 3 5\nRecv counts: 4 5 6 5\n") == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] invalid dump after a slow call:\n%s\n", text);
+        return 1;
+    }
+    fprintf(stdout, "*** dump after a slow call successful\n");
+
+    // The signal is handled at the next call
+    raise(FLIGHT_RECORDER_SIGNAL);
+    _add_call(7, 0.1);
+    if (_read_dump(1, text) != 0 || strstr(text, "Reason: signal\n") == NULL || strstr(text, "## Call 7\n") == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] the signal did not dump the flight recorder\n");
+        return 1;
+    }
+    fprintf(stdout, "*** dump after a signal successful\n");
+
+    flight_recorder_dump("test");
+    if (_read_dump(2, text) != 0 || strstr(text, "Reason: test\n") == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] explicit dump failed\n");
+        return 1;
+    }
+    fprintf(stdout, "*** explicit dump successful\n");
+
+    // The application dumps the flight recorder through the public API
+    if (cp_flight_recorder_dump("application error") != 0 || _read_dump(3, text) != 0 || strstr(text, "Reason: application error\n") == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] dump from the application failed\n");
+        return 1;
+    }
+    fprintf(stdout, "*** dump from the application successful\n");
+
+    flight_recorder_fini();
+    rmdir(output_dir);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (flight_recorder_test())
+    {
+        fprintf(stderr, "[ERROR] flight recorder test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "flight recorder test succeeded\n");
+    return EXIT_SUCCESS;
+}
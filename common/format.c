@@ -1,5 +1,5 @@
 /*************************************************************************
- * Copyright (c) 2020-2021, NVIDIA CORPORATION. All rights reserved.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION. All rights reserved.
  *
  * See LICENSE.txt for license information
  ************************************************************************/
@@ -11,418 +11,315 @@
 #include "format.h"
 #include "common_utils.h"
 
-static char *add_range_uint64(char *str, uint64_t start, uint64_t end)
-{
-    int size;
-    if (str == NULL)
-    {
-        size = MAX_STRING_LEN;
-    }
-    else
-    {
-        size = strlen(str) + (MAX_STRING_LEN - get_remainder(strlen(str), MAX_STRING_LEN));
-    }
-    int ret = size;
+// Maximum number of characters of a 64-bit integer, including the sign
+#define MAX_INT64_DIGITS (20)
 
-    if (str == NULL)
-    {
-        str = (char *)malloc(size * sizeof(char));
-        assert(str);
-        while (ret >= size)
-        {
-            ret = snprintf(str, size, "%" PRIu64 "-%" PRIu64, start, end);
-            if (ret < 0)
-            {
-                fprintf(stderr, "[%s:%d] snprintf failed\n", __FILE__, __LINE__);
-                return NULL;
-            }
-            if (ret >= size)
-            {
-                // truncated result, increasing the size of the buffer and trying again
-                size = size * 2;
-                str = (char *)realloc(str, size);
-                assert(str);
-            }
-        }
-        return str;
-    }
-    else
-    {
-        // We make sure we do not get a truncated result
-        char *s = NULL;
-        while (ret >= size)
-        {
-            if (s == NULL)
-            {
-                s = (char *)malloc(size * sizeof(char));
-                assert(s);
-            }
-            else
-            {
-                // truncated result, increasing the size of the buffer and trying again
-                size = size * 2;
-                char *tmp = (char *)realloc(s, size);
-                assert(tmp);
-                s = tmp;
-            }
-            ret = snprintf(s, size, "%s, %" PRIu64 "-%" PRIu64, str, start, end);
-            if (ret < 0)
-            {
-                fprintf(stderr, "[%s:%d] snprintf failed\n", __FILE__, __LINE__);
-                return NULL;
-            }
-        }
+void string_builder_init(string_builder_t *sb)
+{
+    sb->capacity = MAX_STRING_LEN;
+    sb->len = 0;
+    sb->str = (char *)malloc(sb->capacity);
+    assert(sb->str);
+    sb->str[0] = '\0';
+}
 
-        if (s != NULL)
-        {
-            free(str);
-            str = s;
-        }
+// _string_builder_reserve makes sure n more characters and the terminating character fit in
+// the string; the capacity doubles so appending is amortized O(1)
+static inline void _string_builder_reserve(string_builder_t *sb, size_t n)
+{
+    if (sb->len + n + 1 <= sb->capacity)
+        return;
+    while (sb->len + n + 1 > sb->capacity)
+        sb->capacity *= 2;
+    char *tmp = (char *)realloc(sb->str, sb->capacity);
+    assert(tmp);
+    sb->str = tmp;
+}
 
-        return str;
-    }
+void string_builder_append(string_builder_t *sb, const char *s, size_t len)
+{
+    _string_builder_reserve(sb, len);
+    memcpy(sb->str + sb->len, s, len);
+    sb->len += len;
+    sb->str[sb->len] = '\0';
 }
 
-static char *add_range(char *str, int start, int end)
+// _uint64_to_str writes the digits of a number at the end of a buffer of MAX_INT64_DIGITS
+// characters and returns a pointer to the first digit
+static inline char *_uint64_to_str(char *end, uint64_t n)
 {
-    int size;
-    if (str == NULL)
+    char *p = end;
+    do
     {
-        size = MAX_STRING_LEN;
-    }
-    else
-    {
-        size = strlen(str) + (MAX_STRING_LEN - get_remainder(strlen(str), MAX_STRING_LEN));
-    }
-    int ret = size;
+        p--;
+        *p = '0' + (n % 10);
+        n /= 10;
+    } while (n != 0);
+    return p;
+}
 
-    if (str == NULL)
+void string_builder_append_uint64(string_builder_t *sb, uint64_t n)
+{
+    char buf[MAX_INT64_DIGITS];
+    char *p = _uint64_to_str(buf + MAX_INT64_DIGITS, n);
+    string_builder_append(sb, p, buf + MAX_INT64_DIGITS - p);
+}
+
+void string_builder_append_int64(string_builder_t *sb, int64_t n)
+{
+    char buf[MAX_INT64_DIGITS + 1];
+    // The magnitude is computed on unsigned integers to support INT64_MIN
+    uint64_t magnitude = n < 0 ? -(uint64_t)n : (uint64_t)n;
+    char *p = _uint64_to_str(buf + MAX_INT64_DIGITS + 1, magnitude);
+    if (n < 0)
     {
-        str = (char *)malloc(size * sizeof(char));
-        assert(str);
-        while (ret >= size)
-        {
-            ret = snprintf(str, size, "%d-%d", start, end);
-            if (ret < 0)
-            {
-                fprintf(stderr, "[%s:%d] snprintf failed\n", __FILE__, __LINE__);
-                return NULL;
-            }
-            if (ret >= size)
-            {
-                // truncated result, increasing the size of the buffer and trying again
-                size = size * 2;
-                str = (char *)realloc(str, size);
-                assert(str);
-            }
-        }
-        return str;
+        p--;
+        *p = '-';
     }
-    else
-    {
-        // We make sure we do not get a truncated result
-        char *s = NULL;
-        while (ret >= size)
-        {
-            if (s == NULL)
-            {
-                s = (char *)malloc(size * sizeof(char));
-                assert(s);
-            }
-            else
-            {
-                // truncated result, increasing the size of the buffer and trying again
-                size = size * 2;
-                char *tmp = (char *)realloc(s, size);
-                assert(tmp);
-                s = tmp;
-            }
-            ret = snprintf(s, size, "%s, %d-%d", str, start, end);
-            if (ret < 0)
-            {
-                fprintf(stderr, "[%s:%d] snprintf failed\n", __FILE__, __LINE__);
-                return NULL;
-            }
-        }
+    string_builder_append(sb, p, buf + MAX_INT64_DIGITS + 1 - p);
+}
 
-        if (s != NULL)
-        {
-            free(str);
-            str = s;
-        }
+// string_builder_finish returns the string, which must be freed by the caller
+char *string_builder_finish(string_builder_t *sb)
+{
+    char *str = sb->str;
+    sb->str = NULL;
+    sb->len = 0;
+    sb->capacity = 0;
+    return str;
+}
 
-        return str;
-    }
+void string_builder_fini(string_builder_t *sb)
+{
+    free(sb->str);
+    sb->str = NULL;
+    sb->len = 0;
+    sb->capacity = 0;
 }
 
-static char *add_singleton_uint64(char *str, uint64_t n)
+// range_encoder_init initializes an encoder that appends the ranges to a string builder
+// when sb is not NULL, or writes them directly to f otherwise
+void range_encoder_init(range_encoder_t *enc, string_builder_t *sb, FILE *f, bool is_signed)
 {
+    assert(sb != NULL || f != NULL);
+    enc->sb = sb;
+    enc->f = f;
+    enc->is_signed = is_signed;
+    enc->in_run = false;
+    enc->first_in_line = true;
+}
 
-    int size;
-    if (str == NULL)
-    {
-        size = MAX_STRING_LEN;
-    }
+static inline void _range_encoder_write(range_encoder_t *enc, const char *s, size_t len)
+{
+    if (enc->sb != NULL)
+        string_builder_append(enc->sb, s, len);
     else
-    {
-        size = strlen(str) + (MAX_STRING_LEN - get_remainder(strlen(str), MAX_STRING_LEN));
-    }
-    if (str == NULL)
-    {
-        str = (char *)malloc(size * sizeof(char));
-        assert(str);
-        int rc = sprintf(str, "%" PRIu64, n);
-        assert(rc <= size);
-        return str;
-    }
+        fwrite(s, 1, len, enc->f);
+}
 
-    // We make sure we do not get a truncated result
-    char *s = NULL;
-    int ret = size;
-    while (ret >= size)
+static inline void _range_encoder_write_value(range_encoder_t *enc, uint64_t v)
+{
+    if (enc->sb != NULL)
     {
-        if (s == NULL)
-        {
-            s = (char *)malloc(size * sizeof(char));
-            assert(s);
-        }
+        if (enc->is_signed)
+            string_builder_append_int64(enc->sb, (int64_t)v);
         else
-        {
-            // truncated result, increasing the size of the buffer and trying again
-            size = size * 2;
-            char *tmp = (char *)realloc(s, size);
-            assert(tmp);
-            s = tmp;
-        }
-        ret = snprintf(s, size, "%s, %" PRIu64, str, n);
-        if (ret < 0)
-        {
-            fprintf(stderr, "[%s:%d] snprintf failed\n", __FILE__, __LINE__);
-            return NULL;
-        }
-    }
-
-    if (s != NULL)
-    {
-        if (str != NULL)
-        {
-            free(str);
-        }
-        str = s;
+            string_builder_append_uint64(enc->sb, v);
+        return;
     }
 
-    return str;
+    if (enc->is_signed)
+        fprintf(enc->f, "%" PRId64, (int64_t)v);
+    else
+        fprintf(enc->f, "%" PRIu64, v);
 }
 
-static char *add_singleton(char *str, int n)
+// _range_encoder_flush writes the current run as a singleton or as a range
+static void _range_encoder_flush(range_encoder_t *enc)
 {
+    if (!enc->in_run)
+        return;
 
-    int size;
-    if (str == NULL)
-    {
-        size = MAX_STRING_LEN;
-    }
-    else
-    {
-        size = strlen(str) + (MAX_STRING_LEN - get_remainder(strlen(str), MAX_STRING_LEN));
-    }
-    int ret = size;
-    if (str == NULL)
+    if (!enc->first_in_line)
+        _range_encoder_write(enc, ", ", 2);
+    _range_encoder_write_value(enc, enc->first);
+    if (enc->last != enc->first)
     {
-        str = (char *)malloc(size * sizeof(char));
-        assert(str);
-        int rc = sprintf(str, "%d", n);
-        assert(rc <= size);
-        return str;
+        _range_encoder_write(enc, "-", 1);
+        _range_encoder_write_value(enc, enc->last);
     }
+    enc->in_run = false;
+    enc->first_in_line = false;
+}
 
-    // We make sure we do not get a truncated result
-    char *s = NULL;
-    while (ret >= size)
+// range_encoder_add adds a value; consecutive values are merged into a single range. Values
+// of signed encoders are stored as their two's complement representation.
+void range_encoder_add(range_encoder_t *enc, uint64_t v)
+{
+    // The largest value cannot be followed by another one in a range
+    uint64_t max = enc->is_signed ? (uint64_t)INT64_MAX : UINT64_MAX;
+    if (enc->in_run && enc->last != max && enc->last + 1 == v)
     {
-        if (s == NULL)
-        {
-            s = (char *)malloc(size * sizeof(char));
-            assert(s);
-        }
-        else
-        {
-            // truncated result, increasing the size of the buffer and trying again
-            size = size * 2;
-            char *tmp = (char *)realloc(s, size);
-            assert(tmp);
-            s = tmp;
-        }
-        ret = snprintf(s, size, "%s, %d", str, n);
-        if (ret < 0)
-        {
-            fprintf(stderr, "[%s:%d] snprintf failed\n", __FILE__, __LINE__);
-            return NULL;
-        }
+        enc->last = v;
+        return;
     }
+    _range_encoder_flush(enc);
+    enc->first = v;
+    enc->last = v;
+    enc->in_run = true;
+}
 
-    if (s != NULL)
-    {
-        if (str != NULL)
-        {
-            free(str);
-        }
-        str = s;
-    }
+void range_encoder_new_line(range_encoder_t *enc)
+{
+    _range_encoder_flush(enc);
+    _range_encoder_write(enc, "\n", 1);
+    enc->first_in_line = true;
+}
 
-    return str;
+void range_encoder_finish(range_encoder_t *enc)
+{
+    _range_encoder_flush(enc);
 }
 
-static char *_compress_uint64_vec(uint64_t *array, size_t start_idx, size_t size)
+// compress_uint64_array compresses a matrix or a vector of uint64_t
+// The distinction between a matrix and a vector must be specified through the xsize and ysize parameters
+char *compress_uint64_array(uint64_t *array, size_t xsize, size_t ysize)
 {
-    size_t i, start;
-    char *compressedRep = NULL;
+    string_builder_t sb;
+    range_encoder_t enc;
 
-    if (size == 0)
+    if (xsize * ysize == 0)
         return NULL;
 
-#if DEBUG
-    fprintf(stderr, "Compressing:");
-    for (i = 0; i < size; i++)
-    {
-        fprintf(stderr, " %" PRIu64, array[i]);
-    }
-    fprintf(stderr, "\n");
-#endif // DEBUG
-
-    size_t end_idx = start_idx + size;
-    for (i = start_idx; i < end_idx; i++)
-    {
-        start = i;
-        while (i + 1 < end_idx && array[i] + 1 == array[i + 1])
-        {
-            i++;
-        }
-        if (i != start)
-        {
-            // We found a range
-            compressedRep = add_range_uint64(compressedRep, array[start], array[i]);
-        }
-        else
-        {
-            // We found a singleton
-            compressedRep = add_singleton_uint64(compressedRep, array[i]);
-        }
-    }
-#if DEBUG
-    fprintf(stderr, "Compressed version is: %s\n", compressedRep);
-#endif // DEBUG
-    return compressedRep;
+    string_builder_init(&sb);
+    range_encoder_init(&enc, &sb, NULL, false);
+    write_compressed_uint64_array(&enc, array, xsize, ysize);
+    return string_builder_finish(&sb);
 }
 
-// compress_uint64_array compresses a matrix or a vector of uint64_t
+// compress_int_array compresses a matrix or a vector of int.
 // The distinction between a matrix and a vector must be specified through the xsize and ysize parameters
-char *compress_uint64_array(uint64_t *array, size_t xsize, size_t ysize)
+char *compress_int_array(int *array, int xsize, int ysize)
 {
-    size_t idx;
-    char *compressedRep = NULL;
-    for (idx = 0; idx < xsize * ysize; idx += xsize)
+    string_builder_t sb;
+    range_encoder_t enc;
+
+    if (xsize * ysize <= 0)
+        return NULL;
+
+    string_builder_init(&sb);
+    range_encoder_init(&enc, &sb, NULL, true);
+    write_compressed_int_array(&enc, array, xsize, ysize);
+    return string_builder_finish(&sb);
+}
+
+// write_compressed_uint64_array encodes a matrix or a vector of uint64_t, one line per row
+void write_compressed_uint64_array(range_encoder_t *enc, uint64_t *array, size_t xsize, size_t ysize)
+{
+    size_t x, y;
+    for (y = 0; y < ysize; y++)
     {
-        char *compressed_line = _compress_uint64_vec(array, idx, xsize);
-        if (compressedRep == NULL)
-        {
-            compressedRep = strdup(compressed_line);
-        }
-        else
-        {
-            char *tmp = realloc(compressedRep, strlen(compressedRep) + strlen(compressed_line) + 2);
-            assert(tmp);
-            compressedRep = tmp;
-            size_t n;
-            size_t copy_idx = strlen(compressedRep);
-            compressedRep[copy_idx] = '\n';
-            copy_idx++;
-            for (n = 0; n < strlen(compressed_line); n++)
-            {
-                compressedRep[copy_idx] = compressed_line[n];
-                copy_idx++;
-            }
-            compressedRep[copy_idx] = '\0';
-        }
-        free(compressed_line);
+        if (y > 0)
+            range_encoder_new_line(enc);
+        for (x = 0; x < xsize; x++)
+            range_encoder_add(enc, array[y * xsize + x]);
     }
-    return compressedRep;
+    range_encoder_finish(enc);
 }
 
-static char *_compress_int_vec(int *array, size_t start_idx, size_t size)
+// write_compressed_int_array encodes a matrix or a vector of int, one line per row
+void write_compressed_int_array(range_encoder_t *enc, int *array, int xsize, int ysize)
 {
-    int i, start;
-    char *compressedRep = NULL;
-
-    if (size == 0)
+    int x, y;
+    for (y = 0; y < ysize; y++)
     {
-        return NULL;
+        if (y > 0)
+            range_encoder_new_line(enc);
+        for (x = 0; x < xsize; x++)
+            range_encoder_add(enc, (uint64_t)(int64_t)array[y * xsize + x]);
     }
+    range_encoder_finish(enc);
+}
+
+// _parse_value parses a number, which is negative only for signed values
+static inline int _parse_value(const char **s, bool is_signed, uint64_t *v)
+{
+    const char *p = *s;
+    bool negative = false;
+    uint64_t n = 0;
 
-#if DEBUG
-    fprintf(stderr, "Compressing:");
-    for (i = 0; i < size; i++)
+    if (is_signed && *p == '-')
     {
-        fprintf(stderr, " %d", array[i]);
+        negative = true;
+        p++;
     }
-    fprintf(stderr, "\n");
-#endif // DEBUG
-
-    size_t end_idx = start_idx + size;
-    for (i = start_idx; i < end_idx; i++)
+    if (*p < '0' || *p > '9')
+        return 1;
+    while (*p >= '0' && *p <= '9')
     {
-        start = i;
-        while (i + 1 < end_idx && array[i] + 1 == array[i + 1])
-        {
-            i++;
-        }
-        if (i != start)
-        {
-            // We found a range
-            compressedRep = add_range(compressedRep, array[start], array[i]);
-        }
-        else
-        {
-            // We found a singleton
-            compressedRep = add_singleton(compressedRep, array[i]);
-        }
+        n = n * 10 + (*p - '0');
+        p++;
     }
-#if DEBUG
-    fprintf(stderr, "Compressed version is: %s\n", compressedRep);
-#endif // DEBUG
-    return compressedRep;
+    *v = negative ? -n : n;
+    *s = p;
+    return 0;
 }
 
-// compress_int_array compresses a matrix or a vector of int.
-// The distinction between a matrix and a vector must be specified through the xsize and ysize parameters
-char *compress_int_array(int *array, int xsize, int ysize)
+// parse_compressed_array decodes a string generated by the range encoder, e.g., "0-3, 5",
+// into the list of its values. Rows are concatenated. The array must be freed by the
+// caller. Returns 0 on success.
+int parse_compressed_array(const char *str, bool is_signed, uint64_t **array, size_t *size)
 {
-    size_t idx;
-    char *compressedRep = NULL;
-    for (idx = 0; idx < xsize * ysize; idx += xsize)
+    size_t capacity = 64;
+    size_t n = 0;
+    uint64_t *values = malloc(capacity * sizeof(uint64_t));
+    const char *p = str;
+
+    assert(values);
+    while (*p != '\0')
     {
-        char *compressed_line = _compress_int_vec(array, idx, xsize);
-        if (compressedRep == NULL)
+        uint64_t first, last, v;
+        if (_parse_value(&p, is_signed, &first))
+            goto error;
+        last = first;
+        if (*p == '-')
         {
-            compressedRep = strdup(compressed_line);
+            p++;
+            if (_parse_value(&p, is_signed, &last))
+                goto error;
+            if ((is_signed && (int64_t)last < (int64_t)first) || (!is_signed && last < first))
+                goto error;
         }
-        else
+
+        for (v = first;; v++)
         {
-            char *tmp = realloc(compressedRep, strlen(compressedRep) + strlen(compressed_line) + 2);
-            assert(tmp);
-            compressedRep = tmp;
-            size_t n;
-            size_t copy_idx = strlen(compressedRep);
-            compressedRep[copy_idx] = '\n';
-            copy_idx++;
-            for (n = 0; n < strlen(compressed_line); n++)
+            if (n == capacity)
             {
-                compressedRep[copy_idx] = compressed_line[n];
-                copy_idx++;
+                capacity *= 2;
+                uint64_t *tmp = realloc(values, capacity * sizeof(uint64_t));
+                assert(tmp);
+                values = tmp;
             }
-            compressedRep[copy_idx] = '\0';
+            values[n] = v;
+            n++;
+            if (v == last)
+                break;
         }
-        free(compressed_line);
+
+        if (p[0] == ',' && p[1] == ' ')
+            p += 2;
+        else if (p[0] == '\n')
+            p++;
+        else if (p[0] != '\0')
+            goto error;
     }
-    return compressedRep;
+
+    *array = values;
+    *size = n;
+    return 0;
+
+error:
+    fprintf(stderr, "invalid compressed array: %s\n", str);
+    free(values);
+    return 1;
 }
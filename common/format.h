@@ -1,5 +1,5 @@
 /*************************************************************************
- * Copyright (c) 2020-2021, NVIDIA CORPORATION. All rights reserved.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION. All rights reserved.
  *
  * See LICENSE.txt for license information
  ************************************************************************/
@@ -7,6 +7,8 @@
 #ifndef MPI_COLLECTIVE_PROFILER_FORMAT_H
 #define MPI_COLLECTIVE_PROFILER_FORMAT_H
 
+#include <stdio.h>
+#include <stdbool.h>
 #include <inttypes.h>
 #include <string.h>
 
@@ -14,7 +16,43 @@
 
 #define FORMAT_VERSION_WRITE(_fd) (fprintf(_fd, "FORMAT_VERSION: %d\n\n", FORMAT_VERSION))
 
+// string_builder is a growable string; appending is amortized O(1)
+typedef struct string_builder
+{
+    char *str;
+    size_t len;
+    size_t capacity;
+} string_builder_t;
+
+// range_encoder encodes a stream of values as a list of ranges, e.g., "0-3, 5, 7-9",
+// in a string builder or directly in a file, in linear time
+typedef struct range_encoder
+{
+    string_builder_t *sb;
+    FILE *f;
+    bool is_signed;
+    bool in_run;
+    bool first_in_line;
+    uint64_t first;
+    uint64_t last;
+} range_encoder_t;
+
+void string_builder_init(string_builder_t *sb);
+void string_builder_append(string_builder_t *sb, const char *s, size_t len);
+void string_builder_append_uint64(string_builder_t *sb, uint64_t n);
+void string_builder_append_int64(string_builder_t *sb, int64_t n);
+char *string_builder_finish(string_builder_t *sb);
+void string_builder_fini(string_builder_t *sb);
+
+void range_encoder_init(range_encoder_t *enc, string_builder_t *sb, FILE *f, bool is_signed);
+void range_encoder_add(range_encoder_t *enc, uint64_t v);
+void range_encoder_new_line(range_encoder_t *enc);
+void range_encoder_finish(range_encoder_t *enc);
+
 char *compress_int_array(int *array, int xsize,  int ysize);
 char *compress_uint64_array(uint64_t *array, size_t xsize,  size_t ysize);
+void write_compressed_int_array(range_encoder_t *enc, int *array, int xsize, int ysize);
+void write_compressed_uint64_array(range_encoder_t *enc, uint64_t *array, size_t xsize, size_t ysize);
+int parse_compressed_array(const char *str, bool is_signed, uint64_t **array, size_t *size);
 
 #endif // MPI_COLLECTIVE_PROFILER_FORMAT_H
\ No newline at end of file
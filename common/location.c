@@ -5,6 +5,9 @@
  ************************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
 
 #include "location.h"
 #include "comm.h"
@@ -15,62 +18,157 @@
 location_logger_t *location_loggers_head = NULL;
 location_logger_t *location_loggers_tail = NULL;
 
+// The hostname cannot change during the execution, we look it up only once
+static char local_hostname[LOCATION_HOSTNAME_LEN] = "";
+
 extern char *get_output_dir();
 
-static inline int _open_location_file(location_logger_t *logger)
+static inline int _open_location_file(location_logger_t *logger, char **filename, FILE **fd)
 {
     int rc;
     char *output_dir = NULL;
+    char *_filename = NULL;
 
     assert(logger);
     assert(logger->collective_name);
     output_dir = get_output_dir();
     if (output_dir)
     {
-        _asprintf(logger->filename, rc, "%s/%s_locations_comm%" PRIu64 "_rank%d.md", output_dir, logger->collective_name, logger->commid, logger->world_rank);
+        _asprintf(_filename, rc, "%s/%s_locations_comm%" PRIu64 "_rank%d.md", output_dir, logger->collective_name, logger->commid, logger->world_rank);
     }
     else
     {
-        _asprintf(logger->filename, rc, "%s_locations_comm%" PRIu64 "_rank%d.md", logger->collective_name, logger->commid, logger->world_rank);
+        _asprintf(_filename, rc, "%s_locations_comm%" PRIu64 "_rank%d.md", logger->collective_name, logger->commid, logger->world_rank);
     }
     assert(rc > 0);
 
-    logger->fd = fopen(logger->filename, "w");
-    assert(logger->fd);
+    *fd = fopen(_filename, "w");
+    assert(*fd);
+    *filename = _filename;
     return 0;
 }
 
-int init_location_logger(char *collective_name, int world_rank, uint64_t comm_id, size_t comm_size, char *hostnames, int *pids, int *world_comm_ranks, uint64_t callID, location_logger_t **logger)
+// _intern_hostnames builds the table of unique hostnames from the gathered hostnames
+// and sets for each rank the index of its node in that table. Ranks are usually placed
+// in blocks on nodes so we first compare with the node of the previous rank.
+static inline int _intern_hostnames(location_logger_t *logger, char *hostnames)
 {
-    int rc;
+    int i, j;
+    int max_nodes = 8;
+
+    logger->nodes = malloc(max_nodes * sizeof(char *));
+    assert(logger->nodes);
+    logger->node_ids = malloc(logger->comm_size * sizeof(int));
+    assert(logger->node_ids);
+    logger->num_nodes = 0;
 
+    for (i = 0; i < logger->comm_size; i++)
+    {
+        char *hostname = &(hostnames[i * LOCATION_HOSTNAME_LEN]);
+        int node_id = -1;
+
+        if (i > 0 && strcmp(logger->nodes[logger->node_ids[i - 1]], hostname) == 0)
+        {
+            node_id = logger->node_ids[i - 1];
+        }
+        else
+        {
+            for (j = 0; j < logger->num_nodes; j++)
+            {
+                if (strcmp(logger->nodes[j], hostname) == 0)
+                {
+                    node_id = j;
+                    break;
+                }
+            }
+        }
+
+        if (node_id == -1)
+        {
+            if (logger->num_nodes == max_nodes)
+            {
+                max_nodes *= 2;
+                logger->nodes = realloc(logger->nodes, max_nodes * sizeof(char *));
+                assert(logger->nodes);
+            }
+            logger->nodes[logger->num_nodes] = strdup(hostname);
+            assert(logger->nodes[logger->num_nodes]);
+            node_id = logger->num_nodes;
+            logger->num_nodes++;
+        }
+        logger->node_ids[i] = node_id;
+    }
+
+    return 0;
+}
+
+// _gather_locations gathers the PID, COMM_WORLD rank and hostname of all the ranks of
+// the communicator on its root. It is collective over the communicator.
+static inline int _gather_locations(location_logger_t *logger, MPI_Comm comm)
+{
+    int my_pid = getpid();
+    int *pids = NULL;
+    int *world_comm_ranks = NULL;
+    char *hostnames = NULL;
+
+    if (local_hostname[0] == '\0')
+    {
+        gethostname(local_hostname, LOCATION_HOSTNAME_LEN);
+        local_hostname[LOCATION_HOSTNAME_LEN - 1] = '\0';
+    }
+
+    if (logger->comm_rank == 0)
+    {
+        pids = malloc(logger->comm_size * sizeof(int));
+        assert(pids);
+        world_comm_ranks = malloc(logger->comm_size * sizeof(int));
+        assert(world_comm_ranks);
+        hostnames = malloc(LOCATION_HOSTNAME_LEN * logger->comm_size * sizeof(char));
+        assert(hostnames);
+    }
+
+    PMPI_Gather(&my_pid, 1, MPI_INT, pids, 1, MPI_INT, 0, comm);
+    PMPI_Gather(&(logger->world_rank), 1, MPI_INT, world_comm_ranks, 1, MPI_INT, 0, comm);
+    PMPI_Gather(local_hostname, LOCATION_HOSTNAME_LEN, MPI_CHAR, hostnames, LOCATION_HOSTNAME_LEN, MPI_CHAR, 0, comm);
+
+    if (logger->comm_rank == 0)
+    {
+        logger->pids = pids;
+        logger->world_comm_ranks = world_comm_ranks;
+        int rc = _intern_hostnames(logger, hostnames);
+        free(hostnames);
+        if (rc)
+        {
+            fprintf(stderr, "_intern_hostnames() failed: %d\n", rc);
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+int init_location_logger(char *collective_name, int world_rank, int comm_rank, uint64_t comm_id, size_t comm_size, uint64_t callID, location_logger_t **logger)
+{
     location_logger_t *new_logger = malloc(sizeof(location_logger_t));
     assert(new_logger);
     new_logger->world_rank = world_rank;
+    new_logger->comm_rank = comm_rank;
     new_logger->commid = comm_id;
     new_logger->comm_size = comm_size;
-    new_logger->world_comm_ranks = world_comm_ranks;
+    new_logger->world_comm_ranks = NULL;
     new_logger->collective_name = strdup(collective_name);
-    new_logger->pids = pids;
+    new_logger->pids = NULL;
+    new_logger->nodes = NULL;
+    new_logger->num_nodes = 0;
+    new_logger->node_ids = NULL;
     new_logger->calls_max = 2;
     new_logger->calls = malloc(new_logger->calls_max * sizeof(uint64_t));
     assert(new_logger->calls);
     new_logger->calls_count = 1;
     new_logger->calls[0] = callID;
-    new_logger->locations = hostnames;
-    new_logger->fd = NULL;
-    new_logger->filename = NULL;
     new_logger->next = NULL;
     new_logger->prev = NULL;
 
-    rc = _open_location_file(new_logger);
-    if (rc)
-    {
-        fprintf(stderr, "_open_location_file() failed: %d\n", rc);
-        return -1;
-    }
-    assert(new_logger->fd);
-
     if (location_loggers_head == NULL)
     {
         location_loggers_head = new_logger;
@@ -83,8 +181,6 @@ int init_location_logger(char *collective_name, int world_rank, uint64_t comm_id
         location_loggers_tail = new_logger;
     }
 
-    // Write the format version at the begining of the file
-    FORMAT_VERSION_WRITE(new_logger->fd);
     *logger = new_logger;
 
     return 0;
@@ -108,71 +204,91 @@ int lookup_location_logger(uint64_t commid, location_logger_t **logger)
     return 0;
 }
 
-static inline int _close_location_file(location_logger_t *logger)
+static inline int _write_location_to_file(location_logger_t *logger)
 {
-    if (logger->fd)
-    {
-        fclose(logger->fd);
-        logger->fd = NULL;
-    }
+    char *filename = NULL;
+    FILE *fd = NULL;
 
-    if (logger->filename)
+    assert(logger);
+    int rc = _open_location_file(logger, &filename, &fd);
+    if (rc)
     {
-        free(logger->filename);
-        logger->filename = NULL;
+        fprintf(stderr, "_open_location_file() failed: %d\n", rc);
+        return rc;
     }
+    assert(fd);
 
-    return 0;
-}
-
-static inline int _write_location_to_file(location_logger_t *logger)
-{
-    assert(logger);
-    assert(logger->fd);
-
-    fprintf(logger->fd, "Communicator ID: %"PRIu64"\n", logger->commid);
-    char *strCalls = compress_uint64_array(logger->calls, logger->calls_count, 1);
-    assert(strCalls);
-    fprintf(logger->fd, "Calls: %s\n", strCalls);
-    char *strRanks = compress_int_array(logger->world_comm_ranks, logger->comm_size, 1);
-    assert(strRanks);
-    fprintf(logger->fd, "COMM_WORLD ranks: %s\n", strRanks);
-    char *strPIDs = compress_int_array(logger->pids, logger->comm_size, 1);
-    assert(strPIDs);
-    fprintf(logger->fd, "PIDs: %s\n", strPIDs);
-    fprintf(logger->fd, "Hostnames:\n");
+    // Write the format version at the begining of the file
+    FORMAT_VERSION_WRITE(fd);
+    fprintf(fd, "Communicator ID: %"PRIu64"\n", logger->commid);
+    range_encoder_t enc;
+    fprintf(fd, "Calls: ");
+    range_encoder_init(&enc, NULL, fd, false);
+    write_compressed_uint64_array(&enc, logger->calls, logger->calls_count, 1);
+    fprintf(fd, "\nCOMM_WORLD ranks: ");
+    range_encoder_init(&enc, NULL, fd, true);
+    write_compressed_int_array(&enc, logger->world_comm_ranks, logger->comm_size, 1);
+    fprintf(fd, "\nPIDs: ");
+    range_encoder_init(&enc, NULL, fd, true);
+    write_compressed_int_array(&enc, logger->pids, logger->comm_size, 1);
+    fprintf(fd, "\n");
+    fprintf(fd, "Nodes:\n");
     int i;
+    for (i = 0; i < logger->num_nodes; i++)
+    {
+        fprintf(fd, "\tNode %d: %s\n", i, logger->nodes[i]);
+    }
+    fprintf(fd, "Hostnames:\n");
     for(i = 0; i < logger->comm_size; i++)
     {
-        fprintf(logger->fd, "\tRank %d: %s\n", i, &(logger->locations[i * 256]));
+        fprintf(fd, "\tRank %d: %s\n", i, logger->nodes[logger->node_ids[i]]);
     }
-    free(strCalls);
-    free(strPIDs);
-    free(strRanks);
+    fclose(fd);
+    free(filename);
     return 0;
 }
 
 int fini_location_tracking(location_logger_t **logger)
 {
-    _write_location_to_file(*logger);
-    _close_location_file(*logger);
+    // Only the root of the communicator has the location data
+    if ((*logger)->comm_rank == 0)
+    {
+        int rc = _write_location_to_file(*logger);
+        if (rc)
+        {
+            fprintf(stderr, "_write_location_to_file() failed: %d\n", rc);
+            // Do not return, we still release the memory
+        }
+    }
 
-    if ((*logger)->fd)
+    if ((*logger)->pids)
     {
-        fclose((*logger)->fd);
-        (*logger)->fd = NULL;
+        free((*logger)->pids);
+        (*logger)->pids = NULL;
     }
 
-    if ((*logger)->filename)
+    if ((*logger)->world_comm_ranks)
     {
-        free((*logger)->filename);
-        (*logger)->filename = NULL;
+        free((*logger)->world_comm_ranks);
+        (*logger)->world_comm_ranks = NULL;
     }
 
-    if ((*logger)->pids)
+    if ((*logger)->nodes)
     {
-        free((*logger)->pids);
-        (*logger)->pids = NULL;
+        int i;
+        for (i = 0; i < (*logger)->num_nodes; i++)
+        {
+            free((*logger)->nodes[i]);
+        }
+        free((*logger)->nodes);
+        (*logger)->nodes = NULL;
+        (*logger)->num_nodes = 0;
+    }
+
+    if ((*logger)->node_ids)
+    {
+        free((*logger)->node_ids);
+        (*logger)->node_ids = NULL;
     }
 
     if ((*logger)->calls)
@@ -203,10 +319,14 @@ int release_location_loggers()
         }
         location_loggers_head = ptr;
     }
+    location_loggers_tail = NULL;
     return 0;
 }
 
-int commit_rank_locations(char *collective_name, MPI_Comm comm, int comm_size, int world_rank, int comm_rank, int *pids, int *world_comm_ranks, char *hostnames, uint64_t n_call)
+// commit_rank_locations must be called by all the ranks of the communicator. The first
+// time a communicator is used, the locations of its ranks are gathered on its root, which
+// makes the call collective; afterwards, the call is local and only saves the call ID.
+int commit_rank_locations(char *collective_name, MPI_Comm comm, int comm_size, int world_rank, int comm_rank, uint64_t n_call)
 {
     int rc;
     location_logger_t *logger;
@@ -234,15 +354,20 @@ int commit_rank_locations(char *collective_name, MPI_Comm comm, int comm_size, i
 
     if (logger == NULL)
     {
-        // We have no data about the communicator
-        // We check first if the communicator is already known
-
-        rc = init_location_logger(collective_name, world_rank, comm_id, comm_size, hostnames, pids, world_comm_ranks, n_call, &logger);
+        // We have no data about the communicator, we gather the locations of its ranks
+        rc = init_location_logger(collective_name, world_rank, comm_rank, comm_id, comm_size, n_call, &logger);
         if (rc)
         {
             fprintf(stderr, "init_location_logger(): %d\n", rc);
             return rc;
         }
+
+        rc = _gather_locations(logger, comm);
+        if (rc)
+        {
+            fprintf(stderr, "_gather_locations() failed: %d\n", rc);
+            return rc;
+        }
     }
     else
     {
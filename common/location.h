@@ -12,28 +12,36 @@
 
 #include "mpi.h"
 
+#define LOCATION_HOSTNAME_LEN (256)
+
 // location_logger is the central structure to track and profile locations of ranks in
-// the context of MPI collective. 
+// the context of MPI collective. Locations are gathered only once per communicator, the
+// first time it is used; afterwards, only the call IDs are tracked.
+// Every rank has a logger for each communicator it used so it knows when the locations
+// are already known but only the communicator's root holds the actual location data.
 typedef struct location_logger
 {
     char *collective_name;
     int world_rank;
-    FILE *fd; // File descriptor to write the trace
-    char *filename; // Filename for the trace
+    int comm_rank;
     int *world_comm_ranks;
     size_t calls_count;
     size_t calls_max;
     uint64_t *calls;
     uint64_t commid;
     int comm_size;
-    char *locations;
+    // Unique hostnames of the nodes used by the communicator
+    char **nodes;
+    int num_nodes;
+    // Index in the nodes table for each rank of the communicator
+    int *node_ids;
     int *pids;
     struct location_logger *next;
     struct location_logger *prev;
 } location_logger_t;
 
-int commit_rank_locations(char *collective_name, MPI_Comm comm, int comm_size, int world_rank, int comm_rank, int *pids, int *world_comm_ranks, char *hostnames, uint64_t n_call);
+int commit_rank_locations(char *collective_name, MPI_Comm comm, int comm_size, int world_rank, int comm_rank, uint64_t n_call);
 int release_location_loggers();
 
 
-#endif // MPI_COLLECTIVE_PROFILER_LOCATION_H
\ No newline at end of file
+#endif // MPI_COLLECTIVE_PROFILER_LOCATION_H
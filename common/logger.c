@@ -27,6 +27,7 @@ extern int log_counts(logger_t *logger,
                       uint64_t *calls,
                       uint64_t num_counts_data,
                       counts_data_t **counters,
+                      matrix_structure_t *structure,
                       int size,
                       int rank_vec_len,
                       int type_size);
@@ -128,6 +129,7 @@ static void _log_data(logger_t *logger,
                       uint64_t *calls,
                       uint64_t num_data,
                       void **list,
+                      matrix_structure_t *structure,
                       int size,
                       int rank_vec_len,
                       int type_size)
@@ -180,7 +182,7 @@ static void _log_data(logger_t *logger,
     assert(logger->f);
 
 #if ENABLE_COUNTS
-    log_counts(logger, startcall, endcall, ctx, count, calls, num_data, counters, size, rank_vec_len, type_size);
+    log_counts(logger, startcall, endcall, ctx, count, calls, num_data, counters, structure, size, rank_vec_len, type_size);
 #endif // ENABLE_COUNTS
 
 #if ENABLE_DISPLS
@@ -383,14 +385,14 @@ static void log_data(logger_t *logger, uint64_t startcall, uint64_t endcall, SRC
 
             _log_data(logger, startcall, endcall,
                       SEND_CTX, srDisplPtr->count, srDisplPtr->list_calls,
-                      srDisplPtr->send_data_size, srDisplPtr->send_data, srDisplPtr->size, srDisplPtr->rank_send_vec_len, srDisplPtr->sendtype_size);
+                      srDisplPtr->send_data_size, srDisplPtr->send_data, NULL, srDisplPtr->size, srDisplPtr->rank_send_vec_len, srDisplPtr->sendtype_size);
 
             DEBUG_LOGGER("Logging recv displacements (number of displacement series: %d)\n", srDisplPtr->recv_data_size);
             fprintf(logger->f, "### Data received per rank - Type size: %d\n\n", srDisplPtr->recvtype_size);
 
             _log_data(logger, startcall, endcall,
                       RECV_CTX, srDisplPtr->count, srDisplPtr->list_calls,
-                      srDisplPtr->recv_data_size, srDisplPtr->recv_data, srDisplPtr->size, srDisplPtr->rank_recv_vec_len, srDisplPtr->recvtype_size);
+                      srDisplPtr->recv_data_size, srDisplPtr->recv_data, NULL, srDisplPtr->size, srDisplPtr->rank_recv_vec_len, srDisplPtr->recvtype_size);
 
             DEBUG_LOGGER("%s call %" PRIu64 " logged\n", logger->collective_name, srDisplPtr->count);
             srDisplPtr = srDisplPtr->next;
@@ -414,6 +416,12 @@ static void log_data(logger_t *logger, uint64_t startcall, uint64_t endcall, SRC
         }
         assert(logger->f);
         fprintf(logger->f, "# Send/recv counts for %s operations:\n", logger->collective_name);
+        double tolerance;
+        counts_quantization_t quantization = get_counts_quantization(&tolerance);
+        if (quantization == COUNTS_QUANTIZATION_LOG2)
+            fprintf(logger->f, "\nCounts quantization: log2\n");
+        if (quantization == COUNTS_QUANTIZATION_RELATIVE)
+            fprintf(logger->f, "\nCounts quantization: relative %g\n", tolerance);
         uint64_t count = 0;
         while (srCountPtr != NULL)
         {
@@ -423,21 +431,41 @@ static void log_data(logger_t *logger, uint64_t startcall, uint64_t endcall, SRC
                     srCountPtr->size,
                     logger->collective_name,
                     srCountPtr->count);
+            if (quantization != COUNTS_QUANTIZATION_NONE)
+            {
+                // Counts below are quantized, the amounts of data are exact
+                fprintf(logger->f,
+                        "exact data sent = %" PRIu64 " bytes; exact data received = %" PRIu64 " bytes\n\n",
+                        srCountPtr->send_bytes,
+                        srCountPtr->recv_bytes);
+            }
 
             DEBUG_LOGGER("Logging %s call %" PRIu64 "\n", logger->collective_name, srCountPtr->count);
             DEBUG_LOGGER_NOARGS("Logging send counts\n");
             fprintf(logger->f, "### Data sent per rank - Type size: %d\n\n", srCountPtr->sendtype_size);
+            if (srCountPtr->send_structure != NULL)
+            {
+                fprintf(logger->f, "Structure: ");
+                matrix_structure_write(logger->f, srCountPtr->send_structure);
+                fprintf(logger->f, "\n\n");
+            }
 
             _log_data(logger, startcall, endcall,
                       SEND_CTX, srCountPtr->count, (void *)srCountPtr->list_calls,
-                      srCountPtr->send_data_size, srCountPtr->send_data, srCountPtr->size, srCountPtr->rank_send_vec_len, srCountPtr->sendtype_size);
+                      srCountPtr->send_data_size, srCountPtr->send_data, srCountPtr->send_structure, srCountPtr->size, srCountPtr->rank_send_vec_len, srCountPtr->sendtype_size);
 
             DEBUG_LOGGER("Logging recv counts (number of count series: %d)\n", srCountPtr->recv_data_size);
             fprintf(logger->f, "### Data received per rank - Type size: %d\n\n", srCountPtr->recvtype_size);
+            if (srCountPtr->recv_structure != NULL)
+            {
+                fprintf(logger->f, "Structure: ");
+                matrix_structure_write(logger->f, srCountPtr->recv_structure);
+                fprintf(logger->f, "\n\n");
+            }
 
             _log_data(logger, startcall, endcall,
                       RECV_CTX, srCountPtr->count, (void *)srCountPtr->list_calls,
-                      srCountPtr->recv_data_size, srCountPtr->recv_data, srCountPtr->size, srCountPtr->rank_recv_vec_len, srCountPtr->recvtype_size);
+                      srCountPtr->recv_data_size, srCountPtr->recv_data, srCountPtr->recv_structure, srCountPtr->size, srCountPtr->rank_recv_vec_len, srCountPtr->recvtype_size);
 
             DEBUG_LOGGER("%s call %" PRIu64 " logged\n", logger->collective_name, srCountPtr->count);
             srCountPtr = srCountPtr->next;
@@ -551,6 +579,16 @@ void logger_fini(logger_t **l)
         fclose((*l)->recvcounters_fh);
     if ((*l)->recvcounts_filename)
         free((*l)->recvcounts_filename);
+    rc = counts_writer_fini(&((*l)->sendcounts_writer));
+    if (rc)
+    {
+        fprintf(stderr, "counts_writer_fini() failed: %d\n", rc);
+    }
+    rc = counts_writer_fini(&((*l)->recvcounts_writer));
+    if (rc)
+    {
+        fprintf(stderr, "counts_writer_fini() failed: %d\n", rc);
+    }
     if ((*l)->timing_fh)
         fclose((*l)->timing_fh);
     if ((*l)->timing_filename)
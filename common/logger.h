@@ -12,6 +12,9 @@
 
 #include "collective_profiler_config.h"
 #include "common_types.h"
+#include "counts_format.h"
+#include "counts_data.h"
+#include "matrix_structure.h"
 
 #ifndef LOGGER_H
 #define LOGGER_H
@@ -51,6 +54,8 @@ typedef struct logger
     FILE *sendcounters_fh;     // File handle used to save send counters.
     char *recvcounts_filename; // Path of the receive counts profile.
     FILE *recvcounters_fh;     // File handle used to save recv counters.
+    counts_writer_t *sendcounts_writer; // Writer of the binary send counts file.
+    counts_writer_t *recvcounts_writer; // Writer of the binary recv counts file.
     char *senddispls_filename; // Path of the send displacements profile.
     FILE *senddispls_fh;       // File handle used to save send displacements.
     char *recvdispls_filename; // Path of the receive displacements profile.
@@ -79,7 +84,7 @@ extern void logger_fini(logger_t **l);
  */
 extern void log_profiling_data(logger_t *logger, uint64_t coll_calls, uint64_t callStart, uint64_t callsLogged, SRCountNode_t *counters_list, SRDisplNode_t *displs_list, avTimingsNode_t *times_list);
 extern void log_timing_data(logger_t *logger, avTimingsNode_t *times_list);
-extern int *lookup_rank_counters(int data_size, counts_data_t **data, int rank);
+extern counts_data_t *lookup_rank_counts_data(int data_size, counts_data_t **data, int rank);
 extern int *lookup_rank_displs(int data_size, displs_data_t **data, int rank);
 
 /**
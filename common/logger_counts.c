@@ -19,8 +19,9 @@
 #include "logger.h"
 #include "grouping.h"
 #include "format.h"
+#include "counts_format.h"
 
-int *lookup_rank_counters(int data_size, counts_data_t **data, int rank)
+counts_data_t *lookup_rank_counts_data(int data_size, counts_data_t **data, int rank)
 {
     assert(data);
     DEBUG_LOGGER("Looking up counts for rank %d (%d data elements to scan)\n", rank, data_size);
@@ -35,7 +36,7 @@ int *lookup_rank_counters(int data_size, counts_data_t **data, int rank)
             DEBUG_LOGGER("Scan previous counts for rank %d\n", data[i]->ranks[j]);
             if (rank == data[i]->ranks[j])
             {
-                return data[i]->counters;
+                return data[i];
             }
         }
     }
@@ -43,6 +44,73 @@ int *lookup_rank_counters(int data_size, counts_data_t **data, int rank)
     return NULL;
 }
 
+// _get_counts_writer returns the writer of the binary count file of a context, which is
+// the text count file with the .bin extension
+static int _get_counts_writer(logger_t *logger, int ctx, counts_writer_t **writer)
+{
+    counts_writer_t **w = ctx == RECV_CTX ? &(logger->recvcounts_writer) : &(logger->sendcounts_writer);
+    if (*w == NULL)
+    {
+        char *filename = logger->get_full_filename(ctx, "counters", logger->jobid, logger->rank);
+        char *ext = strrchr(filename, '.');
+        if (ext != NULL && strcmp(ext, ".txt") == 0)
+            strcpy(ext, ".bin");
+        char *delta_envvar = getenv(COLLECTIVE_PROFILER_COUNTS_DELTA_ENVVAR);
+        bool delta = delta_envvar != NULL && atoi(delta_envvar) == 1;
+        int rc = counts_writer_init(filename, logger->collective_name, delta, w);
+        free(filename);
+        if (rc)
+            return rc;
+    }
+    *writer = *w;
+    return 0;
+}
+
+// _add_structure_dataset adds a count matrix described by its structure to a binary count
+// file, which only stores series of counts: the series are generated from the structure
+static int _add_structure_dataset(counts_writer_t *writer, uint64_t startcall, uint64_t endcall, uint64_t count, uint64_t *calls, matrix_structure_t *structure, int type_size)
+{
+    int size = structure->size;
+    counts_data_t **series = malloc(size * sizeof(counts_data_t *));
+    int *counts = malloc(size * sizeof(int));
+    int num_series = 0;
+    int rank, i;
+
+    assert(series);
+    assert(counts);
+    for (rank = 0; rank < size; rank++)
+    {
+        matrix_structure_get_row(structure, rank, counts);
+        for (i = 0; i < num_series; i++)
+        {
+            if (counts_data_equal(series[i], counts, size))
+                break;
+        }
+        if (i == num_series)
+        {
+            series[i] = calloc(1, sizeof(counts_data_t));
+            assert(series[i]);
+            counts_data_set_counts(series[i], counts, size);
+            series[i]->ranks = malloc(size * sizeof(int));
+            assert(series[i]->ranks);
+            num_series++;
+        }
+        series[i]->ranks[series[i]->num_ranks] = rank;
+        series[i]->num_ranks++;
+    }
+
+    int rc = counts_writer_add_dataset(writer, startcall, endcall, count, calls, num_series, series, size, size, type_size);
+    for (i = 0; i < num_series; i++)
+    {
+        counts_data_free_series(series[i]);
+        free(series[i]->ranks);
+        free(series[i]);
+    }
+    free(series);
+    free(counts);
+    return rc;
+}
+
 int log_counts(logger_t *logger,
                uint64_t startcall,
                uint64_t endcall,
@@ -51,6 +119,7 @@ int log_counts(logger_t *logger,
                uint64_t *calls,
                uint64_t num_counts_data,
                counts_data_t **counters,
+               matrix_structure_t *structure,
                int size,
                int rank_vec_len,
                int type_size)
@@ -59,6 +128,30 @@ int log_counts(logger_t *logger,
     assert(logger);
     assert(calls);
     assert(counters);
+
+    counts_format_t format = get_counts_format();
+    if (format != COUNTS_FORMAT_TEXT && (ctx == SEND_CTX || ctx == RECV_CTX))
+    {
+        counts_writer_t *writer = NULL;
+        int rc = _get_counts_writer(logger, ctx, &writer);
+        if (rc)
+        {
+            fprintf(stderr, "_get_counts_writer() failed: %d\n", rc);
+            return rc;
+        }
+        if (structure != NULL)
+            rc = _add_structure_dataset(writer, startcall, endcall, count, calls, structure, type_size);
+        else
+            rc = counts_writer_add_dataset(writer, startcall, endcall, count, calls, num_counts_data, counters, size, rank_vec_len, type_size);
+        if (rc)
+        {
+            fprintf(stderr, "counts_writer_add_dataset() failed: %d\n", rc);
+            return rc;
+        }
+        if (format == COUNTS_FORMAT_BINARY)
+            return 0;
+    }
+
     switch (ctx)
     {
     case RECV_CTX:
@@ -89,26 +182,35 @@ int log_counts(logger_t *logger,
     fprintf(fh, "Number of ranks: %d\n", size);
     fprintf(fh, "Datatype size: %d\n", type_size);
     fprintf(fh, "%s calls %" PRIu64 "-%" PRIu64 "\n", logger->collective_name, startcall, endcall - 1); // endcall is one ahead so we substract 1
-    char *calls_str = compress_uint64_array(calls, count, 1);
-    fprintf(fh, "Count: %" PRIu64 " calls - %s\n", count, calls_str);
+    range_encoder_t enc;
+    fprintf(fh, "Count: %" PRIu64 " calls - ", count);
+    range_encoder_init(&enc, NULL, fh, false);
+    write_compressed_uint64_array(&enc, calls, count, 1);
+    fprintf(fh, "\n");
     fprintf(fh, "\n\nBEGINNING DATA\n");
     DEBUG_LOGGER_NOARGS("Saving counts...\n");
+    if (structure != NULL)
+    {
+        // The series of counts are not stored, only the structure of the matrix
+        fprintf(fh, "Structure: ");
+        matrix_structure_write(fh, structure);
+        fprintf(fh, "\n");
+        fprintf(fh, "END DATA\n");
+        return 0;
+    }
+
     // Save the compressed version of the data
-    int count_data_number, n;
+    int count_data_number;
     for (count_data_number = 0; count_data_number < num_counts_data; count_data_number++)
     {
         DEBUG_LOGGER("Number of ranks: %d\n", (counters[count_data_number])->num_ranks);
 
-        char *str = compress_int_array((counters[count_data_number])->ranks, (counters[count_data_number])->num_ranks, 1);
-        assert(str);
-        fprintf(fh, "Rank(s) %s: ", str);
-        free(str);
-        str = NULL;
-
-        for (n = 0; n < rank_vec_len; n++)
-        {
-            fprintf(fh, "%d ", (counters[count_data_number])->counters[n]);
-        }
+        fprintf(fh, "Rank(s) ");
+        range_encoder_init(&enc, NULL, fh, true);
+        write_compressed_int_array(&enc, (counters[count_data_number])->ranks, (counters[count_data_number])->num_ranks, 1);
+        fprintf(fh, ": ");
+        assert((counters[count_data_number])->len == rank_vec_len);
+        counts_data_write(fh, counters[count_data_number]);
         fprintf(fh, "\n");
     }
     DEBUG_LOGGER_NOARGS("Counts saved\n");
@@ -87,8 +87,11 @@ int log_displs(logger_t *logger,
     fprintf(fh, "Number of ranks: %d\n", size);
     fprintf(fh, "Datatype size: %d\n", type_size);
     fprintf(fh, "%s calls %" PRIu64 "-%" PRIu64 "\n", logger->collective_name, startcall, endcall - 1); // endcall is one ahead so we substract 1
-    char *calls_str = compress_uint64_array(calls, count, 1);
-    fprintf(fh, "Count: %" PRIu64 " calls - %s\n", count, calls_str);
+    range_encoder_t enc;
+    fprintf(fh, "Count: %" PRIu64 " calls - ", count);
+    range_encoder_init(&enc, NULL, fh, false);
+    write_compressed_uint64_array(&enc, calls, count, 1);
+    fprintf(fh, "\n");
     fprintf(fh, "\n\nBEGINNING DATA\n");
     DEBUG_LOGGER_NOARGS("Saving displacements...\n");
     // Save the compressed version of the data
@@ -97,11 +100,10 @@ int log_displs(logger_t *logger,
     {
         DEBUG_LOGGER("Number of ranks: %d\n", (counters[count_data_number])->num_ranks);
 
-        char *str = compress_int_array((displs[count_data_number])->ranks, (displs[count_data_number])->num_ranks, 1);
-        assert(str);
-        fprintf(fh, "Rank(s) %s: ", str);
-        free(str);
-        str = NULL;
+        fprintf(fh, "Rank(s) ");
+        range_encoder_init(&enc, NULL, fh, true);
+        write_compressed_int_array(&enc, (displs[count_data_number])->ranks, (displs[count_data_number])->num_ranks, 1);
+        fprintf(fh, ": ");
 
         for (n = 0; n < rank_vec_len; n++)
         {
@@ -0,0 +1,313 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "matrix_structure.h"
+
+static bool _detect_uniform(int *matrix, int size, matrix_structure_t *s)
+{
+    int i;
+    for (i = 1; i < size * size; i++)
+    {
+        if (matrix[i] != matrix[0])
+            return false;
+    }
+    s->kind = MATRIX_STRUCTURE_UNIFORM;
+    s->value = matrix[0];
+    return true;
+}
+
+// _add_offsets saves the non-zero diagonals of a band matrix, values being indexed by
+// offset - min_offset
+static bool _add_offsets(matrix_structure_t *s, int *values, int min_offset, int max_offset)
+{
+    int offset;
+    s->num_offsets = 0;
+    for (offset = min_offset; offset <= max_offset; offset++)
+    {
+        if (values[offset - min_offset] == 0)
+            continue;
+        if (s->num_offsets == MATRIX_STRUCTURE_MAX_OFFSETS)
+            return false;
+        s->offsets[s->num_offsets] = offset;
+        s->offset_values[s->num_offsets] = values[offset - min_offset];
+        s->num_offsets++;
+    }
+    return true;
+}
+
+// _detect_periodic_band checks whether the matrix is circulant, i.e., every row is the
+// first row rotated by the rank, with a few non-zero diagonals
+static bool _detect_periodic_band(int *matrix, int size, matrix_structure_t *s)
+{
+    int i, j;
+    for (i = 1; i < size; i++)
+    {
+        for (j = 0; j < size; j++)
+        {
+            if (matrix[i * size + j] != matrix[(j - i + size) % size])
+                return false;
+        }
+    }
+    if (!_add_offsets(s, matrix, 0, size - 1))
+        return false;
+    s->kind = MATRIX_STRUCTURE_BAND;
+    s->periodic = true;
+    return true;
+}
+
+// _detect_band checks whether the matrix is a Toeplitz matrix, i.e., the counts of every
+// diagonal are identical, with a few non-zero diagonals
+static bool _detect_band(int *matrix, int size, matrix_structure_t *s)
+{
+    // Value of every diagonal, from offset -(size - 1) to size - 1
+    int *diagonals = malloc((2 * size - 1) * sizeof(int));
+    int i, j;
+    bool rc = true;
+
+    assert(diagonals);
+    for (j = 0; j < size; j++)
+        diagonals[j + size - 1] = matrix[j];
+    for (i = 1; i < size; i++)
+        diagonals[size - 1 - i] = matrix[i * size];
+    for (i = 1; i < size && rc; i++)
+    {
+        for (j = 1; j < size; j++)
+        {
+            if (matrix[i * size + j] != diagonals[j - i + size - 1])
+            {
+                rc = false;
+                break;
+            }
+        }
+    }
+    if (rc)
+        rc = _add_offsets(s, diagonals, -(size - 1), size - 1);
+    free(diagonals);
+    if (!rc)
+        return false;
+    s->kind = MATRIX_STRUCTURE_BAND;
+    s->periodic = false;
+    return true;
+}
+
+static bool _detect_block_diagonal(int *matrix, int size, matrix_structure_t *s)
+{
+    int block_size = 0;
+    int i, j;
+
+    // The size of the blocks is given by the first row
+    if (matrix[0] == 0)
+        return false;
+    while (block_size < size && matrix[block_size] == matrix[0])
+        block_size++;
+    if (block_size == 1 || block_size == size || size % block_size != 0)
+        return false;
+    for (i = 0; i < size; i++)
+    {
+        for (j = 0; j < size; j++)
+        {
+            int expected = i / block_size == j / block_size ? matrix[0] : 0;
+            if (matrix[i * size + j] != expected)
+                return false;
+        }
+    }
+    s->kind = MATRIX_STRUCTURE_BLOCK_DIAGONAL;
+    s->value = matrix[0];
+    s->block_size = block_size;
+    return true;
+}
+
+static bool _detect_permutation(int *matrix, int size, matrix_structure_t *s)
+{
+    int *peers = malloc(size * sizeof(int));
+    bool *used = calloc(size, sizeof(bool));
+    int value = 0;
+    int i, j;
+
+    assert(peers);
+    assert(used);
+    for (i = 0; i < size; i++)
+    {
+        peers[i] = -1;
+        for (j = 0; j < size; j++)
+        {
+            int count = matrix[i * size + j];
+            if (count == 0)
+                continue;
+            if (value == 0)
+                value = count;
+            if (count != value || peers[i] != -1 || used[j])
+                goto not_found;
+            peers[i] = j;
+            used[j] = true;
+        }
+        if (peers[i] == -1)
+            goto not_found;
+    }
+    free(used);
+    s->kind = MATRIX_STRUCTURE_PERMUTATION;
+    s->value = value;
+    s->peers = peers;
+    return true;
+
+not_found:
+    free(peers);
+    free(used);
+    return false;
+}
+
+// matrix_structure_detect returns the structure of a count matrix, or NULL when the matrix
+// has none of the known structures or is too small for its structure to matter
+matrix_structure_t *matrix_structure_detect(int *matrix, int size)
+{
+    if (size < MATRIX_STRUCTURE_MIN_SIZE)
+        return NULL;
+
+    matrix_structure_t *s = calloc(1, sizeof(matrix_structure_t));
+    assert(s);
+    s->size = size;
+    if (_detect_uniform(matrix, size, s) ||
+        _detect_periodic_band(matrix, size, s) ||
+        _detect_band(matrix, size, s) ||
+        _detect_block_diagonal(matrix, size, s) ||
+        _detect_permutation(matrix, size, s))
+    {
+        return s;
+    }
+    free(s);
+    return NULL;
+}
+
+// matrix_structure_get_row writes the counts of a rank in counts, which has s->size elements
+void matrix_structure_get_row(matrix_structure_t *s, int rank, int *counts)
+{
+    int i;
+    if (s->kind == MATRIX_STRUCTURE_UNIFORM)
+    {
+        for (i = 0; i < s->size; i++)
+            counts[i] = s->value;
+        return;
+    }
+
+    memset(counts, 0, s->size * sizeof(int));
+    switch (s->kind)
+    {
+    case MATRIX_STRUCTURE_BAND:
+        for (i = 0; i < s->num_offsets; i++)
+        {
+            int peer = rank + s->offsets[i];
+            if (s->periodic)
+                peer = peer % s->size;
+            if (peer >= 0 && peer < s->size)
+                counts[peer] = s->offset_values[i];
+        }
+        break;
+
+    case MATRIX_STRUCTURE_BLOCK_DIAGONAL:
+        for (i = (rank / s->block_size) * s->block_size; i < (rank / s->block_size + 1) * s->block_size; i++)
+            counts[i] = s->value;
+        break;
+
+    case MATRIX_STRUCTURE_PERMUTATION:
+        counts[s->peers[rank]] = s->value;
+        break;
+
+    default:
+        break;
+    }
+}
+
+int matrix_structure_get(matrix_structure_t *s, int rank, int peer)
+{
+    int i;
+    switch (s->kind)
+    {
+    case MATRIX_STRUCTURE_UNIFORM:
+        return s->value;
+
+    case MATRIX_STRUCTURE_BAND:
+    {
+        int offset = peer - rank;
+        if (s->periodic)
+            offset = (offset + s->size) % s->size;
+        for (i = 0; i < s->num_offsets; i++)
+        {
+            if (s->offsets[i] == offset)
+                return s->offset_values[i];
+        }
+        return 0;
+    }
+
+    case MATRIX_STRUCTURE_BLOCK_DIAGONAL:
+        return rank / s->block_size == peer / s->block_size ? s->value : 0;
+
+    case MATRIX_STRUCTURE_PERMUTATION:
+        return s->peers[rank] == peer ? s->value : 0;
+    }
+    return 0;
+}
+
+// matrix_structure_match checks whether a count matrix has the structure, without storing
+// the matrix
+bool matrix_structure_match(matrix_structure_t *s, int *matrix, int size)
+{
+    int rank;
+    bool rc = true;
+
+    if (s->size != size)
+        return false;
+    int *counts = malloc(size * sizeof(int));
+    assert(counts);
+    for (rank = 0; rank < size && rc; rank++)
+    {
+        matrix_structure_get_row(s, rank, counts);
+        rc = memcmp(counts, &(matrix[rank * size]), size * sizeof(int)) == 0;
+    }
+    free(counts);
+    return rc;
+}
+
+// matrix_structure_write writes the description of a structure as in the count files, e.g.,
+// "band periodic 1:2 19:2"
+void matrix_structure_write(FILE *f, matrix_structure_t *s)
+{
+    int i;
+    switch (s->kind)
+    {
+    case MATRIX_STRUCTURE_UNIFORM:
+        fprintf(f, "uniform %d", s->value);
+        break;
+
+    case MATRIX_STRUCTURE_BAND:
+        fprintf(f, "band%s", s->periodic ? " periodic" : "");
+        for (i = 0; i < s->num_offsets; i++)
+            fprintf(f, " %d:%d", s->offsets[i], s->offset_values[i]);
+        break;
+
+    case MATRIX_STRUCTURE_BLOCK_DIAGONAL:
+        fprintf(f, "block-diagonal %d %d", s->block_size, s->value);
+        break;
+
+    case MATRIX_STRUCTURE_PERMUTATION:
+        fprintf(f, "permutation %d", s->value);
+        for (i = 0; i < s->size; i++)
+            fprintf(f, " %d", s->peers[i]);
+        break;
+    }
+}
+
+void matrix_structure_free(matrix_structure_t **s)
+{
+    if (s == NULL || *s == NULL)
+        return;
+    free((*s)->peers);
+    free(*s);
+    *s = NULL;
+}
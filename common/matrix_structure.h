@@ -0,0 +1,62 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_MATRIX_STRUCTURE_H
+#define COLLECTIVE_PROFILER_MATRIX_STRUCTURE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "collective_profiler_config.h"
+#include "common_types.h"
+
+// Maximum number of non-zero diagonals of a band matrix
+#define MATRIX_STRUCTURE_MAX_OFFSETS (8)
+
+/*
+ * Structures recognized in count matrices, where the count of rank i for peer j is
+ * matrix[i * size + j]:
+ * - uniform: all the counts are identical;
+ * - band: the count only depends on the offset j - i, and only a few offsets have a
+ *   non-zero count. Offsets are taken modulo the size of the matrix for periodic bands,
+ *   e.g., a ring exchange, and are between -(size - 1) and size - 1 otherwise;
+ * - block-diagonal: ranks are split in consecutive groups of block_size ranks and all
+ *   the counts within a group are identical, while counts between groups are zero;
+ * - permutation: every rank has a single peer with a non-zero count and every rank is the
+ *   peer of a single rank; all the non-zero counts are identical.
+ */
+typedef enum matrix_structure_kind
+{
+    MATRIX_STRUCTURE_UNIFORM = 0,
+    MATRIX_STRUCTURE_BAND,
+    MATRIX_STRUCTURE_BLOCK_DIAGONAL,
+    MATRIX_STRUCTURE_PERMUTATION,
+} matrix_structure_kind_t;
+
+typedef struct matrix_structure
+{
+    matrix_structure_kind_t kind;
+    int size;
+    int value; // Count of uniform, block-diagonal and permutation matrices
+    // Band matrices
+    bool periodic;
+    int num_offsets;
+    int offsets[MATRIX_STRUCTURE_MAX_OFFSETS];
+    int offset_values[MATRIX_STRUCTURE_MAX_OFFSETS];
+    // Block-diagonal matrices
+    int block_size;
+    // Permutation matrices: peer of every rank
+    int *peers;
+} matrix_structure_t;
+
+matrix_structure_t *matrix_structure_detect(int *matrix, int size);
+bool matrix_structure_match(matrix_structure_t *s, int *matrix, int size);
+int matrix_structure_get(matrix_structure_t *s, int rank, int peer);
+void matrix_structure_get_row(matrix_structure_t *s, int rank, int *counts);
+void matrix_structure_write(FILE *f, matrix_structure_t *s);
+void matrix_structure_free(matrix_structure_t **s);
+
+#endif // COLLECTIVE_PROFILER_MATRIX_STRUCTURE_H
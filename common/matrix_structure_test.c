@@ -0,0 +1,167 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix_structure.h"
+
+#define SIZE (32)
+#define MAX_TEXT_LEN (1024)
+
+static int matrix[SIZE * SIZE];
+
+static char *_write(matrix_structure_t *s)
+{
+    static char text[MAX_TEXT_LEN];
+    FILE *f = fmemopen(text, MAX_TEXT_LEN, "w");
+    matrix_structure_write(f, s);
+    fclose(f);
+    return text;
+}
+
+// check_structure detects the structure of the matrix and checks that the structure
+// generates the matrix back
+static int check_structure(char *name, matrix_structure_kind_t expected_kind, char *expected_text)
+{
+    matrix_structure_t *s = matrix_structure_detect(matrix, SIZE);
+    int rank, peer;
+
+    if (s == NULL || s->kind != expected_kind)
+    {
+        fprintf(stderr, "*** [ERROR] structure of the %s matrix not detected\n", name);
+        return 1;
+    }
+    if (!matrix_structure_match(s, matrix, SIZE))
+    {
+        fprintf(stderr, "*** [ERROR] the %s matrix does not match its structure\n", name);
+        return 1;
+    }
+    for (rank = 0; rank < SIZE; rank++)
+    {
+        for (peer = 0; peer < SIZE; peer++)
+        {
+            if (matrix_structure_get(s, rank, peer) != matrix[rank * SIZE + peer])
+            {
+                fprintf(stderr, "*** [ERROR] invalid count for rank %d and peer %d of the %s matrix\n", rank, peer, name);
+                return 1;
+            }
+        }
+    }
+    if (expected_text != NULL && strcmp(_write(s), expected_text) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid description of the %s matrix: \"%s\" instead of \"%s\"\n", name, _write(s), expected_text);
+        return 1;
+    }
+
+    // Any change of a count must be detected
+    matrix[5 * SIZE + 7]++;
+    if (matrix_structure_match(s, matrix, SIZE))
+    {
+        fprintf(stderr, "*** [ERROR] modified %s matrix still matches its structure\n", name);
+        return 1;
+    }
+    matrix[5 * SIZE + 7]--;
+
+    matrix_structure_free(&s);
+    fprintf(stdout, "*** %s matrix successful\n", name);
+    return 0;
+}
+
+static int matrix_structure_test(void)
+{
+    int i, j;
+
+    for (i = 0; i < SIZE * SIZE; i++)
+        matrix[i] = 3;
+    if (check_structure("uniform", MATRIX_STRUCTURE_UNIFORM, "uniform 3"))
+        return 1;
+
+    // Ring exchange
+    memset(matrix, 0, sizeof(matrix));
+    for (i = 0; i < SIZE; i++)
+    {
+        matrix[i * SIZE + (i + 1) % SIZE] = 2;
+        matrix[i * SIZE + (i + SIZE - 1) % SIZE] = 4;
+    }
+    if (check_structure("periodic band", MATRIX_STRUCTURE_BAND, "band periodic 1:2 31:4"))
+        return 1;
+
+    // Non-periodic 1D stencil: the first and last ranks only have one neighbor
+    memset(matrix, 0, sizeof(matrix));
+    for (i = 0; i < SIZE; i++)
+    {
+        matrix[i * SIZE + i] = 1;
+        if (i > 0)
+            matrix[i * SIZE + i - 1] = 5;
+        if (i < SIZE - 1)
+            matrix[i * SIZE + i + 1] = 5;
+    }
+    if (check_structure("band", MATRIX_STRUCTURE_BAND, "band -1:5 0:1 1:5"))
+        return 1;
+
+    memset(matrix, 0, sizeof(matrix));
+    for (i = 0; i < SIZE; i++)
+    {
+        for (j = 0; j < SIZE; j++)
+        {
+            if (i / 8 == j / 8)
+                matrix[i * SIZE + j] = 10;
+        }
+    }
+    if (check_structure("block-diagonal", MATRIX_STRUCTURE_BLOCK_DIAGONAL, "block-diagonal 8 10"))
+        return 1;
+
+    // Pairwise exchange between ranks i and i ^ 1, but not a band since the pairs alternate
+    memset(matrix, 0, sizeof(matrix));
+    for (i = 0; i < SIZE; i++)
+        matrix[i * SIZE + (i ^ 1)] = 7;
+    if (check_structure("permutation", MATRIX_STRUCTURE_PERMUTATION, NULL))
+        return 1;
+
+    // Irregular matrix
+    for (i = 0; i < SIZE * SIZE; i++)
+        matrix[i] = (i * 7919) % 13;
+    if (matrix_structure_detect(matrix, SIZE) != NULL)
+    {
+        fprintf(stderr, "*** [ERROR] structure detected in an irregular matrix\n");
+        return 1;
+    }
+
+    // Band with too many diagonals
+    for (i = 0; i < SIZE; i++)
+    {
+        for (j = 0; j < SIZE; j++)
+            matrix[i * SIZE + j] = (j - i + SIZE) % SIZE;
+    }
+    if (matrix_structure_detect(matrix, SIZE) != NULL)
+    {
+        fprintf(stderr, "*** [ERROR] structure detected in a dense circulant matrix\n");
+        return 1;
+    }
+
+    // Small matrices are not analyzed
+    if (matrix_structure_detect(matrix, MATRIX_STRUCTURE_MIN_SIZE - 1) != NULL)
+    {
+        fprintf(stderr, "*** [ERROR] structure detected in a small matrix\n");
+        return 1;
+    }
+    fprintf(stdout, "*** irregular matrices successful\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (matrix_structure_test())
+    {
+        fprintf(stderr, "[ERROR] matrix structure test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "matrix structure test succeeded\n");
+    return EXIT_SUCCESS;
+}
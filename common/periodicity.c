@@ -0,0 +1,165 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "periodicity.h"
+
+periodicity_detector_t *periodicity_detector_init(void)
+{
+    periodicity_detector_t *detector = calloc(1, sizeof(periodicity_detector_t));
+    assert(detector);
+    return detector;
+}
+
+static void _new_segment(periodicity_detector_t *detector, uint64_t first_call, uint64_t call, int period)
+{
+    int i;
+    if (detector->num_segments == detector->max_segments)
+    {
+        detector->max_segments = detector->max_segments == 0 ? 8 : detector->max_segments * 2;
+        detector->segments = (periodicity_segment_t *)realloc(detector->segments, detector->max_segments * sizeof(periodicity_segment_t));
+        assert(detector->segments);
+    }
+    periodicity_segment_t *s = &(detector->segments[detector->num_segments]);
+    s->first_call = first_call;
+    s->last_call = call;
+    s->period = period;
+    s->cycle = (int *)malloc(period * sizeof(int));
+    assert(s->cycle);
+    // The last period calls are still in the history
+    for (i = 0; i < period; i++)
+    {
+        uint64_t pos = detector->num_calls - period + i;
+        uint64_t c = call - period + 1 + i;
+        s->cycle[(c - first_call) % period] = detector->history[pos % PERIODICITY_MAX_PERIOD];
+    }
+    detector->num_segments++;
+    detector->in_segment = true;
+}
+
+// periodicity_add_call adds the pattern of a call; calls are expected to be consecutive and
+// a gap between two calls ends the current segment
+void periodicity_add_call(periodicity_detector_t *detector, uint64_t call, int pattern)
+{
+    int p;
+
+    if (detector->num_calls > 0 && call != detector->last_call + 1)
+    {
+        detector->num_calls = 0;
+        detector->in_segment = false;
+    }
+    for (p = 1; p <= PERIODICITY_MAX_PERIOD; p++)
+    {
+        if ((uint64_t)p <= detector->num_calls && detector->history[(detector->num_calls - p) % PERIODICITY_MAX_PERIOD] == pattern)
+            detector->runs[p]++;
+        else
+            detector->runs[p] = 0;
+    }
+    detector->history[detector->num_calls % PERIODICITY_MAX_PERIOD] = pattern;
+    detector->num_calls++;
+    detector->last_call = call;
+
+    if (detector->in_segment)
+    {
+        periodicity_segment_t *s = &(detector->segments[detector->num_segments - 1]);
+        if (detector->runs[s->period] > 0)
+        {
+            s->last_call = call;
+            return;
+        }
+        detector->in_segment = false;
+    }
+
+    for (p = 1; p <= PERIODICITY_MAX_PERIOD; p++)
+    {
+        if (detector->runs[p] >= (uint64_t)p * (PERIODICITY_MIN_REPEATS - 1))
+        {
+            // The segment cannot start before the end of the previous one
+            uint64_t first_call = call - detector->runs[p] - p + 1;
+            if (detector->num_segments > 0 && first_call <= detector->segments[detector->num_segments - 1].last_call)
+                first_call = detector->segments[detector->num_segments - 1].last_call + 1;
+            if (call - first_call + 1 < (uint64_t)p * PERIODICITY_MIN_REPEATS)
+                continue;
+            _new_segment(detector, first_call, call, p);
+            return;
+        }
+    }
+}
+
+// periodicity_lookup finds the segment of a call and the phase of the call in the cycle of
+// the segment
+bool periodicity_lookup(periodicity_detector_t *detector, uint64_t call, int *segment, int *phase)
+{
+    int low = 0, high = detector->num_segments - 1;
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+        periodicity_segment_t *s = &(detector->segments[mid]);
+        if (call < s->first_call)
+            high = mid - 1;
+        else if (call > s->last_call)
+            low = mid + 1;
+        else
+        {
+            *segment = mid;
+            *phase = (call - s->first_call) % s->period;
+            return true;
+        }
+    }
+    return false;
+}
+
+// periodicity_write writes the segments, with the calls of every pattern of a segment as
+// (period, phase, range of calls)
+void periodicity_write(FILE *f, periodicity_detector_t *detector)
+{
+    int i, j, k;
+
+    fprintf(f, "# Cycles of patterns\n");
+    for (i = 0; i < detector->num_segments; i++)
+    {
+        periodicity_segment_t *s = &(detector->segments[i]);
+        uint64_t num_calls = s->last_call - s->first_call + 1;
+        fprintf(f, "\n## Cycle #%d\n\n", i);
+        fprintf(f, "Calls: %" PRIu64 "-%" PRIu64 " (%" PRIu64 " calls)\n", s->first_call, s->last_call, num_calls);
+        fprintf(f, "Period: %d (%" PRIu64 " complete repetitions)\n", s->period, num_calls / s->period);
+        fprintf(f, "Pattern of every phase:");
+        for (j = 0; j < s->period; j++)
+            fprintf(f, " %d", s->cycle[j]);
+        fprintf(f, "\n");
+        fprintf(f, "Calls per pattern as (period, phase, calls):\n");
+        for (j = 0; j < s->period; j++)
+        {
+            // Every pattern is listed once, at its first phase
+            for (k = 0; k < j && s->cycle[k] != s->cycle[j]; k++)
+                ;
+            if (k < j)
+                continue;
+            fprintf(f, "- %d:", s->cycle[j]);
+            for (k = j; k < s->period; k++)
+            {
+                if (s->cycle[k] == s->cycle[j])
+                    fprintf(f, " (%d, %d, %" PRIu64 "-%" PRIu64 ")", s->period, k, s->first_call, s->last_call);
+            }
+            fprintf(f, "\n");
+        }
+    }
+}
+
+void periodicity_detector_free(periodicity_detector_t **detector)
+{
+    int i;
+    if (detector == NULL || *detector == NULL)
+        return;
+    for (i = 0; i < (*detector)->num_segments; i++)
+        free((*detector)->segments[i].cycle);
+    free((*detector)->segments);
+    free(*detector);
+    *detector = NULL;
+}
@@ -0,0 +1,56 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_PERIODICITY_H
+#define COLLECTIVE_PROFILER_PERIODICITY_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "collective_profiler_config.h"
+
+/*
+ * A periodic segment of calls: the pattern of call first_call + i is cycle[i % period].
+ * The calls of a pattern within the segment are therefore described by (period, phase,
+ * range of calls), i.e., every call c of the range such that (c - first_call) % period is
+ * the phase.
+ */
+typedef struct periodicity_segment
+{
+    uint64_t first_call;
+    uint64_t last_call;
+    int period;
+    int *cycle;
+} periodicity_segment_t;
+
+/*
+ * Online detection of cycles in the sequence of patterns of consecutive calls. For every
+ * candidate period p up to PERIODICITY_MAX_PERIOD, the detector tracks the number of
+ * consecutive calls whose pattern is the pattern of the call p calls earlier; a segment
+ * starts when the last PERIODICITY_MIN_REPEATS cycles of a period are identical, the
+ * smallest such period being used, and ends with the first call that breaks the cycle.
+ * Only the patterns of the last PERIODICITY_MAX_PERIOD calls are kept.
+ */
+typedef struct periodicity_detector
+{
+    uint64_t num_calls; // Number of calls since the last reset
+    uint64_t last_call;
+    int history[PERIODICITY_MAX_PERIOD]; // Patterns of the last calls, indexed by position % PERIODICITY_MAX_PERIOD
+    uint64_t runs[PERIODICITY_MAX_PERIOD + 1];
+    bool in_segment; // Whether the last segment is still open
+    int num_segments;
+    int max_segments;
+    periodicity_segment_t *segments;
+} periodicity_detector_t;
+
+periodicity_detector_t *periodicity_detector_init(void);
+void periodicity_add_call(periodicity_detector_t *detector, uint64_t call, int pattern);
+bool periodicity_lookup(periodicity_detector_t *detector, uint64_t call, int *segment, int *phase);
+void periodicity_write(FILE *f, periodicity_detector_t *detector);
+void periodicity_detector_free(periodicity_detector_t **detector);
+
+#endif // COLLECTIVE_PROFILER_PERIODICITY_H
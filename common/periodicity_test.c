@@ -0,0 +1,118 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "periodicity.h"
+
+#define MAX_TEXT_LEN (4096)
+
+static int check_segment(periodicity_detector_t *d, int idx, uint64_t first_call, uint64_t last_call, int period, int *cycle)
+{
+    if (idx >= d->num_segments)
+    {
+        fprintf(stderr, "*** [ERROR] segment %d not detected (%d segments)\n", idx, d->num_segments);
+        return 1;
+    }
+    periodicity_segment_t *s = &(d->segments[idx]);
+    if (s->first_call != first_call || s->last_call != last_call || s->period != period || memcmp(s->cycle, cycle, period * sizeof(int)) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid segment %d: calls %" PRIu64 "-%" PRIu64 " with a period of %d instead of calls %" PRIu64 "-%" PRIu64 " with a period of %d\n",
+                idx, s->first_call, s->last_call, s->period, first_call, last_call, period);
+        return 1;
+    }
+    return 0;
+}
+
+static int periodicity_test(void)
+{
+    periodicity_detector_t *d = periodicity_detector_init();
+    uint64_t call = 0;
+    int i, segment, phase;
+
+    // Calls 0-3: no cycle
+    int prefix[4] = {7, 8, 9, 7};
+    for (i = 0; i < 4; i++)
+        periodicity_add_call(d, call++, prefix[i]);
+    if (d->num_segments != 0)
+    {
+        fprintf(stderr, "*** [ERROR] cycle detected in a sequence without cycle\n");
+        return 1;
+    }
+
+    // Calls 4-33: 10 repetitions of a solver with 3 phases, the first and last phases
+    // having the same pattern
+    int cycle1[3] = {0, 1, 0};
+    for (i = 0; i < 30; i++)
+        periodicity_add_call(d, call++, cycle1[i % 3]);
+    // Calls 34-43: always the same pattern
+    int cycle2[1] = {5};
+    for (i = 0; i < 10; i++)
+        periodicity_add_call(d, call++, 5);
+    // Calls 44-59: cycle of 4 patterns, which also contains a shorter cycle
+    int cycle3[4] = {1, 2, 1, 3};
+    for (i = 0; i < 16; i++)
+        periodicity_add_call(d, call++, cycle3[i % 4]);
+
+    if (check_segment(d, 0, 4, 33, 3, cycle1) ||
+        check_segment(d, 1, 34, 43, 1, cycle2) ||
+        check_segment(d, 2, 44, 59, 4, cycle3) ||
+        d->num_segments != 3)
+        return 1;
+    fprintf(stdout, "*** detection of cycles successful\n");
+
+    if (!periodicity_lookup(d, 11, &segment, &phase) || segment != 0 || phase != 1 ||
+        !periodicity_lookup(d, 58, &segment, &phase) || segment != 2 || phase != 2 ||
+        periodicity_lookup(d, 2, &segment, &phase))
+    {
+        fprintf(stderr, "*** [ERROR] invalid phase of a call\n");
+        return 1;
+    }
+    fprintf(stdout, "*** phases successful\n");
+
+    static char text[MAX_TEXT_LEN];
+    FILE *f = fmemopen(text, MAX_TEXT_LEN, "w");
+    periodicity_write(f, d);
+    fclose(f);
+    char *expected = "## Cycle #0\n\n"
+                     "Calls: 4-33 (30 calls)\n"
+                     "Period: 3 (10 complete repetitions)\n"
+                     "Pattern of every phase: 0 1 0\n"
+                     "Calls per pattern as (period, phase, calls):\n"
+                     "- 0: (3, 0, 4-33) (3, 2, 4-33)\n"
+                     "- 1: (3, 1, 4-33)\n";
+    if (strstr(text, expected) == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] invalid description of the cycles:\n%s\n", text);
+        return 1;
+    }
+    fprintf(stdout, "*** description of the cycles successful\n");
+
+    // A gap in the calls ends the current cycle
+    call += 10;
+    for (i = 0; i < 8; i++)
+        periodicity_add_call(d, call++, 4);
+    if (check_segment(d, 2, 44, 59, 4, cycle3) || d->num_segments != 4 || d->segments[3].first_call != 70)
+        return 1;
+    fprintf(stdout, "*** gap successful\n");
+
+    periodicity_detector_free(&d);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (periodicity_test())
+    {
+        fprintf(stderr, "[ERROR] periodicity test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "periodicity test succeeded\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiling_control.h"
+
+bool profiling_on = true;
+bool profiling_control_async = false;
+int profiling_control_countdown = PROFILING_CONTROL_SYNC_INTERVAL;
+
+static int control_rank = -1;
+static char *control_file = NULL;
+static int file_state = -1; // Content of the control file at the last agreement, -1 if it did not exist
+
+// Number of signals received by the rank and number of them already applied. Only the signals
+// received by rank 0 are requests; the other ranks ignore them so a signal sent to all the ranks,
+// e.g., by mpirun, does not terminate them.
+static volatile sig_atomic_t signal_requests = 0;
+static int applied_signal_requests = 0;
+static bool signal_handler_installed = false;
+
+static void _signal_handler(int signum)
+{
+    signal_requests++;
+}
+
+// _read_control_file returns 0 if the control file disables profiling, 1 if it enables it
+// and -1 if it does not exist or is empty
+static int _read_control_file(void)
+{
+    FILE *f = fopen(control_file, "r");
+    int c;
+
+    if (f == NULL)
+        return -1;
+    c = fgetc(f);
+    fclose(f);
+    if (c == EOF)
+        return -1;
+    return c != '0';
+}
+
+// profiling_control_init reads the configuration of the controls from the environment
+int profiling_control_init(int world_rank)
+{
+    char *enabled_envvar = getenv(PROFILING_ENABLED_ENVVAR);
+    char *signal_envvar = getenv(PROFILING_CONTROL_SIGNAL_ENVVAR);
+    char *file_envvar = getenv(PROFILING_CONTROL_FILE_ENVVAR);
+
+    control_rank = world_rank;
+    profiling_on = enabled_envvar == NULL || strcmp(enabled_envvar, "0") != 0;
+    profiling_control_countdown = PROFILING_CONTROL_SYNC_INTERVAL;
+
+    if (signal_envvar != NULL && strcmp(signal_envvar, "0") != 0)
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = _signal_handler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        if (sigaction(PROFILING_CONTROL_SIGNAL, &action, NULL) != 0)
+        {
+            fprintf(stderr, "[ERROR] unable to install the handler of the profiling control signal\n");
+            return 1;
+        }
+        signal_handler_installed = true;
+        profiling_control_async = true;
+    }
+
+    if (file_envvar != NULL && file_envvar[0] != '\0')
+    {
+        control_file = strdup(file_envvar);
+        // The content of the file at startup is not a request, only its changes are
+        if (control_rank == 0)
+            file_state = _read_control_file();
+        int rc = PMPI_Bcast(&file_state, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (rc != MPI_SUCCESS)
+            return rc;
+        profiling_control_async = true;
+    }
+    return 0;
+}
+
+// profiling_control_pcontrol applies a call to MPI_Pcontrol(): level 0 disables profiling,
+// any other level enables it
+void profiling_control_pcontrol(int level)
+{
+    profiling_on = level != 0;
+}
+
+// profiling_control_sync must be called by all the ranks of MPI_COMM_WORLD to agree on the
+// signals received by rank 0 and on the content of the control file, read by rank 0
+int profiling_control_sync(void)
+{
+    int requests[2];
+    int received = signal_requests;
+
+    profiling_control_countdown = PROFILING_CONTROL_SYNC_INTERVAL;
+    requests[0] = control_rank == 0 ? received - applied_signal_requests : 0;
+    requests[1] = control_file != NULL && control_rank == 0 ? _read_control_file() : -1;
+    int rc = PMPI_Allreduce(MPI_IN_PLACE, requests, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (rc != MPI_SUCCESS)
+        return rc;
+
+    // Every signal received by rank 0 since the last agreement toggles profiling
+    if (requests[0] % 2 == 1)
+        profiling_on = !profiling_on;
+    applied_signal_requests = received;
+    if (control_file != NULL)
+    {
+        // All the ranks track the content of the file read by rank 0, so they see the same changes
+        if (requests[1] != -1 && requests[1] != file_state)
+            profiling_on = requests[1];
+        file_state = requests[1];
+    }
+    return 0;
+}
+
+int profiling_control_fini(void)
+{
+    if (signal_handler_installed)
+        signal(PROFILING_CONTROL_SIGNAL, SIG_DFL);
+    signal_handler_installed = false;
+    applied_signal_requests = signal_requests;
+    free(control_file);
+    control_file = NULL;
+    file_state = -1;
+    profiling_control_async = false;
+    profiling_on = true;
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_PROFILING_CONTROL_H
+#define COLLECTIVE_PROFILER_PROFILING_CONTROL_H
+
+#include <stdbool.h>
+#include <signal.h>
+
+#include "mpi.h"
+
+#include "collective_profiler_config.h"
+
+// Signal toggling profiling when received by rank 0, SIGUSR2 being used by the flight recorder
+#define PROFILING_CONTROL_SIGNAL SIGUSR1
+
+/*
+ * Profiling is enabled or disabled on all the ranks at the same call, otherwise the ranks
+ * profiling a call would wait for the ranks that do not. MPI_Pcontrol() is called by all
+ * the ranks at the same point of the application and takes effect immediately. Signals and
+ * the control file are asynchronous: they are only requests, applied when the ranks agree
+ * on them every PROFILING_CONTROL_SYNC_INTERVAL calls on MPI_COMM_WORLD.
+ */
+extern bool profiling_on;
+extern bool profiling_control_async;   // True when signals or a control file are used
+extern int profiling_control_countdown; // Number of calls on MPI_COMM_WORLD before the next agreement
+
+int profiling_control_init(int world_rank);
+int profiling_control_fini(void);
+void profiling_control_pcontrol(int level);
+int profiling_control_sync(void);
+
+// profiling_enabled returns false when the calls must go straight to the MPI library
+static inline bool profiling_enabled(void)
+{
+    return profiling_on;
+}
+
+// profiling_control_update must be called by all the ranks at each call of the collective,
+// whether profiling is enabled or not, so they agree on the requests at the same calls
+static inline int profiling_control_update(MPI_Comm comm)
+{
+    if (!profiling_control_async || comm != MPI_COMM_WORLD || --profiling_control_countdown > 0)
+        return 0;
+    return profiling_control_sync();
+}
+
+#endif // COLLECTIVE_PROFILER_PROFILING_CONTROL_H
@@ -0,0 +1,185 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "mpi.h"
+
+#include "profiling_control.h"
+
+static char control_file[] = "/tmp/profiling_control_testXXXXXX";
+
+static void _write_control_file(const char *content)
+{
+    FILE *f = fopen(control_file, "w");
+    fputs(content, f);
+    fclose(f);
+}
+
+// _calls simulates n calls on a communicator
+static void _calls(MPI_Comm comm, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        profiling_control_update(comm);
+}
+
+static int pcontrol_test(void)
+{
+    setenv(PROFILING_ENABLED_ENVVAR, "0", 1);
+    profiling_control_init(0);
+    if (profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] profiling enabled at startup\n");
+        return 1;
+    }
+    profiling_control_pcontrol(1);
+    if (!profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] MPI_Pcontrol(1) did not enable profiling\n");
+        return 1;
+    }
+    profiling_control_pcontrol(0);
+    if (profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] MPI_Pcontrol(0) did not disable profiling\n");
+        return 1;
+    }
+    profiling_control_fini();
+    unsetenv(PROFILING_ENABLED_ENVVAR);
+    fprintf(stdout, "*** MPI_Pcontrol successful\n");
+    return 0;
+}
+
+static int signal_test(void)
+{
+    setenv(PROFILING_CONTROL_SIGNAL_ENVVAR, "1", 1);
+    profiling_control_init(0);
+
+    // The signal is only applied when the ranks agree on it, during a call on MPI_COMM_WORLD
+    raise(PROFILING_CONTROL_SIGNAL);
+    _calls(MPI_COMM_SELF, 2 * PROFILING_CONTROL_SYNC_INTERVAL);
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL - 1);
+    if (!profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] signal applied before the agreement\n");
+        return 1;
+    }
+    _calls(MPI_COMM_WORLD, 1);
+    if (profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] signal did not disable profiling\n");
+        return 1;
+    }
+
+    raise(PROFILING_CONTROL_SIGNAL);
+    raise(PROFILING_CONTROL_SIGNAL);
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] two signals did not cancel each other\n");
+        return 1;
+    }
+    raise(PROFILING_CONTROL_SIGNAL);
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (!profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] signal did not enable profiling\n");
+        return 1;
+    }
+    profiling_control_fini();
+
+    // Only the signals received by rank 0 are requests
+    profiling_control_init(1);
+    raise(PROFILING_CONTROL_SIGNAL);
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (!profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] signal received by another rank than rank 0 applied\n");
+        return 1;
+    }
+    profiling_control_fini();
+    unsetenv(PROFILING_CONTROL_SIGNAL_ENVVAR);
+    fprintf(stdout, "*** signals successful\n");
+    return 0;
+}
+
+static int control_file_test(void)
+{
+    int fd = mkstemp(control_file);
+    if (fd == -1)
+    {
+        fprintf(stderr, "*** [ERROR] unable to create a temporary file\n");
+        return 1;
+    }
+    close(fd);
+
+    // The content of the file at startup is not a request
+    _write_control_file("0\n");
+    setenv(PROFILING_CONTROL_FILE_ENVVAR, control_file, 1);
+    profiling_control_init(0);
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (!profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] content of the control file at startup applied\n");
+        return 1;
+    }
+
+    _write_control_file("1\n");
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    profiling_control_pcontrol(0);
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] unchanged control file overrode MPI_Pcontrol\n");
+        return 1;
+    }
+    // Removing the file is not a request
+    profiling_control_pcontrol(1);
+    unlink(control_file);
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (!profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] removing the control file disabled profiling\n");
+        return 1;
+    }
+    _write_control_file("0\n");
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] control file did not disable profiling\n");
+        return 1;
+    }
+    _write_control_file("1\n");
+    _calls(MPI_COMM_WORLD, PROFILING_CONTROL_SYNC_INTERVAL);
+    if (!profiling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] control file did not enable profiling\n");
+        return 1;
+    }
+    profiling_control_fini();
+    unlink(control_file);
+    unsetenv(PROFILING_CONTROL_FILE_ENVVAR);
+    fprintf(stdout, "*** control file successful\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+    if (pcontrol_test() || signal_test() || control_file_test())
+    {
+        fprintf(stderr, "[ERROR] profiling control test failed\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "profiling control test succeeded\n");
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
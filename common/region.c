@@ -0,0 +1,242 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "region.h"
+
+// Regions are never removed so their identifiers remain valid; the region REGION_NONE is
+// the root of all the regions
+static region_t regions[REGION_MAX_REGIONS] = {{"", "(none)", -1}};
+static int num_regions = 1;
+static pthread_mutex_t regions_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool overflow_reported = false;
+
+// Stack of the regions of the thread. Regions deeper than REGION_MAX_DEPTH are only counted,
+// so they are merged with the innermost region of the stack.
+static __thread int stack[REGION_MAX_DEPTH];
+static __thread int depth = 0;
+static __thread int overflow_depth = 0;
+
+// _region_lookup returns the child of a region with a given name, creating it the first time
+static int _region_lookup(int parent, const char *name)
+{
+    int i, region = parent;
+
+    pthread_mutex_lock(&regions_lock);
+    for (i = 1; i < num_regions; i++)
+    {
+        if (regions[i].parent == parent && strcmp(regions[i].name, name) == 0)
+        {
+            region = i;
+            break;
+        }
+    }
+    if (i == num_regions && num_regions < REGION_MAX_REGIONS)
+    {
+        region_t *r = &(regions[num_regions]);
+        r->name = strdup(name);
+        assert(r->name);
+        if (parent == REGION_NONE)
+        {
+            r->path = strdup(name);
+        }
+        else
+        {
+            size_t len = strlen(regions[parent].path) + strlen(name) + 2;
+            r->path = malloc(len);
+            assert(r->path);
+            snprintf(r->path, len, "%s/%s", regions[parent].path, name);
+        }
+        assert(r->path);
+        r->parent = parent;
+        region = num_regions;
+        num_regions++;
+    }
+    else if (i == num_regions && !overflow_reported)
+    {
+        fprintf(stderr, "[WARN] more than %d regions, new regions are merged with their parent\n", REGION_MAX_REGIONS);
+        overflow_reported = true;
+    }
+    pthread_mutex_unlock(&regions_lock);
+    return region;
+}
+
+int region_begin(const char *name)
+{
+    if (depth == REGION_MAX_DEPTH)
+    {
+        overflow_depth++;
+        return 0;
+    }
+    stack[depth] = _region_lookup(region_current(), name);
+    depth++;
+    return 0;
+}
+
+// region_end ends the innermost region of the thread and returns a non-zero value if the
+// thread is not in a region
+int region_end(void)
+{
+    if (overflow_depth > 0)
+    {
+        overflow_depth--;
+        return 0;
+    }
+    if (depth == 0)
+        return 1;
+    depth--;
+    return 0;
+}
+
+int region_current(void)
+{
+    return depth == 0 ? REGION_NONE : stack[depth - 1];
+}
+
+int region_count(void)
+{
+    return num_regions;
+}
+
+const char *region_path(int region)
+{
+    return regions[region].path;
+}
+
+region_stats_t *region_get_stats(int region)
+{
+    return &(regions[region].stats);
+}
+
+// region_add_call adds a profiled call to the statistics of a region
+void region_add_call(int region, uint64_t call, double duration)
+{
+    region_stats_t *s = &(regions[region].stats);
+    double usecs = duration * 1e6;
+    int bucket = 0;
+
+    if (s->num_ranges > 0 && s->ranges[s->num_ranges - 1].last_call + 1 == call)
+    {
+        s->ranges[s->num_ranges - 1].last_call = call;
+    }
+    else
+    {
+        if (s->num_ranges == s->max_ranges)
+        {
+            s->max_ranges = s->max_ranges == 0 ? 8 : s->max_ranges * 2;
+            s->ranges = (region_range_t *)realloc(s->ranges, s->max_ranges * sizeof(region_range_t));
+            assert(s->ranges);
+        }
+        s->ranges[s->num_ranges].first_call = call;
+        s->ranges[s->num_ranges].last_call = call;
+        s->num_ranges++;
+    }
+
+    if (s->num_calls == 0 || duration < s->min_time)
+        s->min_time = duration;
+    if (s->num_calls == 0 || duration > s->max_time)
+        s->max_time = duration;
+    s->total_time += duration;
+    while (bucket < REGION_HISTOGRAM_BUCKETS - 1 && usecs >= (double)(1ULL << bucket))
+        bucket++;
+    s->histogram[bucket]++;
+    s->num_calls++;
+}
+
+// region_add_data_set adds a call with the given data set, i.e., unique counts, to a region
+void region_add_data_set(int region, int data_set)
+{
+    region_stats_t *s = &(regions[region].stats);
+
+    if (data_set >= s->num_data_sets)
+    {
+        s->data_set_calls = (uint64_t *)realloc(s->data_set_calls, (data_set + 1) * sizeof(uint64_t));
+        assert(s->data_set_calls);
+        memset(&(s->data_set_calls[s->num_data_sets]), 0, (data_set + 1 - s->num_data_sets) * sizeof(uint64_t));
+        s->num_data_sets = data_set + 1;
+    }
+    s->data_set_calls[data_set]++;
+}
+
+// region_write writes the statistics of the regions with profiled calls
+void region_write(FILE *f, const char *collective_name)
+{
+    int i, j;
+
+    fprintf(f, "# Regions of %s\n", collective_name);
+    for (i = 0; i < num_regions; i++)
+    {
+        region_stats_t *s = &(regions[i].stats);
+        if (s->num_calls == 0)
+            continue;
+
+        fprintf(f, "\n## Region %s\n\n", regions[i].path);
+        fprintf(f, "Calls: %" PRIu64 " (", s->num_calls);
+        for (j = 0; j < s->num_ranges; j++)
+        {
+            if (s->ranges[j].first_call == s->ranges[j].last_call)
+                fprintf(f, "%s%" PRIu64, j > 0 ? ", " : "", s->ranges[j].first_call);
+            else
+                fprintf(f, "%s%" PRIu64 "-%" PRIu64, j > 0 ? ", " : "", s->ranges[j].first_call, s->ranges[j].last_call);
+        }
+        fprintf(f, ")\n");
+        fprintf(f, "Time (seconds): total %f, min %f, mean %f, max %f\n", s->total_time, s->min_time, s->total_time / s->num_calls, s->max_time);
+        fprintf(f, "Calls per duration (microseconds):\n");
+        for (j = 0; j < REGION_HISTOGRAM_BUCKETS; j++)
+        {
+            if (s->histogram[j] == 0)
+                continue;
+            if (j == 0)
+                fprintf(f, "- < 1: %" PRIu64 "\n", s->histogram[j]);
+            else if (j == REGION_HISTOGRAM_BUCKETS - 1)
+                fprintf(f, "- >= %llu: %" PRIu64 "\n", 1ULL << (j - 1), s->histogram[j]);
+            else
+                fprintf(f, "- %llu-%llu: %" PRIu64 "\n", 1ULL << (j - 1), 1ULL << j, s->histogram[j]);
+        }
+        if (s->num_data_sets > 0)
+        {
+            fprintf(f, "Calls per data set:");
+            for (j = 0; j < s->num_data_sets; j++)
+            {
+                if (s->data_set_calls[j] > 0)
+                    fprintf(f, " %d (%" PRIu64 ")", j, s->data_set_calls[j]);
+            }
+            fprintf(f, "\n");
+        }
+    }
+}
+
+// region_fini releases the statistics of the regions. The regions remain interned since the
+// threads may still be in regions, e.g., when MPI_Finalize() is called within a region.
+void region_fini(void)
+{
+    int i;
+
+    pthread_mutex_lock(&regions_lock);
+    for (i = 0; i < num_regions; i++)
+    {
+        free(regions[i].stats.ranges);
+        free(regions[i].stats.data_set_calls);
+        memset(&(regions[i].stats), 0, sizeof(region_stats_t));
+    }
+    pthread_mutex_unlock(&regions_lock);
+}
+
+// Entry points of the public API, see collective_profiler.h
+void collective_profiler_region_begin(const char *name)
+{
+    region_begin(name);
+}
+
+void collective_profiler_region_end(void)
+{
+    if (region_end())
+        fprintf(stderr, "[WARN] cp_region_end() called outside of any region\n");
+}
@@ -0,0 +1,64 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_REGION_H
+#define COLLECTIVE_PROFILER_REGION_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "collective_profiler_config.h"
+
+#define REGION_NONE (0)               // Region of the calls outside of any region
+#define REGION_HISTOGRAM_BUCKETS (24) // Bucket i counts the calls of less than 2^i microseconds, the last one all the others
+
+typedef struct region_range
+{
+    uint64_t first_call;
+    uint64_t last_call;
+} region_range_t;
+
+// Statistics of the profiled calls of a region
+typedef struct region_stats
+{
+    uint64_t num_calls;
+    int num_ranges; // The calls, as ranges of consecutive calls
+    int max_ranges;
+    region_range_t *ranges;
+    double total_time; // Time spent in the calls by the rank, in seconds
+    double min_time;
+    double max_time;
+    uint64_t histogram[REGION_HISTOGRAM_BUCKETS];
+    int num_data_sets;         // Number of elements of data_set_calls
+    uint64_t *data_set_calls; // Number of calls per data set, i.e., per unique counts
+} region_stats_t;
+
+/*
+ * Regions are interned: a region is identified by its path, e.g., "timestep/solve", and
+ * the path is only looked up when a region begins. Every thread has a stack of regions and
+ * the region of a call is the innermost region of the thread calling the collective.
+ */
+typedef struct region
+{
+    char *name; // Name given to region_begin()
+    char *path; // Names of the region and of its ancestors, separated by '/'
+    int parent;
+    region_stats_t stats;
+} region_t;
+
+int region_begin(const char *name);
+int region_end(void);
+int region_current(void);
+int region_count(void);
+const char *region_path(int region);
+region_stats_t *region_get_stats(int region);
+void region_add_call(int region, uint64_t call, double duration);
+void region_add_data_set(int region, int data_set);
+void region_write(FILE *f, const char *collective_name);
+void region_fini(void);
+
+#endif // COLLECTIVE_PROFILER_REGION_H
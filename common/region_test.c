@@ -0,0 +1,132 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "collective_profiler.h"
+#include "region.h"
+
+#define MAX_TEXT_LEN (4096)
+
+static void *_thread_region(void *arg)
+{
+    int *region = (int *)arg;
+    // The regions of the main thread are not the regions of this thread
+    cp_region_begin("solve");
+    *region = region_current();
+    cp_region_end();
+    return NULL;
+}
+
+static int region_stack_test(void)
+{
+    int solve, nested_solve, thread_solve, i;
+    pthread_t thread;
+
+    cp_region_begin("solve");
+    solve = region_current();
+    cp_region_begin("timestep");
+    cp_region_begin("solve");
+    nested_solve = region_current();
+    cp_region_end();
+    if (solve == REGION_NONE || nested_solve == solve || strcmp(region_path(nested_solve), "solve/timestep/solve") != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid nested regions\n");
+        return 1;
+    }
+
+    pthread_create(&thread, NULL, _thread_region, &thread_solve);
+    pthread_join(thread, NULL);
+    if (thread_solve != solve)
+    {
+        fprintf(stderr, "*** [ERROR] region of the thread is %d instead of %d\n", thread_solve, solve);
+        return 1;
+    }
+
+    cp_region_end();
+    cp_region_end();
+    if (region_current() != REGION_NONE || region_end() == 0)
+    {
+        fprintf(stderr, "*** [ERROR] unbalanced regions\n");
+        return 1;
+    }
+
+    // Regions that are too deep are merged with the deepest region
+    for (i = 0; i < REGION_MAX_DEPTH + 2; i++)
+        region_begin("deep");
+    if (strlen(region_path(region_current())) != REGION_MAX_DEPTH * strlen("deep/") - 1)
+    {
+        fprintf(stderr, "*** [ERROR] invalid deepest region: %s\n", region_path(region_current()));
+        return 1;
+    }
+    for (i = 0; i < REGION_MAX_DEPTH + 2; i++)
+        region_end();
+    if (region_current() != REGION_NONE)
+    {
+        fprintf(stderr, "*** [ERROR] regions that are too deep are not ended\n");
+        return 1;
+    }
+    fprintf(stdout, "*** region stack successful\n");
+    return 0;
+}
+
+static int region_stats_test(void)
+{
+    static char text[MAX_TEXT_LEN];
+    uint64_t call;
+    int solve;
+
+    region_begin("solve");
+    solve = region_current();
+    region_end();
+    for (call = 0; call < 10; call++)
+    {
+        int region = call < 3 || call == 6 ? solve : REGION_NONE;
+        region_add_call(region, call, call < 3 ? 0.000003 : 0.0005);
+        region_add_data_set(region, call % 2 == 0 ? 0 : 2);
+    }
+    region_stats_t *s = region_get_stats(solve);
+    if (s->num_calls != 4 || s->num_ranges != 2 || s->histogram[2] != 3 || s->histogram[9] != 1 || s->num_data_sets != 3 ||
+        s->data_set_calls[0] != 3 || s->data_set_calls[2] != 1)
+    {
+        fprintf(stderr, "*** [ERROR] invalid statistics of the region\n");
+        return 1;
+    }
+
+    FILE *f = fmemopen(text, MAX_TEXT_LEN, "w");
+    region_write(f, "alltoallv");
+    fclose(f);
+    if (strncmp(text, "# Regions of alltoallv\n\n## Region (none)\n\nCalls: 6 (3-5, 7-9)\n", 60) != 0 ||
+        strstr(text, "## Region solve\n\nCalls: 4 (0-2, 6)\nTime (seconds): total 0.000509, min 0.000003, mean 0.000127, max 0.000500\n") == NULL ||
+        strstr(text, "- 2-4: 3\n- 256-512: 1\nCalls per data set: 0 (3) 2 (1)\n") == NULL || strstr(text, "## Region deep") != NULL)
+    {
+        fprintf(stderr, "*** [ERROR] invalid regions file:\n%s\n", text);
+        return 1;
+    }
+    region_fini();
+    if (region_get_stats(REGION_NONE)->num_calls != 0 || region_get_stats(solve)->num_ranges != 0 || strcmp(region_path(solve), "solve") != 0)
+    {
+        fprintf(stderr, "*** [ERROR] regions not released\n");
+        return 1;
+    }
+    fprintf(stdout, "*** region statistics successful\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (region_stack_test() || region_stats_test())
+    {
+        fprintf(stderr, "[ERROR] region test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "region test succeeded\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "runtime_features.h"
+#include "common_utils.h"
+
+typedef struct feature_name
+{
+    char *name;
+    unsigned int feature;
+} feature_name_t;
+
+// The names are the suffixes of the libraries providing the features
+static feature_name_t feature_names[] = {
+    {"counts", FEATURE_COUNTS},
+    {"exec_timings", FEATURE_EXEC_TIMING},
+    {"backtrace", FEATURE_BACKTRACE},
+    {"location", FEATURE_LOCATION},
+};
+
+#define NUM_FEATURE_NAMES (sizeof(feature_names) / sizeof(feature_names[0]))
+
+// features_parse parses a comma-separated list of features, e.g., "counts,exec_timings",
+// or "all". Returns a non-zero value if a feature is unknown.
+int features_parse(const char *str, unsigned int *features)
+{
+    char *list, *token, *saveptr = NULL;
+    size_t i;
+    int rc = 0;
+
+    *features = 0;
+    list = strdup(str);
+    assert(list);
+    for (token = strtok_r(list, ",", &saveptr); token != NULL; token = strtok_r(NULL, ",", &saveptr))
+    {
+        if (strcmp(token, "all") == 0)
+        {
+            *features = NUM_FEATURE_SETS - 1;
+            continue;
+        }
+        for (i = 0; i < NUM_FEATURE_NAMES; i++)
+        {
+            if (strcmp(token, feature_names[i].name) == 0)
+            {
+                *features |= feature_names[i].feature;
+                break;
+            }
+        }
+        if (i == NUM_FEATURE_NAMES)
+        {
+            fprintf(stderr, "[ERROR] unknown feature: %s\n", token);
+            rc = 1;
+        }
+    }
+    free(list);
+    return rc;
+}
+
+// features_to_str returns the comma-separated list of features, to be freed by the caller
+char *features_to_str(unsigned int features)
+{
+    char *str = malloc(MAX_STRING_LEN);
+    size_t i;
+
+    assert(str);
+    str[0] = '\0';
+    for (i = 0; i < NUM_FEATURE_NAMES; i++)
+    {
+        if (features & feature_names[i].feature)
+        {
+            if (str[0] != '\0')
+                strncat(str, ",", MAX_STRING_LEN - strlen(str) - 1);
+            strncat(str, feature_names[i].name, MAX_STRING_LEN - strlen(str) - 1);
+        }
+    }
+    return str;
+}
+
+// features_init returns the features selected with the FEATURES_ENVVAR environment
+// variable, counts by default
+int features_init(unsigned int *features)
+{
+    char *envvar = getenv(FEATURES_ENVVAR);
+    if (envvar == NULL)
+    {
+        *features = FEATURE_COUNTS;
+        return 0;
+    }
+    return features_parse(envvar, features);
+}
@@ -0,0 +1,31 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_RUNTIME_FEATURES_H
+#define COLLECTIVE_PROFILER_RUNTIME_FEATURES_H
+
+#include "collective_profiler_config.h"
+
+// Features that can be selected at runtime, with FEATURES_ENVVAR, when the profiler is
+// compiled with ENABLE_RUNTIME_FEATURES
+#define FEATURE_COUNTS (1 << 0)      // Counts are gathered and saved
+#define FEATURE_EXEC_TIMING (1 << 1) // Execution times are measured and saved
+#define FEATURE_BACKTRACE (1 << 2)   // Backtraces of the calls are saved
+#define FEATURE_LOCATION (1 << 3)    // Locations of the ranks are saved
+#define NUM_FEATURE_SETS (1 << 4)    // Number of combinations of features
+
+// Features of the libraries where they are selected at compile time. Counts are always
+// gathered, even when they are not saved.
+#define COMPILED_FEATURES (FEATURE_COUNTS |                                \
+                           (ENABLE_EXEC_TIMING ? FEATURE_EXEC_TIMING : 0) | \
+                           (ENABLE_BACKTRACE ? FEATURE_BACKTRACE : 0) |     \
+                           (ENABLE_LOCATION_TRACKING ? FEATURE_LOCATION : 0))
+
+int features_parse(const char *str, unsigned int *features);
+char *features_to_str(unsigned int features);
+int features_init(unsigned int *features);
+
+#endif // COLLECTIVE_PROFILER_RUNTIME_FEATURES_H
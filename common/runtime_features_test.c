@@ -0,0 +1,70 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "runtime_features.h"
+
+static int features_test(void)
+{
+    unsigned int features;
+    char *str;
+
+    if (features_parse("counts,location", &features) != 0 || features != (FEATURE_COUNTS | FEATURE_LOCATION))
+    {
+        fprintf(stderr, "*** [ERROR] invalid features: %u\n", features);
+        return 1;
+    }
+    if (features_parse("all", &features) != 0 || features != NUM_FEATURE_SETS - 1)
+    {
+        fprintf(stderr, "*** [ERROR] invalid features for all: %u\n", features);
+        return 1;
+    }
+    if (features_parse("counts,late_arrival", &features) == 0)
+    {
+        fprintf(stderr, "*** [ERROR] unknown feature accepted\n");
+        return 1;
+    }
+    fprintf(stdout, "*** parsing of features successful\n");
+
+    str = features_to_str(FEATURE_EXEC_TIMING | FEATURE_BACKTRACE);
+    if (strcmp(str, "exec_timings,backtrace") != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid list of features: %s\n", str);
+        free(str);
+        return 1;
+    }
+    free(str);
+
+    unsetenv(FEATURES_ENVVAR);
+    if (features_init(&features) != 0 || features != FEATURE_COUNTS)
+    {
+        fprintf(stderr, "*** [ERROR] invalid default features: %u\n", features);
+        return 1;
+    }
+    setenv(FEATURES_ENVVAR, "exec_timings", 1);
+    if (features_init(&features) != 0 || features != FEATURE_EXEC_TIMING)
+    {
+        fprintf(stderr, "*** [ERROR] invalid features from the environment: %u\n", features);
+        return 1;
+    }
+    fprintf(stdout, "*** selection of features successful\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (features_test())
+    {
+        fprintf(stderr, "[ERROR] features test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "features test succeeded\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,280 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sampling.h"
+
+// Seed of the random policy when SAMPLING_SEED_ENVVAR is not set
+#define DEFAULT_SAMPLING_SEED (0x9e3779b97f4a7c15ULL)
+
+typedef struct sampling_comm_policy
+{
+    char *name;
+    sampling_policy_t policy;
+    struct sampling_comm_policy *next;
+} sampling_comm_policy_t;
+
+bool sampling_on = false;
+
+static sampling_policy_t default_policy = {SAMPLING_ALL, 1, 1.0};
+static sampling_comm_policy_t *comm_policies = NULL;
+static uint64_t sampling_seed = DEFAULT_SAMPLING_SEED;
+static int state_keyval = MPI_KEYVAL_INVALID;
+
+// The state of the last communicator is kept so applications using a single communicator
+// never look up the attributes of the communicator
+static MPI_Comm last_comm = MPI_COMM_NULL;
+static sampling_state_t *last_state = NULL;
+
+static uint64_t _splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// _uniform returns a random number in [0, 1)
+static double _uniform(uint64_t *x)
+{
+    return (double)(_splitmix64(x) >> 11) / (double)(1ULL << 53);
+}
+
+// _fnv1a hashes len bytes, starting from the hash h
+static uint64_t _fnv1a(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// sampling_parse_policy parses a policy: "all", "every:<N>", "random:<PROBABILITY>" or
+// "adaptive:<N>". Returns a non-zero value if the policy is invalid.
+int sampling_parse_policy(const char *str, sampling_policy_t *policy)
+{
+    char *end = NULL;
+
+    policy->type = SAMPLING_ALL;
+    policy->interval = 1;
+    policy->probability = 1.0;
+    if (strcmp(str, "all") == 0)
+        return 0;
+    if (strncmp(str, "every:", 6) == 0 || strncmp(str, "adaptive:", 9) == 0)
+    {
+        bool every = str[0] == 'e';
+        long long interval = strtoll(str + (every ? 6 : 9), &end, 10);
+        if (end == str + (every ? 6 : 9) || *end != '\0' || interval <= 0)
+            return 1;
+        policy->type = every ? SAMPLING_EVERY : SAMPLING_ADAPTIVE;
+        policy->interval = interval;
+        return 0;
+    }
+    if (strncmp(str, "random:", 7) == 0)
+    {
+        double probability = strtod(str + 7, &end);
+        if (end == str + 7 || *end != '\0' || probability <= 0 || probability > 1)
+            return 1;
+        policy->type = SAMPLING_RANDOM;
+        policy->probability = probability;
+        return 0;
+    }
+    return 1;
+}
+
+void sampling_state_init(sampling_state_t *state, sampling_policy_t *policy, uint64_t seed)
+{
+    memset(state, 0, sizeof(sampling_state_t));
+    state->policy = *policy;
+    state->rng = seed;
+    state->interval = policy->interval;
+}
+
+// sampling_state_next computes the number of calls to skip after a sampled call. changed
+// is only used by the adaptive policy and tells whether the counts changed since the
+// previous sampled call.
+void sampling_state_next(sampling_state_t *state, bool changed)
+{
+    switch (state->policy.type)
+    {
+    case SAMPLING_ALL:
+        state->countdown = 0;
+        break;
+    case SAMPLING_EVERY:
+        state->countdown = state->policy.interval - 1;
+        break;
+    case SAMPLING_RANDOM:
+        // The number of calls before the next sampled call follows a geometric distribution
+        state->countdown = 0;
+        while (_uniform(&(state->rng)) >= state->policy.probability)
+            state->countdown++;
+        break;
+    case SAMPLING_ADAPTIVE:
+        if (changed)
+            state->interval = state->policy.interval;
+        else if (state->interval < SAMPLING_MAX_ADAPTIVE_INTERVAL)
+            state->interval = state->interval * 2 < SAMPLING_MAX_ADAPTIVE_INTERVAL ? state->interval * 2 : SAMPLING_MAX_ADAPTIVE_INTERVAL;
+        state->countdown = state->interval - 1;
+        break;
+    }
+}
+
+// sampling_init reads the policies from the SAMPLING_ENVVAR environment variable: a
+// comma-separated list of a default policy and of policies of named communicators, e.g.,
+// "every:10,MPI_COMM_WORLD=random:0.01"
+int sampling_init(void)
+{
+    char *policies = getenv(SAMPLING_ENVVAR);
+    char *seed = getenv(SAMPLING_SEED_ENVVAR);
+    char *str, *token, *saveptr = NULL;
+    int rc = 0;
+
+    if (policies == NULL || sampling_on)
+        return 0;
+    if (seed != NULL)
+        sampling_seed = strtoull(seed, NULL, 10);
+
+    str = strdup(policies);
+    assert(str);
+    for (token = strtok_r(str, ",", &saveptr); token != NULL; token = strtok_r(NULL, ",", &saveptr))
+    {
+        char *sep = strchr(token, '=');
+        if (sep == NULL)
+        {
+            if (sampling_parse_policy(token, &default_policy))
+            {
+                fprintf(stderr, "[ERROR] invalid sampling policy: %s\n", token);
+                rc = 1;
+            }
+            continue;
+        }
+
+        sampling_comm_policy_t *p = malloc(sizeof(sampling_comm_policy_t));
+        assert(p);
+        *sep = '\0';
+        if (sampling_parse_policy(sep + 1, &(p->policy)))
+        {
+            fprintf(stderr, "[ERROR] invalid sampling policy of %s: %s\n", token, sep + 1);
+            free(p);
+            rc = 1;
+            continue;
+        }
+        p->name = strdup(token);
+        p->next = comm_policies;
+        comm_policies = p;
+    }
+    free(str);
+    sampling_on = true;
+    return rc;
+}
+
+static int _state_delete_fn(MPI_Comm comm, int keyval, void *attr_val, void *extra_state)
+{
+    if (attr_val == last_state)
+    {
+        last_comm = MPI_COMM_NULL;
+        last_state = NULL;
+    }
+    free(attr_val);
+    return MPI_SUCCESS;
+}
+
+// sampling_lookup returns the sampling state of a communicator, creating it the first
+// time the communicator is used
+sampling_state_t *sampling_lookup(MPI_Comm comm)
+{
+    char name[MPI_MAX_OBJECT_NAME];
+    sampling_policy_t *policy = &default_policy;
+    sampling_comm_policy_t *p;
+    sampling_state_t *state = NULL;
+    int found = 0;
+    int len;
+
+    if (comm == last_comm)
+        return last_state;
+
+    if (state_keyval == MPI_KEYVAL_INVALID)
+    {
+        int rc = PMPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, _state_delete_fn, &state_keyval, NULL);
+        assert(rc == MPI_SUCCESS);
+    }
+    PMPI_Comm_get_attr(comm, state_keyval, &state, &found);
+    if (!found)
+    {
+        PMPI_Comm_get_name(comm, name, &len);
+        for (p = comm_policies; p != NULL; p = p->next)
+        {
+            if (strcmp(p->name, name) == 0)
+            {
+                policy = &(p->policy);
+                break;
+            }
+        }
+        state = malloc(sizeof(sampling_state_t));
+        assert(state);
+        // The name is part of the seed so communicators are not sampled in lockstep
+        sampling_state_init(state, policy, _fnv1a(sampling_seed, name, len));
+        PMPI_Comm_set_attr(comm, state_keyval, state);
+    }
+    last_comm = comm;
+    last_state = state;
+    return state;
+}
+
+// sampling_next must be called by all the ranks of the communicator during a sampled call,
+// to compute the number of calls to skip. With the adaptive policy, the ranks agree on
+// whether the counts of any of them changed since the previous sampled call.
+int sampling_next(sampling_state_t *state, MPI_Comm comm, const int *sendcounts, const int *recvcounts, int num_counts)
+{
+    int changed = 0;
+
+    if (state->policy.type == SAMPLING_ADAPTIVE)
+    {
+        int local_changed;
+        uint64_t signature = 0xcbf29ce484222325ULL;
+        if (sendcounts != NULL)
+            signature = _fnv1a(signature, sendcounts, num_counts * sizeof(int));
+        if (recvcounts != NULL)
+            signature = _fnv1a(signature, recvcounts, num_counts * sizeof(int));
+        local_changed = !state->has_signature || signature != state->signature;
+        state->signature = signature;
+        state->has_signature = true;
+        int rc = PMPI_Allreduce(&local_changed, &changed, 1, MPI_INT, MPI_LOR, comm);
+        if (rc != MPI_SUCCESS)
+            return rc;
+    }
+    sampling_state_next(state, changed);
+    return 0;
+}
+
+int sampling_fini(void)
+{
+    while (comm_policies != NULL)
+    {
+        sampling_comm_policy_t *next = comm_policies->next;
+        free(comm_policies->name);
+        free(comm_policies);
+        comm_policies = next;
+    }
+    // States cached on communicators are released when the communicators are freed
+    if (state_keyval != MPI_KEYVAL_INVALID)
+    {
+        PMPI_Comm_free_keyval(&state_keyval);
+        state_keyval = MPI_KEYVAL_INVALID;
+    }
+    last_comm = MPI_COMM_NULL;
+    last_state = NULL;
+    sampling_on = false;
+    return 0;
+}
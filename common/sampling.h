@@ -0,0 +1,76 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_SAMPLING_H
+#define COLLECTIVE_PROFILER_SAMPLING_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "mpi.h"
+
+#include "collective_profiler_config.h"
+
+typedef enum
+{
+    SAMPLING_ALL = 0,
+    SAMPLING_EVERY,    // Every interval-th call
+    SAMPLING_RANDOM,   // Every call with a probability
+    SAMPLING_ADAPTIVE, // Every interval-th call, the interval doubling while the counts do not change
+} sampling_policy_type_t;
+
+typedef struct sampling_policy
+{
+    sampling_policy_type_t type;
+    uint64_t interval;
+    double probability;
+} sampling_policy_t;
+
+/*
+ * Sampling state of a communicator, cached on the communicator. All the ranks of a
+ * communicator make the same decisions: they only depend on the number of calls on the
+ * communicator, the seed, the name of the communicator and, for the adaptive policy, on
+ * whether the counts of any rank changed, which is agreed on during sampled calls. The
+ * number of calls to skip before the next sampled call is computed during a sampled call,
+ * so an unsampled call only decrements the countdown.
+ */
+typedef struct sampling_state
+{
+    uint64_t countdown; // Number of calls to skip before the next sampled call
+    sampling_policy_t policy;
+    uint64_t rng;      // State of the random number generator of the communicator
+    uint64_t interval; // Current interval of the adaptive policy
+    uint64_t signature; // Signature of the counts of the rank at the last sampled call
+    bool has_signature;
+} sampling_state_t;
+
+extern bool sampling_on;
+
+int sampling_init(void);
+int sampling_fini(void);
+int sampling_parse_policy(const char *str, sampling_policy_t *policy);
+void sampling_state_init(sampling_state_t *state, sampling_policy_t *policy, uint64_t seed);
+void sampling_state_next(sampling_state_t *state, bool changed);
+sampling_state_t *sampling_lookup(MPI_Comm comm);
+int sampling_next(sampling_state_t *state, MPI_Comm comm, const int *sendcounts, const int *recvcounts, int num_counts);
+
+// sampling_enabled returns true when a sampling policy is set, i.e., when the ranks must
+// call sampling_skip_call() and sampling_next()
+static inline bool sampling_enabled(void)
+{
+    return sampling_on;
+}
+
+// sampling_skip_call returns true if the current call on the communicator is not sampled
+static inline bool sampling_skip_call(sampling_state_t *state)
+{
+    if (state->countdown == 0)
+        return false;
+    state->countdown--;
+    return true;
+}
+
+#endif // COLLECTIVE_PROFILER_SAMPLING_H
@@ -0,0 +1,151 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpi.h"
+
+#include "sampling.h"
+
+#define NUM_CALLS (10000)
+
+// _sampled_calls simulates NUM_CALLS calls and returns the number of sampled calls
+static int _sampled_calls(sampling_state_t *state, bool *sampled)
+{
+    int call, n = 0;
+    for (call = 0; call < NUM_CALLS; call++)
+    {
+        sampled[call] = !sampling_skip_call(state);
+        if (sampled[call])
+        {
+            sampling_state_next(state, false);
+            n++;
+        }
+    }
+    return n;
+}
+
+static int sampling_policies_test(void)
+{
+    static bool sampled[NUM_CALLS];
+    static bool other_sampled[NUM_CALLS];
+    sampling_policy_t policy;
+    sampling_state_t state, other_state;
+    int call, n;
+
+    if (sampling_parse_policy("every:0", &policy) == 0 || sampling_parse_policy("random:1.5", &policy) == 0 ||
+        sampling_parse_policy("adaptive:", &policy) == 0 || sampling_parse_policy("sometimes", &policy) == 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid policy accepted\n");
+        return 1;
+    }
+
+    sampling_parse_policy("every:3", &policy);
+    sampling_state_init(&state, &policy, 42);
+    n = _sampled_calls(&state, sampled);
+    for (call = 0; call < NUM_CALLS; call++)
+    {
+        if (sampled[call] != (call % 3 == 0))
+        {
+            fprintf(stderr, "*** [ERROR] call %d of every:3 wrongly sampled\n", call);
+            return 1;
+        }
+    }
+    fprintf(stdout, "*** every:3 successful (%d sampled calls)\n", n);
+
+    // Ranks with the same seed make the same decisions
+    sampling_parse_policy("random:0.25", &policy);
+    sampling_state_init(&state, &policy, 42);
+    sampling_state_init(&other_state, &policy, 42);
+    n = _sampled_calls(&state, sampled);
+    _sampled_calls(&other_state, other_sampled);
+    if (n < NUM_CALLS * 0.23 || n > NUM_CALLS * 0.27 || memcmp(sampled, other_sampled, sizeof(sampled)) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] random:0.25 sampled %d calls out of %d\n", n, NUM_CALLS);
+        return 1;
+    }
+    fprintf(stdout, "*** random:0.25 successful (%d sampled calls)\n", n);
+
+    // The interval doubles while the counts do not change and is reset when they change
+    sampling_parse_policy("adaptive:2", &policy);
+    sampling_state_init(&state, &policy, 42);
+    // The counts of the first sampled call are always new
+    uint64_t expected[] = {2, 4, 8, 2, 4};
+    for (n = 0; n < 5; n++)
+    {
+        sampling_state_next(&state, n == 0 || n == 3);
+        if (state.countdown != expected[n] - 1)
+        {
+            fprintf(stderr, "*** [ERROR] adaptive interval is %" PRIu64 " instead of %" PRIu64 "\n", state.countdown + 1, expected[n]);
+            return 1;
+        }
+    }
+    for (n = 0; n < 20; n++)
+        sampling_state_next(&state, false);
+    if (state.countdown != SAMPLING_MAX_ADAPTIVE_INTERVAL - 1)
+    {
+        fprintf(stderr, "*** [ERROR] adaptive interval not bounded: %" PRIu64 "\n", state.countdown + 1);
+        return 1;
+    }
+    fprintf(stdout, "*** adaptive:2 successful\n");
+    return 0;
+}
+
+static int sampling_comms_test(void)
+{
+    int counts[2] = {1, 2};
+    sampling_state_t *world, *self;
+
+    setenv(SAMPLING_ENVVAR, "every:4,MPI_COMM_SELF=adaptive:1", 1);
+    if (sampling_init() != 0 || !sampling_enabled())
+    {
+        fprintf(stderr, "*** [ERROR] sampling_init() failed\n");
+        return 1;
+    }
+    world = sampling_lookup(MPI_COMM_WORLD);
+    self = sampling_lookup(MPI_COMM_SELF);
+    if (world->policy.type != SAMPLING_EVERY || world->policy.interval != 4 || self->policy.type != SAMPLING_ADAPTIVE ||
+        sampling_lookup(MPI_COMM_WORLD) != world || sampling_lookup(MPI_COMM_SELF) != self)
+    {
+        fprintf(stderr, "*** [ERROR] invalid policies of the communicators\n");
+        return 1;
+    }
+
+    sampling_next(self, MPI_COMM_SELF, counts, counts, 2);
+    sampling_next(self, MPI_COMM_SELF, counts, counts, 2);
+    if (self->countdown != 1)
+    {
+        fprintf(stderr, "*** [ERROR] unchanged counts did not slow down the sampling\n");
+        return 1;
+    }
+    counts[1] = 3;
+    sampling_next(self, MPI_COMM_SELF, counts, counts, 2);
+    if (self->countdown != 0)
+    {
+        fprintf(stderr, "*** [ERROR] changed counts did not reset the sampling\n");
+        return 1;
+    }
+    sampling_fini();
+    fprintf(stdout, "*** policies of communicators successful\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+    if (sampling_policies_test() || sampling_comms_test())
+    {
+        fprintf(stderr, "[ERROR] sampling test failed\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "sampling test succeeded\n");
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "similarity.h"
+#include "format.h"
+
+#define SIMILARITY_INITIAL_TABLE_SIZE (64)
+
+// similarity_enabled checks whether the clustering of count matrices is requested with the
+// MATRIX_CLUSTERS_ENVVAR environment variable and gets the similarity threshold
+bool similarity_enabled(double *threshold)
+{
+    char *clusters_envvar = getenv(MATRIX_CLUSTERS_ENVVAR);
+    char *threshold_envvar = getenv(SIMILARITY_THRESHOLD_ENVVAR);
+
+    if (threshold != NULL)
+    {
+        *threshold = DEFAULT_SIMILARITY_THRESHOLD;
+        if (threshold_envvar != NULL && atof(threshold_envvar) > 0)
+            *threshold = atof(threshold_envvar);
+    }
+    return clusters_envvar != NULL && atoi(clusters_envvar) == 1;
+}
+
+static inline uint64_t _mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// similarity_sketch_init computes the sketch of a matrix of size x size counts. The hash
+// functions of the signature are derived from two hashes of every pair (double hashing)
+// so a pair only costs two full hashes.
+void similarity_sketch_init(similarity_sketch_t *sketch, int *matrix, int size)
+{
+    uint64_t total = 0;
+    uint64_t i;
+    int k;
+
+    for (k = 0; k < SIMILARITY_NUM_HASHES; k++)
+        sketch->minhash[k] = UINT32_MAX;
+    for (i = 0; i < (uint64_t)size * size; i++)
+    {
+        if (matrix[i] <= 0)
+            continue;
+        total += matrix[i];
+        uint64_t h1 = _mix(i);
+        uint64_t h2 = _mix(h1) | 1;
+        for (k = 0; k < SIMILARITY_NUM_HASHES; k++)
+        {
+            uint32_t h = (uint32_t)((h1 + k * h2) >> 32);
+            if (h < sketch->minhash[k])
+                sketch->minhash[k] = h;
+        }
+    }
+    sketch->volume_class = total == 0 ? -1 : 63 - __builtin_clzll(total);
+}
+
+// similarity_estimate returns the fraction of identical hashes of two signatures, an
+// estimate of the Jaccard similarity of the non-zero pairs of the two matrices
+double similarity_estimate(similarity_sketch_t *sketch1, similarity_sketch_t *sketch2)
+{
+    int k, same = 0;
+    for (k = 0; k < SIMILARITY_NUM_HASHES; k++)
+    {
+        if (sketch1->minhash[k] == sketch2->minhash[k])
+            same++;
+    }
+    return (double)same / SIMILARITY_NUM_HASHES;
+}
+
+static uint64_t _band_key(similarity_sketch_t *sketch, int band)
+{
+    uint64_t key = 0;
+    int k;
+    for (k = band * SIMILARITY_BAND_ROWS; k < (band + 1) * SIMILARITY_BAND_ROWS; k++)
+        key = _mix(key ^ sketch->minhash[k]);
+    return key;
+}
+
+static similarity_bucket_t *_new_table(int size)
+{
+    int i;
+    similarity_bucket_t *table = (similarity_bucket_t *)malloc(size * sizeof(similarity_bucket_t));
+    assert(table);
+    for (i = 0; i < size; i++)
+        table[i].cluster = -1;
+    return table;
+}
+
+static void _table_insert(similarity_bucket_t *table, int table_size, uint64_t key, int cluster)
+{
+    uint64_t slot = key & (table_size - 1);
+    while (table[slot].cluster != -1)
+        slot = (slot + 1) & (table_size - 1);
+    table[slot].key = key;
+    table[slot].cluster = cluster;
+}
+
+// _grow_tables doubles the size of the tables, which are kept at most half full
+static void _grow_tables(similarity_index_t *index)
+{
+    int band, i;
+    int new_size = index->table_size * 2;
+    for (band = 0; band < SIMILARITY_NUM_BANDS; band++)
+    {
+        similarity_bucket_t *table = _new_table(new_size);
+        for (i = 0; i < index->table_size; i++)
+        {
+            if (index->bands[band][i].cluster != -1)
+                _table_insert(table, new_size, index->bands[band][i].key, index->bands[band][i].cluster);
+        }
+        free(index->bands[band]);
+        index->bands[band] = table;
+    }
+    index->table_size = new_size;
+}
+
+similarity_index_t *similarity_index_init(double threshold)
+{
+    int band;
+    similarity_index_t *index = calloc(1, sizeof(similarity_index_t));
+    assert(index);
+    index->threshold = threshold;
+    index->table_size = SIMILARITY_INITIAL_TABLE_SIZE;
+    for (band = 0; band < SIMILARITY_NUM_BANDS; band++)
+        index->bands[band] = _new_table(index->table_size);
+    return index;
+}
+
+static void _add_matrix(similarity_cluster_t *cluster, int data_set, double similarity)
+{
+    if (cluster->num_matrices == cluster->max_matrices)
+    {
+        cluster->max_matrices = cluster->max_matrices == 0 ? 4 : cluster->max_matrices * 2;
+        cluster->data_sets = (int *)realloc(cluster->data_sets, cluster->max_matrices * sizeof(int));
+        assert(cluster->data_sets);
+    }
+    cluster->data_sets[cluster->num_matrices] = data_set;
+    cluster->num_matrices++;
+    if (similarity < cluster->min_similarity)
+        cluster->min_similarity = similarity;
+}
+
+// similarity_index_add adds a new matrix to the index and returns its cluster
+int similarity_index_add(similarity_index_t *index, similarity_sketch_t *sketch, int data_set)
+{
+    int best_cluster = -1;
+    double best_similarity = -1;
+    int band;
+
+    for (band = 0; band < SIMILARITY_NUM_BANDS; band++)
+    {
+        uint64_t key = _band_key(sketch, band);
+        uint64_t slot = key & (index->table_size - 1);
+        for (; index->bands[band][slot].cluster != -1; slot = (slot + 1) & (index->table_size - 1))
+        {
+            similarity_cluster_t *c = &(index->clusters[index->bands[band][slot].cluster]);
+            if (index->bands[band][slot].key != key || abs(c->sketch.volume_class - sketch->volume_class) > 1)
+                continue;
+            double similarity = similarity_estimate(&(c->sketch), sketch);
+            if (similarity >= index->threshold && similarity > best_similarity)
+            {
+                best_cluster = index->bands[band][slot].cluster;
+                best_similarity = similarity;
+            }
+        }
+    }
+    if (best_cluster != -1)
+    {
+        _add_matrix(&(index->clusters[best_cluster]), data_set, best_similarity);
+        return best_cluster;
+    }
+
+    // New cluster
+    if (index->num_clusters == index->max_clusters)
+    {
+        index->max_clusters = index->max_clusters == 0 ? 16 : index->max_clusters * 2;
+        index->clusters = (similarity_cluster_t *)realloc(index->clusters, index->max_clusters * sizeof(similarity_cluster_t));
+        assert(index->clusters);
+    }
+    if (2 * (index->num_clusters + 1) > index->table_size)
+        _grow_tables(index);
+    similarity_cluster_t *c = &(index->clusters[index->num_clusters]);
+    memset(c, 0, sizeof(similarity_cluster_t));
+    c->sketch = *sketch;
+    c->min_similarity = 1;
+    _add_matrix(c, data_set, 1);
+    for (band = 0; band < SIMILARITY_NUM_BANDS; band++)
+        _table_insert(index->bands[band], index->table_size, _band_key(sketch, band), index->num_clusters);
+    index->num_clusters++;
+    return index->num_clusters - 1;
+}
+
+void similarity_index_add_calls(similarity_index_t *index, int cluster, uint64_t num_calls)
+{
+    assert(cluster >= 0 && cluster < index->num_clusters);
+    index->clusters[cluster].num_calls += num_calls;
+}
+
+static similarity_index_t *_sorted_index = NULL;
+
+// Clusters are sorted by decreasing number of calls
+static int _cmp_clusters(const void *a, const void *b)
+{
+    uint64_t calls_a = _sorted_index->clusters[*(const int *)a].num_calls;
+    uint64_t calls_b = _sorted_index->clusters[*(const int *)b].num_calls;
+    if (calls_a != calls_b)
+        return calls_a < calls_b ? 1 : -1;
+    return *(const int *)a - *(const int *)b;
+}
+
+// similarity_index_write writes a summary of the clusters, the clusters with the most calls
+// first
+void similarity_index_write(FILE *f, similarity_index_t *index)
+{
+    int *order = (int *)malloc((index->num_clusters > 0 ? index->num_clusters : 1) * sizeof(int));
+    int num_matrices = 0;
+    int i;
+
+    assert(order);
+    for (i = 0; i < index->num_clusters; i++)
+    {
+        order[i] = i;
+        num_matrices += index->clusters[i].num_matrices;
+    }
+    _sorted_index = index;
+    qsort(order, index->num_clusters, sizeof(int), _cmp_clusters);
+    _sorted_index = NULL;
+
+    fprintf(f, "# Clusters of similar count matrices\n\n");
+    fprintf(f, "%d unique count matrices in %d clusters; MinHash signatures: %d hashes in %d bands; similarity threshold: %g\n",
+            num_matrices, index->num_clusters, SIMILARITY_NUM_HASHES, SIMILARITY_NUM_BANDS, index->threshold);
+    for (i = 0; i < index->num_clusters; i++)
+    {
+        similarity_cluster_t *c = &(index->clusters[order[i]]);
+        char *data_sets = compress_int_array(c->data_sets, c->num_matrices, 1);
+        fprintf(f, "\n## Cluster #%d\n\n", i);
+        fprintf(f, "Calls: %" PRIu64 "\n", c->num_calls);
+        fprintf(f, "Count matrices: %d (data sets %s)\n", c->num_matrices, data_sets);
+        fprintf(f, "Representative: data set %d\n", c->data_sets[0]);
+        fprintf(f, "Lowest estimated similarity with the representative: %.2f\n", c->min_similarity);
+        if (c->sketch.volume_class >= 0)
+            fprintf(f, "Total count of the representative: 2^%d to 2^%d\n", c->sketch.volume_class, c->sketch.volume_class + 1);
+        else
+            fprintf(f, "Total count of the representative: 0\n");
+        free(data_sets);
+    }
+    free(order);
+}
+
+void similarity_index_free(similarity_index_t **index)
+{
+    int i;
+    if (index == NULL || *index == NULL)
+        return;
+    for (i = 0; i < (*index)->num_clusters; i++)
+        free((*index)->clusters[i].data_sets);
+    free((*index)->clusters);
+    for (i = 0; i < SIMILARITY_NUM_BANDS; i++)
+        free((*index)->bands[i]);
+    free(*index);
+    *index = NULL;
+}
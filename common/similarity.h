@@ -0,0 +1,77 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_SIMILARITY_H
+#define COLLECTIVE_PROFILER_SIMILARITY_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "collective_profiler_config.h"
+
+// Number of hash functions of a MinHash signature
+#define SIMILARITY_NUM_HASHES (32)
+// The signatures are split in bands of SIMILARITY_BAND_ROWS hashes for the LSH index
+#define SIMILARITY_NUM_BANDS (8)
+#define SIMILARITY_BAND_ROWS (SIMILARITY_NUM_HASHES / SIMILARITY_NUM_BANDS)
+
+/*
+ * Sketch of a count matrix: the MinHash signature of the set of its non-zero (rank, peer)
+ * pairs, whose similarity estimates the Jaccard similarity of the communication patterns
+ * of two matrices, and the class of its total count, i.e., the floor of its log2, so
+ * matrices with similar patterns but very different volumes are not mixed up.
+ */
+typedef struct similarity_sketch
+{
+    uint32_t minhash[SIMILARITY_NUM_HASHES];
+    int volume_class; // -1 when all the counts are zero
+} similarity_sketch_t;
+
+typedef struct similarity_cluster
+{
+    similarity_sketch_t sketch; // Sketch of the first matrix of the cluster, its representative
+    double min_similarity;      // Lowest estimated similarity of a matrix of the cluster with the representative
+    int num_matrices;
+    int max_matrices;
+    int *data_sets; // Data sets of the matrices of the cluster, the first one being the representative
+    uint64_t num_calls;
+} similarity_cluster_t;
+
+typedef struct similarity_bucket
+{
+    uint64_t key;
+    int cluster; // -1 for an empty bucket
+} similarity_bucket_t;
+
+/*
+ * Online clustering of count matrices: a new matrix joins the most similar cluster whose
+ * representative has an estimated similarity of at least the threshold, and creates a new
+ * cluster otherwise. Candidate clusters are found with an LSH index: one hash table per
+ * band of the signatures, with open addressing, maps the hash of the band of the signature
+ * of every representative to its cluster, so only the clusters sharing at least one band
+ * with the new matrix are compared with it.
+ */
+typedef struct similarity_index
+{
+    double threshold;
+    int num_clusters;
+    int max_clusters;
+    similarity_cluster_t *clusters;
+    similarity_bucket_t *bands[SIMILARITY_NUM_BANDS];
+    int table_size; // Number of buckets of every table, always a power of 2
+} similarity_index_t;
+
+bool similarity_enabled(double *threshold);
+void similarity_sketch_init(similarity_sketch_t *sketch, int *matrix, int size);
+double similarity_estimate(similarity_sketch_t *sketch1, similarity_sketch_t *sketch2);
+similarity_index_t *similarity_index_init(double threshold);
+int similarity_index_add(similarity_index_t *index, similarity_sketch_t *sketch, int data_set);
+void similarity_index_add_calls(similarity_index_t *index, int cluster, uint64_t num_calls);
+void similarity_index_write(FILE *f, similarity_index_t *index);
+void similarity_index_free(similarity_index_t **index);
+
+#endif // COLLECTIVE_PROFILER_SIMILARITY_H
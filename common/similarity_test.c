@@ -0,0 +1,129 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "similarity.h"
+
+#define SIZE (64)
+#define NUM_PATTERNS (100)
+#define MAX_TEXT_LEN (65536)
+
+static int matrix[SIZE * SIZE];
+
+// _pattern generates a sparse matrix where every rank exchanges with 4 peers that depend on
+// the seed
+static void _pattern(int seed, int count)
+{
+    int rank, i;
+    memset(matrix, 0, sizeof(matrix));
+    for (rank = 0; rank < SIZE; rank++)
+    {
+        for (i = 0; i < 4; i++)
+            matrix[rank * SIZE + (rank * (seed + 3) + i * (seed + 7) * 13) % SIZE] = count;
+    }
+}
+
+static int similarity_test(void)
+{
+    similarity_sketch_t ring, ring2, dense;
+    similarity_index_t *index = similarity_index_init(DEFAULT_SIMILARITY_THRESHOLD);
+    int rank, i;
+
+    // Ring exchange
+    memset(matrix, 0, sizeof(matrix));
+    for (rank = 0; rank < SIZE; rank++)
+        matrix[rank * SIZE + (rank + 1) % SIZE] = 10;
+    similarity_sketch_init(&ring, matrix, SIZE);
+    // Same ring, a few ranks also exchange with their previous rank
+    for (rank = 0; rank < 4; rank++)
+        matrix[rank * SIZE + (rank + SIZE - 1) % SIZE] = 10;
+    similarity_sketch_init(&ring2, matrix, SIZE);
+    for (i = 0; i < SIZE * SIZE; i++)
+        matrix[i] = 1;
+    similarity_sketch_init(&dense, matrix, SIZE);
+
+    if (similarity_estimate(&ring, &ring) != 1 || similarity_estimate(&ring, &ring2) < 0.8 || similarity_estimate(&ring, &dense) > 0.2)
+    {
+        fprintf(stderr, "*** [ERROR] invalid similarity estimates: %g, %g\n", similarity_estimate(&ring, &ring2), similarity_estimate(&ring, &dense));
+        return 1;
+    }
+    fprintf(stdout, "*** similarity estimates successful\n");
+
+    if (similarity_index_add(index, &ring, 0) != 0 || similarity_index_add(index, &dense, 1) != 1 || similarity_index_add(index, &ring2, 2) != 0)
+    {
+        fprintf(stderr, "*** [ERROR] invalid clusters of the ring matrices\n");
+        return 1;
+    }
+    similarity_index_add_calls(index, 0, 2);
+    similarity_index_add_calls(index, 1, 5);
+
+    // Same pattern with a much larger volume
+    memset(matrix, 0, sizeof(matrix));
+    for (rank = 0; rank < SIZE; rank++)
+        matrix[rank * SIZE + (rank + 1) % SIZE] = 100000;
+    similarity_sketch_init(&ring2, matrix, SIZE);
+    if (similarity_index_add(index, &ring2, 3) != 2)
+    {
+        fprintf(stderr, "*** [ERROR] matrices with different volumes are in the same cluster\n");
+        return 1;
+    }
+    fprintf(stdout, "*** ring clusters successful\n");
+
+    // Many patterns, so the tables of the index grow, each of them seen twice with small
+    // changes of the counts
+    int clusters[NUM_PATTERNS];
+    for (i = 0; i < NUM_PATTERNS; i++)
+    {
+        similarity_sketch_t sketch;
+        _pattern(i, 8);
+        similarity_sketch_init(&sketch, matrix, SIZE);
+        clusters[i] = similarity_index_add(index, &sketch, 4 + i);
+    }
+    for (i = 0; i < NUM_PATTERNS; i++)
+    {
+        similarity_sketch_t sketch;
+        _pattern(i, 9);
+        similarity_sketch_init(&sketch, matrix, SIZE);
+        if (similarity_index_add(index, &sketch, 4 + NUM_PATTERNS + i) != clusters[i])
+        {
+            fprintf(stderr, "*** [ERROR] pattern %d is not in the cluster of its first occurrence\n", i);
+            return 1;
+        }
+    }
+    fprintf(stdout, "*** %d patterns in %d clusters successful\n", NUM_PATTERNS, index->num_clusters);
+
+    // The cluster with the most calls comes first
+    static char text[MAX_TEXT_LEN];
+    FILE *f = fmemopen(text, MAX_TEXT_LEN, "w");
+    similarity_index_write(f, index);
+    fclose(f);
+    char *first = strstr(text, "## Cluster #0\n\nCalls: 5\nCount matrices: 1 (data sets 1)\nRepresentative: data set 1\n");
+    char *second = strstr(text, "## Cluster #1\n\nCalls: 2\nCount matrices: 2 (data sets 0, 2)\nRepresentative: data set 0\n");
+    if (first == NULL || second == NULL)
+    {
+        fprintf(stderr, "*** [ERROR] invalid summary of the clusters:\n%s\n", text);
+        return 1;
+    }
+    fprintf(stdout, "*** summary successful\n");
+
+    similarity_index_free(&index);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (similarity_test())
+    {
+        fprintf(stderr, "[ERROR] similarity test failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "similarity test succeeded\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "timer.h"
+#include "collective_profiler_config.h"
+
+#if TIMER_HAVE_TSC
+#include <cpuid.h>
+#endif // TIMER_HAVE_TSC
+
+bool timer_use_tsc = false;
+uint64_t timer_tsc_base = 0;
+double timer_base_time = 0.0;
+double timer_seconds_per_tick = 0.0;
+
+#if TIMER_HAVE_TSC
+static inline bool _has_invariant_tsc()
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007)
+        return false;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0)
+        return false;
+    // Bit 8 of EDX reports an invariant TSC
+    return (edx & (1 << 8)) != 0;
+}
+#endif // TIMER_HAVE_TSC
+
+// timer_init selects the time source and calibrates the TSC against CLOCK_MONOTONIC_RAW
+// so both sources return times in the same time base. It is meant to be called once, while
+// initializing the profiler; until then, timer_wtime() relies on CLOCK_MONOTONIC_RAW.
+int timer_init()
+{
+    timer_use_tsc = false;
+
+#if TIMER_HAVE_TSC
+    char *disable_tsc = getenv(TIMER_DISABLE_TSC_ENVVAR);
+    if (disable_tsc != NULL && strncmp(disable_tsc, "0", 1) != 0)
+        return 0;
+
+    if (!_has_invariant_tsc())
+        return 0;
+
+    unsigned int aux;
+    double t_start = _timer_monotonic_time();
+    uint64_t ticks_start = __rdtscp(&aux);
+    double t_end;
+    uint64_t ticks_end;
+    do
+    {
+        t_end = _timer_monotonic_time();
+        ticks_end = __rdtscp(&aux);
+    } while (t_end - t_start < TIMER_CALIBRATION_TIME);
+
+    if (ticks_end <= ticks_start)
+        return 0;
+
+    timer_seconds_per_tick = (t_end - t_start) / (double)(ticks_end - ticks_start);
+    timer_tsc_base = ticks_end;
+    timer_base_time = t_end;
+    timer_use_tsc = true;
+#endif // TIMER_HAVE_TSC
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_TIMER_H
+#define COLLECTIVE_PROFILER_TIMER_H
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "mpi.h"
+
+// The time stamp counter is only used on x86_64, when the CPU reports an invariant TSC,
+// i.e., a TSC running at a constant rate regardless of the frequency and power states.
+#if defined(__x86_64__) && !defined(HAVE_MPIX_HARMONIZE)
+#define TIMER_HAVE_TSC (1)
+#include <x86intrin.h>
+#else
+#define TIMER_HAVE_TSC (0)
+#endif
+
+// Duration of the TSC calibration against CLOCK_MONOTONIC_RAW, in seconds
+#define TIMER_CALIBRATION_TIME (0.01)
+
+extern bool timer_use_tsc;
+extern uint64_t timer_tsc_base;
+extern double timer_base_time;
+extern double timer_seconds_per_tick;
+
+int timer_init();
+
+static inline double _timer_monotonic_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// timer_wtime returns the local time in seconds. It is meant to replace MPI_Wtime() in the
+// data path: the TSC is read without any system call and has a sub-nanosecond resolution.
+// When the clocks are harmonized with MPIX_Harmonize, MPI_Wtime() is used so timestamps
+// stay harmonized.
+static inline double timer_wtime()
+{
+#if defined(HAVE_MPIX_HARMONIZE)
+    return MPI_Wtime();
+#else
+#if TIMER_HAVE_TSC
+    if (timer_use_tsc)
+    {
+        unsigned int aux;
+        uint64_t ticks = __rdtscp(&aux);
+        // The TSC of the core may be slightly behind the one read by timer_init()
+        return timer_base_time + (double)(int64_t)(ticks - timer_tsc_base) * timer_seconds_per_tick;
+    }
+#endif // TIMER_HAVE_TSC
+    return _timer_monotonic_time();
+#endif // HAVE_MPIX_HARMONIZE
+}
+
+#endif // COLLECTIVE_PROFILER_TIMER_H
@@ -0,0 +1,206 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "timestamps.h"
+#include "collective_profiler_config.h"
+#include "common_utils.h"
+
+extern char *get_output_dir();
+
+static timestamps_log_t *timestamps_log = NULL;
+
+static inline timestamps_block_t *_get_block(timestamps_log_t *log)
+{
+    timestamps_block_t *block = log->free_blocks;
+    if (block != NULL)
+    {
+        log->free_blocks = block->next;
+    }
+    else
+    {
+        block = malloc(sizeof(timestamps_block_t));
+        assert(block);
+    }
+    block->count = 0;
+    block->next = NULL;
+    return block;
+}
+
+static inline int _open_timestamps_file(timestamps_log_t *log, FILE **f)
+{
+    int rc;
+
+    if (log->filename == NULL)
+    {
+        // First time we write data: create the file and write the header
+        char *output_dir = get_output_dir();
+        if (output_dir)
+        {
+            _asprintf(log->filename, rc, "%s/%s_timestamps.rank%d.bin", output_dir, log->collective_name, log->world_rank);
+        }
+        else
+        {
+            _asprintf(log->filename, rc, "%s_timestamps.rank%d.bin", log->collective_name, log->world_rank);
+        }
+        assert(rc > 0);
+
+        *f = fopen(log->filename, "w");
+        assert(*f);
+
+        timestamps_file_header_t header;
+        memcpy(header.magic, TIMESTAMPS_FILE_MAGIC, TIMESTAMPS_FILE_MAGIC_LEN);
+        header.format_version = FORMAT_VERSION;
+        header.entry_size = sizeof(timestamp_entry_t);
+        if (fwrite(&header, sizeof(header), 1, *f) != 1)
+        {
+            fprintf(stderr, "unable to write header to %s\n", log->filename);
+            fclose(*f);
+            return 1;
+        }
+        return 0;
+    }
+
+    *f = fopen(log->filename, "a");
+    assert(*f);
+    return 0;
+}
+
+// _write_blocks writes the blocks of the log to the file; when all is false, the last
+// block, which is the one currently being filled, is not written.
+static int _write_blocks(timestamps_log_t *log, bool all)
+{
+    FILE *f = NULL;
+
+    if (log->head == NULL || (!all && log->head == log->tail))
+        return 0;
+
+    int rc = _open_timestamps_file(log, &f);
+    if (rc)
+    {
+        fprintf(stderr, "_open_timestamps_file() failed: %d\n", rc);
+        return rc;
+    }
+
+    while (log->head != NULL && (all || log->head != log->tail))
+    {
+        timestamps_block_t *block = log->head;
+        if (block->count > 0 && fwrite(block->entries, sizeof(timestamp_entry_t), block->count, f) != block->count)
+        {
+            fprintf(stderr, "unable to write timestamps to %s\n", log->filename);
+            fclose(f);
+            return 1;
+        }
+        log->head = block->next;
+        log->num_blocks--;
+        block->next = log->free_blocks;
+        log->free_blocks = block;
+    }
+    if (log->head == NULL)
+        log->tail = NULL;
+
+    fclose(f);
+    return 0;
+}
+
+int timestamps_init(char *collective_name, int world_rank)
+{
+    assert(timestamps_log == NULL);
+    timestamps_log = malloc(sizeof(timestamps_log_t));
+    assert(timestamps_log);
+    timestamps_log->collective_name = strdup(collective_name);
+    timestamps_log->world_rank = world_rank;
+    timestamps_log->filename = NULL;
+    timestamps_log->num_blocks = 0;
+    timestamps_log->head = NULL;
+    timestamps_log->tail = NULL;
+    timestamps_log->free_blocks = NULL;
+
+    size_t threshold = TIMESTAMPS_DEFAULT_FLUSH_THRESHOLD;
+    char *threshold_envvar = getenv(TIMESTAMPS_FLUSH_THRESHOLD_ENVVAR);
+    if (threshold_envvar != NULL)
+        threshold = strtoull(threshold_envvar, NULL, 10);
+    timestamps_log->flush_threshold = threshold / sizeof(timestamps_block_t);
+    if (timestamps_log->flush_threshold == 0)
+        timestamps_log->flush_threshold = 1;
+
+    return 0;
+}
+
+// timestamps_add appends the timestamps of a call to the log. The cost is constant: a new
+// block is taken from the pool when the current one is full and the full blocks are written
+// to the file once they reach the size threshold.
+int timestamps_add(uint64_t call, double start, double end)
+{
+    timestamps_log_t *log = timestamps_log;
+    assert(log);
+
+    if (log->tail == NULL || log->tail->count == TIMESTAMPS_BLOCK_ENTRIES)
+    {
+        timestamps_block_t *block = _get_block(log);
+        if (log->tail == NULL)
+            log->head = block;
+        else
+            log->tail->next = block;
+        log->tail = block;
+        log->num_blocks++;
+
+        if (log->num_blocks > log->flush_threshold)
+        {
+            int rc = _write_blocks(log, false);
+            if (rc)
+            {
+                fprintf(stderr, "_write_blocks() failed: %d\n", rc);
+                return rc;
+            }
+        }
+    }
+
+    timestamp_entry_t *entry = &(log->tail->entries[log->tail->count]);
+    entry->call = call;
+    entry->start = start;
+    entry->end = end;
+    log->tail->count++;
+    return 0;
+}
+
+// timestamps_flush writes all the timestamps still in memory to the file.
+int timestamps_flush()
+{
+    if (timestamps_log == NULL)
+        return 0;
+    return _write_blocks(timestamps_log, true);
+}
+
+int timestamps_fini()
+{
+    if (timestamps_log == NULL)
+        return 0;
+
+    int rc = timestamps_flush();
+    if (rc)
+    {
+        fprintf(stderr, "timestamps_flush() failed: %d\n", rc);
+        // Do not return, we still release the memory
+    }
+
+    while (timestamps_log->free_blocks != NULL)
+    {
+        timestamps_block_t *next = timestamps_log->free_blocks->next;
+        free(timestamps_log->free_blocks);
+        timestamps_log->free_blocks = next;
+    }
+    free(timestamps_log->collective_name);
+    if (timestamps_log->filename)
+        free(timestamps_log->filename);
+    free(timestamps_log);
+    timestamps_log = NULL;
+    return 0;
+}
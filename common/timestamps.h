@@ -0,0 +1,64 @@
+/*************************************************************************
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * See LICENSE.txt for license information
+ ************************************************************************/
+
+#ifndef COLLECTIVE_PROFILER_TIMESTAMPS_H
+#define COLLECTIVE_PROFILER_TIMESTAMPS_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+// Number of entries in a block of the timestamp log
+#define TIMESTAMPS_BLOCK_ENTRIES (1024)
+
+// By default, the full blocks of the log are written to the file once they use more
+// than TIMESTAMPS_DEFAULT_FLUSH_THRESHOLD bytes
+#define TIMESTAMPS_DEFAULT_FLUSH_THRESHOLD (4 * 1024 * 1024)
+
+// Binary file layout: a header followed by all the entries, in the order of the calls
+#define TIMESTAMPS_FILE_MAGIC "CPTSTAMP"
+#define TIMESTAMPS_FILE_MAGIC_LEN (8)
+
+typedef struct timestamps_file_header
+{
+    char magic[TIMESTAMPS_FILE_MAGIC_LEN];
+    uint32_t format_version;
+    uint32_t entry_size;
+} timestamps_file_header_t;
+
+typedef struct timestamp_entry
+{
+    uint64_t call;
+    double start;
+    double end;
+} timestamp_entry_t;
+
+// timestamps_block is a fixed-size chunk of the append-only timestamp log. Blocks are
+// recycled through a pool once written to the file.
+typedef struct timestamps_block
+{
+    size_t count;
+    timestamp_entry_t entries[TIMESTAMPS_BLOCK_ENTRIES];
+    struct timestamps_block *next;
+} timestamps_block_t;
+
+typedef struct timestamps_log
+{
+    char *collective_name;
+    int world_rank;
+    char *filename;
+    size_t num_blocks; // Number of blocks in the log, not including the free ones
+    size_t flush_threshold; // Number of full blocks triggering a write to the file
+    timestamps_block_t *head;
+    timestamps_block_t *tail;
+    timestamps_block_t *free_blocks;
+} timestamps_log_t;
+
+int timestamps_init(char *collective_name, int world_rank);
+int timestamps_add(uint64_t call, double start, double end);
+int timestamps_flush();
+int timestamps_fini();
+
+#endif // COLLECTIVE_PROFILER_TIMESTAMPS_H
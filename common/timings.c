@@ -12,6 +12,7 @@
 #include "collective_profiler_config.h"
 #include "common_utils.h"
 #include "format.h"
+#include "capture.h"
 
 comm_timing_logger_t *timing_loggers_head = NULL;
 comm_timing_logger_t *timing_loggers_tail = NULL;
@@ -27,6 +28,9 @@ int init_time_tracking(MPI_Comm comm, char *collective_name, int world_rank, int
     comm_timing_logger_t *new_logger = malloc(sizeof(comm_timing_logger_t));
     assert(new_logger);
     new_logger->filename = NULL;
+    new_logger->changes_filename = NULL;
+    new_logger->changes_file_created = false;
+    changepoint_init(&(new_logger->changes));
     new_logger->next = NULL;
     new_logger->prev = NULL;
     new_logger->comm_id = comm_id;
@@ -45,6 +49,14 @@ int init_time_tracking(MPI_Comm comm, char *collective_name, int world_rank, int
     {
         _asprintf(new_logger->filename, rc, "%s_execution_times.rank%d_comm%" PRIu32 "_job%d.md", collective_name, world_rank, comm_id, jobid);
     }
+    if (output_dir)
+    {
+        _asprintf(new_logger->changes_filename, rc, "%s/%s_execution_times_changes.rank%d_comm%" PRIu32 "_job%d.md", output_dir, collective_name, world_rank, comm_id, jobid);
+    }
+    else
+    {
+        _asprintf(new_logger->changes_filename, rc, "%s_execution_times_changes.rank%d_comm%" PRIu32 "_job%d.md", collective_name, world_rank, comm_id, jobid);
+    }
 #endif // ENABLE_EXEC_TIMING
 
 #if ENABLE_LATE_ARRIVAL_TIMING
@@ -56,6 +68,14 @@ int init_time_tracking(MPI_Comm comm, char *collective_name, int world_rank, int
     {
         _asprintf(new_logger->filename, rc, "%s_late_arrival_times.rank%d_comm%" PRIu32 "_job%d.md", collective_name, world_rank, comm_id, jobid);
     }
+    if (output_dir)
+    {
+        _asprintf(new_logger->changes_filename, rc, "%s/%s_late_arrival_times_changes.rank%d_comm%" PRIu32 "_job%d.md", output_dir, collective_name, world_rank, comm_id, jobid);
+    }
+    else
+    {
+        _asprintf(new_logger->changes_filename, rc, "%s_late_arrival_times_changes.rank%d_comm%" PRIu32 "_job%d.md", collective_name, world_rank, comm_id, jobid);
+    }
 #endif // ENABLE_LATE_ARRIVAL_TIMING
     assert(rc > 0);
     assert(new_logger->filename);
@@ -120,6 +140,7 @@ int fini_time_tracking(comm_timing_logger_t **logger)
         (*logger)->fd = NULL;
     }
     free((*logger)->filename);
+    free((*logger)->changes_filename);
     free((*logger));
     *logger = NULL;
 
@@ -139,6 +160,59 @@ int release_time_loggers()
     return 0;
 }
 
+// entry_times_to_late_arrivals converts in place the synchronized entry timestamps of the ranks
+// into the time each rank would have waited for the last rank to arrive, i.e., what timing a
+// barrier placed before the collective would measure.
+void entry_times_to_late_arrivals(double *entry_times, int comm_size)
+{
+    int i;
+    double last_arrival;
+
+    assert(entry_times);
+    last_arrival = entry_times[0];
+    for (i = 1; i < comm_size; i++)
+    {
+        if (entry_times[i] > last_arrival)
+            last_arrival = entry_times[i];
+    }
+
+    for (i = 0; i < comm_size; i++)
+    {
+        entry_times[i] = last_arrival - entry_times[i];
+    }
+}
+
+// _commit_change saves a change of the timings of a communicator and selects the next calls
+// for capture when requested with the CHANGEPOINT_CAPTURE_CALLS_ENVVAR environment variable
+static int _commit_change(comm_timing_logger_t *logger, changepoint_event_t *event)
+{
+    FILE *fd;
+    if (logger->changes_filename == NULL)
+        return 0;
+
+    if (!logger->changes_file_created)
+    {
+        fd = fopen(logger->changes_filename, "w");
+        if (fd == NULL)
+            return 1;
+        FORMAT_VERSION_WRITE(fd);
+        logger->changes_file_created = true;
+    }
+    else
+    {
+        fd = fopen(logger->changes_filename, "a");
+        if (fd == NULL)
+            return 1;
+    }
+    changepoint_write_event(fd, event);
+    fclose(fd);
+
+    char *capture_calls = getenv(CHANGEPOINT_CAPTURE_CALLS_ENVVAR);
+    if (capture_calls != NULL && atoi(capture_calls) > 0)
+        capture_add_calls(event->call + 1, event->call + atoi(capture_calls));
+    return 0;
+}
+
 int commit_timings(MPI_Comm comm, char *collective_name, int world_rank, int comm_rank, int jobid, double *times, int comm_size, uint64_t n_call)
 {
     assert(times);
@@ -188,5 +262,23 @@ int commit_timings(MPI_Comm comm, char *collective_name, int world_rank, int com
     // after the each alltoallv operation.
     fclose(logger->fd);
     logger->fd = NULL;
+
+    // The timing of a call is the timing of the slowest rank
+    double slowest = times[0];
+    for (i = 1; i < comm_size; i++)
+    {
+        if (times[i] > slowest)
+            slowest = times[i];
+    }
+    changepoint_event_t event;
+    if (changepoint_add(&(logger->changes), n_call, slowest, &event))
+    {
+        rc = _commit_change(logger, &event);
+        if (rc)
+        {
+            fprintf(stderr, "_commit_change() failed: %d\n", rc);
+            return rc;
+        }
+    }
     return 0;
 }
@@ -8,13 +8,18 @@
 #define COLLECTIVE_PROFILER_TIMINGS_H
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include "mpi.h"
+#include "changepoint.h"
 
 typedef struct comm_timing_logger
 {
     uint32_t comm_id;
     FILE *fd;
     char *filename;
+    changepoint_detector_t changes; // Detection of changes of the slowest timing of the calls
+    char *changes_filename;         // File of the changes, only created when a change is detected
+    bool changes_file_created;
     struct comm_timing_logger *next;
     struct comm_timing_logger *prev;
 } comm_timing_logger_t;
@@ -22,6 +27,7 @@ typedef struct comm_timing_logger
 int init_time_tracking(MPI_Comm comm, char *collective_name, int world_rank, int comm_rank, int jobid, comm_timing_logger_t **logger);
 int fini_time_tracking(comm_timing_logger_t **logger);
 int release_time_loggers();
+void entry_times_to_late_arrivals(double *entry_times, int comm_size);
 int commit_timings(MPI_Comm comm, char *collective_name, int world_rank, int comm_rank, int jobid, double *times, int comm_size, uint64_t n_call);
 
 #endif // COLLECTIVE_PROFILER_TIMINGS_H
\ No newline at end of file
@@ -4,4 +4,4 @@
 #
 
 # Avoid duplicating the list of common objects is makefiles.
-COMMON_OBJECTS=../common/format.o ../common/comm.o ../common/backtrace.o ../common/grouping.o ../common/location.o
\ No newline at end of file
+COMMON_OBJECTS=../common/format.o ../common/counts_data.o ../common/counts_format.o ../common/comm.o ../common/backtrace.o ../common/grouping.o ../common/matrix_structure.o ../common/similarity.o ../common/periodicity.o ../common/changepoint.o ../common/flight_recorder.o ../common/sampling.o ../common/runtime_features.o ../common/profiling_control.o ../common/region.o ../common/location.o ../common/timer.o ../common/clock_sync.o ../common/timestamps.o ../common/datatype.o ../common/capture.o ../common/digest.o
\ No newline at end of file